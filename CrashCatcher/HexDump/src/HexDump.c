@@ -18,12 +18,19 @@
 #include <stdio.h>
 // #include "../../../Marlin/Configuration.h"
 #include "../../../snapmaker/lib/GD32F1/libraries/FreeRTOS1030/MapleFreeRTOS1030.h"
+#include "../../../snapmaker/debug/flight_recorder.h"
 
 
 CRASH_CATCHER_TEST_WRITEABLE CrashCatcherReturnCodes g_crashCatcherDumpEndReturn = CRASH_CATCHER_EXIT;
 static                       CrashCatcherInfo        g_info;
 // static CrashCatcherMemoryRegion mri_region[2];
 
+// Saved after the registers so the history before the fault is in the dump
+static const CrashCatcherMemoryRegion flight_recorder_region[] = {
+    {(uint32_t)&flight_recorder, (uint32_t)&flight_recorder + sizeof(flight_recorder), CRASH_CATCHER_BYTE},
+    {0xFFFFFFFF, 0xFFFFFFFF, CRASH_CATCHER_BYTE}
+};
+
 static void printString(const char* pString);
 static void waitForUserInput(void);
 static void dumpBytes(const uint8_t* pMemory, size_t elementCount);
@@ -59,7 +66,7 @@ void CrashCatcher_DumpStart(const CrashCatcherInfo* pInfo)
    If NULL is returned from this function, the core will only dump the registers. */
 const CrashCatcherMemoryRegion* CrashCatcher_GetMemoryRegions(void) {
 
-  return NULL;
+  return flight_recorder_region;
 
   // TaskHandle_t ct = xTaskGetCurrentTaskHandle();
   // mri_region[0].startAddress  = *(uint32_t *)(ct);
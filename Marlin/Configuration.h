@@ -596,6 +596,41 @@
   #endif
 #endif // PIDTEMP
 
+/**
+ * Model Predictive Control for hotends
+ *
+ * Uses a model of each hotend's heat capacity, heater power and losses to
+ * ambient, and feeds forward the extrusion rate and part fan speed, instead of
+ * waiting for a temperature error as PID does.
+ * Each hotend picks PID or MPC at runtime with M306 E<hotend> M<0|1>.
+ * Tune with M306 E<hotend> T and keep the result with M500, or apply the
+ * reported values here.
+ */
+#define MPCTEMP
+#if ENABLED(MPCTEMP)
+  //#define MPC_DEFAULT_ENABLED                       // Start with MPC instead of PID on every hotend
+  #define MPC_MAX BANG_MAX                            // (0..255) Current to nozzle while MPC is active.
+  #define MPC_HEATER_POWER { 40.0f, 40.0f }           // (W) Heat cartridge powers.
+
+  #define MPC_INCLUDE_FAN                             // Model the part fan speed of each hotend.
+
+  // Measured physical constants from M306
+  #define MPC_BLOCK_HEAT_CAPACITY { 16.7f, 16.7f }    // (J/K) Heat block heat capacities.
+  #define MPC_SENSOR_RESPONSIVENESS { 0.22f, 0.22f }  // (K/s per ∆K) Rate of change of sensor temperature from heat block.
+  #define MPC_AMBIENT_XFER_COEFF { 0.068f, 0.068f }   // (W/K) Heat transfer coefficients from heat block to room air with fan off.
+  #if ENABLED(MPC_INCLUDE_FAN)
+    #define MPC_AMBIENT_XFER_COEFF_FAN255 { 0.097f, 0.097f } // (W/K) Heat transfer coefficients with fan on full.
+  #endif
+
+  // For 1.75mm filament at ~1.8 J/g/K: 0.0056 J/K/mm
+  #define FILAMENT_HEAT_CAPACITY_PERMM { 5.6e-3f, 5.6e-3f } // (J/K/mm) Heat capacity per mm of filament.
+
+  // Advanced options
+  #define MPC_SMOOTHING_FACTOR 0.5f                   // (0.0...1.0) Noisy temperature sensors may need a lower value for stabilization.
+  #define MPC_MIN_AMBIENT_CHANGE 1.0f                 // (K/s) Modeled ambient temperature rate of change, when correcting model inaccuracies.
+  #define MPC_STEADYSTATE 0.5f                        // (K/s) Temperature change rate for steady state logic to be enforced.
+#endif
+
 //===========================================================================
 //====================== PID > Bed Temperature Control ======================
 //===========================================================================
@@ -998,6 +1033,59 @@
  */
 // #define S_CURVE_ACCELERATION
 
+/**
+ * S-Curve ramps for the input shaper motion path
+ *
+ * The shaper MoveQueue replaces each acceleration and deceleration ramp with
+ * a run of constant-acceleration steps that follow a smoothstep velocity curve.
+ * Acceleration rises and falls in steps instead of jumping to its full value,
+ * but the profile is neither jerk-limited nor a true cubic S-curve. The
+ * steepest step is 1.375x the mean acceleration of the ramp with 4 steps (at
+ * most 1.48x for other counts), so blocks that get the steps ramp at the
+ * planned acceleration divided by that ratio and take correspondingly longer.
+ * Blocks that can't, such as those braking at the full planned rate, stay
+ * trapezoidal at their planned acceleration.
+ */
+//#define SHAPER_S_CURVE
+#if ENABLED(SHAPER_S_CURVE)
+  #define SHAPER_S_CURVE_SEGMENTS       4   // Constant-acceleration steps per ramp
+  #define SHAPER_S_CURVE_MIN_RAMP_TIME  5   // (ms) Shorter ramps stay trapezoidal
+#endif
+
+/**
+ * Input shaper acceleration limit
+ *
+ * Every input shaper smooths the printed path, the more the lower its frequency
+ * and the higher the acceleration. For the configured shaper the firmware works
+ * out the smoothing and the highest X/Y acceleration that keeps it under
+ * SHAPER_TARGET_SMOOTHING, and reports both with M593 I and over SACP.
+ * With this option the planner also holds every block to that acceleration.
+ * M593 L<bool> switches the limit at runtime.
+ */
+//#define SHAPER_ACCEL_LIMIT
+#define SHAPER_TARGET_SMOOTHING   0.12  // (mm)
+#define SHAPER_SMOOTHING_ACCEL    5000  // (mm/s^2) Acceleration the reported smoothing is taken at
+#define SHAPER_SMOOTHING_SCV      5     // (mm/s) Corner velocity of the smoothing estimate
+#define SHAPER_MIN_ACCEL          500   // (mm/s^2) The limit never goes below this
+
+/**
+ * Z mesh compensation in the input shaper pipeline
+ *
+ * The bed height of a measured grid is added to Z while its step functions
+ * are generated, bilinear per cell along each move. Unlike the leveling
+ * systems below, moves are never split at grid lines and XY moves stay one
+ * planner block each.
+ *
+ * M421 I J Z sets a grid point, M420 S<bool> turns the mesh on or off,
+ * M420 V reports it. G28 turns it off.
+ */
+#define SHAPER_Z_MESH
+#if ENABLED(SHAPER_Z_MESH)
+  #define Z_MESH_GRID_X   5
+  #define Z_MESH_GRID_Y   5
+  #define Z_MESH_INSET    10    // (mm) Distance of the outer grid points from the bed edges
+#endif
+
 //===========================================================================
 //============================= Z Probe Options =============================
 //===========================================================================
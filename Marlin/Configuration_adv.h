@@ -2017,6 +2017,12 @@
 #define ARC_SUPPORT                 // Disable this feature to save ~3226 bytes
 #if ENABLED(ARC_SUPPORT)
   #define MM_PER_ARC_SEGMENT      1 // (mm) Length (or minimum length) of each arc segment
+  #define ARC_CHORD_TOLERANCE  0.01 // (mm) Size segments so no chord strays further than this from the arc. Replaces MM_PER_ARC_SEGMENT.
+  #ifdef ARC_CHORD_TOLERANCE
+    #define MIN_ARC_SEGMENT_MM  0.2 // (mm) Shortest segment for tight arcs
+    #define MAX_ARC_SEGMENT_MM    5 // (mm) Longest segment for wide arcs
+    #define ARC_LOW_BUFFER_SEGMENTS_PER_SEC 80 // Segment rate limit while the planner is under half full
+  #endif
   //#define ARC_SEGMENTS_PER_R    1 // Max segment length, MM_PER = Min
   #define MIN_ARC_SEGMENTS       24 // Minimum number of segments in a complete circle
   //#define ARC_SEGMENTS_PER_SEC 50 // Use feedrate to choose segment length (with MM_PER_ARC_SEGMENT as the minimum)
@@ -2122,12 +2128,33 @@
 // @section serial
 
 // The ASCII buffer for serial input
+// Queued commands are packed back-to-back into CMD_ARENA_SIZE bytes, so
+// BUFSIZE is the maximum number of queued commands, not their storage.
+// HMI and serial lines take only their own length, SD lines reserve
+// MAX_CMD_SIZE while they are read, so CMD_ARENA_SIZE must hold at least
+// two commands of MAX_CMD_SIZE.
+// 8 index entries (12 bytes each) and 320 bytes take the same 416 bytes of
+// RAM as the former 4 fixed slots, plus one MAX_CMD_SIZE line held for the
+// HMI. They hold 8 typical sliced moves at any arena offset, which covers a
+// host round trip of about 10ms at 0.2mm segments and 150mm/s.
+// Deeper queues cost 12 bytes per entry plus arena, mind the FreeRTOS heap.
 #define MAX_CMD_SIZE 96
-#define BUFSIZE 4
+#define BUFSIZE 8
+#define CMD_ARENA_SIZE 320
 
 #define AXIS_SIZE 4
 #define SHAPED_WAITING_MIN_TIME 20
 
+// Receive firmware updates into the second flash bank while the printer keeps
+// running, the reboot then only swaps the image in. Needs a bootloader that
+// copies an image marked STAGED (0xAA07), the stock one does not.
+//#define UPDATE_STAGE_IMAGE
+#if ENABLED(UPDATE_STAGE_IMAGE)
+  // Accept heatshrink-compressed frames when staging a firmware update over SACP.
+  // Frames are made by snapmaker/scripts/gen_header.py --compress
+  #define UPDATE_STAGE_COMPRESSION
+#endif
+
 // Transmission to Host Buffer Size
 // To save 386 bytes of PROGMEM (and TX_BUFFER_SIZE+3 bytes of RAM) set to 0.
 // To buffer a simple "ok" you need 4 bytes.
@@ -3799,7 +3826,7 @@
  *
  * Implement M486 to allow Marlin to skip objects
  */
-//#define CANCEL_OBJECTS
+#define CANCEL_OBJECTS
 #if ENABLED(CANCEL_OBJECTS)
   #define CANCEL_OBJECTS_REPORTING // Emit the current object as a status message
 #endif
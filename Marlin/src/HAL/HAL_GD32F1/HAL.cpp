@@ -32,6 +32,7 @@
 // --------------------------------------------------------------------------
 
 #include "HAL.h"
+#include "HAL_adc_filter_STM32F1.h"
 #include <STM32ADC.h>
 #include "../../inc/MarlinConfig.h"
 
@@ -133,6 +134,12 @@ uint8_t adc_pins[] = {
   #if ENABLED(FILAMENT_WIDTH_SENSOR)
     FILWIDTH_PIN,
   #endif
+  #if PIN_EXISTS(FILAMENT0_ADC)
+    FILAMENT0_ADC_PIN,
+  #endif
+  #if PIN_EXISTS(FILAMENT1_ADC)
+    FILAMENT1_ADC_PIN,
+  #endif
 };
 
 enum TEMP_PINS : char {
@@ -162,11 +169,28 @@ enum TEMP_PINS : char {
   #endif
   #if ENABLED(FILAMENT_WIDTH_SENSOR)
     FILWIDTH,
+  #endif
+  #if PIN_EXISTS(FILAMENT0_ADC)
+    FILAMENT0_ADC,
+  #endif
+  #if PIN_EXISTS(FILAMENT1_ADC)
+    FILAMENT1_ADC,
   #endif
     ADC_PIN_COUNT
 };
 
-uint16_t HAL_adc_results[ADC_PIN_COUNT];
+/**
+ * ADC1 scans every pin continuously into a circular DMA buffer of two halves.
+ * The half and full transfer interrupts add each finished half to the
+ * filter, which publishes the block average every 64 scans.
+ */
+#define ADC_DMA_HALF_SCANS  16
+#define ADC_FILTER_HALVES    4
+#define ADC_FILTER_LOG2      6
+
+static uint16_t adc_dma_buf[2 * ADC_DMA_HALF_SCANS * ADC_PIN_COUNT];
+static ADCBlockFilter<ADC_PIN_COUNT, ADC_DMA_HALF_SCANS, ADC_FILTER_HALVES, ADC_FILTER_LOG2, HAL_ADC_FILTER_FRAC> adc_filter;
+volatile uint32_t HAL_adc_sequence;
 
 
 // --------------------------------------------------------------------------
@@ -267,54 +291,80 @@ extern "C" {
 // --------------------------------------------------------------------------
 // ADC
 // --------------------------------------------------------------------------
+static void adc_dma_isr() {
+  const uint16_t *buf = adc_dma_buf;
+  switch (dma_get_irq_cause(DMA1, DMA_CH1)) {
+    case DMA_TRANSFER_HALF_COMPLETE: break;
+    case DMA_TRANSFER_COMPLETE: buf += adc_filter.half_len; break;
+    default: return;
+  }
+  if (adc_filter.add_half(buf)) HAL_adc_sequence++;
+}
+
 // Init the AD in continuous capture mode
 void HAL_adc_init(void) {
   // configure the ADC
   adc.calibrate();
-  adc.setSampleRate(ADC_SMPR_41_5); // ?
+  adc.setSampleRate(ADC_SMPR_239_5); // Settle fully through the thermistor dividers; the filter sets the bandwidth
   adc.setPins(adc_pins, ADC_PIN_COUNT);
-  adc.setDMA(HAL_adc_results, (uint16_t)ADC_PIN_COUNT, (uint32_t)(DMA_MINC_MODE | DMA_CIRC_MODE), (void (*)())NULL);
+  adc.setDMA(adc_dma_buf, (uint16_t)COUNT(adc_dma_buf), (uint32_t)(DMA_MINC_MODE | DMA_CIRC_MODE | DMA_HALF_TRNS | DMA_TRNS_CMPLT), adc_dma_isr);
   adc.setScanMode();
   adc.setContinuous();
   adc.startConversion();
 }
 
-void HAL_adc_start_conversion(const uint8_t adc_pin) {
-  TEMP_PINS pin_index = TEMP_0;
+static int8_t adc_pin_index(const uint8_t adc_pin) {
   switch (adc_pin) {
     #if HAS_TEMP_ADC_0
-      case TEMP_0_PIN: pin_index = TEMP_0; break;
+      case TEMP_0_PIN: return TEMP_0;
     #endif
     #if HAS_HEATED_BED
-      case TEMP_BED_PIN: pin_index = TEMP_BED; break;
+      case TEMP_BED_PIN: return TEMP_BED;
     #endif
     #if HAS_HEATED_CHAMBER
-      case TEMP_CHAMBER_PIN: pin_index = TEMP_CHAMBER; break;
+      case TEMP_CHAMBER_PIN: return TEMP_CHAMBER;
     #endif
     #if HAS_TEMP_ADC_1
-      case TEMP_1_PIN: pin_index = TEMP_1; break;
+      case TEMP_1_PIN: return TEMP_1;
     #endif
     #if HAS_TEMP_ADC_2
-      case TEMP_2_PIN: pin_index = TEMP_2; break;
+      case TEMP_2_PIN: return TEMP_2;
     #endif
     #if HAS_TEMP_ADC_3
-      case TEMP_3_PIN: pin_index = TEMP_3; break;
+      case TEMP_3_PIN: return TEMP_3;
     #endif
     #if HAS_TEMP_ADC_4
-      case TEMP_4_PIN: pin_index = TEMP_4; break;
+      case TEMP_4_PIN: return TEMP_4;
     #endif
     #if HAS_TEMP_ADC_5
-      case TEMP_5_PIN: pin_index = TEMP_5; break;
+      case TEMP_5_PIN: return TEMP_5;
     #endif
     #if ENABLED(FILAMENT_WIDTH_SENSOR)
-      case FILWIDTH_PIN: pin_index = FILWIDTH; break;
+      case FILWIDTH_PIN: return FILWIDTH;
+    #endif
+    #if PIN_EXISTS(FILAMENT0_ADC)
+      case FILAMENT0_ADC_PIN: return FILAMENT0_ADC;
+    #endif
+    #if PIN_EXISTS(FILAMENT1_ADC)
+      case FILAMENT1_ADC_PIN: return FILAMENT1_ADC;
     #endif
   }
-  HAL_adc_result = HAL_adc_results[(int)pin_index] & 0xFFF;
-  if (adc_pin == TEMP_BED_PIN || adc_pin == TEMP_CHAMBER_PIN) {
-    HAL_adc_result = HAL_adc_result >> 2;  // shift to get 10 bits only.
-  }
+  return -1;
+}
 
+const uint16_t* HAL_adc_snapshot() { return adc_filter.snapshot(); }
+
+uint16_t HAL_adc_filtered(const uint8_t adc_pin, const uint16_t *snapshot) {
+  const int8_t i = adc_pin_index(adc_pin);
+  if (i < 0) return 0;
+  uint16_t v = snapshot[i];
+  if (adc_pin == TEMP_BED_PIN || adc_pin == TEMP_CHAMBER_PIN)
+    v >>= 2;  // shift to get 10 bits only.
+  return v;
+}
+
+void HAL_adc_start_conversion(const uint8_t adc_pin) {
+  HAL_adc_result = HAL_adc_filtered(adc_pin) >> HAL_ADC_FILTER_FRAC;
 }
 
 uint16_t HAL_adc_get_result(void) {
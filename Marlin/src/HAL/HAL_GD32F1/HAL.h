@@ -290,6 +290,20 @@ void HAL_adc_start_conversion(const uint8_t adc_pin);
 
 uint16_t HAL_adc_get_result(void);
 
+// All channels are scanned by DMA and block-averaged in the DMA interrupt
+#define HAL_ADC_FILTERED
+#define HAL_ADC_FILTER_FRAC 4 // Fraction bits kept in filtered values
+
+// Increments each time a new set of filtered values is published
+extern volatile uint32_t HAL_adc_sequence;
+
+// The latest filtered values, whole until the block after next is published
+const uint16_t* HAL_adc_snapshot();
+
+// Filtered value of an ADC pin, scaled by _BV(HAL_ADC_FILTER_FRAC). Take the
+// snapshot once to read several pins from the same block.
+uint16_t HAL_adc_filtered(const uint8_t adc_pin, const uint16_t *snapshot=HAL_adc_snapshot());
+
 /* Todo: Confirm none of this is needed.
 uint16_t HAL_getAdcReading(uint8_t chan);
 
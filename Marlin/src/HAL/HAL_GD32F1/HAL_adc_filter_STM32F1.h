@@ -0,0 +1,65 @@
+/**
+ * Marlin 3D Printer Firmware
+ * Copyright (c) 2020 MarlinFirmware [https://github.com/MarlinFirmware/Marlin]
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Block average of a scanned set of ADC pins, fed one DMA half at a time.
+ * Every HALVES halves the sum of each pin is published, keeping FRAC
+ * fraction bits, into the idle one of two snapshots.
+ *
+ * A snapshot taken with snapshot() stays whole until the block after next
+ * is published, so a reader that takes it once per pass gets every pin
+ * from the same block.
+ */
+template<uint8_t PINS, uint8_t HALF_SCANS, uint8_t HALVES, uint8_t LOG2, uint8_t FRAC>
+class ADCBlockFilter {
+  static_assert(HALF_SCANS * HALVES == 1 << LOG2, "HALF_SCANS * HALVES must be 2^LOG2.");
+  static_assert(LOG2 >= FRAC, "FRAC exceeds the filter gain.");
+
+  public:
+    static constexpr uint16_t half_len = HALF_SCANS * PINS;
+
+    // A finished half of the DMA buffer, pins interleaved. Returns true
+    // when it completed a block.
+    bool add_half(const uint16_t *buf) {
+      for (uint8_t scan = 0; scan < HALF_SCANS; scan++)
+        for (uint8_t i = 0; i < PINS; i++) acc[i] += *buf++ & 0xFFF;
+
+      if (++halves < HALVES) return false;
+      halves = 0;
+
+      uint16_t * const next = values[idx ^ 1];
+      for (uint8_t i = 0; i < PINS; i++) {
+        next[i] = acc[i] >> (LOG2 - FRAC);
+        acc[i] = 0;
+      }
+      idx ^= 1;
+      return true;
+    }
+
+    const uint16_t* snapshot() const { return values[idx]; }
+
+  private:
+    uint32_t acc[PINS] = { 0 };
+    uint8_t halves = 0;
+    uint16_t values[2][PINS] = { { 0 } };
+    volatile uint8_t idx = 0;
+};
@@ -71,8 +71,18 @@
   #error "EMERGENCY_PARSER is not yet implemented for STM32F1. Disable EMERGENCY_PARSER to continue."
 #endif
 
+// An EXTI line serves one port at a time. switch_detect attaches X0_CAL_PIN
+// (PA7) to line 7 for the probe, which would take it from Z_MAX_PIN (PE7).
+#if ENABLED(ENDSTOP_INTERRUPTS_FEATURE) && HAS_Z_MAX && defined(X0_CAL_PIN)
+  #error "ENDSTOP_INTERRUPTS_FEATURE can't be used with Z_MAX_PIN (PE7), it shares EXTI line 7 with X0_CAL_PIN (PA7)."
+#endif
+
 #if ENABLED(SDIO_SUPPORT) && DISABLED(SDSUPPORT)
   #error "SDIO_SUPPORT requires SDSUPPORT. Enable SDSUPPORT to continue."
 #elif ENABLED(UDISK_SUPPORT) && DISABLED(SDSUPPORT) 
   #error "UDISK_SUPPORT requires SDSUPPORT. Enable SDSUPPORT to continue."
 #endif
+
+#if ANY(HAS_TEMP_ADC_PROBE, HAS_TEMP_ADC_COOLER, HAS_TEMP_ADC_REDUNDANT, HAS_TEMP_ADC_6, HAS_TEMP_ADC_7, POWER_MONITOR_CURRENT, POWER_MONITOR_VOLTAGE, HAS_JOY_ADC_X, HAS_JOY_ADC_Y, HAS_JOY_ADC_Z, HAS_ADC_BUTTONS)
+  #error "Only hotend, bed, chamber and filament sensors are in the GD32F1 ADC scan. Add the pin to adc_pins in HAL.cpp to continue."
+#endif
@@ -72,6 +72,7 @@
 #include "../snapmaker/module/filament_sensor.h"
 #include "../snapmaker/module/print_control.h"
 #include "../snapmaker/module/system.h"
+#include "../snapmaker/debug/flight_recorder.h"
 #if HAS_TOUCH_BUTTONS
   #include "lcd/touch/touch_buttons.h"
 #endif
@@ -817,6 +818,7 @@ void idle(bool no_stepper_sleep/*=false*/) {
   thermalManager.manage_heater();
 
   planner.shaped_loop();
+  axisManager.fillAxisSteppers();
 
   // Max7219 heartbeat, animation, etc
   TERN_(MAX7219_DEBUG, max7219.idle_tasks());
@@ -1154,6 +1156,8 @@ AT_END_OF_TEXT void setup() {
   #ifdef BOARD_PREINIT
     BOARD_PREINIT(); // Low-level init (before serial init)
   #endif
+  flight_recorder_init();
+  system_service.boot_mark(BOOT_PHASE_SETUP);
   // Powerup
   OUT_WRITE(MOTOR_PWR_PIN, HIGH);
   OUT_WRITE(HEATER_PWR_PIN, HIGH);
@@ -1265,6 +1269,7 @@ AT_END_OF_TEXT void setup() {
 
   #if HAS_TMC220x
     SETUP_RUN(tmc_serial_begin());
+    tmc_serial_hold(true);            // Settings only fill the shadow registers, J1 sends them
   #endif
 
   #if ENABLED(PSU_CONTROL)
@@ -1383,6 +1388,7 @@ AT_END_OF_TEXT void setup() {
 
   SETUP_RUN(settings.first_load());   // Load data from EEPROM if available (or use defaults)
                                       // This also updates variables in the planner, elsewhere
+  system_service.boot_mark(BOOT_PHASE_SETTINGS);
 
   #if HAS_ETHERNET
     SETUP_RUN(ethernet.init());
@@ -1407,6 +1413,7 @@ AT_END_OF_TEXT void setup() {
   SETUP_RUN(stepper.init());          // Init stepper. This enables interrupts!
 
   SETUP_RUN(axisManager.init());
+  system_service.boot_mark(BOOT_PHASE_HARDWARE);
 
   enable_all_steppers();
   #if HAS_SERVOS
@@ -1711,6 +1718,7 @@ AT_END_OF_TEXT void setup() {
   #ifdef DEBUG_IO
   SET_OUTPUT(DEBUG_IO);
   #endif
+  system_service.boot_mark(BOOT_PHASE_SCHEDULER);
   vTaskStartScheduler();
 }
 
@@ -1731,18 +1739,31 @@ void marlin_loop() {
   while (1) {
     idle();
 
+    // G-codes may move the axes, hold them until J1 has configured the drivers
+    if (!system_service.is_ready(SYSTEM_READY_DRIVERS)) {
+      vTaskDelay(pdMS_TO_TICKS(5));
+      continue;
+    }
+
     #if ENABLED(SDSUPPORT)
       if (card.flag.abort_sd_printing) abortSDPrinting();
       if (marlin_state == MF_SD_COMPLETE) finishSDPrinting();
     #endif
 
-    queue.advance();
-
-    if (system_service.get_status() >= SYSTEM_STATUE_PAUSING && system_service.get_status() <= SYSTEM_STATUE_STOPPED) {
-      while(!queue.ring_buffer.empty()) {
-        GCodeQueue::CommandLine &command = queue.ring_buffer.peek_next_command();
-        LOG_I("Clear GCodeQueue: %s\r\n", command.buffer);
-        queue.ring_buffer.advance_pos(queue.ring_buffer.index_r, -1);
+    // A pause held in place keeps the queued commands for the resume
+    if (print_control.holds_in_place()) {
+      vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    else {
+      queue.advance();
+
+      if (system_service.get_status() >= SYSTEM_STATUE_PAUSING && system_service.get_status() <= SYSTEM_STATUE_STOPPED) {
+        while(!queue.ring_buffer.empty()) {
+          GCodeQueue::CommandLine &command = queue.ring_buffer.peek_next_command();
+          LOG_I("Clear GCodeQueue: %s\r\n", command.buffer);
+          queue.ring_buffer.advance_pos(queue.ring_buffer.index_r, -1);
+        }
+        queue.clear();  // and a HMI line still waiting for arena space
       }
     }
 
@@ -680,4 +680,10 @@
 #define UPDATE_DATA_FLASH_ADDR        (FLASH_MARLIN_POWERPANIC + POWERLOSS_DATA_SIZE)
 #define FLASH_MARLIN_EEPROM           (UPDATE_DATA_FLASH_ADDR + UPDATE_DATA_SIZE)
 #define CRASH_DATA_FLASH_ADDR         (DATA_FLASH_START_ADDR - CRASH_DATA_SIZE)
-#define FACTORY_DATA_FLASH_ADDR       (CRASH_DATA_FLASH_ADDR - FACTORY_DATA_SIZE)
\ No newline at end of file
+#define FACTORY_DATA_FLASH_ADDR       (CRASH_DATA_FLASH_ADDR - FACTORY_DATA_SIZE)
+
+// Inactive slot for in-application update staging, in the second flash bank
+// so erasing/programming it does not stall code fetch from the first bank
+#define UPDATE_STAGING_FLASH_ADDR     (FLASH_BASE + 512 * 1024)
+#define UPDATE_STAGING_SIZE           (480 * 1024)
+#define UPDATE_STAGING_PAGE_SIZE      (DATA_FLASH_PAGE_SIZE)
\ No newline at end of file
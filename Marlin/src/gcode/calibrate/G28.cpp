@@ -246,6 +246,7 @@ void GcodeSuite::G28() {
 
   // Disable leveling before homing
   TERN_(HAS_LEVELING, set_bed_leveling_enabled(false));
+  TERN_(SHAPER_Z_MESH, zMesh.setActive(false));
 
   // Reset to the XY plane
   TERN_(CNC_WORKSPACE_PLANES, workspace_plane = PLANE_XY);
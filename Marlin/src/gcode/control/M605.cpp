@@ -117,6 +117,7 @@
 
       idex_set_parked(true);
       set_duplication_enabled(false);
+      axisManager.select_x_shaper();
 
       #ifdef EVENT_GCODE_IDEX_AFTER_MODECHANGE
         gcode.process_subcommands_now_P(PSTR(EVENT_GCODE_IDEX_AFTER_MODECHANGE));
@@ -68,6 +68,7 @@ GcodeSuite gcode;
 #include "../MarlinCore.h" // for idle, kill
 #include "../../../snapmaker/module/system.h"
 #include "../../../snapmaker/module/print_control.h"
+#include "../../../snapmaker/debug/flight_recorder.h"
 
 // Inactivity shutdown
 millis_t GcodeSuite::previous_move_ms = 0,
@@ -754,6 +755,10 @@ void GcodeSuite::process_parsed_command(const bool no_ok/*=false*/) {
         case 305: M305(); break;                                  // M305: Set user thermistor parameters
       #endif
 
+      #if ENABLED(MPCTEMP)
+        case 306: M306(); break;                                  // M306: MPC settings and autotune
+      #endif
+
       #if ENABLED(REPETIER_GCODE_M360)
         case 360: M360(); break;                                  // M360: Firmware settings
       #endif
@@ -798,11 +803,11 @@ void GcodeSuite::process_parsed_command(const bool no_ok/*=false*/) {
         case 414: M414(); break;                                  // M414: Select multi language menu
       #endif
 
-      #if HAS_LEVELING
+      #if HAS_LEVELING || ENABLED(SHAPER_Z_MESH)
         case 420: M420(); break;                                  // M420: Enable/Disable Bed Leveling
       #endif
 
-      #if HAS_MESH
+      #if HAS_MESH || ENABLED(SHAPER_Z_MESH)
         case 421: M421(); break;                                  // M421: Set a Mesh Bed Leveling Z coordinate
       #endif
 
@@ -1082,6 +1087,7 @@ void GcodeSuite::process_next_command() {
 
   // Parse the next command in the queue
   parser.parse(command.buffer);
+  flight_record(FLIGHT_RECORD_GCODE, parser.command_letter, (uint32_t(parser.codenum) << 20) | (command.lines & 0xFFFFF));
   process_parsed_command();
 }
 
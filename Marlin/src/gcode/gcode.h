@@ -202,6 +202,7 @@
  * M303 - PID relay autotune S<temperature> sets the target temperature. Default 150C. (Requires PIDTEMP)
  * M304 - Set bed PID parameters P I and D. (Requires PIDTEMPBED)
  * M305 - Set user thermistor parameters R T and P. (Requires TEMP_SENSOR_x 1000)
+ * M306 - MPC settings, hotend controller selection and autotune. (Requires MPCTEMP)
  * M309 - Set chamber PID parameters P I and D. (Requires PIDTEMPCHAMBER)
  * M350 - Set microstepping mode. (Requires digital microstepping pins.)
  * M351 - Toggle MS1 MS2 pins directly. (Requires digital microstepping pins.)
@@ -858,6 +859,10 @@ private:
     static void M305();
   #endif
 
+  #if ENABLED(MPCTEMP)
+    static void M306();
+  #endif
+
   #if ENABLED(PIDTEMPCHAMBER)
     static void M309();
   #endif
@@ -915,7 +920,7 @@ private:
     static void M414();
   #endif
 
-  #if HAS_LEVELING
+  #if HAS_LEVELING || ENABLED(SHAPER_Z_MESH)
     static void M420();
     static void M421();
   #endif
@@ -44,9 +44,9 @@
  * Plan an arc in 2 dimensions, with optional linear motion in a 3rd dimension
  *
  * The arc is traced by generating many small linear segments, as configured by
- * MM_PER_ARC_SEGMENT (Default 1mm). In the future we hope more slicers will include
- * an option to generate G2/G3 arcs for curved surfaces, as this will allow faster
- * boards to produce much smoother curved surfaces.
+ * MM_PER_ARC_SEGMENT (Default 1mm). With ARC_CHORD_TOLERANCE the segment length
+ * follows the radius instead, so every chord stays within the tolerance of the
+ * true arc: tight arcs get more segments and wide arcs fewer planner blocks.
  */
 void plan_arc(
   const xyze_pos_t &cart,   // Destination position
@@ -145,17 +145,32 @@ void plan_arc(
   const feedRate_t scaled_fr_mm_s = MMS_SCALED(feedrate_mm_s);
 
   // Start with a nominal segment length
-  float seg_length = (
-    #ifdef ARC_SEGMENTS_PER_R
-      constrain(MM_PER_ARC_SEGMENT * radius, MM_PER_ARC_SEGMENT, ARC_SEGMENTS_PER_R)
-    #elif ARC_SEGMENTS_PER_SEC
-      _MAX(scaled_fr_mm_s * RECIPROCAL(ARC_SEGMENTS_PER_SEC), MM_PER_ARC_SEGMENT)
-    #else
-      MM_PER_ARC_SEGMENT
-    #endif
-  );
+  #ifdef ARC_CHORD_TOLERANCE
+    // Longest chord whose midpoint is ARC_CHORD_TOLERANCE inside the arc
+    float seg_length = radius > (ARC_CHORD_TOLERANCE)
+      ? 2 * SQRT((ARC_CHORD_TOLERANCE) * (2 * radius - (ARC_CHORD_TOLERANCE)))
+      : float(MAX_ARC_SEGMENT_MM);
+    LIMIT(seg_length, float(MIN_ARC_SEGMENT_MM), float(MAX_ARC_SEGMENT_MM));
+    // Short segments at speed drain a low planner faster than it fills, so trade accuracy for block rate
+    if (planner.movesplanned() < (BLOCK_BUFFER_SIZE) / 2)
+      NOLESS(seg_length, _MIN(scaled_fr_mm_s * RECIPROCAL(ARC_LOW_BUFFER_SEGMENTS_PER_SEC), float(MAX_ARC_SEGMENT_MM)));
+  #else
+    float seg_length = (
+      #ifdef ARC_SEGMENTS_PER_R
+        constrain(MM_PER_ARC_SEGMENT * radius, MM_PER_ARC_SEGMENT, ARC_SEGMENTS_PER_R)
+      #elif ARC_SEGMENTS_PER_SEC
+        _MAX(scaled_fr_mm_s * RECIPROCAL(ARC_SEGMENTS_PER_SEC), MM_PER_ARC_SEGMENT)
+      #else
+        MM_PER_ARC_SEGMENT
+      #endif
+    );
+  #endif
   // Divide total travel by nominal segment length
-  uint16_t segments = FLOOR(mm_of_travel / seg_length);
+  #ifdef ARC_CHORD_TOLERANCE
+    uint16_t segments = CEIL(mm_of_travel / seg_length); // Round up to stay within tolerance
+  #else
+    uint16_t segments = FLOOR(mm_of_travel / seg_length);
+  #endif
   NOLESS(segments, min_segments);         // At least some segments
   seg_length = mm_of_travel / segments;
 
@@ -173,24 +188,15 @@ void plan_arc(
    * round off issues for CNC applications.) Single precision error can accumulate to be greater than
    * tool precision in some cases. Therefore, arc path correction is implemented.
    *
-   * Small angle approximation may be used to reduce computation overhead further. This approximation
-   * holds for everything, but very small circles and large MM_PER_ARC_SEGMENT values. In other words,
-   * theta_per_segment would need to be greater than 0.1 rad and N_ARC_CORRECTION would need to be large
-   * to cause an appreciable drift error. N_ARC_CORRECTION~=25 is more than small enough to correct for
-   * numerical drift error. N_ARC_CORRECTION may be on the order a hundred(s) before error becomes an
-   * issue for CNC machines with the single precision Arduino calculations.
-   *
-   * This approximation also allows plan_arc to immediately insert a line segment into the planner
-   * without the initial overhead of computing cos() or sin(). By the time the arc needs to be applied
-   * a correction, the planner should have caught up to the lag caused by the initial plan_arc overhead.
-   * This is important when there are successive arc motions.
+   * The rotation matrix is computed once per arc with cos() and sin(), since chord-tolerance
+   * segments can be too wide for a small angle approximation. Every N_ARC_CORRECTION segments the
+   * position is still recomputed exactly from the initial radius vector.
    */
   // Vector rotation matrix values
   xyze_pos_t raw;
   const float theta_per_segment = angular_travel / segments,
-              sq_theta_per_segment = sq(theta_per_segment),
-              sin_T = theta_per_segment - sq_theta_per_segment * theta_per_segment / 6,
-              cos_T = 1 - 0.5f * sq_theta_per_segment; // Small angle approximation
+              sin_T = sin(theta_per_segment),
+              cos_T = cos(theta_per_segment);
 
   #if HAS_Z_AXIS && DISABLED(AUTO_BED_LEVELING_UBL)
     const float linear_per_segment = linear_travel / segments;
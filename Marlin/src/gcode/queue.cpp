@@ -37,6 +37,7 @@ GCodeQueue queue;
 #include "../MarlinCore.h"
 #include "../core/bug_on.h"
 #include "../../../snapmaker/module/print_control.h"
+#include "../../../snapmaker/module/tool_preheat.h"
 #if ENABLED(PRINTER_EVENT_LEDS)
   #include "../feature/leds/printer_event_leds.h"
 #endif
@@ -82,10 +83,53 @@ PGM_P GCodeQueue::injected_commands_P; // = nullptr
  */
 char GCodeQueue::injected_commands[64]; // = { 0 }
 
+char GCodeQueue::hmi_line[MAX_CMD_SIZE];
+uint32_t GCodeQueue::hmi_line_number;
+bool GCodeQueue::hmi_line_held; // = false
+
+
+/**
+ * The unread command strings occupy the arena from the start of the command
+ * at index_r up to arena_w, possibly wrapping around. A new string always
+ * goes into one contiguous run of size bytes, so a short tail is skipped
+ * and writing resumes at the start of the arena.
+ */
+bool GCodeQueue::RingBuffer::arena_write_offset(uint16_t &offset, const uint16_t size/*=MAX_CMD_SIZE*/) const {
+  const bool tail_fits = (CMD_ARENA_SIZE - arena_w) >= size;
+
+  if (empty()) {
+    offset = tail_fits ? arena_w : 0;
+    return true;
+  }
+
+  const uint16_t r = commands[index_r].buffer - arena;
+  if (r < arena_w) {                  // Unread: [r, arena_w), free: [arena_w, end) and [0, r)
+    if (tail_fits) { offset = arena_w; return true; }
+    if (r > size) { offset = 0; return true; }
+    return false;
+  }
+
+  // Unread strings wrap around, free: [arena_w, r)
+  if (r - arena_w > size) { offset = arena_w; return true; }
+  return false;
+}
+
+bool GCodeQueue::RingBuffer::full(uint8_t cmdCount/*=1*/) const {
+  uint16_t offset;
+  return length > (BUFSIZE - cmdCount) || !arena_write_offset(offset);
+}
+
+char* GCodeQueue::RingBuffer::reserve_command(const uint16_t size/*=MAX_CMD_SIZE*/) {
+  uint16_t offset;
+  if (length >= BUFSIZE || !arena_write_offset(offset, size)) return nullptr;
+  arena_w = offset;
+  return commands[index_w].buffer = &arena[offset];
+}
 
 void GCodeQueue::RingBuffer::commit_command(bool skip_ok
   OPTARG(HAS_MULTI_SERIAL, serial_index_t serial_ind/*=-1*/)
 ) {
+  arena_w += strlen(commands[index_w].buffer) + 1;
   commands[index_w].skip_ok = skip_ok;
   TERN_(HAS_MULTI_SERIAL, commands[index_w].port = serial_ind);
   TERN_(POWER_LOSS_RECOVERY, recovery.commit_sdpos(index_w));
@@ -100,8 +144,12 @@ void GCodeQueue::RingBuffer::commit_command(bool skip_ok
 bool GCodeQueue::RingBuffer::enqueue(const char *cmd, bool skip_ok/*=true*/
   OPTARG(HAS_MULTI_SERIAL, serial_index_t serial_ind/*=-1*/)
 ) {
-  if (*cmd == ';' || length >= BUFSIZE) return false;
-  strcpy(commands[index_w].buffer, cmd);
+  if (*cmd == ';') return false;
+  const uint16_t size = _MIN(strlen(cmd) + 1, size_t(MAX_CMD_SIZE));
+  char * const buffer = reserve_command(size);
+  if (!buffer) return false;
+  strncpy(buffer, cmd, size - 1);
+  buffer[size - 1] = '\0';
   commands[index_w].lines = INVALID_CMD_LINE;
   commit_command(skip_ok
     #if HAS_MULTI_SERIAL
@@ -317,7 +365,7 @@ FORCE_INLINE bool is_M29(const char * const cmd) {  // matches "M29" & "M29 ", b
 #define PS_PAREN  3
 #define PS_ESC    4
 
-inline void process_stream_char(const char c, uint8_t &sis, char (&buff)[MAX_CMD_SIZE], int &ind) {
+inline void process_stream_char(const char c, uint8_t &sis, char * const buff, int &ind) {
 
   if (sis == PS_EOL) return;    // EOL comment or overflow
 
@@ -373,7 +421,7 @@ inline void process_stream_char(const char c, uint8_t &sis, char (&buff)[MAX_CMD
  * Handle a line being completed. For an empty line
  * keep sensor readings going and watchdog alive.
  */
-inline bool process_line_done(uint8_t &sis, char (&buff)[MAX_CMD_SIZE], int &ind) {
+inline bool process_line_done(uint8_t &sis, char * const buff, int &ind) {
   sis = PS_NORMAL;                    // "Normal" Serial Input State
   buff[ind] = '\0';                   // Of course, I'm a Terminator.
   const bool is_empty = (ind == 0);   // An empty line?
@@ -419,7 +467,20 @@ void GCodeQueue::get_serial_commands() {
 
     LOOP_L_N(p, NUM_SERIAL) {
       // Check if the queue is full and exit if it is.
-      if (ring_buffer.full()) return;
+      if (ring_buffer.length >= BUFSIZE) return;
+
+      SerialState &serial = serial_state[p];
+
+      // A line that did not fit waits for its own length in the arena,
+      // the rest of its port's input stays in the RX buffer meanwhile
+      if (serial.line_held) {
+        if (!ring_buffer.enqueue(serial.line_buffer, false
+          #if HAS_MULTI_SERIAL
+            , p
+          #endif
+        )) continue;
+        serial.line_held = false;
+      }
 
       // No data for this port ? Skip it
       if (!serial_data_available(p)) continue;
@@ -439,7 +500,6 @@ void GCodeQueue::get_serial_commands() {
       }
 
       const char serial_char = (char)c;
-      SerialState &serial = serial_state[p];
 
       if (ISEOL(serial_char)) {
 
@@ -527,12 +587,12 @@ void GCodeQueue::get_serial_commands() {
           last_command_time = ms;
         #endif
 
-        // Add the command to the queue
-        ring_buffer.enqueue(serial.line_buffer, false
+        // Add the command to the queue, or hold it until there is room
+        if (serial.line_buffer[0] != ';' && !ring_buffer.enqueue(serial.line_buffer, false
           #if HAS_MULTI_SERIAL
             , p
           #endif
-        );
+        )) serial.line_held = true;
       }
       else
         process_stream_char(serial_char, serial.input_state, serial.line_buffer, serial.count);
@@ -541,13 +601,26 @@ void GCodeQueue::get_serial_commands() {
   } // queue has space, serial has data
 }
 
+/**
+ * Get lines from the HMI buffer until the command buffer is full. A line
+ * is read whole before it is queued, so it takes only its own length in
+ * the arena instead of a MAX_CMD_SIZE reservation.
+ */
 void GCodeQueue::get_hmi_commands() {
-  // if (ring_buffer.full()) return;
-  uint32_t lines = 0;
-  while (!ring_buffer.full() && print_control.get_commands((uint8_t *)ring_buffer.commands[ring_buffer.index_w].buffer, lines, MAX_CMD_SIZE)) {
-    ring_buffer.commands[ring_buffer.index_w].lines = lines;
-    ring_buffer.commands[ring_buffer.index_w].skip_ok = true;
-    ring_buffer.advance_pos(ring_buffer.index_w, 1);
+  for (;;) {
+    if (!hmi_line_held) {
+      if (ring_buffer.length >= BUFSIZE) return;
+      if (!print_control.get_commands((uint8_t *)hmi_line, hmi_line_number, MAX_CMD_SIZE)) return;
+      hmi_line_held = true;
+    }
+
+    const uint16_t size = strlen(hmi_line) + 1;
+    char * const buffer = ring_buffer.reserve_command(size);
+    if (!buffer) return;
+    memcpy(buffer, hmi_line, size);
+    ring_buffer.commands[ring_buffer.index_w].lines = hmi_line_number;
+    ring_buffer.commit_command(true);
+    hmi_line_held = false;
   }
 }
 
@@ -566,7 +639,7 @@ void GCodeQueue::get_hmi_commands() {
     if (!IS_SD_FETCHING()) return;
 
     int sd_count = 0;
-    while (!ring_buffer.full() && !card.eof()) {
+    while (ring_buffer.reserve_command() && !card.eof()) {
       const int16_t n = card.get();
       const bool card_eof = card.eof();
       if (n < 0 && !card_eof) { SERIAL_ERROR_MSG(STR_SD_ERR_READ); continue; }
@@ -613,10 +686,9 @@ void GCodeQueue::get_hmi_commands() {
  *  - The SD card file being actively printed
  */
 void GCodeQueue::get_available_commands() {
-  if (ring_buffer.full()) return;
+  tool_preheat.loop();
 
   get_serial_commands();
-
   TERN_(SDSUPPORT, get_sdcard_commands());
   get_hmi_commands();
 }
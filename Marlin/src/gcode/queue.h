@@ -45,13 +45,16 @@ public:
     int count;                      //!< Number of characters read in the current line of serial input
     char line_buffer[MAX_CMD_SIZE]; //!< The current line accumulator
     uint8_t input_state;            //!< The input state
+    bool line_held;                 //!< line_buffer holds a whole line waiting for arena space
   };
 
   static SerialState serial_state[NUM_SERIAL]; //!< Serial states for each serial port
 
   /**
    * GCode Command Queue
-   * A simple (circular) ring buffer of BUFSIZE command strings.
+   * A (circular) ring buffer of up to BUFSIZE command strings. The strings
+   * are packed back-to-back into a CMD_ARENA_SIZE byte arena, so short
+   * commands (the usual case for sliced moves) take only the space they need.
    *
    * Commands are copied into this buffer by the command injectors
    * (immediate, serial, sd card) and they are processed sequentially by
@@ -59,7 +62,7 @@ public:
    * command and hands off execution to individual handler functions.
    */
   struct CommandLine {
-    char buffer[MAX_CMD_SIZE];      //!< The command buffer
+    char *buffer;                   //!< The command string, located in the ring buffer's arena
     bool skip_ok;                   //!< Skip sending ok when command is processed?
     uint32_t lines;                 // position of gcode of this command in the file
     #if ENABLED(HAS_MULTI_SERIAL)
@@ -74,11 +77,29 @@ public:
     uint8_t length,                 //!< Number of commands in the queue
             index_r,                //!< Ring buffer's read position
             index_w;                //!< Ring buffer's write position
+    uint16_t arena_w;               //!< Arena offset where the next command string will be written
     CommandLine commands[BUFSIZE];  //!< The ring buffer of commands
+    char arena[CMD_ARENA_SIZE];     //!< Storage for the command strings, packed back-to-back
 
     inline serial_index_t command_port() const { return TERN0(HAS_MULTI_SERIAL, commands[index_r].port); }
 
-    inline void clear() { length = index_r = index_w = 0; }
+    inline void clear() { length = index_r = index_w = 0; arena_w = 0; }
+
+    /**
+     * Reserve size contiguous bytes in the arena for the next command and
+     * point commands[index_w].buffer at them. Feeders that write the string
+     * in place reserve MAX_CMD_SIZE; only the string actually written is
+     * consumed by commit_command().
+     * Return nullptr if there is no free slot or not enough arena space.
+     */
+    char* reserve_command(const uint16_t size=MAX_CMD_SIZE);
+
+    /**
+     * Find where a command of size bytes can be written, wrapping to the
+     * start of the arena when the tail is too short.
+     * Return false if the unread commands leave no room.
+     */
+    bool arena_write_offset(uint16_t &offset, const uint16_t size=MAX_CMD_SIZE) const;
 
     void advance_pos(uint8_t &p, const int inc) { if (++p >= BUFSIZE) p = 0; length += inc; }
 
@@ -92,7 +113,8 @@ public:
 
     void ok_to_send();
 
-    inline bool full(uint8_t cmdCount=1) const { return length > (BUFSIZE - cmdCount); }
+    // Full when a command of MAX_CMD_SIZE would not fit
+    bool full(uint8_t cmdCount=1) const;
 
     inline bool occupied() const { return length != 0; }
 
@@ -111,7 +133,7 @@ public:
   /**
    * Clear the Marlin command queue
    */
-  static void clear() { ring_buffer.clear(); }
+  static void clear() { ring_buffer.clear(); hmi_line_held = false; }
 
   /**
    * Next Injected Command (PROGMEM) pointer. (nullptr == empty)
@@ -158,7 +180,7 @@ public:
   /**
    * Check whether there are any commands yet to be executed
    */
-  static bool has_commands_queued() { return ring_buffer.length || injected_commands_P || injected_commands[0]; }
+  static bool has_commands_queued() { return ring_buffer.length || hmi_line_held || injected_commands_P || injected_commands[0]; }
 
   /**
    * Get the next command in the queue, optionally log it to SD, then dispatch it
@@ -202,11 +224,22 @@ public:
 
   static inline uint32_t file_line_number() {return ring_buffer.peek_next_command().lines;}
 
+  // The HMI line waiting for arena space, it runs after the ring buffer
+  static inline const char* held_hmi_line() { return hmi_line_held ? hmi_line : nullptr; }
+
 private:
 
   static void get_serial_commands();
   static void get_hmi_commands();
 
+  /**
+   * A line read from the HMI buffer before its length was known. It waits
+   * here, after the ring buffer's commands, until the arena has room for it.
+   */
+  static char hmi_line[MAX_CMD_SIZE];
+  static uint32_t hmi_line_number;
+  static bool hmi_line_held;
+
   #if ENABLED(SDSUPPORT)
     static void get_sdcard_commands();
   #endif
@@ -0,0 +1,96 @@
+/**
+ * Marlin 3D Printer Firmware
+ * Copyright (c) 2022 MarlinFirmware [https://github.com/MarlinFirmware/Marlin]
+ *
+ * Based on Sprinter and grbl.
+ * Copyright (c) 2011 Camiel Gubbels / Erik van der Zalm
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "../../inc/MarlinConfig.h"
+
+#if ENABLED(MPCTEMP)
+
+#include "../gcode.h"
+#include "../../lcd/marlinui.h"
+#include "../../module/temperature.h"
+
+/**
+ * M306: MPC settings and autotune
+ *
+ *  E<extruder>       Extruder index. (Default: Active Extruder)
+ *  M<bool>           Control the hotend with MPC (1) or PID (0)
+ *  T                 Autotune the selected hotend
+ *
+ *  P<watts>          Heater power
+ *  C<joules/kelvin>  Block heat capacity
+ *  R<kelvin/second/kelvin>  Sensor responsiveness (= transfer coefficient / heat capacity)
+ *  A<watts/kelvin>   Ambient heat transfer coefficient (no fan)
+ *  F<watts/kelvin>   Ambient heat transfer coefficient (fan on full)
+ *  H<joules/kelvin/mm>  Filament heat capacity per mm
+ *
+ * With no other parameters, report the settings of the selected hotend.
+ */
+void GcodeSuite::M306() {
+  const uint8_t e = parser.seenval('E') ? parser.value_byte() : active_extruder;
+  if (e >= HOTENDS) {
+    SERIAL_ERROR_MSG(STR_INVALID_EXTRUDER);
+    return;
+  }
+
+  hotend_info_t &hotend = thermalManager.temp_hotend[e];
+  MPC_t &constants = hotend.constants;
+
+  if (parser.seen_test('T')) {
+    #if DISABLED(BUSY_WHILE_HEATING)
+      KEEPALIVE_STATE(NOT_BUSY);
+    #endif
+    LCD_MESSAGEPGM(MSG_PID_AUTOTUNE);
+    thermalManager.MPC_autotune(e);
+    ui.reset_status();
+  }
+
+  if (parser.seen('P')) constants.heater_power = parser.value_float();
+  if (parser.seen('C')) constants.block_heat_capacity = parser.value_float();
+  if (parser.seen('R')) constants.sensor_responsiveness = parser.value_float();
+  if (parser.seen('A')) constants.ambient_xfer_coeff_fan0 = parser.value_float();
+  #if ENABLED(MPC_INCLUDE_FAN)
+    if (parser.seen('F')) constants.fan255_adjustment = parser.value_float() - constants.ambient_xfer_coeff_fan0;
+  #endif
+  if (parser.seen('H')) constants.filament_heat_capacity_permm = parser.value_float();
+
+  if (parser.seen('M')) {
+    const bool use_mpc = parser.value_bool();
+    if (use_mpc != hotend.use_mpc) {
+      hotend.modeled_block_temp = NAN; // Re-seed the model from the sensor
+      hotend.use_mpc = use_mpc;
+    }
+  }
+
+  SERIAL_ECHO_START();
+  SERIAL_ECHOPAIR("M306 E", e, " M", hotend.use_mpc);
+  SERIAL_ECHOPAIR_F(" P", constants.heater_power, 2);
+  SERIAL_ECHOPAIR_F(" C", constants.block_heat_capacity, 2);
+  SERIAL_ECHOPAIR_F(" R", constants.sensor_responsiveness, 4);
+  SERIAL_ECHOPAIR_F(" A", constants.ambient_xfer_coeff_fan0, 4);
+  #if ENABLED(MPC_INCLUDE_FAN)
+    SERIAL_ECHOPAIR_F(" F", constants.ambient_xfer_coeff_fan0 + constants.fan255_adjustment, 4);
+  #endif
+  SERIAL_ECHOPAIR_F(" H", constants.filament_heat_capacity_permm, 4);
+  SERIAL_EOL();
+}
+
+#endif // MPCTEMP
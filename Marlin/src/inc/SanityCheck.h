@@ -1191,6 +1191,28 @@ static_assert(Y_MAX_LENGTH >= Y_BED_SIZE, "Movement bounds (Y_MIN_POS, Y_MAX_POS
   #endif
 #endif
 
+/**
+ * S-Curve ramps on the input shaper motion path
+ */
+#if ENABLED(SHAPER_S_CURVE)
+  #if ENABLED(S_CURVE_ACCELERATION)
+    #error "SHAPER_S_CURVE replaces S_CURVE_ACCELERATION on the shaper motion path. Enable only one."
+  #endif
+  static_assert(WITHIN(SHAPER_S_CURVE_SEGMENTS, 2, 8), "SHAPER_S_CURVE_SEGMENTS must be from 2 to 8.");
+  static_assert(SHAPER_S_CURVE_MIN_RAMP_TIME > 0, "SHAPER_S_CURVE_MIN_RAMP_TIME must be greater than 0.");
+#endif
+
+/**
+ * Z mesh applied on the input shaper motion path
+ */
+#if ENABLED(SHAPER_Z_MESH)
+  #if HAS_LEVELING
+    #error "SHAPER_Z_MESH replaces planner bed leveling and uses M420/M421. Disable bed leveling to use it."
+  #endif
+  static_assert(Z_MESH_GRID_X >= 2 && Z_MESH_GRID_Y >= 2, "Z_MESH_GRID_X and Z_MESH_GRID_Y must be at least 2.");
+  static_assert(2 * (Z_MESH_INSET) < _MIN(X_BED_SIZE, Y_BED_SIZE), "Z_MESH_INSET is too large for the bed size.");
+#endif
+
 /**
  * Special tool-changing options
  */
@@ -1316,6 +1338,10 @@ static_assert(Y_MAX_LENGTH >= Y_BED_SIZE, "Movement bounds (Y_MIN_POS, Y_MAX_POS
 /**
  * Bed Heating Options - PID vs Limit Switching
  */
+#if ENABLED(MPCTEMP) && DISABLED(PIDTEMP)
+  #error "MPCTEMP requires PIDTEMP, which stays available as the per-hotend fallback."
+#endif
+
 #if BOTH(PIDTEMPBED, BED_LIMIT_SWITCHING)
   #error "To use BED_LIMIT_SWITCHING you must disable PIDTEMPBED."
 #endif
@@ -3239,6 +3265,14 @@ static_assert(   _ARR_TEST(3,0) && _ARR_TEST(3,1) && _ARR_TEST(3,2)
   #error "A very large BLOCK_BUFFER_SIZE is not needed and takes longer to drain the buffer on pause / cancel."
 #endif
 
+#if !BUFSIZE || BUFSIZE > 255
+  #error "BUFSIZE must be between 1 and 255."
+#elif CMD_ARENA_SIZE < 2 * (MAX_CMD_SIZE)
+  #error "CMD_ARENA_SIZE must be at least twice MAX_CMD_SIZE."
+#elif CMD_ARENA_SIZE > 65535
+  #error "CMD_ARENA_SIZE must be less than 65536."
+#endif
+
 #if ENABLED(LED_CONTROL_MENU) && !IS_ULTIPANEL
   #error "LED_CONTROL_MENU requires an LCD controller."
 #endif
@@ -22,6 +22,7 @@
 #include "AxisManager.h"
 #include "shaper/MoveQueue.h"
 #include "../gcode/gcode.h"
+#include "motion.h"
 
 #include "../../../snapmaker/J1/common_type.h"
 
@@ -40,7 +41,19 @@ static const char *dbg_name[SHAPER_DBG_MAX] = {
   "NOT_ENOUGH_FUNC_LIST_RESC",
   "CALC_STEP_TIMEOUT_COUNT",
   "CALC_STEP_TIME",
-  "ABORT_END_BLOCK"
+  "ABORT_END_BLOCK",
+  "STEP_UNDERRUN",
+  "STEP_STALL",
+  "STEP_MOVES",
+  "STEP_COUNT",
+  "STEP_MAX_ERR",
+  "STEP_BUNDLES",
+  "STEP_MERGED",
+  "STEP_MAX_JITTER",
+  "PLAN_BLOCKS",
+  "PLAN_REVERSE",
+  "PLAN_FORWARD",
+  "PLAN_TRAPEZOID"
 };
 
 
@@ -50,16 +63,88 @@ void AxisManager::input_shaper_reset() {
   AxisInputShaper::axis_input_shaper_x.frequency = DEFAULT_IS_FREQ;
   AxisInputShaper::axis_input_shaper_x.zeta = DEFAULT_IS_DAMP;
 
+  x_shaper[0] = { DEFAULT_IS_TYPE, DEFAULT_IS_FREQ, DEFAULT_IS_DAMP };
+  for (int i = 1; i < X_SHAPER_TOOLS; i++) {
+    x_shaper[i] = { DEFAULT_IS_TYPE, 0, DEFAULT_IS_DAMP };
+  }
+  x_shaper_selected = 0;
+
   AxisInputShaper::axis_input_shaper_y.type = (InputShaperType)DEFAULT_IS_TYPE;
   AxisInputShaper::axis_input_shaper_y.frequency = DEFAULT_IS_FREQ;
   AxisInputShaper::axis_input_shaper_y.zeta = DEFAULT_IS_DAMP;
 
 }
 
-ErrCode AxisManager::input_shaper_set(int axis, int type, float freq, float dampe)  {
+/*
+ X shaper model of a tool, or of both carriages moving together. A single
+ shaper can not cancel two resonances, the combined model shapes for the
+ lower one: its longer window smooths more and still damps the stiffer
+ carriage, while a shaper tuned to the higher one leaves the softer carriage
+ ringing. An unshaped carriage does not veto the other one.
+*/
+void AxisManager::x_shaper_config(uint8_t selected, shaper_config_t &config) {
+  if (selected < X_SHAPER_TOOLS) {
+    config = x_shaper[selected].frequency > 0 ? x_shaper[selected] : x_shaper[0];
+    return;
+  }
+
+  x_shaper_config(0, config);
+  for (int i = 1; i < X_SHAPER_TOOLS; i++) {
+    shaper_config_t other;
+    x_shaper_config(i, other);
+    if (other.type == (int)InputShaperType::none) continue;
+    if (config.type == (int)InputShaperType::none || other.frequency < config.frequency) {
+      other.zeta = _MAX(other.zeta, config.zeta);
+      config = other;
+    }
+    else {
+      config.zeta = _MAX(other.zeta, config.zeta);
+    }
+  }
+}
+
+/*
+ Load the X model of the moving carriage(s). Called whenever the active tool
+ or the IDEX mode changes, the shaper is only rebuilt if the model differs.
+*/
+void AxisManager::select_x_shaper() {
+  x_shaper_selected = TERN0(DUAL_X_CARRIAGE, idex_is_duplicating()) ? X_SHAPER_COMBINED : active_extruder;
+
+  shaper_config_t config;
+  x_shaper_config(x_shaper_selected, config);
+
+  AxisInputShaper* axis_input_shaper = &AxisInputShaper::axis_input_shaper_x;
+  if (config.frequency == axis_input_shaper->frequency && config.zeta == axis_input_shaper->zeta && config.type == (int)axis_input_shaper->type) {
+    return;
+  }
+
+  planner.synchronize();
+  axis_input_shaper->setConfig(config.type, config.frequency, config.zeta);
+  axisManager.initAxisShaper();
+  axisManager.abort();
+  // shaped_loop() clears the planner on the abort, moves the tool change
+  // queues next must come after it
+  planner.synchronize();
+  LOG_I("X shaper for %s%d: type: %s, frequency: %lf, zeta: %lf\n", x_shaper_selected == X_SHAPER_COMBINED ? "combined " : "T",
+        x_shaper_selected == X_SHAPER_COMBINED ? X_SHAPER_TOOLS : x_shaper_selected, input_shaper_type_name[config.type], config.frequency, config.zeta);
+}
+
+ErrCode AxisManager::input_shaper_set(int axis, int type, float freq, float dampe, uint8_t tool)  {
 
   if (axis != X_AXIS && axis != Y_AXIS) return E_PARAM;
 
+  if (axis == X_AXIS) {
+    if (tool != X_SHAPER_ANY_TOOL && tool >= X_SHAPER_TOOLS) return E_PARAM;
+    for (int i = 0; i < X_SHAPER_TOOLS; i++) {
+      if (tool == X_SHAPER_ANY_TOOL || tool == i) {
+        x_shaper[i] = { type, freq, dampe };
+      }
+    }
+    select_x_shaper();
+    LOG_I("setting: axis: %d tool: %d type: %s, frequency: %lf, zeta: %lf\n", axis, tool, input_shaper_type_name[type], freq, dampe);
+    return E_SUCCESS;
+  }
+
   AxisInputShaper* axis_input_shaper = axisManager.axis[axis].axis_input_shaper;
   if (freq != axis_input_shaper->frequency || dampe != axis_input_shaper->zeta || type != (int)axis_input_shaper->type) {
     axis_input_shaper->setConfig(type, freq, dampe);
@@ -72,10 +157,20 @@ ErrCode AxisManager::input_shaper_set(int axis, int type, float freq, float damp
   return E_SUCCESS;
 }
 
-ErrCode AxisManager::input_shaper_get(int axis, int &type, float &freq, float &dampe) {
+ErrCode AxisManager::input_shaper_get(int axis, int &type, float &freq, float &dampe, uint8_t tool) {
 
   if (axis != X_AXIS && axis != Y_AXIS) return E_PARAM;
 
+  if (axis == X_AXIS && tool != X_SHAPER_ANY_TOOL) {
+    if (tool >= X_SHAPER_TOOLS) return E_PARAM;
+    shaper_config_t config;
+    x_shaper_config(tool, config);
+    type = config.type;
+    freq = config.frequency;
+    dampe = config.zeta;
+    return E_SUCCESS;
+  }
+
   AxisInputShaper* axis_input_shaper = axisManager.axis[axis].axis_input_shaper;
   type = (int)axis_input_shaper->type;
   freq = axis_input_shaper->frequency;
@@ -90,6 +185,15 @@ void AxisManager::show_debug_info() {
   for (int i = 0; i < SHAPER_DBG_MAX; i++) {
     LOG_I("[%s] = %d\n", dbg_name[i], counts[i]);
   }
+  LOG_I("step merge window: %d ticks\n", step_merge_ticks);
+  LOG_I("X smoothing: %.3f mm, max accel: %d mm/s^2\n", AxisInputShaper::axis_input_shaper_x.smoothing, (int)AxisInputShaper::axis_input_shaper_x.max_accel);
+  LOG_I("Y smoothing: %.3f mm, max accel: %d mm/s^2\n", AxisInputShaper::axis_input_shaper_y.smoothing, (int)AxisInputShaper::axis_input_shaper_y.max_accel);
+  LOG_I("shaper accel limit: %d\n", shaper_accel_limit);
+  if (counts[SHAPER_DBG_PLAN_BLOCKS]) {
+    const float blocks = counts[SHAPER_DBG_PLAN_BLOCKS];
+    LOG_I("planner kernels per block: reverse %.2f, forward %.2f, trapezoid %.2f\n",
+          counts[SHAPER_DBG_PLAN_REVERSE] / blocks, counts[SHAPER_DBG_PLAN_FORWARD] / blocks, counts[SHAPER_DBG_PLAN_TRAPEZOID] / blocks);
+  }
 }
 
 
@@ -111,6 +215,28 @@ void GcodeSuite::M593() {
         axisManager.reset_debug_info();
         return;
     }
+
+    if (parser.seen('H')) {
+        if (parser.value_bool()) {
+            axisManager.feedHold();
+        } else {
+            axisManager.feedResume();
+        }
+        LOG_I("feed hold: %d\n", axisManager.feed_hold_req);
+        return;
+    }
+
+    if (parser.seen('L')) {
+        axisManager.shaper_accel_limit = parser.value_bool();
+        LOG_I("shaper accel limit: %d\n", axisManager.shaper_accel_limit);
+        return;
+    }
+
+    if (parser.seen('W')) {
+        axisManager.step_merge_ticks = parser.value_ulong() * STEPPER_TIMER_TICKS_PER_US;
+        LOG_I("step merge window: %d ticks\n", axisManager.step_merge_ticks);
+        return;
+    }
     // if (axisManager.req_update_shaped) {
     //     LOG_I("Send too many\n");
     //     return;
@@ -119,7 +245,11 @@ void GcodeSuite::M593() {
     // if (parser.seen('P') || parser.seen('F') || parser.seen('D')) {
     //     update = true;
     // }
-    bool x = parser.seen('X');
+    // T<tool> picks the IDEX carriage the X parameters belong to, without it
+    // they change every carriage
+    const bool t = parser.seen('T');
+    const uint8_t tool = t ? parser.value_byte() : X_SHAPER_ANY_TOOL;
+    bool x = parser.seen('X') || t;
     bool y = parser.seen('Y');
     if (!x && !y) {
         x = true;
@@ -127,18 +257,25 @@ void GcodeSuite::M593() {
     }
 
     if (x) {
-        AxisInputShaper* axis_input_shaper = axisManager.axis[0].axis_input_shaper;
-        float frequency = parser.floatval('F', axis_input_shaper->frequency);
-        float zeta = parser.floatval('D', axis_input_shaper->zeta);
-        int type = parser.floatval('P', (int)axis_input_shaper->type);
-        if (frequency != axis_input_shaper->frequency || zeta != axis_input_shaper->zeta || type != (int)axis_input_shaper->type) {
-            update = true;
+        if (t && tool >= X_SHAPER_TOOLS) {
+            LOG_E("X shaper: no tool %d\n", tool);
+            return;
         }
-        LOG_I("X type: %s, frequency: %lf, zeta: %lf\n", input_shaper_type_name[type], frequency, zeta);
-        if (!update) {
-            axis_input_shaper->logParams();
-        } else {
-            axis_input_shaper->setConfig(type, frequency, zeta);
+        const bool x_update = parser.seen('F') || parser.seen('D') || parser.seen('P');
+        if (!x_update) {
+            axisManager.axis[0].axis_input_shaper->logParams();
+        }
+        // Every carriage keeps what the command leaves out, a carriage without
+        // a frequency of its own keeps following T0 unless F gives it one
+        else for (uint8_t i = 0; i < X_SHAPER_TOOLS; i++) {
+            if (t ? i != tool : (i != 0 && axisManager.x_shaper[i].frequency == 0 && !parser.seen('F'))) continue;
+            int type; float frequency, zeta;
+            axisManager.input_shaper_get(X_AXIS, type, frequency, zeta, i);
+            frequency = parser.floatval('F', frequency);
+            zeta = parser.floatval('D', zeta);
+            type = parser.floatval('P', type);
+            LOG_I("X tool: %d type: %s, frequency: %lf, zeta: %lf\n", i, input_shaper_type_name[type], frequency, zeta);
+            axisManager.input_shaper_set(X_AXIS, type, frequency, zeta, i);
         }
     }
     if (y) {
@@ -338,6 +475,14 @@ FORCE_INLINE bool Axis::generateAxisFuncParams(uint8_t move_start, uint8_t move_
       continue;
     }
 
+    #if ENABLED(SHAPER_Z_MESH)
+      if (axis == Z_AXIS && zMesh.active) {
+        zMesh.addMoveFuncParams(func_manager, *move, mesh_base, mesh_last);
+        move_index = moveQueue.nextMoveIndex(move_index);
+        continue;
+      }
+    #endif
+
     generateLineFuncParams(move);
 
     move_index = moveQueue.nextMoveIndex(move_index);
@@ -412,79 +557,426 @@ bool AxisManager::generateAllAxisFuncParams(uint8_t block_index, block_t* block)
     return res;
 }
 
-// /*
-//  Copy next step's information to axis_stepper
-//  and mark is_consumed = true;
-// */
-// bool AxisManager::getNextAxisStepper(AxisStepper *axis_stepper) {
-//     if (getAxisStepperSize() == 0) {
-//         return false;
-//     }
+/*
+ Fit the longest run at the start of the pending steps of an axis that a
+ single (interval, count, add) move reproduces within STEP_COMPRESS_MAX_ERR.
+ Each run length tries the interval that fit the shorter run, then the ones
+ within the allowed error of the first step, takes the add from the last
+ step of the run and checks every step. An interval off the first step
+ lets an integer interval drift from both sides of the ideal one.
+*/
+uint8_t AxisManager::compressSteps(uint8_t i, step_move_t &move) {
+    step_time_t *steps = pending_steps[i];
+    uint8_t n = pending_count[i];
+    step_time_t base = produced_last[i];
+
+    int32_t first = (int32_t)(steps[0] - base);
+
+    uint8_t count = 1;
+    int32_t interval = first < 0 ? 0 : first;
+    int32_t add = 0;
+    int32_t max_err = 0;
+
+    for (uint8_t c = 2; c <= n; c++) {
+        bool fit = false;
+        for (int32_t d = -1; d <= (int32_t)(2 * STEP_COMPRESS_MAX_ERR) && !fit; d++) {
+            // The interval of the shorter run first, then around the first step
+            int32_t try_interval = d < 0 ? interval : first + ((d & 1) ? (d + 1) / 2 : -d / 2);
+            if (try_interval < 0 || (d >= 0 && try_interval == interval)) {
+                continue;
+            }
+            int32_t span = (int32_t)(steps[c - 1] - base) - c * try_interval;
+            int32_t div = c * (c - 1) / 2;
+            int32_t try_add = span >= 0 ? (span + div / 2) / div : (span - div / 2) / div;
+            if (try_add < INT16_MIN || try_add > INT16_MAX) {
+                continue;
+            }
 
-//     AxisStepper* current_stepper = &axis_steppers[axis_steppper_tail];
-//     axis_stepper->axis = current_stepper->axis;
-//     axis_stepper->dir = current_stepper->dir;
-//     axis_stepper->delta_time = current_stepper->delta_time;
-//     axis_stepper->print_time = current_stepper->print_time;
+            int32_t cur = try_interval;
+            int32_t time = try_interval;
+            int32_t err_max = ABS(time - first);
+            fit = err_max <= STEP_COMPRESS_MAX_ERR;
+            for (uint8_t k = 1; k < c && fit; k++) {
+                cur += try_add;
+                time += cur;
+                int32_t err = ABS(time - (int32_t)(steps[k] - base));
+                if (cur < 0 || err > STEP_COMPRESS_MAX_ERR) {
+                    fit = false;
+                }
+                NOLESS(err_max, err);
+            }
+            if (fit) {
+                count = c;
+                interval = try_interval;
+                add = try_add;
+                max_err = err_max;
+            }
+        }
+        if (!fit) {
+            break;
+        }
+    }
 
-//     if (print_axis != T0_T1_AXIS_INDEX) {
-//         current_steps[print_axis] += print_dir;
-//     }
+    move.interval = interval;
+    move.add = add;
+    move.count = count | (pending_dir[i] < 0 ? STEP_MOVE_DIR_NEG : 0);
 
-//     axis_steppper_tail = nextAxisStepper(axis_steppper_tail);
-//     return true;
-// }
+    // Chain the next move on the time the ISR will give the last step
+    produced_last[i] = base + count * interval + add * (count - 1) * count / 2;
+
+    counts[SHAPER_DBG_STEP_MOVES]++;
+    counts[SHAPER_DBG_STEP_COUNT] += count;
+    NOLESS(counts[SHAPER_DBG_STEP_MAX_ERR], max_err);
+
+    return count;
+}
 
 /*
- Calcuation all axes's next step's time if need
- And then return the closest time axis if we have
+ Calculate up to budget steps of an axis and queue them as compressed moves.
+ A run is compressed once it cannot grow any more: the pending buffer is
+ full, the direction changes or the FuncManager has no more steps. flush
+ compresses whatever is pending, and so does a queue running short: the
+ steps held for a longer run may be all the ISR has until the next pass.
 */
-bool AxisManager::calcNextAxisStepper() {
-    if (getAxisStepperFreeSize() == 0) {
-        return false;
+void AxisManager::fillAxis(uint8_t i, uint8_t budget, bool flush) {
+    Axis &ax = axis[i];
+    bool exhausted = false;
+    bool stopped = false;
+    bool held;
+
+    // Calculate until the pending buffer is full, compress what is done and
+    // go on while the budget and the queue last
+    do {
+        while (pending_count[i] < STEP_PENDING_SIZE) {
+            if (ax.is_consumed) {
+                if (!budget) {
+                    break;
+                }
+                if (!ax.getNextStep()) {
+                    exhausted = true;
+                    break;
+                }
+                budget--;
+            }
+            step_time_t p = timeToTicks(ax.print_time);
+            // A feed hold keeps the steps past the stop point for the resume
+            if (feed_hold == FEED_HOLD_STOPPING && !STEP_TIME_BEFORE(p, feed_hold_start + FEED_HOLD_RAMP_TICKS / 2)) {
+                stopped = true;
+                break;
+            }
+            // A direction change ends the run, the step waits for the next one
+            if (pending_count[i] && ax.dir != pending_dir[i]) {
+                break;
+            }
+            pending_dir[i] = ax.dir;
+            pending_steps[i][pending_count[i]++] = printToStepTicks(p);
+            produced_print[i] = p;
+            produced_step[i] = p;
+            produced_idle[i] = false;
+            ax.is_consumed = true;
+            if (ax.print_time > print_time) {
+                print_time = ax.print_time;
+            }
+        }
+
+        held = !ax.is_consumed;
+        while (pending_count[i] && getStepMoveFreeSize(i) &&
+               (flush || held || exhausted || pending_count[i] == STEP_PENDING_SIZE || getStepMoveSize(i) < STEP_MOVE_LOW)) {
+            step_move_t move;
+            uint8_t count = compressSteps(i, move);
+
+            uint8_t head = step_move_head[i];
+            step_moves[i][head].interval = move.interval;
+            step_moves[i][head].add = move.add;
+            step_moves[i][head].count = move.count;
+            STEP_QUEUE_BARRIER();
+            step_move_head[i] = STEP_MOVE_MOD(head + 1);
+
+            pending_count[i] -= count;
+            memmove(pending_steps[i], pending_steps[i] + count, pending_count[i] * sizeof(step_time_t));
+        }
+    } while (budget && !exhausted && !stopped && pending_count[i] < STEP_PENDING_SIZE && getStepMoveFreeSize(i));
+
+    // Tell the ISR how far it may run without a step of this axis
+    if (pending_count[i]) {
+        produced_until[i] = pending_steps[i][0] - 1;
+    } else if (held) {
+        produced_until[i] = printToStepTicks(timeToTicks(ax.print_time)) - 1;
+    } else if (exhausted) {
+        produced_idle[i] = true;
+        produced_print[i] = timeToTicks(ax.func_manager.last_time);
+        produced_until[i] = printToStepTicks(produced_print[i]);
+    } else {
+        produced_until[i] = produced_last[i];
     }
+}
 
-    // If a axis has been consumed, calculate the next step time
-    for (int i = 0; i < AXIS_SIZE; ++i) {
-        if (axis[i].is_consumed) {
-            axis[i].getNextStep();
+/*
+ Producer side of the step queues, runs from idle().
+ The ISR only calculates steps itself when an axis is starved
+ and this is not in progress.
+*/
+void AxisManager::fillAxisSteppers() {
+    if (req_abort) {
+        return;
+    }
+
+    producing = true;
+    STEP_QUEUE_BARRIER();
+    if (feed_hold_req != feed_hold || feed_park_back_req) {
+        applyFeedHold();
+    }
+    for (uint8_t i = 0; i < AXIS_SIZE; ++i) {
+        if (req_abort) {
+            break;
         }
+        fillAxis(i, AXIS_STEPPER_FILL_BUDGET, false);
     }
+    STEP_QUEUE_BARRIER();
+    producing = false;
+}
 
-    bool is_consumed = true;
+/*
+ Called from the stepper ISR when peekStepAxis() found an axis without
+ queued moves that may still have a step before the earliest known one.
+*/
+int8_t AxisManager::feedStarvedAxes(step_time_t &time) {
+    if (producing) {
+        counts[SHAPER_DBG_STEP_STALL]++;
+        return STEP_AXIS_STALL;
+    }
 
-    // Fine the closest time of all the axes
-    time_double_t min_print_time = 2000000000;
-    for (int i = 0; i < AXIS_SIZE; ++i) {
-        if (!axis[i].is_consumed) {
-            if (axis[i].print_time < min_print_time) {
-                min_print_time = axis[i].print_time;
-                print_axis = i;
-                is_consumed = false;
-            }
+    for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+        if (!step_state[i].count && step_move_tail[i] == step_move_head[i] && STEP_TIME_BEFORE(produced_until[i], time)) {
+            fillAxis(i, AXIS_STEPPER_ISR_BUDGET, true);
         }
     }
+    counts[SHAPER_DBG_STEP_UNDERRUN]++;
+
+    int8_t i = peekStepAxis(time);
+    if (i == STEP_AXIS_STALL) {
+        counts[SHAPER_DBG_STEP_STALL]++;
+    }
+    return i;
+}
+
+/*
+ Called from the stepper ISR when there is slack before the next step,
+ helps the axis that is closest to starving if the producer fell behind.
+*/
+void AxisManager::topUpAxisSteppers() {
+    if (producing) {
+        return;
+    }
 
-    // is_consumed == false, means that we has a steps need to output
-    if (!is_consumed) {
-        axis[print_axis].is_consumed = true;
+    int8_t starving = -1;
+    for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+        if (step_move_tail[i] != step_move_head[i]) {
+            continue;
+        }
+        if (starving < 0 || STEP_TIME_BEFORE(produced_until[i], produced_until[starving])) {
+            starving = i;
+        }
+    }
+    if (starving >= 0) {
+        fillAxis(starving, 2, false);
+    }
+}
 
-        print_dir = axis[print_axis].dir;
+/*
+ Stepper ticks of print ticks p at or after feed_hold_start. With the rate
+ s = 1 - u / R over the stepper time u of the deceleration ramp R, print
+ time advances by u - u^2 / 2R, so the axes stop after R / 2 print ticks.
+ The acceleration ramp mirrors it from there.
+*/
+step_time_t AxisManager::feedHoldTicks(step_time_t p) {
+    const float ramp = FEED_HOLD_RAMP_TICKS;
+    const step_time_t w0 = feed_hold_start + time_offset;
+    int32_t q = (int32_t)(p - feed_hold_start);
 
-        AxisStepper* axis_stepper = &axis_steppers[axis_steppper_head];
+    if (q < FEED_HOLD_RAMP_TICKS / 2) {
+        return w0 + (int32_t)(ramp * (1.0f - SQRT(1.0f - 2.0f * q / ramp)));
+    }
+    if (feed_hold == FEED_HOLD_STOPPING) {
+        // Not before the resume, which comes right after the stop point
+        return w0 + FEED_HOLD_RAMP_TICKS;
+    }
+    q -= FEED_HOLD_RAMP_TICKS / 2;
+    if (q < FEED_HOLD_RAMP_TICKS / 2) {
+        return w0 + FEED_HOLD_RAMP_TICKS + (int32_t)SQRT(2.0f * ramp * q);
+    }
+    return p + time_offset + FEED_HOLD_RAMP_TICKS;
+}
 
-        axis_stepper->axis = print_axis;
-        axis_stepper->dir = print_dir;
-        axis_stepper->delta_time = min_print_time - print_time;
-        axis_stepper->print_time = min_print_time;
+/*
+ Every axis has output its steps before the stop point
+*/
+bool AxisManager::feedHoldDrained() {
+    const step_time_t stop = feed_hold_start + time_offset + FEED_HOLD_RAMP_TICKS - 1;
+    for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+        if (step_state[i].count || step_move_tail[i] != step_move_head[i] || STEP_TIME_BEFORE(produced_until[i], stop)) {
+            return false;
+        }
+    }
+    return true;
+}
 
-        print_time = min_print_time;
+/*
+ Fold a finished resume into the offset and leave the hold. Every axis has
+ to be past the end of the acceleration ramp, or have nothing to step: its
+ next steps are then only shifted later by what is left of the ramp.
+*/
+bool AxisManager::foldFeedResume() {
+    const step_time_t ramp_end = feed_hold_start + FEED_HOLD_RAMP_TICKS;
+    for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+        if (!produced_idle[i] && STEP_TIME_BEFORE(produced_print[i], ramp_end)) {
+            return false;
+        }
+    }
 
-        axis_steppper_head = nextAxisStepper(axis_steppper_head);
+    DISABLE_ISRS();
+    time_offset += FEED_HOLD_RAMP_TICKS;
+    feed_hold = FEED_HOLD_NONE;
+    feed_hold_gen++;
+    ENABLE_ISRS();
+    return true;
+}
 
-        return true;
-    } else {
+/*
+ Time of step k of n of a park move: the position goes as 2x^2 over the
+ first half of FEED_HOLD_PARK_TICKS and mirrors that over the second.
+*/
+static uint32_t parkStepTicks(uint32_t k, uint32_t n) {
+    const float x = (float)k / n;
+    const float f = x <= 0.5f ? SQRT(x * 0.5f) : 1.0f - SQRT((1.0f - x) * 0.5f);
+    return (uint32_t)(f * FEED_HOLD_PARK_TICKS);
+}
+
+/*
+ Next pulse phase of the park, called by the ISR while it stands at the
+ stop point. step_now and the time mapping stay where they are, so the
+ planned steps go on from the stop point once the park is back.
+*/
+bool AxisManager::getParkStepBundle(AxisStepper* axis_stepper) {
+    if (feed_park != FEED_PARK_OUT && feed_park != FEED_PARK_BACK) {
+        return false;
+    }
+
+    uint32_t next[AXIS_SIZE];
+    int8_t first = STEP_AXIS_NONE;
+    for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+        const uint32_t n = ABS(feed_park_steps[i]);
+        if (feed_park_done[i] >= n) {
+            continue;
+        }
+        next[i] = parkStepTicks(feed_park_done[i] + 1, n);
+        if (first == STEP_AXIS_NONE || next[i] < next[first]) {
+            first = i;
+        }
+    }
+    if (first == STEP_AXIS_NONE) {
+        feed_park = feed_park == FEED_PARK_OUT ? FEED_PARK_AWAY : FEED_PARK_NONE;
         return false;
     }
+
+    const bool out = feed_park == FEED_PARK_OUT;
+    axis_stepper->axis = first;
+    axis_stepper->axis_bits = 0;
+    axis_stepper->dir_bits = 0;
+    for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+        if (feed_park_done[i] >= (uint32_t)ABS(feed_park_steps[i]) || next[i] - next[first] > step_merge_ticks) {
+            continue;
+        }
+        const int8_t dir = (feed_park_steps[i] > 0) == out ? 1 : -1;
+        SBI(axis_stepper->axis_bits, i);
+        if (dir < 0) {
+            SBI(axis_stepper->dir_bits, i);
+        }
+        if (i == first) {
+            axis_stepper->dir = dir;
+        }
+        current_steps[i] += dir;
+        feed_park_done[i]++;
+    }
+    axis_stepper->delta_ticks = next[first] - feed_park_time;
+    axis_stepper->print_ticks = step_now;
+    feed_park_time = next[first];
+    return true;
+}
+
+/*
+ Send the park back, true once it is in place. A park that has not
+ started is dropped.
+*/
+bool AxisManager::returnFeedPark() {
+    DISABLE_ISRS();
+    if (feed_park == FEED_PARK_OUT && !feed_park_time) {
+        feed_park = FEED_PARK_NONE;
+    } else if (feed_park == FEED_PARK_AWAY) {
+        for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+            feed_park_done[i] = 0;
+        }
+        feed_park_time = 0;
+        feed_park = FEED_PARK_BACK;
+    }
+    const bool back = feed_park == FEED_PARK_NONE;
+    ENABLE_ISRS();
+    return back;
 }
 
+/*
+ Start or release a feed hold, runs in the producer so fillAxis() never
+ sees the mapping change halfway. The deceleration starts at the latest
+ step calculated on any axis, the steps already queued are not touched.
+ The FuncManager horizon of an idle axis does not count, no step of it is
+ calculated there. A park goes back before the resume.
+*/
+void AxisManager::applyFeedHold() {
+    if (feed_park_back_req) {
+        if (!returnFeedPark()) {
+            return;
+        }
+        feed_park_back_req = false;
+    }
+    if (feed_hold_req == feed_hold) {
+        return;
+    }
+
+    if (feed_hold == FEED_HOLD_RESUMING && !foldFeedResume()) {
+        return;
+    }
+
+    if (feed_hold_req == FEED_HOLD_STOPPING) {
+        step_time_t start = produced_step[0];
+        for (uint8_t i = 1; i < AXIS_SIZE; i++) {
+            if (STEP_TIME_BEFORE(start, produced_step[i])) {
+                start = produced_step[i];
+            }
+        }
+
+        bool park = false;
+        for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+            feed_park_steps[i] = feed_park_req[i];
+            feed_park_done[i] = 0;
+            feed_park_req[i] = 0;
+            park |= feed_park_steps[i] != 0;
+        }
+        feed_park_time = 0;
+
+        DISABLE_ISRS();
+        feed_hold_start = start;
+        feed_hold = FEED_HOLD_STOPPING;
+        feed_hold_drained = false;
+        feed_hold_gen++;
+        feed_park = park ? FEED_PARK_OUT : FEED_PARK_NONE;
+        ENABLE_ISRS();
+        LOG_I("feed hold at %d\n", start);
+    } else if (feed_hold == FEED_HOLD_STOPPING) {
+        DISABLE_ISRS();
+        feed_hold = FEED_HOLD_RESUMING;
+        feed_hold_drained = false;
+        feed_hold_gen++;
+        ENABLE_ISRS();
+        LOG_I("feed resume\n");
+    }
+}
@@ -25,13 +25,95 @@
 #include "shaper/AxisInputShaper.h"
 #include "shaper/FuncManager.h"
 #include "shaper/MoveQueue.h"
+#include "shaper/ZMesh.h"
 #include "../../../../snapmaker/debug/debug.h"
+#include "../../../../snapmaker/debug/flight_recorder.h"
 #include "../../../../snapmaker/J1/common_type.h"
 
 #define T0_T1_AXIS_INDEX  (4)
 
-#define AXIS_STEPPER_SIZE 4
-#define AXIS_STEPPER_MOD(n) ((n)&(AXIS_STEPPER_SIZE-1))
+// Steps are produced ahead of time by fillAxisSteppers() from idle() and
+// queued per axis as compressed (interval, count, add) moves, the stepper
+// ISR only expands them with integer adds.
+#define STEP_MOVE_QUEUE_SIZE      32  // per axis, power of 2
+#define STEP_MOVE_MOD(n)          ((n)&(STEP_MOVE_QUEUE_SIZE-1))
+#define STEP_PENDING_SIZE         32  // raw steps looked at when compressing
+#define STEP_MOVE_LOW             8   // below this many queued moves pending steps are not held for a longer run
+#define STEP_COMPRESS_MAX_ERR     (2 * STEPPER_TIMER_TICKS_PER_US)  // allowed timing error of a compressed step
+#define AXIS_STEPPER_FILL_BUDGET  64  // steps calculated per axis per idle() pass
+#define AXIS_STEPPER_ISR_BUDGET   4   // steps the ISR calculates for a starved axis
+#define AXIS_STEPPER_STALL_TICKS  (20 * STEPPER_TIMER_TICKS_PER_US)  // retry interval when starved
+
+// Stepper timer ticks since the last reset, wraps around
+typedef uint32_t step_time_t;
+#define STEP_TIME_BEFORE(a, b)    ((int32_t)((a) - (b)) < 0)
+
+// Step i of a move comes interval + i * add ticks after the previous step of the axis
+typedef struct {
+  uint32_t interval;
+  int16_t add;
+  uint16_t count;  // bit 15 set for negative direction
+} step_move_t;
+#define STEP_MOVE_DIR_NEG         0x8000
+
+// Expansion state of the move an axis is executing, owned by the stepper ISR
+typedef struct {
+  step_time_t next;  // time of the next step, or of the last one once count is 0
+  uint32_t interval;
+  int16_t add;
+  uint16_t count;  // steps left
+  int8_t dir;
+} step_axis_state_t;
+
+#define STEP_AXIS_NONE            -1
+#define STEP_AXIS_STALL           -2
+
+// X shaper of each IDEX carriage. While both carriages move (duplication and
+// mirrored) the X axis runs a combined model, see AxisManager::x_shaper_config().
+// A carriage with frequency 0 has no calibration of its own and follows T0.
+#define X_SHAPER_TOOLS            EXTRUDERS
+#define X_SHAPER_COMBINED         X_SHAPER_TOOLS
+#define X_SHAPER_ANY_TOOL         0xFF  // set: every carriage, get: the model the X axis runs
+
+typedef struct {
+  int type;
+  float frequency;
+  float zeta;
+} shaper_config_t;
+
+#define STEP_QUEUE_BARRIER()      __asm__ __volatile__("" ::: "memory")
+
+// Steps of other axes due within this window after the earliest one are
+// output in the same pulse phase, default of M593 W
+#define STEP_MERGE_WINDOW_US      5
+
+// Feed hold: print time advances at a rate ramped linearly from 1 down to 0
+// over FEED_HOLD_RAMP_MS of stepper time, and back up to 1 on resume, so every
+// axis, shaped ones included, slows down along its planned path. The planned
+// blocks, moves and functions are kept.
+#define FEED_HOLD_RAMP_MS         100
+#define FEED_HOLD_RAMP_TICKS      (FEED_HOLD_RAMP_MS * STEPPER_TIMER_TICKS_PER_MS)
+#define FEED_HOLD_IDLE_TICKS      STEPPER_TIMER_TICKS_PER_MS  // ISR poll interval once stopped
+
+enum FeedHoldState : uint8_t {
+  FEED_HOLD_NONE = 0,
+  FEED_HOLD_STOPPING,  // decelerating to, then standing at the stop point
+  FEED_HOLD_RESUMING,  // accelerating away from the stop point
+};
+
+// Once stopped, a feed hold moves the axes set with setFeedHoldPark() (a Z
+// hop, an E retract) by that many steps and back again before the resume.
+// Each way takes FEED_HOLD_PARK_MS with a triangular speed profile. The ISR
+// outputs these steps at the stop point, the planned moves are not touched.
+#define FEED_HOLD_PARK_MS         100
+#define FEED_HOLD_PARK_TICKS      (FEED_HOLD_PARK_MS * STEPPER_TIMER_TICKS_PER_MS)
+
+enum FeedHoldPark : uint8_t {
+  FEED_PARK_NONE = 0,  // nothing to move, or back in place
+  FEED_PARK_OUT,  // moving away once the axes stand
+  FEED_PARK_AWAY,
+  FEED_PARK_BACK,  // returning before the resume
+};
 
 enum InputShaperDebugInfoType {
   SHAPER_DBG_EMPTY_MOVES_COUNT = 0,
@@ -41,17 +123,35 @@ enum InputShaperDebugInfoType {
   SHAPER_DBG_CALC_STEP_TIMEOUT_COUNT,
   SHAPER_DBG_CALC_STEP_TIME,
   SHAPER_DBG_ABORT_END_BLOCK,
+  SHAPER_DBG_STEP_UNDERRUN,  // step queue ran dry, the ISR had to calculate the step
+  SHAPER_DBG_STEP_STALL,  // step queue ran dry while the producer was preempted
+  SHAPER_DBG_STEP_MOVES,  // compressed moves queued
+  SHAPER_DBG_STEP_COUNT,  // steps in those moves
+  SHAPER_DBG_STEP_MAX_ERR,  // largest timing error of a compressed step, in ticks
+  SHAPER_DBG_STEP_BUNDLES,  // pulse phases
+  SHAPER_DBG_STEP_MERGED,  // steps output early in the pulse phase of another axis
+  SHAPER_DBG_STEP_MAX_JITTER,  // largest such advance, in ticks
+  SHAPER_DBG_PLAN_BLOCKS,  // planner recalculations, one per queued block
+  SHAPER_DBG_PLAN_REVERSE,  // reverse pass kernel invocations
+  SHAPER_DBG_PLAN_FORWARD,  // forward pass kernel invocations
+  SHAPER_DBG_PLAN_TRAPEZOID,  // trapezoids recalculated
 
   SHAPER_DBG_MAX
 };
 
+// Stepper ISR timing slots kept after the named counters (DEBUG_ISR_CPU_USAGE)
+#define SHAPER_DBG_ISR_MAX_DELAY  (SHAPER_DBG_MAX)
+#define SHAPER_DBG_ISR_TICKS      (SHAPER_DBG_MAX + 1)
+
 class AxisStepper {
   public:
     int8_t axis = -1;
     int8_t last_axis = -1;
     int8_t dir = 0;
-    time_double_t print_time = 0;
-    float delta_time = 0;
+    uint8_t axis_bits = 0;  // all axes stepping in this pulse phase
+    uint8_t dir_bits = 0;  // set for the ones stepping negative
+    uint32_t delta_ticks = 0;  // stepper timer ticks since the previous step
+    step_time_t print_ticks = 0;  // stepper timer ticks since the last reset
 };
 
 class Axis {
@@ -78,6 +178,11 @@ class Axis {
 
     double delta_e = 0;
 
+    #if ENABLED(SHAPER_Z_MESH)
+      float mesh_base = 0;  // (steps) mesh height the correction counts from
+      float mesh_last = 0;  // (steps) correction where the last generated move ended
+    #endif
+
   private:
     int8_t axis;
 
@@ -125,6 +230,7 @@ class Axis {
         is_get_next_step_null = false;
 
         delta_e = 0;
+        TERN_(SHAPER_Z_MESH, mesh_last = 0);
 
         if (axis_input_shaper != nullptr) {
             axis_input_shaper->reset();
@@ -172,7 +278,7 @@ class Axis {
 
 class AxisManager {
   public:
-    int counts[20] = {0};
+    int counts[SHAPER_DBG_MAX + 2] = {0};
     bool T0_T1_simultaneously_move_req = false;
     bool T0_T1_simultaneously_move = false;
     float T0_T1_target_pos;
@@ -198,38 +304,82 @@ class AxisManager {
     float shaped_right_delta = 0;
     float shaped_delta_window = 0;
 
+    shaper_config_t x_shaper[X_SHAPER_TOOLS];
+    uint8_t x_shaper_selected = 0;  // tool index or X_SHAPER_COMBINED
+    bool shaper_accel_limit = ENABLED(SHAPER_ACCEL_LIMIT);  // planner holds X/Y to AxisInputShaper::max_accel
+
     // FuncManager Generate
     time_double_t min_last_time = 0;
 
     // FuncManager Consume
     // bool is_consumed = true;
-    time_double_t print_time = 0;
-    int8_t print_axis = -1;
-    int8_t print_dir = 0;
+    time_double_t print_time = 0;  // latest step calculated on any axis
     int current_steps[AXIS_SIZE];
 
-    AxisStepper axis_steppers[AXIS_STEPPER_SIZE];
-    uint8_t axis_steppper_tail;
-    uint8_t axis_steppper_head;
-
-    FORCE_INLINE uint8_t getAxisStepperSize() {
-        return AXIS_STEPPER_MOD(axis_steppper_head - axis_steppper_tail);
+    // Producer: raw steps waiting to be compressed
+    step_time_t pending_steps[AXIS_SIZE][STEP_PENDING_SIZE];
+    uint8_t pending_count[AXIS_SIZE];
+    int8_t pending_dir[AXIS_SIZE];
+    step_time_t produced_last[AXIS_SIZE];  // last step handed to the move queue, as the ISR will time it
+    volatile step_time_t produced_until[AXIS_SIZE];  // an axis with an empty queue has no step before this
+    volatile bool producing = false;  // fillAxisSteppers() is running, the ISR must not calculate
+
+    volatile step_move_t step_moves[AXIS_SIZE][STEP_MOVE_QUEUE_SIZE];
+    volatile uint8_t step_move_head[AXIS_SIZE];
+    volatile uint8_t step_move_tail[AXIS_SIZE];
+
+    // Consumer
+    step_axis_state_t step_state[AXIS_SIZE];
+    step_time_t step_now = 0;  // time of the step last output
+    bool step_stalled = false;
+    uint32_t step_merge_ticks = STEP_MERGE_WINDOW_US * STEPPER_TIMER_TICKS_PER_US;
+
+    // Feed hold, see printToStepTicks()
+    volatile uint8_t feed_hold_req = FEED_HOLD_NONE;  // applied by the producer
+    volatile uint8_t feed_hold = FEED_HOLD_NONE;
+    volatile uint8_t feed_hold_gen = 0;  // changes whenever the time mapping does
+    volatile bool feed_hold_drained = false;  // stopped, every step before the stop point is out
+    step_time_t feed_hold_start = 0;  // print ticks where the deceleration starts
+    int32_t time_offset = 0;  // stepper ticks minus print ticks outside of a ramp
+    step_time_t produced_print[AXIS_SIZE];  // no step of the axis is calculated before this
+    step_time_t produced_step[AXIS_SIZE];  // print ticks of the last step calculated
+    bool produced_idle[AXIS_SIZE];  // the FuncManager had no more steps at the last fill
+    volatile uint8_t feed_park = FEED_PARK_NONE;
+    volatile bool feed_park_back_req = false;  // applied by the producer
+    int32_t feed_park_req[AXIS_SIZE];  // park steps for the next hold
+    int32_t feed_park_steps[AXIS_SIZE];  // park steps of this hold, the sign is the way out
+    uint32_t feed_park_done[AXIS_SIZE];  // steps output this way
+    uint32_t feed_park_time;  // ticks into this way
+
+    static FORCE_INLINE step_time_t timeToTicks(time_double_t &t) {
+        return (step_time_t)t.i * STEPPER_TIMER_TICKS_PER_MS + (int32_t)(t.d * STEPPER_TIMER_TICKS_PER_MS);
     }
 
-    FORCE_INLINE uint8_t getAxisStepperFreeSize() { return AXIS_STEPPER_SIZE - 1 - getAxisStepperSize(); }
+    /*
+     Print ticks to stepper ticks. Outside of a feed hold this is a constant
+     offset, the ramps are handled by feedHoldTicks().
+    */
+    FORCE_INLINE step_time_t printToStepTicks(step_time_t p) {
+        if (feed_hold != FEED_HOLD_NONE && !STEP_TIME_BEFORE(p, feed_hold_start)) {
+            return feedHoldTicks(p);
+        }
+        return p + time_offset;
+    }
 
-    FORCE_INLINE uint8_t nextAxisStepper(uint8_t index) {
-        return AXIS_STEPPER_MOD(index + 1);
+    FORCE_INLINE uint8_t getStepMoveSize(uint8_t i) {
+        return STEP_MOVE_MOD(step_move_head[i] - step_move_tail[i]);
     }
 
-    FORCE_INLINE uint8_t prevAxisStepper(uint8_t index) {
-        return AXIS_STEPPER_MOD(index - 1);
+    FORCE_INLINE uint8_t getStepMoveFreeSize(uint8_t i) {
+        return STEP_MOVE_QUEUE_SIZE - 1 - getStepMoveSize(i);
     }
 
   public:
     void input_shaper_reset();
-    ErrCode input_shaper_set(int axis, int type, float freq, float dampe);
-    ErrCode input_shaper_get(int axis, int &type, float &freq, float &dampe);
+    ErrCode input_shaper_set(int axis, int type, float freq, float dampe, uint8_t tool = X_SHAPER_ANY_TOOL);
+    ErrCode input_shaper_get(int axis, int &type, float &freq, float &dampe, uint8_t tool = X_SHAPER_ANY_TOOL);
+    void x_shaper_config(uint8_t selected, shaper_config_t &config);
+    void select_x_shaper();
     void show_debug_info();
     void reset_debug_info();
 
@@ -291,14 +441,40 @@ class AxisManager {
         min_last_time = 0;
 
         print_time = 0;
-        print_axis = -1;
-        print_dir = 0;
 
-        axis_steppper_tail = 0;
-        axis_steppper_head = 0;
+        for (int i = 0; i < AXIS_SIZE; i++) {
+            pending_count[i] = 0;
+            pending_dir[i] = 0;
+            produced_last[i] = 0;
+            produced_until[i] = 0;
+            step_move_head[i] = 0;
+            step_move_tail[i] = 0;
+            step_state[i].next = 0;
+            step_state[i].count = 0;
+        }
+        step_now = 0;
+        step_stalled = false;
+
+        for (int i = 0; i < AXIS_SIZE; i++) {
+            produced_print[i] = 0;
+            produced_step[i] = 0;
+            produced_idle[i] = true;
+        }
+        feed_hold_req = FEED_HOLD_NONE;
+        feed_hold = FEED_HOLD_NONE;
+        feed_hold_drained = false;
+        feed_hold_start = 0;
+        time_offset = 0;
+        feed_hold_gen++;
+        feed_park = FEED_PARK_NONE;
+        feed_park_back_req = false;
+        for (int i = 0; i < AXIS_SIZE; i++) {
+            feed_park_req[i] = 0;
+        }
     }
 
     void abort() {
+        flight_record(FLIGHT_RECORD_ABORT, 0, moveQueue.getMoveSize());
         req_abort = true;
         moveQueue.reset();
         reset();
@@ -349,50 +525,132 @@ class AxisManager {
         return moveQueue.addEmptyMove(shaped_delta_window + 0.001f);
     }
 
-    FORCE_INLINE bool getNextZeroAxisStepper(AxisStepper* axis_stepper) {
-        if (getAxisStepperSize() == 0) {
+    FORCE_INLINE bool loadStepMove(uint8_t i) {
+        uint8_t tail = step_move_tail[i];
+        if (tail == step_move_head[i]) {
             return false;
         }
+        step_axis_state_t &state = step_state[i];
+        volatile step_move_t &move = step_moves[i][tail];
+        state.interval = move.interval;
+        state.add = move.add;
+        state.count = move.count & ~STEP_MOVE_DIR_NEG;
+        state.dir = (move.count & STEP_MOVE_DIR_NEG) ? -1 : 1;
+        state.next += state.interval;
+        step_move_tail[i] = STEP_MOVE_MOD(tail + 1);
+        return true;
+    }
 
-        AxisStepper* current_stepper = &axis_steppers[axis_steppper_tail];
-
-        if (current_stepper->delta_time > 0.005) {
-            return false;
+    /*
+     Earliest step over all axes. An axis without queued moves may still get
+     a step before produced_until, such a step must not be overtaken.
+    */
+    FORCE_INLINE int8_t peekStepAxis(step_time_t &time) {
+        int8_t best = STEP_AXIS_NONE;
+        for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+            if (!step_state[i].count && !loadStepMove(i)) {
+                continue;
+            }
+            if (best == STEP_AXIS_NONE || STEP_TIME_BEFORE(step_state[i].next, time)) {
+                best = i;
+                time = step_state[i].next;
+            }
+        }
+        if (best == STEP_AXIS_NONE) {
+            return STEP_AXIS_NONE;
+        }
+        for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+            if (!step_state[i].count && STEP_TIME_BEFORE(produced_until[i], time)) {
+                return STEP_AXIS_STALL;
+            }
         }
+        return best;
+    }
 
-        axis_stepper->axis = current_stepper->axis;
-        axis_stepper->dir = current_stepper->dir;
-        axis_stepper->delta_time = current_stepper->delta_time;
-        axis_stepper->print_time = current_stepper->print_time;
+    FORCE_INLINE void stepAxis(uint8_t i, AxisStepper* axis_stepper) {
+        step_axis_state_t &state = step_state[i];
 
-        if (axis_stepper->axis != T0_T1_AXIS_INDEX) {
-            current_steps[axis_stepper->axis] += axis_stepper->dir;
+        SBI(axis_stepper->axis_bits, i);
+        if (state.dir < 0) {
+            SBI(axis_stepper->dir_bits, i);
         }
+        current_steps[i] += state.dir;
 
-        axis_steppper_tail = nextAxisStepper(axis_steppper_tail);
-        return true;
-    };
+        if (--state.count) {
+            state.interval += state.add;
+            state.next += state.interval;
+        }
+    }
 
-    FORCE_INLINE bool getNextAxisStepper(AxisStepper* axis_stepper) {
-        if (getAxisStepperSize() == 0 && !calcNextAxisStepper()) {
+    /*
+     Next pulse phase: the earliest step plus the steps of every other axis
+     due within step_merge_ticks of it, output together.
+    */
+    FORCE_INLINE bool getNextStepBundle(AxisStepper* axis_stepper) {
+        step_time_t time;
+        int8_t first = peekStepAxis(time);
+        if (first == STEP_AXIS_STALL) {
+            first = feedStarvedAxes(time);
+        }
+        if (first == STEP_AXIS_NONE && feed_hold == FEED_HOLD_STOPPING) {
+            // Standing at the stop point, or the producer has not got there yet
+            const bool drained = feedHoldDrained();
+            if (drained && getParkStepBundle(axis_stepper)) {
+                step_stalled = false;
+                return true;
+            }
+            feed_hold_drained = drained && feed_park != FEED_PARK_OUT;
+            first = STEP_AXIS_STALL;
+        }
+        step_stalled = (first == STEP_AXIS_STALL);
+        if (first < 0) {
             return false;
         }
 
-        AxisStepper* current_stepper = &axis_steppers[axis_steppper_tail];
-        axis_stepper->axis = current_stepper->axis;
-        axis_stepper->dir = current_stepper->dir;
-        axis_stepper->delta_time = current_stepper->delta_time;
-        axis_stepper->print_time = current_stepper->print_time;
-
-        if (axis_stepper->axis != T0_T1_AXIS_INDEX) {
-            current_steps[axis_stepper->axis] += axis_stepper->dir;
+        axis_stepper->axis = first;
+        axis_stepper->dir = step_state[first].dir;
+        axis_stepper->axis_bits = 0;
+        axis_stepper->dir_bits = 0;
+        axis_stepper->delta_ticks = time - step_now;
+        axis_stepper->print_ticks = time;
+        step_now = time;
+
+        stepAxis(first, axis_stepper);
+        for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+            if (i == first || !step_state[i].count) {
+                continue;
+            }
+            uint32_t advance = step_state[i].next - time;
+            if ((int32_t)advance >= 0 && advance <= step_merge_ticks) {
+                stepAxis(i, axis_stepper);
+                counts[SHAPER_DBG_STEP_MERGED]++;
+                NOLESS(counts[SHAPER_DBG_STEP_MAX_JITTER], (int)advance);
+            }
         }
-
-        axis_steppper_tail = nextAxisStepper(axis_steppper_tail);
+        counts[SHAPER_DBG_STEP_BUNDLES]++;
         return true;
     };
 
-    bool calcNextAxisStepper();
+    void fillAxisSteppers();
+    void topUpAxisSteppers();
+
+    void feedHold() { feed_hold_req = FEED_HOLD_STOPPING; }
+    void feedResume() { feed_park_back_req = true; feed_hold_req = FEED_HOLD_NONE; }
+    bool isFeedHeld() { return feed_hold_drained; }
+    void setFeedHoldPark(uint8_t i, int32_t steps) { feed_park_req[i] = steps; }
+    void feedHoldUnpark() { feed_park_back_req = true; }
+    bool isFeedParked() { return feed_park != FEED_PARK_NONE; }
+
+  private:
+    step_time_t feedHoldTicks(step_time_t p);
+    bool feedHoldDrained();
+    void applyFeedHold();
+    bool foldFeedResume();
+    bool returnFeedPark();
+    bool getParkStepBundle(AxisStepper* axis_stepper);
+    uint8_t compressSteps(uint8_t i, step_move_t &move);
+    void fillAxis(uint8_t i, uint8_t budget, bool flush);
+    int8_t feedStarvedAxes(step_time_t &time);
 };
 
 
@@ -1290,6 +1290,7 @@ FORCE_INLINE void segment_idle(millis_t &next_idle_ms) {
           if (DEBUGGING(LEVELING)) DEBUG_ECHOLNPGM("set_duplication_enabled(true)\nidex_set_parked(false)");
           break;
       }
+      axisManager.select_x_shaper();    // Mode may have been restored behind tool_change()
       idex_set_parked(false);           // No longer parked
       update_software_endstops(X_AXIS, 0, active_extruder);
       apply_motion_limits(destination);
@@ -70,6 +70,7 @@
 #include "../gcode/parser.h"
 #include "AxisManager.h"
 #include "../../../../snapmaker/debug/debug.h"
+#include "../../../../snapmaker/debug/flight_recorder.h"
 #include "../../../../snapmaker/module/print_control.h"
 #include "../../../../snapmaker/module/system.h"
 
@@ -989,6 +990,7 @@ void Planner::calculate_trapezoid_for_block(block_t * const block, const_float_t
 
 // The kernel called by recalculate() when scanning the plan from last to first entry.
 void Planner::reverse_pass_kernel(block_t * const current, const block_t * const next) {
+  axisManager.counts[SHAPER_DBG_PLAN_REVERSE]++;
   if (current) {
     // If entry speed is already at the maximum entry speed, and there was no change of speed
     // in the next block, there is no need to recheck. Block is cruising and there is no need to
@@ -1086,6 +1088,7 @@ void Planner::reverse_pass() {
 
 // The kernel called by recalculate() when scanning the plan from first to last entry.
 void Planner::forward_pass_kernel(const block_t * const previous, block_t * const current, const uint8_t block_index) {
+  axisManager.counts[SHAPER_DBG_PLAN_FORWARD]++;
   if (previous) {
     // If the previous block is an acceleration block, too short to complete the full speed
     // change, adjust the entry speed accordingly. Entry speeds have already been reset,
@@ -1231,6 +1234,7 @@ void Planner::recalculate_trapezoids() {
             // block->initial_speed = current_entry_speed;
             // block->final_speed = next_entry_speed;
             calculate_trapezoid_for_block(block, current_entry_speed, next_entry_speed);
+            axisManager.counts[SHAPER_DBG_PLAN_TRAPEZOID]++;
 
             // #if ENABLED(LIN_ADVANCE)
             //   if (block->use_advance_lead) {
@@ -1273,6 +1277,7 @@ void Planner::recalculate_trapezoids() {
       // next->initial_speed = next_entry_speed;
       // next->final_speed = float(MINIMUM_PLANNER_SPEED);
       calculate_trapezoid_for_block(next, next_entry_speed, float(MINIMUM_PLANNER_SPEED));
+      axisManager.counts[SHAPER_DBG_PLAN_TRAPEZOID]++;
       // #if ENABLED(LIN_ADVANCE)
       //   if (next->use_advance_lead) {
       //     const float comp = next->e_D_ratio * extruder_advance_K[active_extruder] * settings.axis_steps_per_mm[E_AXIS];
@@ -1291,6 +1296,7 @@ void Planner::recalculate_trapezoids() {
 void Planner::recalculate() {
   // Initialize block index to the last block in the planner buffer.
   const uint8_t block_index = prev_block_index(block_buffer_head);
+  axisManager.counts[SHAPER_DBG_PLAN_BLOCKS]++;
   // If there is just one block, no planning can be done. Avoid it!
   if (block_index != block_buffer_planned) {
     reverse_pass();
@@ -1422,6 +1428,12 @@ void Planner::shaped_loop() {
 
     // LOG_I("remainingConsumeTime: %lf, %d, %d, %d, %d\n", axisManager.getRemainingConsumeTime(), tail_index, shaped_index, planned_index, head_index);
     delay_before_delivering = 0;
+    if (block_buffer_shaped != shaped_index) {
+      flight_record_shaper(movesplanned(),
+                           (uint32_t(axisManager.axis[Y_AXIS].func_manager.getSize()) << 20)
+                           | (uint32_t(axisManager.axis[X_AXIS].func_manager.getSize()) << 8)
+                           | moveQueue.getMoveSize());
+    }
     block_buffer_shaped = shaped_index;
 }
 
@@ -2292,6 +2304,10 @@ bool Planner::_populate_block(block_t * const block, bool split_move,
       block->axis_r.e = 0
     );
   }
+  #if ENABLED(SHAPER_Z_MESH)
+    block->shaper_data.start_steps[0] = position.a;
+    block->shaper_data.start_steps[1] = position.b;
+  #endif
 
   block->step_event_count = _MAX(LOGICAL_AXIS_LIST(
     esteps, block->steps.a, block->steps.b, block->steps.c, block->steps.i, block->steps.j, block->steps.k
@@ -2669,6 +2685,16 @@ bool Planner::_populate_block(block_t * const block, bool split_move,
     NOMORE(block->acceleration, print_control.pnm_param.max_acc);
   }
 
+  // Hold X and Y to what their input shaper smooths acceptably, see AxisInputShaper::calcSmoothing()
+  if (axisManager.shaper_accel_limit) {
+    const float max_accel_x = AxisInputShaper::axis_input_shaper_x.max_accel,
+                max_accel_y = AxisInputShaper::axis_input_shaper_y.max_accel,
+                ratio_x = ABS(steps_dist_mm.x) * inverse_millimeters,
+                ratio_y = ABS(steps_dist_mm.y) * inverse_millimeters;
+    if (max_accel_x > 0 && block->acceleration * ratio_x > max_accel_x) block->acceleration = max_accel_x / ratio_x;
+    if (max_accel_y > 0 && block->acceleration * ratio_y > max_accel_y) block->acceleration = max_accel_y / ratio_y;
+  }
+
   if (settings.acceleration_to_deceleration_ratio > 20) {
     block->acceleration_to_deceleration = block->acceleration * settings.acceleration_to_deceleration_ratio * 0.01;
   } else {
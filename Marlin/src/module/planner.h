@@ -168,6 +168,10 @@ typedef struct shaper_data_t {
 
     time_double_t last_print_time;
 
+    #if ENABLED(SHAPER_Z_MESH)
+      int32_t start_steps[2];  // X/Y where the block starts, for the Z mesh
+    #endif
+
     void init() {
         is_create_move = false;
         is_zero_speed = false;
@@ -36,7 +36,7 @@
  */
 
 // Change EEPROM version if the structure changes
-#define EEPROM_VERSION "V86"
+#define EEPROM_VERSION "V89"
 #define EEPROM_OFFSET 100
 
 // Check the integrity of data offsets.
@@ -506,6 +506,18 @@ typedef struct SettingsDataStruct {
 
   uint8_t z_home_sg;
 
+  is_setting_t input_shaper_x1;                         // X shaper of T1, frequency 0 follows T0
+
+  #if ENABLED(SHAPER_Z_MESH)
+    float z_mesh[Z_MESH_GRID_Y][Z_MESH_GRID_X];         // M421 I J Z
+    bool z_mesh_valid;
+  #endif
+
+  #if ENABLED(MPCTEMP)
+    MPC_t mpc_constants[HOTENDS];                       // M306 P C R A F H
+    bool mpc_enabled[HOTENDS];                          // M306 M
+  #endif
+
 } SettingsData;
 
 //static_assert(sizeof(SettingsData) <= MARLIN_EEPROM_SIZE, "EEPROM too small to contain SettingsData!");
@@ -1381,11 +1393,10 @@ void MarlinSettings::postprocess() {
       _FIELD_TEST(input_shaper);
 
       int type; float freq, damp;
-      axisManager.input_shaper_get(X_AXIS, type, freq, damp);
       input_shaper[X_AXIS].axis = X_AXIS;
-      input_shaper[X_AXIS].type = type;
-      input_shaper[X_AXIS].freq = freq;
-      input_shaper[X_AXIS].dampe = damp;
+      input_shaper[X_AXIS].type = axisManager.x_shaper[0].type;
+      input_shaper[X_AXIS].freq = axisManager.x_shaper[0].frequency;
+      input_shaper[X_AXIS].dampe = axisManager.x_shaper[0].zeta;
       axisManager.input_shaper_get(Y_AXIS, type, freq, damp);
       input_shaper[Y_AXIS].axis = Y_AXIS;
       input_shaper[Y_AXIS].type = type;
@@ -1459,6 +1470,41 @@ void MarlinSettings::postprocess() {
     {
       EEPROM_WRITE(print_control.z_home_sg);
     }
+
+    //
+    // X input shaper of the second carriage
+    //
+    {
+      is_setting_t input_shaper_x1;
+      _FIELD_TEST(input_shaper_x1);
+      input_shaper_x1.axis = X_AXIS;
+      input_shaper_x1.type = axisManager.x_shaper[1].type;
+      input_shaper_x1.freq = axisManager.x_shaper[1].frequency;
+      input_shaper_x1.dampe = axisManager.x_shaper[1].zeta;
+      EEPROM_WRITE(input_shaper_x1);
+    }
+
+    //
+    // Z mesh of the shaper motion path
+    //
+    #if ENABLED(SHAPER_Z_MESH)
+    {
+      _FIELD_TEST(z_mesh);
+      EEPROM_WRITE(zMesh.z);
+      EEPROM_WRITE(zMesh.valid);
+    }
+    #endif
+
+    //
+    // Model predictive control of the hotends
+    //
+    #if ENABLED(MPCTEMP)
+    {
+      _FIELD_TEST(mpc_constants);
+      HOTEND_LOOP() EEPROM_WRITE(thermalManager.temp_hotend[e].constants);
+      HOTEND_LOOP() EEPROM_WRITE(thermalManager.temp_hotend[e].use_mpc);
+    }
+    #endif
   }
 
   /**
@@ -2412,9 +2458,7 @@ void MarlinSettings::postprocess() {
       _FIELD_TEST(input_shaper);
       EEPROM_READ(input_shaper);
 
-      AxisInputShaper::axis_input_shaper_x.type = (InputShaperType)input_shaper[0].type;
-      AxisInputShaper::axis_input_shaper_x.frequency = input_shaper[0].freq;
-      AxisInputShaper::axis_input_shaper_x.zeta = input_shaper[0].dampe;
+      axisManager.x_shaper[0] = { input_shaper[0].type, input_shaper[0].freq, input_shaper[0].dampe };
 
       AxisInputShaper::axis_input_shaper_y.type = (InputShaperType)input_shaper[1].type;
       AxisInputShaper::axis_input_shaper_y.frequency = input_shaper[1].freq;
@@ -2489,6 +2533,46 @@ void MarlinSettings::postprocess() {
     {
       EEPROM_READ(print_control.z_home_sg);
     }
+
+    //
+    // X input shaper of the second carriage
+    //
+    {
+      is_setting_t input_shaper_x1;
+      _FIELD_TEST(input_shaper_x1);
+      EEPROM_READ(input_shaper_x1);
+      axisManager.x_shaper[1] = { input_shaper_x1.type, input_shaper_x1.freq, input_shaper_x1.dampe };
+
+      shaper_config_t config;
+      axisManager.x_shaper_config(axisManager.x_shaper_selected, config);
+      AxisInputShaper::axis_input_shaper_x.setConfig(config.type, config.frequency, config.zeta);
+    }
+
+    //
+    // Z mesh of the shaper motion path
+    //
+    #if ENABLED(SHAPER_Z_MESH)
+    {
+      _FIELD_TEST(z_mesh);
+      EEPROM_READ(zMesh.z);
+      EEPROM_READ(zMesh.valid);
+      if (!validating) zMesh.restore();
+    }
+    #endif
+
+    //
+    // Model predictive control of the hotends
+    //
+    #if ENABLED(MPCTEMP)
+    {
+      _FIELD_TEST(mpc_constants);
+      HOTEND_LOOP() EEPROM_READ(thermalManager.temp_hotend[e].constants);
+      HOTEND_LOOP() {
+        EEPROM_READ(thermalManager.temp_hotend[e].use_mpc);
+        thermalManager.temp_hotend[e].modeled_block_temp = NAN; // Re-seed the model from the sensor
+      }
+    }
+    #endif
   }
 
   /**
@@ -3053,6 +3137,39 @@ void MarlinSettings::reset() {
   //
   TERN_(PID_EXTRUSION_SCALING, thermalManager.lpq_len = 20); // Default last-position-queue size
 
+  //
+  // Hotend MPC
+  //
+  #if ENABLED(MPCTEMP)
+  {
+    constexpr float heater_power[] = MPC_HEATER_POWER,
+                    block_heat_capacity[] = MPC_BLOCK_HEAT_CAPACITY,
+                    sensor_responsiveness[] = MPC_SENSOR_RESPONSIVENESS,
+                    ambient_xfer_coeff_fan0[] = MPC_AMBIENT_XFER_COEFF,
+                    ambient_xfer_coeff_fan255[] = MPC_AMBIENT_XFER_COEFF_FAN255,
+                    filament_heat_capacity_permm[] = FILAMENT_HEAT_CAPACITY_PERMM;
+    static_assert(COUNT(heater_power) == HOTENDS, "MPC_HEATER_POWER must have HOTENDS items.");
+    static_assert(COUNT(block_heat_capacity) == HOTENDS, "MPC_BLOCK_HEAT_CAPACITY must have HOTENDS items.");
+    static_assert(COUNT(sensor_responsiveness) == HOTENDS, "MPC_SENSOR_RESPONSIVENESS must have HOTENDS items.");
+    static_assert(COUNT(ambient_xfer_coeff_fan0) == HOTENDS, "MPC_AMBIENT_XFER_COEFF must have HOTENDS items.");
+    static_assert(COUNT(ambient_xfer_coeff_fan255) == HOTENDS, "MPC_AMBIENT_XFER_COEFF_FAN255 must have HOTENDS items.");
+    static_assert(COUNT(filament_heat_capacity_permm) == HOTENDS, "FILAMENT_HEAT_CAPACITY_PERMM must have HOTENDS items.");
+
+    HOTEND_LOOP() {
+      hotend_info_t &hotend = thermalManager.temp_hotend[e];
+      MPC_t &constants = hotend.constants;
+      hotend.use_mpc = TERN0(MPC_DEFAULT_ENABLED, true);
+      constants.heater_power = heater_power[e];
+      constants.block_heat_capacity = block_heat_capacity[e];
+      constants.sensor_responsiveness = sensor_responsiveness[e];
+      constants.ambient_xfer_coeff_fan0 = ambient_xfer_coeff_fan0[e];
+      constants.fan255_adjustment = ambient_xfer_coeff_fan255[e] - ambient_xfer_coeff_fan0[e];
+      constants.filament_heat_capacity_permm = filament_heat_capacity_permm[e];
+      hotend.modeled_block_temp = NAN; // Re-seed the model from the sensor
+    }
+  }
+  #endif
+
   //
   // Heated Bed PID
   //
@@ -3191,6 +3308,7 @@ void MarlinSettings::reset() {
   #endif
 
   axisManager.input_shaper_reset();
+  TERN_(SHAPER_Z_MESH, zMesh.reset());
 
   //
   // MKS UI controller
@@ -3676,6 +3794,23 @@ void MarlinSettings::reset() {
         }
       #endif // PIDTEMP
 
+      #if ENABLED(MPCTEMP)
+        HOTEND_LOOP() {
+          const MPC_t &constants = thermalManager.temp_hotend[e].constants;
+          CONFIG_ECHO_START();
+          SERIAL_ECHOPAIR("  M306 E", e, " M", thermalManager.temp_hotend[e].use_mpc);
+          SERIAL_ECHOPAIR_F(" P", constants.heater_power, 2);
+          SERIAL_ECHOPAIR_F(" C", constants.block_heat_capacity, 2);
+          SERIAL_ECHOPAIR_F(" R", constants.sensor_responsiveness, 4);
+          SERIAL_ECHOPAIR_F(" A", constants.ambient_xfer_coeff_fan0, 4);
+          #if ENABLED(MPC_INCLUDE_FAN)
+            SERIAL_ECHOPAIR_F(" F", constants.ambient_xfer_coeff_fan0 + constants.fan255_adjustment, 4);
+          #endif
+          SERIAL_ECHOPAIR_F(" H", constants.filament_heat_capacity_permm, 4);
+          SERIAL_EOL();
+        }
+      #endif
+
       #if ENABLED(PIDTEMPBED)
         CONFIG_ECHO_MSG(
             "  M304 P", thermalManager.temp_bed.pid.Kp
@@ -4126,14 +4261,25 @@ void MarlinSettings::reset() {
 
     {
       int type; float freq, damp;
-      axisManager.input_shaper_get(X_AXIS, type, freq, damp);
-      SERIAL_ECHOPAIR_P("M593 X P", type, " F", freq, " D", damp);
-      SERIAL_EOL();
+      LOOP_L_N(t, X_SHAPER_TOOLS) {
+        axisManager.input_shaper_get(X_AXIS, type, freq, damp, t);
+        SERIAL_ECHOPAIR_P("M593 X T", t, " P", type, " F", freq, " D", damp);
+        SERIAL_EOL();
+      }
       axisManager.input_shaper_get(Y_AXIS, type, freq, damp);
       SERIAL_ECHOPAIR_P("M593 Y P", type, " F", freq, " D", damp);
       SERIAL_EOL();
     }
 
+    #if ENABLED(SHAPER_Z_MESH)
+      if (zMesh.valid) {
+        LOOP_L_N(j, Z_MESH_GRID_Y) LOOP_L_N(i, Z_MESH_GRID_X) {
+          SERIAL_ECHOPAIR_P("M421 I", i, " J", j, " Z", zMesh.z[j][i]);
+          SERIAL_EOL();
+        }
+      }
+    #endif
+
     #if ENABLED(BACKLASH_GCODE)
       CONFIG_ECHO_HEADING("Backlash compensation:");
       CONFIG_ECHO_START();
@@ -86,7 +86,7 @@ void AxisInputShaper::init()
             float df = SQRT(1. - sq(zeta));
             float K = expf(-zeta * M_PI / df);
             float t_d = 1. / (frequency * df);
-            params.n = 4;
+            params.n = 5;
 
             params.A[0] = 1;
             params.A[1] = 4 * K;
@@ -206,10 +206,54 @@ void AxisInputShaper::init()
     }
 
     shiftPulses();
+    calcSmoothing();
 
     logParams();
 }
 
+/*
+ Smoothing as Klipper estimates it: how far the shaped path strays from the
+ commanded one on a 90 degree corner taken at SHAPER_SMOOTHING_SCV, and on a
+ 180 degree reversal. Both offsets are linear in the acceleration, so the
+ highest acceleration within SHAPER_TARGET_SMOOTHING is solved directly
+ rather than by bisection.
+*/
+void AxisInputShaper::calcSmoothing() {
+    float sum_a = 0., ts = 0.;
+    for (int i = 0; i < params.n; ++i) {
+        sum_a += params.A[i];
+        ts += params.A[i] * params.T[i];
+    }
+    float inv_a = 1. / sum_a;
+    ts *= inv_a;
+
+    // offset_90 = k_90 * accel + c_90, offset_180 = k_180 * accel
+    float k_90 = 0., c_90 = 0., k_180 = 0.;
+    for (int i = 0; i < params.n; ++i) {
+        float dt = params.T[i] - ts;
+        if (dt >= 0) {
+            c_90 += params.A[i] * SHAPER_SMOOTHING_SCV * dt;
+            k_90 += params.A[i] * 0.5f * sq(dt);
+        }
+        k_180 += params.A[i] * 0.5f * sq(dt);
+    }
+    k_90 *= inv_a * M_SQRT2;
+    c_90 *= inv_a * M_SQRT2;
+    k_180 *= inv_a;
+
+    smoothing = _MAX(k_90 * SHAPER_SMOOTHING_ACCEL + c_90, k_180 * SHAPER_SMOOTHING_ACCEL);
+
+    if (k_180 <= 0) {
+        max_accel = 0;  // Unshaped
+        return;
+    }
+    max_accel = SHAPER_TARGET_SMOOTHING / k_180;
+    if (k_90 > 0) {
+        NOMORE(max_accel, (SHAPER_TARGET_SMOOTHING - c_90) / k_90);
+    }
+    NOLESS(max_accel, SHAPER_MIN_ACCEL);
+}
+
 void AxisInputShaper::logParams() {
     // LOG_I("logParams\n");
     // LOG_I("n: %d\n", shift_params.n);
@@ -246,44 +290,6 @@ void AxisInputShaper::shiftPulses() {
     delta_window = right_delta + left_delta;
 }
 
-FORCE_INLINE void AxisInputShaper::addFuncParamsToManager(FuncManager *func_manager,float a, time_double_t right_time, float right_pos, float x2, float y1, float y2) {
-    float b = 0, c = 0;
-
-    float dx = x2;
-    float dy = y2 - y1;
-    if (dx < EPSILON) {
-        return;
-    }
-
-    if (IS_ZERO(a)) {
-        b = dy / dx;
-        c = y1;
-
-        int type = IS_ZERO(b) ? 0 : b > 0 ? 1 : -1;
-        func_manager->addFuncParams(a, b, c, type, right_time, right_pos);
-    } else {
-        b = dy / dx - a * x2;
-        c = y1;
-        float middle = 0.5f * x2 - dy / (dx * 2 * a);
-
-        if (EPSILON < middle && middle < x2 - EPSILON) {
-            float k = dy / dx;
-            float middle_pos = c - 0.25f * (sq(k) / a - 2 * k * x2 + a * sq(x2));
-            int type = a > 0 ? -1 : 1;
-            time_double_t middle_time = func_manager->last_time + middle;
-            func_manager->addFuncParams(a, b, c, type, middle_time, middle_pos);
-
-            type = -type;
-            b = 0.0f;
-            c = middle_pos;
-            func_manager->addFuncParams(a, b, c, type, right_time, right_pos);
-        } else {
-            int type = a > 0 ? middle < EPSILON ? 1 : -1 :middle < EPSILON ? -1 : 1;
-            func_manager->addFuncParams(a, b, c, type, right_time, right_pos);
-        }
-    }
-}
-
 float AxisInputShaper::calcPosition(int move_index, time_double_t time, int move_shaped_start, int move_shaped_end) {
     if (moveQueue.getMoveSize() == 0) {
         LOG_I("moveQueue.getMoveSize() zero\n");
@@ -349,7 +355,7 @@ FORCE_INLINE void AxisInputShaper::moveShaperWindowByIndex(FuncManager *func_man
     // shaper_window.updateABC();
     // shaper_window.updateABC(x1, y1, x2, y2);
     shaper_window.updateParamsA();
-    addFuncParamsToManager(func_manager, shaper_window.func_params.a, shaper_time, y2, x2, y1, y2);
+    func_manager->addQuadraticFuncParams(shaper_window.func_params.a, shaper_time, y2, x2, y1, y2);
 
     // LOG_I("move_index: %d, %d\n", shaper_window.params[0].move_index, shaper_window.params[1].move_index);
 }
@@ -414,7 +420,7 @@ bool AxisInputShaper::moveShaperWindowToNext(FuncManager *func_manager, uint8_t
     float y2 = shaper_window.pos;
 
     shaper_window.updateParamsA();
-    addFuncParamsToManager(func_manager, shaper_window.func_params.a, new_time, y2, x2, y1, y2);
+    func_manager->addQuadraticFuncParams(shaper_window.func_params.a, new_time, y2, x2, y1, y2);
     // shaper_window.updateABC();
     // shaper_window.updateABC(x1, y1, x2, y2);
 
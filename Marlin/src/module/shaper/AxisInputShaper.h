@@ -94,6 +94,7 @@ private:
   ShaperWindow shaper_window;
 
   void shiftPulses();
+  void calcSmoothing();
 
 public:
   static AxisInputShaper axis_input_shaper_x;
@@ -111,6 +112,9 @@ public:
 
   float shaped_func_all_time;
 
+  float smoothing = 0;  // (mm) at SHAPER_SMOOTHING_ACCEL
+  float max_accel = 0;  // (mm/s^2) keeps the smoothing under SHAPER_TARGET_SMOOTHING, 0 for no limit
+
   AxisInputShaper(){};
 
   void setConfig(int type, float frequency, float zeta) {
@@ -144,5 +148,4 @@ public:
 
   bool generateShapedFuncParams(FuncManager *func_manager, uint8_t move_shaper_start, uint8_t move_shaper_end);
 
-  FORCE_INLINE void addFuncParamsToManager(FuncManager *func_manager, float a, time_double_t right_time, float right_pos, float x2, float y1, float y2);
 };
\ No newline at end of file
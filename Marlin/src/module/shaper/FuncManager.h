@@ -72,7 +72,7 @@ class FuncParamsExtend {
 
 #define FUNC_PARAMS_X_SIZE 300
 #define FUNC_PARAMS_Y_SIZE 300
-#define FUNC_PARAMS_Z_SIZE 64
+#define FUNC_PARAMS_Z_SIZE TERN(SHAPER_Z_MESH, 128, 64)  // a mesh corrected move adds pieces per cell
 #define FUNC_PARAMS_E_SIZE 64
 #define FUNC_PARAMS_T_SIZE 8
 
@@ -213,6 +213,48 @@ class FuncManager {
     void addFuncParams(float a, float b, float c,int type, time_double_t right_time, float right_pos);
     void addFuncParamsExtend(double a, double b, double c, int type, time_double_t right_time, double right_pos);
 
+    /*
+     Add y = a * x^2 + b * x + y1 over the next x2 ms up to y2, a segment that
+     turns around is split at its vertex so every piece is monotone.
+    */
+    FORCE_INLINE void addQuadraticFuncParams(float a, time_double_t right_time, float right_pos, float x2, float y1, float y2) {
+        float b = 0, c = 0;
+
+        float dx = x2;
+        float dy = y2 - y1;
+        if (dx < EPSILON) {
+            return;
+        }
+
+        if (IS_ZERO(a)) {
+            b = dy / dx;
+            c = y1;
+
+            int type = IS_ZERO(b) ? 0 : b > 0 ? 1 : -1;
+            addFuncParams(a, b, c, type, right_time, right_pos);
+        } else {
+            b = dy / dx - a * x2;
+            c = y1;
+            float middle = 0.5f * x2 - dy / (dx * 2 * a);
+
+            if (EPSILON < middle && middle < x2 - EPSILON) {
+                float k = dy / dx;
+                float middle_pos = c - 0.25f * (sq(k) / a - 2 * k * x2 + a * sq(x2));
+                int type = a > 0 ? -1 : 1;
+                time_double_t middle_time = last_time + middle;
+                addFuncParams(a, b, c, type, middle_time, middle_pos);
+
+                type = -type;
+                b = 0.0f;
+                c = middle_pos;
+                addFuncParams(a, b, c, type, right_time, right_pos);
+            } else {
+                int type = a > 0 ? middle < EPSILON ? 1 : -1 :middle < EPSILON ? -1 : 1;
+                addFuncParams(a, b, c, type, right_time, right_pos);
+            }
+        }
+    }
+
     float getPos(time_double_t time);
 
     float getY(float x, float a, float b, float c) {
@@ -44,6 +44,27 @@ void MoveQueue::calculateMoves(block_t* block) {
     float acceleration = LROUND(block->acceleration) / 1000000.0f;
     float i_acceleration = 1000000.0f / LROUND(block->acceleration);
 
+    #if ENABLED(SHAPER_S_CURVE)
+        // The steps of an S-curve ramp peak at SHAPER_S_CURVE_PEAK_RATIO times their mean,
+        // so a block that gets them ramps at the mean that keeps the peak at the planned
+        // acceleration. Only when the ring has room for the split block, the block still
+        // joins its junction speeds at that rate and its longer ramp is worth splitting.
+        // Other blocks keep the planned trapezoid.
+        bool s_curve = false;
+        if (getFreeMoveSize() >= MOVE_S_CURVE_BLOCK_MOVES) {
+            const float s_acceleration = acceleration * (1.0f / (SHAPER_S_CURVE_PEAK_RATIO)),
+                        peak_speed = _MIN(cruise_speed, SQRT(s_acceleration * millimeters + 0.5f * (sq(entry_speed) + sq(leave_speed))));
+            if (ABS(sq(leave_speed) - sq(entry_speed)) <= 2 * s_acceleration * millimeters
+                && peak_speed - _MIN(entry_speed, leave_speed) >= s_acceleration * SHAPER_S_CURVE_MIN_RAMP_TIME) {
+                acceleration = s_acceleration;
+                i_acceleration = 1.0f / s_acceleration;
+                s_curve = true;
+            }
+        }
+    #else
+        constexpr bool s_curve = false;
+    #endif
+
     float accelDistance = Planner::estimate_acceleration_distance(entry_speed, cruise_speed, acceleration);
     // if (accelDistance > millimeters + EPSILON) {
         // LOG_I("error accelDistance: %lf, %lf\n", accelDistance, millimeters);
@@ -103,21 +124,21 @@ void MoveQueue::calculateMoves(block_t* block) {
 
     if (plateau == 0) {
         if (accelDistance > 0) {
-            addMove(entry_speed, cruise_speed, acceleration, accelDistance, axis_r, accelClocks);
+            addRampMoves(entry_speed, cruise_speed, acceleration, accelDistance, axis_r, accelClocks, s_curve);
         }
         if (decelDistance > 0) {
-            addMove(cruise_speed, leave_speed, -deceleration, decelDistance, axis_r, decelClocks);
+            addRampMoves(cruise_speed, leave_speed, -deceleration, decelDistance, axis_r, decelClocks, s_curve);
         }
     } else {
         if (accelDistance > 0) {
-            addMove(entry_speed, cruise_speed, acceleration, accelDistance, axis_r, accelClocks);
+            addRampMoves(entry_speed, cruise_speed, acceleration, accelDistance, axis_r, accelClocks, s_curve);
         }
 
         // LOG_I("p: %lf, s: %lf, t: %lf\n", plateau, cruise_speed, plateau / cruise_speed);
         addMove(cruise_speed, cruise_speed, 0, plateau, axis_r, plateauClocks);
 
         if (decelDistance > 0) {
-            addMove(cruise_speed, leave_speed, -deceleration, decelDistance, axis_r, decelClocks);
+            addRampMoves(cruise_speed, leave_speed, -deceleration, decelDistance, axis_r, decelClocks, s_curve);
         }
     }
 
@@ -125,6 +146,16 @@ void MoveQueue::calculateMoves(block_t* block) {
 
     block->shaper_data.move_end = prevMoveIndex(move_head);
 
+    #if ENABLED(SHAPER_Z_MESH)
+      // Where the block sits on the bed, set_position() does not reset the move positions
+      const float origin_x = block->shaper_data.start_steps[0] - moves[block->shaper_data.move_start].start_pos[X_AXIS],
+                  origin_y = block->shaper_data.start_steps[1] - moves[block->shaper_data.move_start].start_pos[Y_AXIS];
+      for (uint8_t i = block->shaper_data.move_start; i != move_head; i = nextMoveIndex(i)) {
+        moves[i].mesh_origin[0] = origin_x;
+        moves[i].mesh_origin[1] = origin_y;
+      }
+    #endif
+
     block->cruise_speed = cruise_speed * 1000;
 
     Move& end_move = moves[block->shaper_data.move_end];
@@ -150,6 +181,40 @@ void MoveQueue::calculateMoves(block_t* block) {
     block->shaper_data.last_print_time = moves[block->shaper_data.move_end].end_t;
 }
 
+/**
+ * Add one acceleration or deceleration ramp.
+ *
+ * With SHAPER_S_CURVE the ramp is split into SHAPER_S_CURVE_SEGMENTS equal-time
+ * constant-acceleration moves whose end speeds follow v0 + dv * (3s^2 - 2s^3).
+ * The curve is symmetric, so the steps cover exactly the same time and distance
+ * as the single trapezoidal ramp. The shaper and step generation still only see
+ * quadratic position segments. calculateMoves() lowers the ramp acceleration of
+ * the blocks it splits, so the steepest step stays at the planned acceleration.
+ */
+void MoveQueue::addRampMoves(float start_v, float end_v, float accelerate, float distance, xyze_float_t& axis_r, float t, bool s_curve) {
+    #if ENABLED(SHAPER_S_CURVE)
+        if (s_curve && t >= SHAPER_S_CURVE_MIN_RAMP_TIME) {
+            const float seg_t = t / SHAPER_S_CURVE_SEGMENTS, dv = end_v - start_v;
+            float v0 = start_v, remaining = distance;
+            LOOP_S_L_N(i, 1, SHAPER_S_CURVE_SEGMENTS) {
+                const float s = float(i) / SHAPER_S_CURVE_SEGMENTS,
+                            v1 = start_v + dv * S_CURVE_SPEED(s),
+                            d = 0.5f * (v0 + v1) * seg_t;
+                addMove(v0, v1, (v1 - v0) / seg_t, d, axis_r, seg_t);
+                remaining -= d;
+                v0 = v1;
+            }
+            // The last step takes the remainder so the block ends exactly on its target
+            addMove(v0, end_v, (end_v - v0) / seg_t, _MAX(remaining, 0.0f), axis_r, seg_t);
+            return;
+        }
+    #else
+        UNUSED(s_curve);
+    #endif
+
+    addMove(start_v, end_v, accelerate, distance, axis_r, t);
+}
+
 void MoveQueue::setMove(uint8_t move_index, float start_v, float end_v, float accelerate, float distance, xyze_float_t& axis_r, float t, uint8_t flag) {
     Move &move = moves[move_index];
 
@@ -199,6 +264,12 @@ void MoveQueue::setMove(uint8_t move_index, float start_v, float end_v, float ac
     move.start_pos_e = is_first ? E_START_POS : last_move.end_pos_e;
     move.end_pos_e = move.start_pos_e + move.distance * move.axis_r[E_AXIS];
 
+    #if ENABLED(SHAPER_Z_MESH)
+      // Moves outside of a block keep the origin of the one before, see calculateMoves()
+      move.mesh_origin[0] = is_first ? 0 : last_move.mesh_origin[0];
+      move.mesh_origin[1] = is_first ? 0 : last_move.mesh_origin[1];
+    #endif
+
     is_first = false;
 
     // LOG_I("v1: %lf, v2: %lf, s_p: %lf, e_p: %lf, t: %lf\n", start_v, end_v, move.start_pos[3], move.end_pos[3], t);
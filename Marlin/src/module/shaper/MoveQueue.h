@@ -33,6 +33,17 @@
 #define MOVE_FLAG_START 1
 #define MOVE_FLAG_END 2
 
+#if ENABLED(SHAPER_S_CURVE)
+  // Moves needed for one block with both ramps split
+  #define MOVE_S_CURVE_BLOCK_MOVES (2 * (SHAPER_S_CURVE_SEGMENTS) + 1)
+
+  // Ramp speed fraction at time fraction s, and the steepest step over the
+  // mean acceleration (1.375 for 4 steps). The steepest step is the middle one.
+  #define S_CURVE_SPEED(s)          ((s) * (s) * (3.0f - 2.0f * (s)))
+  #define S_CURVE_PEAK_STEP_START   (float(((SHAPER_S_CURVE_SEGMENTS) - 1) / 2) / (SHAPER_S_CURVE_SEGMENTS))
+  #define SHAPER_S_CURVE_PEAK_RATIO ((SHAPER_S_CURVE_SEGMENTS) * (S_CURVE_SPEED(S_CURVE_PEAK_STEP_START + 1.0f / (SHAPER_S_CURVE_SEGMENTS)) - S_CURVE_SPEED(S_CURVE_PEAK_STEP_START)))
+#endif
+
 class Move {
   public:
     uint8_t flag = 0;
@@ -49,6 +60,10 @@ class Move {
     double start_pos_e;
     double end_pos_e;
 
+    #if ENABLED(SHAPER_Z_MESH)
+      float mesh_origin[2];  // absolute X/Y steps of position 0, positions only count from the last reset
+    #endif
+
     time_double_t start_t = 0;
     time_double_t end_t = 0;
 };
@@ -86,6 +101,7 @@ class MoveQueue {
     }
 
     void calculateMoves(block_t* block);
+    void addRampMoves(float start_v, float end_v, float accelerate, float distance, xyze_float_t& axis_r, float t, bool s_curve);
 
     uint8_t addEmptyMove(float time);
     uint8_t addMoveStart();
@@ -0,0 +1,243 @@
+/*
+ * Snapmaker 3D Printer Firmware
+ * Copyright (C) 2023 Snapmaker [https://github.com/Snapmaker]
+ *
+ * This file is part of SnapmakerController-IDEX
+ * (see https://github.com/Snapmaker/SnapmakerController-IDEX)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ZMesh.h"
+#include "../AxisManager.h"
+#include "../motion.h"
+#include "../../gcode/gcode.h"
+#include "../../../../snapmaker/debug/debug.h"
+
+#if ENABLED(SHAPER_Z_MESH)
+
+// Grid lines closer than this to a piece end are not split at (ms)
+#define Z_MESH_MIN_PIECE_TIME   0.5f
+
+ZMesh zMesh;
+
+void ZMesh::reset() {
+  for (uint8_t j = 0; j < Z_MESH_GRID_Y; j++) {
+    for (uint8_t i = 0; i < Z_MESH_GRID_X; i++) {
+      z[j][i] = 0;
+      measured[j][i] = false;
+    }
+  }
+  valid = false;
+}
+
+void ZMesh::setPoint(const uint8_t i, const uint8_t j, const float height) {
+  z[j][i] = height;
+  measured[j][i] = true;
+  valid = !missing();
+}
+
+/*
+ After the grid was read back. Only a complete mesh is saved as valid,
+ anything else is dropped.
+*/
+void ZMesh::restore() {
+  if (!valid) {
+    reset();
+    return;
+  }
+  for (uint8_t j = 0; j < Z_MESH_GRID_Y; j++) {
+    for (uint8_t i = 0; i < Z_MESH_GRID_X; i++) {
+      measured[j][i] = true;
+    }
+  }
+}
+
+uint8_t ZMesh::missing() {
+  uint8_t n = 0;
+  for (uint8_t j = 0; j < Z_MESH_GRID_Y; j++) {
+    for (uint8_t i = 0; i < Z_MESH_GRID_X; i++) {
+      n += !measured[j][i];
+    }
+  }
+  return n;
+}
+
+void ZMesh::setActive(const bool on) {
+  if (on == active || (on && !valid)) {
+    return;
+  }
+
+  planner.synchronize();
+  // The nozzle stays put, its height above the surface becomes the planner Z
+  const float dz = getZ(current_position.x, current_position.y);
+  current_position.z += on ? -dz : dz;
+  active = on;
+  sync_plan_position();
+  axisManager.abort();
+  LOG_I("Z mesh %s\n", active ? "on" : "off");
+}
+
+void ZMesh::report() {
+  LOG_I("Z mesh: valid: %d, active: %d, missing points: %d\n", valid, active, missing());
+  // Back row first, as seen from the front of the machine
+  for (int8_t j = Z_MESH_GRID_Y - 1; j >= 0; j--) {
+    char row[Z_MESH_GRID_X * 9 + 1];
+    uint8_t len = 0;
+    for (uint8_t i = 0; i < Z_MESH_GRID_X; i++) {
+      len += snprintf(row + len, sizeof(row) - len, " %7.3f", z[j][i]);
+    }
+    LOG_I("%d:%s\n", j, row);
+  }
+}
+
+/*
+ Bilinear height at (x, y), outside the grid the edge values extend outwards.
+*/
+float ZMesh::getZ(const float x, const float y) {
+  const float fx = constrain((x - Z_MESH_MIN_X) * (1.0f / Z_MESH_SPACING_X), 0.0f, Z_MESH_GRID_X - 1.0f),
+              fy = constrain((y - Z_MESH_MIN_Y) * (1.0f / Z_MESH_SPACING_Y), 0.0f, Z_MESH_GRID_Y - 1.0f);
+  const uint8_t i = _MIN((uint8_t)fx, Z_MESH_GRID_X - 2),
+                j = _MIN((uint8_t)fy, Z_MESH_GRID_Y - 2);
+  const float dx = fx - i, dy = fy - j,
+              z0 = z[j][i] + (z[j][i + 1] - z[j][i]) * dx,
+              z1 = z[j + 1][i] + (z[j + 1][i + 1] - z[j + 1][i]) * dx;
+  return z0 + (z1 - z0) * dy;
+}
+
+// Path lengths where p0 + u * s crosses one of the grid lines, in increasing order
+void ZMesh::addBreaks(float *breaks, uint8_t &n, const float p0, const float u, const float length, const float grid_min, const float spacing, const uint8_t count) {
+  if (IS_ZERO(u)) {
+    return;
+  }
+  const float inv_u = 1.0f / u;
+  for (uint8_t k = 0; k < count; k++) {
+    const float s = (grid_min + (u > 0 ? k : count - 1 - k) * spacing - p0) * inv_u;
+    if (s <= 0 || s >= length) {
+      continue;
+    }
+    // Merge into the crossings of the other axis
+    uint8_t m = n++;
+    for (; m > 0 && breaks[m - 1] > s; m--) {
+      breaks[m] = breaks[m - 1];
+    }
+    breaks[m] = s;
+  }
+}
+
+/*
+ Z of a Move with the mesh added, one FuncParams piece per grid cell crossed.
+ Inside a cell the bilinear height is quadratic along the path, it is fitted
+ through the start, middle and end time of the piece, exact while cruising
+ and within the residue of the quartic while accelerating.
+
+ The correction is relative to base so Z never jumps between moves: it is
+ re-anchored on the height where the last move ended, which also starts a
+ new pipeline at 0 after a reset, with the nozzle where it is.
+*/
+void ZMesh::addMoveFuncParams(FuncManager &func_manager, Move &move, float &base, float &last) {
+  const float x_mm = planner.steps_to_mm[X_AXIS], y_mm = planner.steps_to_mm[Y_AXIS],
+              z_steps = planner.settings.axis_steps_per_mm[Z_AXIS],
+              x0 = (move.start_pos[X_AXIS] + move.mesh_origin[X_AXIS]) * x_mm,
+              y0 = (move.start_pos[Y_AXIS] + move.mesh_origin[Y_AXIS]) * y_mm,
+              ux = move.axis_r[X_AXIS] * x_mm,
+              uy = move.axis_r[Y_AXIS] * y_mm;
+
+  base = getZ(x0, y0) * z_steps - last;
+
+  float breaks[Z_MESH_GRID_X + Z_MESH_GRID_Y];
+  uint8_t n = 0;
+  addBreaks(breaks, n, x0, ux, move.distance, Z_MESH_MIN_X, Z_MESH_SPACING_X, Z_MESH_GRID_X);
+  addBreaks(breaks, n, y0, uy, move.distance, Z_MESH_MIN_Y, Z_MESH_SPACING_Y, Z_MESH_GRID_Y);
+
+  float t0 = 0, z0 = move.start_pos[Z_AXIS] + last;
+  for (uint8_t k = 0; k <= n; k++) {
+    float t1, s1;
+    if (k < n) {
+      s1 = breaks[k];
+      // s = v * t + a / 2 * t^2 solved for t, without cancellation when decelerating
+      t1 = 2 * s1 / (move.start_v + SQRT(_MAX(sq(move.start_v) + 2 * move.accelerate * s1, 0.0f)));
+      if (t1 - t0 < Z_MESH_MIN_PIECE_TIME || move.t - t1 < Z_MESH_MIN_PIECE_TIME) {
+        continue;
+      }
+    }
+    else {
+      s1 = move.distance;
+      t1 = move.t;
+    }
+
+    const float tm = 0.5f * (t0 + t1),
+                sm = (move.start_v + 0.5f * move.accelerate * tm) * tm,
+                zm = move.start_pos[Z_AXIS] + move.axis_r[Z_AXIS] * sm + getZ(x0 + ux * sm, y0 + uy * sm) * z_steps - base,
+                corr = getZ(x0 + ux * s1, y0 + uy * s1) * z_steps - base,
+                z1 = (k < n ? move.start_pos[Z_AXIS] + move.axis_r[Z_AXIS] * s1 : move.end_pos[Z_AXIS]) + corr,
+                dt = t1 - t0,
+                a = 2 * (z1 - 2 * zm + z0) / sq(dt);
+
+    func_manager.addQuadraticFuncParams(a, k < n ? move.start_t + t1 : move.end_t, z1, dt, z0, z1);
+    t0 = t1;
+    z0 = z1;
+    last = corr;
+  }
+}
+
+/**
+ * M420: Z mesh compensation
+ *
+ *   S<bool>  Turn the mesh on or off
+ *   V        Report the mesh
+ */
+void GcodeSuite::M420() {
+  if (parser.seen('S')) {
+    const bool on = parser.value_bool();
+    if (on && !zMesh.valid) {
+      LOG_E("Z mesh: %d points missing\n", zMesh.missing());
+      return;
+    }
+    zMesh.setActive(on);
+  }
+  if (parser.seen('V') || !parser.seen('S')) {
+    zMesh.report();
+  }
+}
+
+/**
+ * M421: Set a Z mesh point
+ *
+ *   I<col> J<row> Z<mm>  Height of one grid point, the mesh is valid once every point is set
+ *   R                     Clear the mesh
+ */
+void GcodeSuite::M421() {
+  if (parser.seen('R')) {
+    zMesh.setActive(false);
+    zMesh.reset();
+    return;
+  }
+  const int8_t i = parser.intval('I', -1), j = parser.intval('J', -1);
+  if (!WITHIN(i, 0, Z_MESH_GRID_X - 1) || !WITHIN(j, 0, Z_MESH_GRID_Y - 1) || !parser.seenval('Z')) {
+    LOG_E("Z mesh: bad point\n");
+    return;
+  }
+  if (zMesh.active) {
+    // Changing the surface under a running correction would move Z
+    zMesh.setActive(false);
+    zMesh.setPoint(i, j, parser.value_linear_units());
+    zMesh.setActive(true);
+  }
+  else {
+    zMesh.setPoint(i, j, parser.value_linear_units());
+  }
+}
+
+#endif // SHAPER_Z_MESH
@@ -0,0 +1,70 @@
+/*
+ * Snapmaker 3D Printer Firmware
+ * Copyright (C) 2023 Snapmaker [https://github.com/Snapmaker]
+ *
+ * This file is part of SnapmakerController-IDEX
+ * (see https://github.com/Snapmaker/SnapmakerController-IDEX)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "MoveQueue.h"
+#include "FuncManager.h"
+
+#if ENABLED(SHAPER_Z_MESH)
+
+/*
+ Bed height mesh applied inside the shaper pipeline. The correction is added
+ to Z while its FuncParams are generated, bilinear per cell along each Move,
+ so XY moves are never split at grid lines and stay one planner block each.
+
+ With the mesh active the planner Z is the height above the measured surface.
+ Turning it on or off moves the planner Z instead of the nozzle.
+*/
+
+#define Z_MESH_MIN_X        (Z_MESH_INSET)
+#define Z_MESH_MIN_Y        (Z_MESH_INSET)
+#define Z_MESH_SPACING_X    ((X_BED_SIZE - 2.0f * (Z_MESH_INSET)) / (Z_MESH_GRID_X - 1))
+#define Z_MESH_SPACING_Y    ((Y_BED_SIZE - 2.0f * (Z_MESH_INSET)) / (Z_MESH_GRID_Y - 1))
+
+class ZMesh {
+  public:
+    float z[Z_MESH_GRID_Y][Z_MESH_GRID_X];  // (mm) bed height at each grid point
+    bool measured[Z_MESH_GRID_Y][Z_MESH_GRID_X];  // set since the last reset
+    bool valid = false;  // every grid point is measured
+    bool active = false;  // applied to Z, see setActive()
+
+    static FORCE_INLINE float gridX(const uint8_t i) { return Z_MESH_MIN_X + i * Z_MESH_SPACING_X; }
+    static FORCE_INLINE float gridY(const uint8_t j) { return Z_MESH_MIN_Y + j * Z_MESH_SPACING_Y; }
+
+    void reset();
+    void setPoint(const uint8_t i, const uint8_t j, const float height);
+    void restore();
+    uint8_t missing();
+    void setActive(const bool on);
+    void report();
+
+    float getZ(const float x, const float y);
+
+    void addMoveFuncParams(FuncManager &func_manager, Move &move, float &base, float &last);
+
+  private:
+    static void addBreaks(float *breaks, uint8_t &n, const float p0, const float u, const float length, const float grid_min, const float spacing, const uint8_t count);
+};
+
+extern ZMesh zMesh;
+
+#endif // SHAPER_Z_MESH
@@ -159,7 +159,6 @@ uint8_t Stepper::current_direction_bits = 0,
         Stepper::axis_did_move; // = 0
 
 bool Stepper::abort_current_block;
-uint32_t Stepper::delta_t = 0;
 int32_t Stepper::current_block_e_position = 0;
 
 #if DISABLED(MIXING_EXTRUDER) && HAS_MULTI_EXTRUDER
@@ -205,9 +204,13 @@ uint32_t Stepper::advance_divisor = 0,
 AxisStepper Stepper::axis_stepper;
 int Stepper::block_move_target_steps[AXIS_SIZE];
 bool Stepper::is_start = true;
-time_double_t Stepper::block_print_time;
-bool Stepper::req_pause = false;
-bool Stepper::can_pause = false;
+step_time_t Stepper::block_end_ticks;
+step_time_t Stepper::block_end_print;
+uint8_t Stepper::block_end_gen;
+volatile bool Stepper::req_pause = false;
+volatile bool Stepper::can_pause = false;
+// Re-check interval while the power-loss handler holds the stepper
+#define POWER_LOSS_HOLD_TICKS (50 * STEPPER_TIMER_TICKS_PER_US)
 
 // Screen extrude and retrack
 bool Stepper::is_only_extrude;
@@ -1438,15 +1441,15 @@ HAL_STEP_TIMER_ISR() {
   #if ENABLED(DEBUG_ISR_CPU_USAGE)
     static uint16_t isr_delay = 0;
     isr_delay = HAL_timer_get_count(STEP_TIMER_NUM);
-    if (isr_delay > uint16_t(axisManager.counts[18])) {
-      axisManager.counts[18] = isr_delay;
+    if (isr_delay > uint16_t(axisManager.counts[SHAPER_DBG_ISR_MAX_DELAY])) {
+      axisManager.counts[SHAPER_DBG_ISR_MAX_DELAY] = isr_delay;
     }
   #endif
 
   Stepper::isr();
 
   #if ENABLED(DEBUG_ISR_CPU_USAGE)
-    axisManager.counts[19] += HAL_timer_get_count(STEP_TIMER_NUM);
+    axisManager.counts[SHAPER_DBG_ISR_TICKS] += HAL_timer_get_count(STEP_TIMER_NUM);
   #endif
 
   HAL_timer_isr_epilogue(STEP_TIMER_NUM);
@@ -1487,7 +1490,10 @@ void Stepper::isr() {
   // We need this variable here to be able to use it in the following loop
   hal_timer_t min_ticks;
 
-  if (power_loss.check()) {
+  // is_trigger is raised by power_loss.process() once the loss is confirmed,
+  // until then this is a single load. The handler then stops the motion from
+  // here, as soon as it did when it ran in every pulse phase.
+  if (power_loss.is_trigger && power_loss.check()) {
     if (abort_current_block) {
       statistics_abort_cnt++;
       switch_detect.disable_all();
@@ -1508,7 +1514,7 @@ void Stepper::isr() {
       }
     }
     HAL_timer_set_compare(  STEP_TIMER_NUM,
-                            hal_timer_t(HAL_timer_get_count(STEP_TIMER_NUM) + STEPPER_TIMER_TICKS_PER_US));
+                            hal_timer_t(HAL_timer_get_count(STEP_TIMER_NUM) + POWER_LOSS_HOLD_TICKS));
     ENABLE_ISRS();
     return;
   }
@@ -1554,58 +1560,6 @@ void Stepper::isr() {
 
   if (!nextOtherAxisISR) nextOtherAxisISR = other_axis_block_phase_isr();
 
-  #define SLOWDOWN_DELAT_CLOCK (1 * STEPPER_TIMER_TICKS_PER_US)
-  #define STOP_TIME_INTERVAL   (1 * STEPPER_TIMER_TICKS_PER_MS)
-  static uint32_t x_time_interval = STOP_TIME_INTERVAL + 1;
-  static uint32_t y_time_interval = STOP_TIME_INTERVAL + 1;
-  static uint32_t no_move_count = 0;
-
-  if (req_pause) {
-    if ((!axis_is_moving(X_AXIS) && !axis_is_moving(Y_AXIS)) ||
-        axis_stepper.axis < 0) {
-      no_move_count++;
-      if (no_move_count >= 10) {
-        req_pause = false;
-        can_pause = true;
-        x_time_interval = STOP_TIME_INTERVAL + 1;
-        y_time_interval = STOP_TIME_INTERVAL + 1;
-        no_move_count = 0;
-      }
-    }
-    else {
-      delta_t += SLOWDOWN_DELAT_CLOCK;
-      nextMainISR += delta_t;
-
-      if (!axis_is_moving(X_AXIS)) {
-        x_time_interval = STOP_TIME_INTERVAL + 1;
-      }
-      if (!axis_is_moving(Y_AXIS)) {
-        y_time_interval = STOP_TIME_INTERVAL + 1;
-      }
-
-      if (axis_stepper.axis == X_AXIS) {
-        x_time_interval = nextMainISR;
-      }
-      else if (axis_stepper.axis == Y_AXIS) {
-        y_time_interval = nextMainISR;
-      }
-
-      if (x_time_interval > STOP_TIME_INTERVAL &&
-          y_time_interval > STOP_TIME_INTERVAL) {
-        req_pause = false;
-        can_pause = true;
-        x_time_interval = STOP_TIME_INTERVAL + 1;
-        y_time_interval = STOP_TIME_INTERVAL + 1;
-        no_move_count = 0;
-        delta_t = 0;
-      }
-    }
-  }
-
-  // if (can_pause) {
-  //   nextMainISR += delta_t;
-  // }
-
     #if ENABLED(INTEGRATED_BABYSTEPPING)
       if (is_babystep)                                  // Avoid ANY stepping too soon after baby-stepping
         NOLESS(nextMainISR, (BABYSTEP_TICKS) / 8);      // FULL STOP for 125µs after a baby-step
@@ -1722,6 +1676,25 @@ void Stepper::isr() {
   ENABLE_ISRS();
 }
 
+/**
+ * Housekeeping that used to run on every step, now serviced from
+ * Temperature::isr() at ~1KHz:
+ *  - Probe switch backstop for the EXTI-driven switch_detect
+ *  - Pause, a feed hold in the AxisManager time base
+ */
+void Stepper::housekeeping_isr() {
+  switch_detect.check();
+
+  // The feed hold ramps the print time down, all axes stop on their path
+  if (req_pause) {
+    axisManager.feedHold();
+    if (!current_block || axisManager.isFeedHeld()) {
+      req_pause = false;
+      can_pause = true;
+    }
+  }
+}
+
 #if MINIMUM_STEPPER_PULSE || MAXIMUM_STEPPER_RATE
   #define ISR_PULSE_CONTROL 1
 #endif
@@ -1738,10 +1711,6 @@ void Stepper::isr() {
  */
 void Stepper::pulse_phase_isr() {
 
-  switch_detect.check();
-  // endstops.poll();
-  power_loss.check();
-
   // If we must abort the current block, do so!
   if (abort_current_block) {
     statistics_abort_cnt++;
@@ -1815,52 +1784,29 @@ void Stepper::pulse_phase_isr() {
       _APPLY_STEP(AXIS, _INVERT_STEP_PIN(AXIS), 0); \
   }while(0)
 
-  do {
-      if (axis_stepper.dir > 0) {
-        CBI(current_direction_bits, axis_stepper.axis);
-      } else if(axis_stepper.dir < 0) {
-        SBI(current_direction_bits, axis_stepper.axis);
-      }
+  // Every axis of the bundle gets its direction first, then all pulses go out together
+  current_direction_bits = (current_direction_bits & ~axis_stepper.axis_bits) | axis_stepper.dir_bits;
+  if (current_direction_bits != last_direction_bits) {
+    set_directions(current_direction_bits);
+  }
 
-      // if ( ENABLED(HAS_L64XX)       // Always set direction for L64xx (Also enables the chips)
-      //   || ENABLED(DUAL_X_CARRIAGE) // TODO: Find out why this fixes "jittery" small circles
-      //   || current_direction_bits != last_direction_bits
-      //   || TERN(MIXING_EXTRUDER, false, stepper_extruder != last_moved_extruder)
-      // ) {
-      //   TERN_(HAS_MULTI_EXTRUDER, last_moved_extruder = stepper_extruder);
-      //   TERN_(HAS_L64XX, L64XX_OK_to_power_up = true);
-      //   set_directions(current_direction_bits);
-      // }
-
-
-      if (current_direction_bits != last_direction_bits) {
-        // TERN_(HAS_MULTI_EXTRUDER, last_moved_extruder = stepper_extruder);
-        // TERN_(HAS_L64XX, L64XX_OK_to_power_up = true);
-        set_directions(current_direction_bits);
-      }
+  const uint8_t axis_bits = axis_stepper.axis_bits;
+  if (TEST(axis_bits, X_AXIS)) PULSE_START(X);
+  if (TEST(axis_bits, Y_AXIS)) PULSE_START(Y);
+  if (TEST(axis_bits, Z_AXIS)) PULSE_START(Z);
+  if (TEST(axis_bits, E_AXIS)) PULSE_START(E);
 
-      if (axis_stepper.axis == 0) {
-        PULSE_START(X);
-        PULSE_PREP(X);
-        PULSE_STOP(X);
-      } else if(axis_stepper.axis == 1) {
-        PULSE_START(Y);
-        PULSE_PREP(Y);
-        PULSE_STOP(Y);
-      } else if(axis_stepper.axis == 2) {
-        PULSE_START(Z);
-        PULSE_PREP(Z);
-        PULSE_STOP(Z);
-      // } else if(axis_stepper.axis == 3 && !req_pause) {
-      } else if(axis_stepper.axis == 3) {
-        PULSE_START(E);
-        // PULSE_PREP(E);
-        current_block_e_position += count_direction[E_AXIS];
-        PULSE_STOP(E);
-      }
+  if (TEST(axis_bits, X_AXIS)) PULSE_PREP(X);
+  if (TEST(axis_bits, Y_AXIS)) PULSE_PREP(Y);
+  if (TEST(axis_bits, Z_AXIS)) PULSE_PREP(Z);
+  if (TEST(axis_bits, E_AXIS)) current_block_e_position += count_direction[E_AXIS];
+
+  if (TEST(axis_bits, X_AXIS)) PULSE_STOP(X);
+  if (TEST(axis_bits, Y_AXIS)) PULSE_STOP(Y);
+  if (TEST(axis_bits, Z_AXIS)) PULSE_STOP(Z);
+  if (TEST(axis_bits, E_AXIS)) PULSE_STOP(E);
 
-      axis_stepper.axis = -1;
-  } while (axisManager.getNextZeroAxisStepper(&axis_stepper));
+  axis_stepper.axis = -1;
 
   // if (need_x) {
   //   PULSE_START(X);
@@ -1962,24 +1908,18 @@ uint32_t Stepper::block_phase_isr() {
     // #ifdef DEBUG_IO
     //   WRITE(DEBUG_IO, 1);
     // #endif
-    if (axisManager.getNextAxisStepper(&axis_stepper)) {
+    if (axisManager.getNextStepBundle(&axis_stepper)) {
     // #ifdef DEBUG_IO
     //   WRITE(DEBUG_IO, 0);
     // #endif
-      if (axis_stepper.delta_time < 0) {
-        axis_stepper.delta_time = 0;
-      }
-
+      // Normally idle() keeps the step queue filled, only help out if it fell behind
       hal_timer_t st = HAL_timer_get_count(STEP_TIMER_NUM);
-      if (axis_stepper.delta_time > 0.02) {
-        axisManager.calcNextAxisStepper();
-        axisManager.calcNextAxisStepper();
-      } else if (axis_stepper.delta_time > 0.01) {
-        axisManager.calcNextAxisStepper();
+      if (axis_stepper.delta_ticks > 20 * STEPPER_TIMER_TICKS_PER_US) {
+        axisManager.topUpAxisSteppers();
       }
       hal_timer_t et = HAL_timer_get_count(STEP_TIMER_NUM);
 
-      interval = (uint32_t)(axis_stepper.delta_time * STEPPER_TIMER_TICKS_PER_MS);
+      interval = axis_stepper.delta_ticks;
 
       hal_timer_t dt = et - st;
       if (interval > 0 && (hal_timer_t)interval < dt) {
@@ -1989,13 +1929,22 @@ uint32_t Stepper::block_phase_isr() {
         }
       }
 
-      if (axis_stepper.print_time >= block_print_time) {
+      // A feed hold moved the block end
+      if (block_end_gen != axisManager.feed_hold_gen) {
+        block_end_gen = axisManager.feed_hold_gen;
+        block_end_ticks = axisManager.printToStepTicks(block_end_print);
+      }
+      if (!STEP_TIME_BEFORE(axis_stepper.print_ticks, block_end_ticks)) {
         count_position.e = current_block->destination.e * planner.settings.axis_steps_per_mm[E_AXIS];
         discard_current_block();
       }
 
       done_count = 0;
     }
+    else if (axisManager.step_stalled) {
+      // Steps of some axis are still being calculated, come back shortly
+      return axisManager.feed_hold_drained ? FEED_HOLD_IDLE_TICKS : AXIS_STEPPER_STALL_TICKS;
+    }
     else {
 
       done_count++;
@@ -2207,7 +2156,9 @@ uint32_t Stepper::block_phase_isr() {
       // Based on the oversampling factor, do the calculations
       // step_event_count = current_block->step_event_count << oversampling;
 
-      block_print_time = current_block->shaper_data.last_print_time;
+      block_end_print = AxisManager::timeToTicks(current_block->shaper_data.last_print_time);
+      block_end_gen = axisManager.feed_hold_gen;
+      block_end_ticks = axisManager.printToStepTicks(block_end_print);
       Move& end_move = moveQueue.moves[current_block->shaper_data.move_end];
       for (int i = 0; i < AXIS_SIZE; ++i) {
           block_move_target_steps[i] = LROUND(end_move.end_pos[i]);
@@ -2306,9 +2257,7 @@ uint32_t Stepper::block_phase_isr() {
 
       if (is_start) {
         is_start = false;
-        while (axisManager.calcNextAxisStepper()) {
-        }
-        axisManager.getNextAxisStepper(&axis_stepper);
+        axisManager.getNextStepBundle(&axis_stepper);
       }
 
       // interval = CEIL(axis_stepper.delta_time * STEPPER_TIMER_TICKS_PER_MS);
@@ -2341,11 +2290,7 @@ uint32_t Stepper::block_phase_isr() {
     return interval;
   }
 
-  if (axis_stepper.dir > 0) {
-    CBI(current_direction_bits, axis_stepper.axis);
-  } else if(axis_stepper.dir < 0) {
-    SBI(current_direction_bits, axis_stepper.axis);
-  }
+  current_direction_bits = (current_direction_bits & ~axis_stepper.axis_bits) | axis_stepper.dir_bits;
 
   if ( ENABLED(HAS_L64XX)       // Always set direction for L64xx (Also enables the chips)
     || ENABLED(DUAL_X_CARRIAGE) // TODO: Find out why this fixes "jittery" small circles
@@ -2908,6 +2853,15 @@ int32_t Stepper::position(const AxisEnum axis) {
   return v;
 }
 
+int32_t Stepper::position_e_live() {
+  const bool was_enabled = suspend();
+  int32_t v = count_position.e;
+  if (current_block && current_block->steps.e)
+    v += LROUND((float)current_block_e_position / current_block->steps.e * current_block->origin_de);
+  if (was_enabled) wake_up();
+  return v;
+}
+
 // Set the current position in steps
 void Stepper::set_position(const xyze_long_t &spos) {
   planner.synchronize();
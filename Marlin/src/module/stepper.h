@@ -282,7 +282,6 @@ class Stepper {
                     axis_did_move;           // Last Movement in the given direction is not null, as computed when the last movement was fetched from planner
 
     static bool abort_current_block;        // Signals to the stepper that current block should be aborted
-    static uint32_t delta_t;
     static int32_t current_block_e_position;
 
     #if ENABLED(X_DUAL_ENDSTOPS)
@@ -324,9 +323,11 @@ class Stepper {
 
     static int block_move_target_steps[AXIS_SIZE];
     static bool is_start;
-    static time_double_t block_print_time;
-    static bool req_pause;
-    static bool can_pause;
+    static step_time_t block_end_ticks;
+    static step_time_t block_end_print;
+    static uint8_t block_end_gen;
+    static volatile bool req_pause;
+    static volatile bool can_pause;
 
     // Screen extrude and retrack
     static bool is_only_extrude;
@@ -426,6 +427,9 @@ class Stepper {
     // The stepper pulse ISR phase
     static void pulse_phase_isr();
 
+    // ~1KHz housekeeping kept out of the step pulse path
+    static void housekeeping_isr();
+
     static void other_axis_puls_phase_isr();
 
     // The stepper block processing ISR phase
@@ -457,6 +461,10 @@ class Stepper {
     // Get the position of a stepper, in steps
     static int32_t position(const AxisEnum axis);
 
+    // E position in steps including the block being executed, position(E_AXIS)
+    // only moves when a block ends
+    static int32_t position_e_live();
+
     // Set the current position in steps
     static void set_position(const xyze_long_t &spos);
     static void set_axis_position(const AxisEnum a, const int32_t &v);
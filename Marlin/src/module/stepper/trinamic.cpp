@@ -591,6 +591,12 @@ enum StealthIndex : uint8_t {
       #endif
     #endif
   }
+
+  // Boot configures the drivers with the writes held, so the settings only fill the
+  // shadow registers. restore_trinamic_drivers() sends them after the release.
+  void tmc_serial_hold(const bool hold) {
+    st_hold_writes = hold;
+  }
 #endif
 
 #if HAS_DRIVER(TMC2208)
@@ -631,7 +637,7 @@ enum StealthIndex : uint8_t {
     TERN(HYBRID_THRESHOLD, st.set_pwm_thrs(hyb_thrs), UNUSED(hyb_thrs));
 
     st.GSTAT(0b111); // Clear
-    delay(200);
+    if (!st_hold_writes) delay(200);
   }
 #endif // TMC2208
 
@@ -673,7 +679,7 @@ enum StealthIndex : uint8_t {
     TERN(HYBRID_THRESHOLD, st.set_pwm_thrs(hyb_thrs), UNUSED(hyb_thrs));
 
     st.GSTAT(0b111); // Clear
-    delay(200);
+    if (!st_hold_writes) delay(200);
   }
 #endif // TMC2209
 
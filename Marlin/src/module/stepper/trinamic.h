@@ -104,6 +104,7 @@ typedef struct {
 
 #if HAS_TMC220x
   void tmc_serial_begin();
+  void tmc_serial_hold(const bool hold);
 #endif
 
 void restore_trinamic_drivers();
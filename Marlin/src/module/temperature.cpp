@@ -34,6 +34,7 @@
 #include "temperature.h"
 #include "endstops.h"
 #include "planner.h"
+#include "stepper.h"
 #include "../../../snapmaker/module/filament_sensor.h"
 #include "../../../snapmaker/module/exception.h"
 
@@ -42,7 +43,7 @@
   #include "../feature/spindle_laser.h"
 #endif
 
-#if ENABLED(EMERGENCY_PARSER)
+#if EITHER(EMERGENCY_PARSER, MPCTEMP)
   #include "motion.h"
 #endif
 
@@ -208,17 +209,7 @@
   #include "servo.h"
 #endif
 
-#if ANY(TEMP_SENSOR_0_IS_THERMISTOR, TEMP_SENSOR_1_IS_THERMISTOR, TEMP_SENSOR_2_IS_THERMISTOR, TEMP_SENSOR_3_IS_THERMISTOR, \
-        TEMP_SENSOR_4_IS_THERMISTOR, TEMP_SENSOR_5_IS_THERMISTOR, TEMP_SENSOR_6_IS_THERMISTOR, TEMP_SENSOR_7_IS_THERMISTOR )
-  #define HAS_HOTEND_THERMISTOR 1
-#endif
-
-#if HAS_HOTEND_THERMISTOR
-  #define NEXT_TEMPTABLE(N) ,TEMPTABLE_##N
-  #define NEXT_TEMPTABLE_LEN(N) ,TEMPTABLE_##N##_LEN
-  static const temp_entry_t* heater_ttbl_map[HOTENDS] = ARRAY_BY_HOTENDS(TEMPTABLE_0 REPEAT_S(1, HOTENDS, NEXT_TEMPTABLE));
-  static constexpr uint8_t heater_ttbllen_map[HOTENDS] = ARRAY_BY_HOTENDS(TEMPTABLE_0_LEN REPEAT_S(1, HOTENDS, NEXT_TEMPTABLE_LEN));
-#endif
+#include "thermistor/thermistor_uniform.h"
 
 #define BED_TEMP_FIRST_MIN_ABNORMAL_DISABLE_TIME_MS   (5 * 60 * 1000)
 #define BED_TEMP_MIN_ABNORMAL_WATCH_WINDOW_TIME_MS    (10 * 60 * 1000)
@@ -777,6 +768,197 @@ volatile bool Temperature::raw_temps_ready = false;
       return;
   }
 
+  #if ENABLED(MPCTEMP)
+
+    /**
+     * MPC Autotuning (M306 T)
+     *
+     * Cool to ambient with the part fan on, heat at full power past 200°C to
+     * fit the block and sensor time constants, then hold the temperature
+     * under MPC with the fan off and at full speed to measure the losses.
+     * The filament heat capacity is not measured; set it with M306 H.
+     */
+    void Temperature::MPC_autotune(const uint8_t e) {
+      hotend_info_t &hotend = temp_hotend[e];
+      MPC_t &constants = hotend.constants;
+      const uint8_t old_fan_speed = fan_speed[e];
+
+      // Returns true once the tune must stop
+      auto housekeeping = [&](millis_t &ms, celsius_float_t &current_temp, millis_t &next_report_ms) {
+        ms = millis();
+
+        if (updateTemperaturesIfReady()) current_temp = degHotend(e);
+
+        if (ELAPSED(ms, next_report_ms)) {
+          next_report_ms += 1000UL;
+          print_heater_states(e);
+          SERIAL_EOL();
+        }
+
+        TERN_(HAL_IDLETASK, HAL_idletask());
+        TERN(DWIN_CREALITY_LCD, DWIN_Update(), ui.update());
+
+        if (current_temp > temp_range[e].maxtemp - (HOTEND_OVERSHOOT)) {
+          SERIAL_ECHOLNPGM(STR_PID_TEMP_TOO_HIGH);
+          return true;
+        }
+        if (!wait_for_heatup) {
+          SERIAL_ECHOLNPGM("MPC autotune interrupted");
+          return true;
+        }
+        return false;
+      };
+
+      auto finish = [&]() {
+        wait_for_heatup = false;
+        hotend.target = 0;
+        hotend.soft_pwm_amount = 0;
+        set_fan_speed(e, old_fan_speed);
+        hotend.modeled_block_temp = NAN;
+      };
+
+      disable_all_heaters();
+      TERN_(AUTO_POWER_CONTROL, powerManager.power_on());
+
+      SERIAL_ECHOLNPAIR("MPC autotune start for E", e);
+      SERIAL_ECHOLNPGM("Cooling to ambient");
+      set_fan_speed(e, 255);
+
+      millis_t ms = millis(), next_report_ms = ms, next_test_ms = ms + 10000UL;
+      celsius_float_t current_temp = degHotend(e),
+                      ambient_temp = current_temp;
+
+      wait_for_heatup = true; // Can be interrupted with M108
+      for (;;) {
+        if (housekeeping(ms, current_temp, next_report_ms)) return finish();
+
+        if (ELAPSED(ms, next_test_ms)) {
+          if (current_temp >= ambient_temp) {
+            ambient_temp = (ambient_temp + current_temp) / 2.0f;
+            break;
+          }
+          ambient_temp = current_temp;
+          next_test_ms += 10000UL;
+        }
+      }
+
+      set_fan_speed(e, 0);
+
+      SERIAL_ECHOLNPGM("Heating to over 200C");
+      hotend.target = 200; // So M105 looks nice
+      hotend.soft_pwm_amount = (MPC_MAX) >> 1;
+      const millis_t heat_start_ms = next_test_ms = ms;
+      celsius_float_t temp_samples[16];
+      uint8_t sample_count = 0;
+      uint16_t sample_distance = 1;
+      float t1_time = 0;
+
+      for (;;) {
+        if (housekeeping(ms, current_temp, next_report_ms)) return finish();
+
+        if (ELAPSED(ms, next_test_ms)) {
+          // Record samples between 100°C and 200°C, spacing them wider as the buffer fills
+          if (current_temp >= 100.0f) {
+            if (sample_count == COUNT(temp_samples)) {
+              LOOP_L_N(i, COUNT(temp_samples) / 2) temp_samples[i] = temp_samples[i * 2];
+              sample_count /= 2;
+              sample_distance *= 2;
+            }
+            if (sample_count == 0) t1_time = float(ms - heat_start_ms) / 1000.0f;
+            temp_samples[sample_count++] = current_temp;
+          }
+
+          if (current_temp >= 200.0f) break;
+
+          next_test_ms += 1000UL * sample_distance;
+        }
+      }
+      hotend.soft_pwm_amount = 0;
+
+      if (sample_count < 3) {
+        SERIAL_ECHOLNPGM("MPC autotune failed: too few samples");
+        return finish();
+      }
+
+      // Fit the asymptote of a first-order heat-up through three equally spaced samples
+      sample_count = (sample_count + 1) / 2 * 2 - 1;
+      const float t1 = temp_samples[0],
+                  t2 = temp_samples[(sample_count - 1) >> 1],
+                  t3 = temp_samples[sample_count - 1],
+                  asymp_temp = (t2 * t2 - t1 * t3) / (2 * t2 - t1 - t3),
+                  block_responsiveness = -logf((t2 - asymp_temp) / (t1 - asymp_temp)) / (sample_distance * (sample_count >> 1));
+
+      constants.ambient_xfer_coeff_fan0 = constants.heater_power * (MPC_MAX) / 255 / (asymp_temp - ambient_temp);
+      constants.fan255_adjustment = 0.0f;
+      constants.block_heat_capacity = constants.ambient_xfer_coeff_fan0 / block_responsiveness;
+      constants.sensor_responsiveness = block_responsiveness / (1.0f - (ambient_temp - asymp_temp) * expf(-block_responsiveness * t1_time) / (t1 - asymp_temp));
+
+      hotend.modeled_ambient_temp = ambient_temp;
+      hotend.modeled_block_temp = asymp_temp + (ambient_temp - asymp_temp) * expf(-block_responsiveness * (ms - heat_start_ms) / 1000.0f);
+      hotend.modeled_sensor_temp = current_temp;
+      hotend.last_e_position = stepper.position_e_live();
+
+      // Let MPC settle, then measure the power needed to hold temperature with and without the fan
+      SERIAL_ECHOLNPAIR("Measuring ambient heat loss at ", hotend.modeled_block_temp);
+      hotend.target = hotend.modeled_block_temp;
+      next_test_ms = ms + MPC_dT * 1000;
+      constexpr millis_t settle_time = 20000UL, test_duration = 20000UL;
+      millis_t settle_end_ms = ms + settle_time,
+               test_end_ms = settle_end_ms + test_duration;
+      float total_energy_fan0 = 0.0f;
+      #if ENABLED(MPC_INCLUDE_FAN)
+        bool fan0_done = false;
+        float total_energy_fan255 = 0.0f;
+      #endif
+      float last_temp = current_temp;
+
+      for (;;) {
+        if (housekeeping(ms, current_temp, next_report_ms)) return finish();
+
+        if (ELAPSED(ms, next_test_ms)) {
+          hotend.soft_pwm_amount = (int)get_mpc_output_hotend(e) >> 1;
+
+          if (ELAPSED(ms, settle_end_ms) && !ELAPSED(ms, test_end_ms) && TERN1(MPC_INCLUDE_FAN, !fan0_done))
+            total_energy_fan0 += constants.heater_power * hotend.soft_pwm_amount / 127 * MPC_dT + (last_temp - current_temp) * constants.block_heat_capacity;
+          #if ENABLED(MPC_INCLUDE_FAN)
+            else if (ELAPSED(ms, test_end_ms) && !fan0_done) {
+              set_fan_speed(e, 255);
+              settle_end_ms = ms + settle_time;
+              test_end_ms = settle_end_ms + test_duration;
+              fan0_done = true;
+            }
+            else if (ELAPSED(ms, settle_end_ms) && !ELAPSED(ms, test_end_ms))
+              total_energy_fan255 += constants.heater_power * hotend.soft_pwm_amount / 127 * MPC_dT + (last_temp - current_temp) * constants.block_heat_capacity;
+          #endif
+          else if (ELAPSED(ms, test_end_ms))
+            break;
+
+          last_temp = current_temp;
+          next_test_ms += MPC_dT * 1000;
+        }
+
+        if (!WITHIN(current_temp, t3 - 15.0f, hotend.target + 15.0f)) {
+          SERIAL_ECHOLNPGM("MPC autotune failed: temperature out of range");
+          return finish();
+        }
+      }
+
+      const float power_fan0 = total_energy_fan0 * 1000 / test_duration;
+      constants.ambient_xfer_coeff_fan0 = power_fan0 / (hotend.target - ambient_temp);
+
+      #if ENABLED(MPC_INCLUDE_FAN)
+        const float power_fan255 = total_energy_fan255 * 1000 / test_duration,
+                    ambient_xfer_coeff_fan255 = power_fan255 / (hotend.target - ambient_temp);
+        constants.fan255_adjustment = ambient_xfer_coeff_fan255 - constants.ambient_xfer_coeff_fan0;
+      #endif
+
+      finish();
+
+      SERIAL_ECHOLNPGM("MPC autotune finished");
+    }
+
+  #endif // MPCTEMP
+
 #endif // HAS_PID_HEATING
 
 /**
@@ -1014,6 +1196,9 @@ void Temperature::min_temp_error(const heater_id_t heater_id) {
 
   float Temperature::get_pid_output_hotend(const uint8_t E_NAME) {
     const uint8_t ee = HOTEND_INDEX;
+    #if ENABLED(MPCTEMP)
+      if (temp_hotend[ee].use_mpc) return get_mpc_output_hotend(ee);
+    #endif
     #if ENABLED(PIDTEMP)
       #if DISABLED(PID_OPENLOOP)
         static hotend_pid_t work_pid[HOTENDS];
@@ -1068,7 +1253,7 @@ void Temperature::min_temp_error(const heater_id_t heater_id) {
             #endif
             work_pid[ee].Kc = 0;
             if (this_hotend) {
-              const long e_position = stepper.position(E_AXIS);
+              const long e_position = stepper.position_e_live();
               if (e_position > last_e_position) {
                 lpq[lpq_ptr] = e_position - last_e_position;
                 last_e_position = e_position;
@@ -1124,6 +1309,87 @@ void Temperature::min_temp_error(const heater_id_t heater_id) {
     return pid_output;
   }
 
+  #if ENABLED(MPCTEMP)
+
+    /**
+     * Model predictive control of a hotend.
+     *
+     * A two-body model (heater block and sensor) is stepped forward every MPC_dT
+     * from the power last applied. Losses to ambient grow with the part fan and
+     * with the filament being pushed through, so feed rate and fan changes are
+     * compensated before they show up as a temperature error.
+     */
+    float Temperature::get_mpc_output_hotend(const uint8_t ee) {
+      hotend_info_t &hotend = temp_hotend[ee];
+      const MPC_t &constants = hotend.constants;
+
+      // First pass after a reset or a change of controller
+      if (isnan(hotend.modeled_block_temp)) {
+        hotend.modeled_ambient_temp = _MIN(30.0f, hotend.celsius); // Cap at a reasonable room temperature
+        hotend.modeled_block_temp = hotend.modeled_sensor_temp = hotend.celsius;
+        hotend.last_e_position = stepper.position_e_live();
+      }
+
+      float ambient_xfer_coeff = constants.ambient_xfer_coeff_fan0;
+      #if ENABLED(MPC_INCLUDE_FAN)
+        ambient_xfer_coeff += fan_speed[ee] * RECIPROCAL(255) * constants.fan255_adjustment;
+      #endif
+
+      // Both nozzles extrude in duplication and mirror modes
+      if (ee == active_extruder || TERN0(DUAL_X_CARRIAGE, idex_is_duplicating())) {
+        const int32_t e_position = stepper.position_e_live();
+        const float e_speed = (e_position - hotend.last_e_position) * planner.steps_to_mm[E_AXIS] / MPC_dT;
+
+        // The position can appear to jump, e.g. on a G92 or a tool change
+        if (ABS(e_speed) > planner.settings.max_feedrate_mm_s[E_AXIS])
+          hotend.last_e_position = e_position;
+        else if (e_speed > 0.0f) { // Ignore retract and recover
+          ambient_xfer_coeff += e_speed * constants.filament_heat_capacity_permm;
+          hotend.last_e_position = e_position;
+        }
+      }
+
+      // Step the model with the power of the last period
+      float blocktempdelta = hotend.soft_pwm_amount * constants.heater_power * (MPC_dT / 127) / constants.block_heat_capacity;
+      blocktempdelta += (hotend.modeled_ambient_temp - hotend.modeled_block_temp) * ambient_xfer_coeff * MPC_dT / constants.block_heat_capacity;
+      hotend.modeled_block_temp += blocktempdelta;
+
+      const float sensortempdelta = (hotend.modeled_block_temp - hotend.modeled_sensor_temp) * (constants.sensor_responsiveness * MPC_dT);
+      hotend.modeled_sensor_temp += sensortempdelta;
+
+      // Any remaining error is slow model drift or fast noise; pull gently towards the reading
+      const float delta_to_apply = (hotend.celsius - hotend.modeled_sensor_temp) * (MPC_SMOOTHING_FACTOR);
+      hotend.modeled_block_temp += delta_to_apply;
+      hotend.modeled_sensor_temp += delta_to_apply;
+
+      // Only learn ambient near steady state, when the output is not clipped
+      if (WITHIN(hotend.soft_pwm_amount, 1, 126) || ABS(blocktempdelta + delta_to_apply) < (MPC_STEADYSTATE) * MPC_dT)
+        hotend.modeled_ambient_temp += delta_to_apply > 0.0f
+          ? _MAX(delta_to_apply, (MPC_MIN_AMBIENT_CHANGE) * MPC_dT)
+          : _MIN(delta_to_apply, -(MPC_MIN_AMBIENT_CHANGE) * MPC_dT);
+
+      float power = 0.0f;
+      if (hotend.target != 0 && !TERN0(HEATER_IDLE_HANDLER, heater_idle[ee].timed_out)) {
+        // Plan to reach the target in 2 seconds, then hold it against the losses
+        power = (hotend.target - hotend.modeled_block_temp) * constants.block_heat_capacity / 2.0f;
+        power += (hotend.target - hotend.modeled_ambient_temp) * ambient_xfer_coeff;
+      }
+
+      // +1 so the >> 1 in manage_heater quantizes evenly into 0..127
+      float mpc_output = power * 254.0f / constants.heater_power + 1.0f;
+      LIMIT(mpc_output, 0, MPC_MAX);
+
+      #if ENABLED(PID_DEBUG)
+        if (ee == active_extruder && pid_debug_flag)
+          SERIAL_ECHO_MSG("MPC", ee, " block:", hotend.modeled_block_temp, " sensor:", hotend.modeled_sensor_temp,
+                          " ambient:", hotend.modeled_ambient_temp, STR_PID_DEBUG_OUTPUT, mpc_output);
+      #endif
+
+      return mpc_output;
+    }
+
+  #endif // MPCTEMP
+
 #endif // HAS_HOTEND
 
 #if ENABLED(PIDTEMPBED)
@@ -1641,26 +1907,10 @@ void Temperature::manage_heater() {
 #define TEMP_AD8495(RAW) ((RAW) * 6.6 * 100.0 / float(HAL_ADC_RANGE) / (OVERSAMPLENR) * (TEMP_SENSOR_AD8495_GAIN) + TEMP_SENSOR_AD8495_OFFSET)
 
 /**
- * Bisect search for the range of the 'raw' value, then interpolate
- * proportionally between the under and over values.
+ * Look up the 'raw' value in the build-time resampled copy of the table,
+ * see thermistor_uniform.h.
  */
-#define SCAN_THERMISTOR_TABLE(TBL,LEN) do{                                \
-  uint8_t l = 0, r = LEN, m;                                              \
-  for (;;) {                                                              \
-    m = (l + r) >> 1;                                                     \
-    if (!m) return celsius_t(pgm_read_dword(&TBL[0].celsius));             \
-    if (m == l || m == r) return celsius_t(pgm_read_dword(&TBL[LEN-1].celsius)); \
-    int32_t v00 = pgm_read_dword(&TBL[m-1].value),                         \
-            v10 = pgm_read_dword(&TBL[m-0].value);                         \
-         if (raw < v00) r = m;                                            \
-    else if (raw > v10) l = m;                                            \
-    else {                                                                \
-      const celsius_t v01 = celsius_t(pgm_read_dword(&TBL[m-1].celsius)),  \
-                      v11 = celsius_t(pgm_read_dword(&TBL[m-0].celsius));  \
-      return v01 + (raw - v00) * float(v11 - v01) / float(v10 - v00);     \
-    }                                                                     \
-  }                                                                       \
-}while(0)
+#define SCAN_THERMISTOR_TABLE(TBL,LEN) return uniform_tt_to_celsius(uniform_tt<TBL, LEN>::table, raw)
 
 #if HAS_USER_THERMISTORS
 
@@ -1813,6 +2063,8 @@ void Temperature::manage_heater() {
           return TEMP_AD595(raw);
         #elif TEMP_SENSOR_0_IS_AD8495
           return TEMP_AD8495(raw);
+        #elif TEMP_SENSOR_0_IS_THERMISTOR
+          SCAN_THERMISTOR_TABLE(TEMPTABLE_0, TEMPTABLE_0_LEN);
         #else
           break;
         #endif
@@ -1825,6 +2077,8 @@ void Temperature::manage_heater() {
           return TEMP_AD595(raw);
         #elif TEMP_SENSOR_1_IS_AD8495
           return TEMP_AD8495(raw);
+        #elif TEMP_SENSOR_1_IS_THERMISTOR
+          SCAN_THERMISTOR_TABLE(TEMPTABLE_1, TEMPTABLE_1_LEN);
         #else
           break;
         #endif
@@ -1835,6 +2089,8 @@ void Temperature::manage_heater() {
           return TEMP_AD595(raw);
         #elif TEMP_SENSOR_2_IS_AD8495
           return TEMP_AD8495(raw);
+        #elif TEMP_SENSOR_2_IS_THERMISTOR
+          SCAN_THERMISTOR_TABLE(TEMPTABLE_2, TEMPTABLE_2_LEN);
         #else
           break;
         #endif
@@ -1845,6 +2101,8 @@ void Temperature::manage_heater() {
           return TEMP_AD595(raw);
         #elif TEMP_SENSOR_3_IS_AD8495
           return TEMP_AD8495(raw);
+        #elif TEMP_SENSOR_3_IS_THERMISTOR
+          SCAN_THERMISTOR_TABLE(TEMPTABLE_3, TEMPTABLE_3_LEN);
         #else
           break;
         #endif
@@ -1855,6 +2113,8 @@ void Temperature::manage_heater() {
           return TEMP_AD595(raw);
         #elif TEMP_SENSOR_4_IS_AD8495
           return TEMP_AD8495(raw);
+        #elif TEMP_SENSOR_4_IS_THERMISTOR
+          SCAN_THERMISTOR_TABLE(TEMPTABLE_4, TEMPTABLE_4_LEN);
         #else
           break;
         #endif
@@ -1865,6 +2125,8 @@ void Temperature::manage_heater() {
           return TEMP_AD595(raw);
         #elif TEMP_SENSOR_5_IS_AD8495
           return TEMP_AD8495(raw);
+        #elif TEMP_SENSOR_5_IS_THERMISTOR
+          SCAN_THERMISTOR_TABLE(TEMPTABLE_5, TEMPTABLE_5_LEN);
         #else
           break;
         #endif
@@ -1875,6 +2137,8 @@ void Temperature::manage_heater() {
           return TEMP_AD595(raw);
         #elif TEMP_SENSOR_6_IS_AD8495
           return TEMP_AD8495(raw);
+        #elif TEMP_SENSOR_6_IS_THERMISTOR
+          SCAN_THERMISTOR_TABLE(TEMPTABLE_6, TEMPTABLE_6_LEN);
         #else
           break;
         #endif
@@ -1885,18 +2149,14 @@ void Temperature::manage_heater() {
           return TEMP_AD595(raw);
         #elif TEMP_SENSOR_7_IS_AD8495
           return TEMP_AD8495(raw);
+        #elif TEMP_SENSOR_7_IS_THERMISTOR
+          SCAN_THERMISTOR_TABLE(TEMPTABLE_7, TEMPTABLE_7_LEN);
         #else
           break;
         #endif
       default: break;
     }
 
-    #if HAS_HOTEND_THERMISTOR
-      // Thermistor with conversion table?
-      const temp_entry_t(*tt)[] = (temp_entry_t(*)[])(heater_ttbl_map[e]);
-      SCAN_THERMISTOR_TABLE((*tt), heater_ttbllen_map[e]);
-    #endif
-
     return 0;
   }
 #endif // HAS_HOTEND
@@ -2169,6 +2429,10 @@ void Temperature::init() {
     last_e_position = 0;
   #endif
 
+  #if ENABLED(MPCTEMP)
+    HOTEND_LOOP() temp_hotend[e].modeled_block_temp = NAN; // Seeded from the sensor on first use
+  #endif
+
   // Init (and disable) SPI thermocouples
   #if TEMP_SENSOR_IS_MAX(0, MAX6675) && PIN_EXISTS(MAX6675_CS)
     OUT_WRITE(MAX6675_CS_PIN, HIGH);
@@ -3021,15 +3285,18 @@ public:
  * Handle various ~1KHz tasks associated with temperature
  *  - Heater PWM (~1KHz with scaler)
  *  - LCD Button polling (~500Hz)
- *  - Start / Read one ADC sensor
+ *  - Start / Read one ADC sensor, or take the HAL's filtered ADC snapshot
  *  - Advance Babysteps
  *  - Endstop polling
+ *  - Stepper housekeeping
  *  - Planner clean buffer
  */
 void Temperature::isr() {
 
-  static int8_t temp_count = -1;
-  static ADCSensorState adc_sensor_state = StartupDelay;
+  #ifndef HAL_ADC_FILTERED
+    static int8_t temp_count = -1;
+    static ADCSensorState adc_sensor_state = StartupDelay;
+  #endif
   static uint8_t pwm_count = _BV(SOFT_PWM_SCALE);
 
   // avoid multiple loads of pwm_count
@@ -3321,6 +3588,34 @@ void Temperature::isr() {
   static bool do_buttons;
   if ((do_buttons ^= true)) ui.update_buttons();
 
+  #ifdef HAL_ADC_FILTERED
+
+    /**
+     * The HAL filters every ADC pin in its DMA interrupt, so there is no
+     * per-sensor work here. Take a snapshot once per sampling period,
+     * scaled as OVERSAMPLENR summed samples, to keep PID_dT and the raw
+     * value range unchanged. Every sensor is read from the same block.
+     */
+    #define SAMPLE_FILTERED_ADC(obj, pin) obj.sample((uint32_t(HAL_adc_filtered(pin, adc)) * (OVERSAMPLENR)) >> (HAL_ADC_FILTER_FRAC))
+
+    static uint8_t adc_ticks = 0;
+    if (HAL_adc_sequence && ++adc_ticks >= OVERSAMPLENR * ACTUAL_ADC_SAMPLES) {
+      adc_ticks = 0;
+      const uint16_t * const adc = HAL_adc_snapshot();
+      TERN_(HAS_TEMP_ADC_0, SAMPLE_FILTERED_ADC(temp_hotend[0], TEMP_0_PIN));
+      TERN_(HAS_TEMP_ADC_1, SAMPLE_FILTERED_ADC(temp_hotend[1], TEMP_1_PIN));
+      TERN_(HAS_TEMP_ADC_2, SAMPLE_FILTERED_ADC(temp_hotend[2], TEMP_2_PIN));
+      TERN_(HAS_TEMP_ADC_3, SAMPLE_FILTERED_ADC(temp_hotend[3], TEMP_3_PIN));
+      TERN_(HAS_TEMP_ADC_4, SAMPLE_FILTERED_ADC(temp_hotend[4], TEMP_4_PIN));
+      TERN_(HAS_TEMP_ADC_5, SAMPLE_FILTERED_ADC(temp_hotend[5], TEMP_5_PIN));
+      TERN_(HAS_TEMP_ADC_BED, SAMPLE_FILTERED_ADC(temp_bed, TEMP_BED_PIN));
+      TERN_(HAS_TEMP_ADC_CHAMBER, SAMPLE_FILTERED_ADC(temp_chamber, TEMP_CHAMBER_PIN));
+      TERN_(FILAMENT_WIDTH_SENSOR, filwidth.accumulate(HAL_adc_filtered(FILWIDTH_PIN, adc) >> (HAL_ADC_FILTER_FRAC)));
+      readings_ready();
+    }
+
+  #else // !HAL_ADC_FILTERED
+
   /**
    * One sensor is sampled on every other call of the ISR.
    * Each sensor is read 16 (OVERSAMPLENR) times, taking the average.
@@ -3504,6 +3799,8 @@ void Temperature::isr() {
   // Go to the next state
   adc_sensor_state = next_sensor_state;
 
+  #endif // !HAL_ADC_FILTERED
+
   //
   // Additional ~1KHz Tasks
   //
@@ -3515,6 +3812,9 @@ void Temperature::isr() {
   // Poll endstops state, if required
   endstops.poll();
 
+  // Probe backstop and pause bookkeeping for the stepper
+  stepper.housekeeping_isr();
+
   // Periodically call the planner timer service routine
   planner.isr();
 }
@@ -208,7 +208,30 @@ struct PIDHeaterInfo : public HeaterInfo {
   T pid;  // Initialized by settings.load()
 };
 
-#if ENABLED(PIDTEMP)
+#if ENABLED(MPCTEMP)
+  // Physical constants of a hotend model, in SI units
+  typedef struct {
+    float heater_power;                 // M306 P
+    float block_heat_capacity;          // M306 C
+    float sensor_responsiveness;        // M306 R
+    float ambient_xfer_coeff_fan0;      // M306 A
+    float fan255_adjustment;            // M306 F (stored as the difference from A)
+    float filament_heat_capacity_permm; // M306 H
+  } MPC_t;
+
+  #define MPC_dT ((OVERSAMPLENR * float(ACTUAL_ADC_SAMPLES)) / TEMP_TIMER_FREQUENCY)
+
+  // A PID heater that can also be driven from a thermal model
+  struct MPCHeaterInfo : public PIDHeaterInfo<hotend_pid_t> {
+    bool use_mpc;                       // M306 M, chosen per hotend
+    MPC_t constants;
+    float modeled_ambient_temp,
+          modeled_block_temp,
+          modeled_sensor_temp;
+    int32_t last_e_position;
+  };
+  typedef struct MPCHeaterInfo hotend_info_t;
+#elif ENABLED(PIDTEMP)
   typedef struct PIDHeaterInfo<hotend_pid_t> hotend_info_t;
 #else
   typedef heater_info_t hotend_info_t;
@@ -846,6 +869,10 @@ class Temperature {
         static constexpr bool adaptive_fan_slowing = true;
       #endif
 
+      #if ENABLED(MPCTEMP)
+        static void MPC_autotune(const uint8_t e);
+      #endif
+
       /**
        * Update the temp manager when PID values change
        */
@@ -926,6 +953,9 @@ class Temperature {
 
     #if ENABLED(HAS_HOTEND)
       static float get_pid_output_hotend(const uint8_t e);
+      #if ENABLED(MPCTEMP)
+        static float get_mpc_output_hotend(const uint8_t e);
+      #endif
     #endif
     #if ENABLED(PIDTEMPBED)
       static float get_pid_output_bed();
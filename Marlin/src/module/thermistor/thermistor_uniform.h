@@ -0,0 +1,89 @@
+/**
+ * Marlin 3D Printer Firmware
+ * Copyright (c) 2020 MarlinFirmware [https://github.com/MarlinFirmware/Marlin]
+ *
+ * Based on Sprinter and grbl.
+ * Copyright (c) 2011 Camiel Gubbels / Erik van der Zalm
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+/**
+ * Uniformly spaced thermistor tables
+ *
+ * Each thermistor table is resampled at build time into a table indexed
+ * directly by the high bits of the oversampled ADC value. Temperatures are
+ * stored in 1/_BV(UNIFORM_TT_FRAC) degrees and interpolated with integer
+ * math, so a conversion is two loads, a multiply and a shift instead of a
+ * binary search with a float division.
+ *
+ * The resampling follows the piecewise linear interpolation of the source
+ * table, values below the first entry or above the last one are clamped.
+ */
+
+constexpr int uniform_tt_log2(const int32_t n) { return n > 1 ? 1 + uniform_tt_log2(n >> 1) : 0; }
+
+// Raw values per entry as a power of 2, one entry every 8 ADC counts
+#define UNIFORM_TT_SHIFT  (uniform_tt_log2(OVERSAMPLENR) + 3)
+#define UNIFORM_TT_FRAC   4   // fraction bits of the stored temperature
+#define UNIFORM_TT_LEN    (((MAX_RAW_THERMISTOR_VALUE) >> UNIFORM_TT_SHIFT) + 2)
+
+typedef struct { int16_t celsius[UNIFORM_TT_LEN]; } uniform_temp_table_t;
+
+constexpr int16_t uniform_tt_round(const double c) { return int16_t(c < 0 ? c - 0.5 : c + 0.5); }
+
+constexpr double uniform_tt_lerp(const temp_entry_t &a, const temp_entry_t &b, const int32_t raw) {
+  return b.value == a.value ? a.celsius
+       : a.celsius + double(raw - a.value) * (b.celsius - a.celsius) / (b.value - a.value);
+}
+
+// Temperature of the source table at a raw value, first segment ending at or after it
+constexpr double uniform_tt_scan(const temp_entry_t *tbl, const uint8_t len, const int32_t raw, const uint8_t i=1) {
+  return raw < tbl[0].value ? tbl[0].celsius
+       : i >= len           ? tbl[len - 1].celsius
+       : raw <= tbl[i].value ? uniform_tt_lerp(tbl[i - 1], tbl[i], raw)
+       : uniform_tt_scan(tbl, len, raw, i + 1);
+}
+
+template<int...> struct uniform_tt_seq {};
+template<int N, int... I> struct uniform_tt_make_seq : uniform_tt_make_seq<N - 1, N - 1, I...> {};
+template<int... I> struct uniform_tt_make_seq<0, I...> { typedef uniform_tt_seq<I...> type; };
+
+template<const temp_entry_t *TBL, uint8_t LEN>
+struct uniform_tt_entry {
+  static constexpr int16_t at(const int i) {
+    return uniform_tt_round(uniform_tt_scan(TBL, LEN, int32_t(i) << UNIFORM_TT_SHIFT) * _BV(UNIFORM_TT_FRAC));
+  }
+  template<int... I>
+  static constexpr uniform_temp_table_t build(uniform_tt_seq<I...>) { return {{ at(I)... }}; }
+};
+
+// One instance per source table, shared by every sensor using it
+template<const temp_entry_t *TBL, uint8_t LEN>
+struct uniform_tt {
+  static constexpr uniform_temp_table_t table = uniform_tt_entry<TBL, LEN>::build(typename uniform_tt_make_seq<UNIFORM_TT_LEN>::type());
+};
+template<const temp_entry_t *TBL, uint8_t LEN>
+constexpr uniform_temp_table_t uniform_tt<TBL, LEN>::table;
+
+FORCE_INLINE celsius_float_t uniform_tt_to_celsius(const uniform_temp_table_t &tt, int32_t raw) {
+  LIMIT(raw, 0, MAX_RAW_THERMISTOR_VALUE);
+  const int32_t i = raw >> UNIFORM_TT_SHIFT,
+                f = raw & (_BV(UNIFORM_TT_SHIFT) - 1),
+                c0 = tt.celsius[i],
+                c = c0 + (((tt.celsius[i + 1] - c0) * f) >> UNIFORM_TT_SHIFT);
+  return c * (1.0f / _BV(UNIFORM_TT_FRAC));
+}
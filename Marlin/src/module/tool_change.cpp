@@ -869,6 +869,9 @@ void fast_line_to_current(const AxisEnum fr_axis) { _line_to_current(fr_axis, 0.
     // Activate the new extruder ahead of calling set_axis_is_at_home!
     active_extruder = new_tool;
 
+    // Each carriage rings at its own frequency
+    axisManager.select_x_shaper();
+
     // This function resets the max/min values - the current position may be overwritten below.
     set_axis_is_at_home(X_AXIS);
 
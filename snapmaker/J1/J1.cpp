@@ -297,14 +297,14 @@ void step_isr_usage_log(void) {
   static float max_stepper_isr_usage = 0.0;
   static bool need_log = false;
 
-  isr_usage = (axisManager.counts[19] * 100.0 / STEPPER_TIMER_RATE);
+  isr_usage = (axisManager.counts[SHAPER_DBG_ISR_TICKS] * 100.0 / STEPPER_TIMER_RATE);
   if (isr_usage > max_stepper_isr_usage) {
     max_stepper_isr_usage = isr_usage;
     need_log = true;
   }
 
-  if (axisManager.counts[18] > max_stepper_isr_delay) {
-    max_stepper_isr_delay = axisManager.counts[18];
+  if (axisManager.counts[SHAPER_DBG_ISR_MAX_DELAY] > max_stepper_isr_delay) {
+    max_stepper_isr_delay = axisManager.counts[SHAPER_DBG_ISR_MAX_DELAY];
     need_log = true;
   }
 
@@ -314,7 +314,7 @@ void step_isr_usage_log(void) {
   if (PENDING(millis(), last_log_tick + 1000))
     return;
 
-  axisManager.counts[19] = 0;
+  axisManager.counts[SHAPER_DBG_ISR_TICKS] = 0;
   last_log_tick = millis();
 
   if (need_log) {
@@ -417,12 +417,32 @@ void E_position_log(void) {
   last_ms = millis();
 }
 
+// Initialization the HMI does not need for its first requests. It runs
+// here rather than before the scheduler, the readiness flags hold back the
+// G-codes and SACP tasks that depend on it.
+static void j1_deferred_init() {
+  #if HAS_TMC220x
+    tmc_serial_hold(false);
+    restore_stepper_drivers();
+    vTaskDelay(pdMS_TO_TICKS(200));  // the settle time tmc_init() gives each driver, once for all
+  #endif
+  print_control.init();
+  system_service.set_ready(SYSTEM_READY_DRIVERS);
+  system_service.boot_mark(BOOT_PHASE_DRIVERS);
+
+  fd_srv.init();
+  calibtration.updateBuildPlateThickness(fd_srv.getBuildPlateThickness());
+  system_service.set_ready(SYSTEM_READY_FACTORY_DATA);
+  system_service.boot_mark(BOOT_PHASE_FACTORY_DATA);
+}
+
 void j1_main_task(void *args) {
 
   uint32_t syslog_timeout = millis();
   log_reset_source();
   power_loss.show_power_loss_info();
-  print_control.init();
+  j1_deferred_init();
+  system_service.boot_report();
 
   #if 0
   // LOG_I("LROUND(0.1) = %d, LROUND(0.5) = %d, LROUND(-0.1) = %d, LROUND(-0.5) = %d\n", LROUND(0.1), LROUND(0.5), LROUND(-0.1), LROUND(-0.5));
@@ -430,9 +450,6 @@ void j1_main_task(void *args) {
   // float_round_test(-0.1375f, 20);
   #endif
 
-  fd_srv.init();
-  calibtration.updateBuildPlateThickness(fd_srv.getBuildPlateThickness());
-
   while(1) {
     print_control.loop();
     printer_event_loop();
@@ -496,13 +513,12 @@ void j1_main_task(void *args) {
 
 
 void J1_setup() {
+  system_service.init();
   update_server.init();
   switch_detect.init();
   fdm_head.init();
   debug.init();
   subscribe_init();
-  event_init();
-  system_service.init();
 
   TaskHandle_t thandle_j1_main = NULL;
   BaseType_t ret = xTaskCreate(j1_main_task, "j1_main_task", 1024, NULL, 5, &thandle_j1_main);
@@ -512,4 +528,8 @@ void J1_setup() {
   else {
     SERIAL_ECHO("Created j1_main_task task!\n");
   }
+
+  // Of the tasks with the same priority, the scheduler starts the one created
+  // last, so the SACP tasks are created last to answer the HMI first
+  event_init();
 }
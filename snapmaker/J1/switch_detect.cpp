@@ -116,7 +116,76 @@ void SwitchDetect::check() {
   status_bits = tmp_status_bits;
 }
 
+static void probe_switch_isr() {
+  switch_detect.check();
+}
+
+// The probe edges stop the stepper from EXTI instead of being polled on every
+// step. X0_CAL_PIN (PA7) shares EXTI line 7 with Z_MAX_PIN (PE7), SanityCheck
+// keeps endstop interrupts off for that reason. Temperature::isr() polls check()
+// at ~1KHz as a backstop for a level that was already active at attach time.
+void SwitchDetect::attach_probe_irq() {
+  attachInterrupt(X0_CAL_PIN, probe_switch_isr, probe_detect_level ? RISING : FALLING);
+  attachInterrupt(X1_CAL_PIN, probe_switch_isr, probe_detect_level ? RISING : FALLING);
+}
+
+void SwitchDetect::detach_probe_irq() {
+  detachInterrupt(X0_CAL_PIN);
+  detachInterrupt(X1_CAL_PIN);
+}
+
+static void probe_sweep_isr() {
+  switch_detect.probe_sweep_edge();
+}
+
+// Runs on every edge of the active probe pin. Positions are read from the
+// stepper's step counter at the edge, so they do not depend on how quickly
+// the move stops and the sweep never has to stop to take a sample.
+// Z leaves the bed going up and only touches it going down, the direction
+// tells a bounce apart where a flat bed touches at the height it was left.
+void SwitchDetect::probe_sweep_edge() {
+  const bool touched = READ(sweep_pin) == LOW;
+  const int32_t steps = stepper.position((AxisEnum)sweep_axis);
+  switch (sweep_state) {
+    case PROBE_SWEEP_WAIT_RELEASE:
+      if (!touched) {
+        sweep_release_steps = steps;
+        sweep_state = PROBE_SWEEP_WAIT_TOUCH;
+      }
+      break;
+    case PROBE_SWEEP_WAIT_TOUCH:
+      if (sweep_axis == Z_AXIS ? !stepper.motor_direction(Z_AXIS) : ABS(steps - sweep_release_steps) < sweep_min_steps) {
+        // Contact bounce while leaving: keep the last release
+        if (!touched) sweep_release_steps = steps;
+      }
+      else if (touched) {
+        sweep_touch_steps = steps;
+        sweep_state = PROBE_SWEEP_TOUCHED;
+        stepper.quick_stop();
+      }
+      break;
+  }
+}
+
+void SwitchDetect::start_probe_sweep(uint8_t axis) {
+  init_probe();
+  sweep_axis = axis;
+  sweep_pin = active_extruder ? X1_CAL_PIN : X0_CAL_PIN;
+  sweep_min_steps = PROBE_SWEEP_MIN_TRAVEL * planner.settings.axis_steps_per_mm[axis];
+  sweep_state = PROBE_SWEEP_WAIT_RELEASE;
+  attachInterrupt(sweep_pin, probe_sweep_isr, CHANGE);
+  // Already clear of the target: there is no edge to wait for
+  if (READ(sweep_pin) != LOW) probe_sweep_edge();
+}
+
+void SwitchDetect::stop_probe_sweep() {
+  detachInterrupt(sweep_pin);
+  sweep_state = PROBE_SWEEP_IDLE;
+}
+
 void SwitchDetect::disable_all() {
+  if (enable_bits & (_BV(SW_PROBE0_BIT) | _BV(SW_PROBE1_BIT)))
+    detach_probe_irq();
   enable_bits = 0;
   status_bits = 0;
 }
@@ -126,9 +195,12 @@ void SwitchDetect::enable_probe(bool trigger_level) {
   probe_detect_level = trigger_level;
   enable(SW_PROBE0_BIT);
   enable(SW_PROBE1_BIT);
+  attach_probe_irq();
+  check();
 }
 
 void SwitchDetect::disable_probe() {
+  detach_probe_irq();
   disable(SW_PROBE0_BIT);
   disable(SW_PROBE1_BIT);
 }
@@ -21,6 +21,15 @@
 
 #include "stdint.h"
 
+enum : uint8_t {
+  PROBE_SWEEP_IDLE,
+  PROBE_SWEEP_WAIT_RELEASE,
+  PROBE_SWEEP_WAIT_TOUCH,
+  PROBE_SWEEP_TOUCHED,
+};
+
+#define PROBE_SWEEP_MIN_TRAVEL  (0.3)   // mm, touches closer than this to the release are contact bounce
+
 class SwitchDetect
 {
 public:
@@ -43,18 +52,32 @@ public:
   bool read_e0_probe_status();
   bool read_e1_probe_status();
   bool read_active_extruder_status();
+  // Latch where the active probe leaves the target during a move, then
+  // stop the move when it touches again. Results are in axis steps.
+  void start_probe_sweep(uint8_t axis);
+  void stop_probe_sweep();
+  void probe_sweep_edge();
   // bool test_trigger();
 
   bool debug_probe_poweron_sw = true;
 
+  volatile uint8_t sweep_state = PROBE_SWEEP_IDLE;
+  volatile int32_t sweep_release_steps;
+  volatile int32_t sweep_touch_steps;
+
 private:
   void enable(uint8_t Item);
   void disable(uint8_t Item);
+  void attach_probe_irq();
+  void detach_probe_irq();
 
 private:
-  uint32_t enable_bits;
+  volatile uint32_t enable_bits;
   uint32_t status_bits;
   uint8_t probe_detect_level = 0;
+  uint8_t sweep_axis;
+  uint8_t sweep_pin;
+  int32_t sweep_min_steps;
 };
 
 extern SwitchDetect switch_detect;
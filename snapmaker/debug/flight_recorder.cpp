@@ -0,0 +1,40 @@
+/*
+ * Snapmaker 3D Printer Firmware
+ * Copyright (C) 2023 Snapmaker [https://github.com/Snapmaker]
+ *
+ * This file is part of SnapmakerController-IDEX
+ * (see https://github.com/Snapmaker/SnapmakerController-IDEX)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "flight_recorder.h"
+
+// Placed in .noinit by the linker script, so it keeps its contents across a reset
+flight_recorder_t flight_recorder __attribute__((section(".noinit")));
+
+// Called before the scheduler starts. A ring left by the last run is kept,
+// anything else in that RAM (power on, bootloader use) is cleared.
+void flight_recorder_init(void) {
+  if (flight_recorder.magic != FLIGHT_RECORDER_MAGIC
+      || flight_recorder.event_head >= FLIGHT_RECORDER_EVENTS
+      || flight_recorder.task_head >= FLIGHT_RECORDER_TASKS
+      || flight_recorder.shaper_head >= FLIGHT_RECORDER_SHAPER) {
+    memset(&flight_recorder, 0, sizeof(flight_recorder));
+    flight_recorder.magic = FLIGHT_RECORDER_MAGIC;
+  }
+  flight_recorder.boots++;
+  flight_record(FLIGHT_RECORD_BOOT, 0, flight_recorder.boots);
+}
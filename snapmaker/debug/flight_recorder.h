@@ -0,0 +1,119 @@
+/*
+ * Snapmaker 3D Printer Firmware
+ * Copyright (C) 2023 Snapmaker [https://github.com/Snapmaker]
+ *
+ * This file is part of SnapmakerController-IDEX
+ * (see https://github.com/Snapmaker/SnapmakerController-IDEX)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SNAPMAKER_FLIGHT_RECORDER_H_
+#define SNAPMAKER_FLIGHT_RECORDER_H_
+
+// Also included by FreeRTOSConfig.h, so this header must stay plain C
+
+#include <stdint.h>
+#include <libmaple/systick.h>
+
+/*
+ Always-on history of the last things the firmware did. The rings live in
+ .noinit RAM, which the startup code does not clear, so they survive a reset
+ and CrashCatcher saves them in the crash dump next to the registers.
+ snapmaker/scripts/decode-flight-recorder.py prints them from a dump.
+
+ Task switches have their own ring, otherwise they would push everything
+ else out within a few ms. So does the shaper progress, recorded once per
+ block in short segments and as often as the G-code lines that queue them.
+*/
+
+#define FLIGHT_RECORDER_EVENTS  96
+#define FLIGHT_RECORDER_TASKS   32
+#define FLIGHT_RECORDER_SHAPER  32
+#define FLIGHT_RECORDER_MAGIC   0x32455246  // "FRE2" in a little-endian dump, the layout with the shaper ring
+
+enum {
+  FLIGHT_RECORD_NONE,
+  FLIGHT_RECORD_BOOT,    // arg: 0, value: boot count
+  FLIGHT_RECORD_SACP,    // arg: event source, value: sequence << 16 | command set << 8 | command id
+  FLIGHT_RECORD_GCODE,   // arg: command letter, value: code << 20 | file line (low 20 bits)
+  FLIGHT_RECORD_SHAPER,  // arg: planner blocks, value: Y params << 20 | X params << 8 | shaper moves
+  FLIGHT_RECORD_ABORT,   // arg: 0, value: shaper moves dropped
+  FLIGHT_RECORD_TASK,    // arg: priority, value: first 4 chars of the task name
+};
+
+typedef struct {
+  uint16_t time;  // (ms) low bits of the uptime
+  uint8_t type;
+  uint8_t arg;
+  uint32_t value;
+} flight_record_t;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t boots;
+  uint32_t event_head;  // slot of the next record, the oldest one once the ring has wrapped
+  uint32_t task_head;
+  uint32_t shaper_head;
+  flight_record_t events[FLIGHT_RECORDER_EVENTS];
+  flight_record_t tasks[FLIGHT_RECORDER_TASKS];
+  flight_record_t shaper[FLIGHT_RECORDER_SHAPER];
+} flight_recorder_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern flight_recorder_t flight_recorder;
+
+void flight_recorder_init(void);
+
+// Interrupts are masked only around the slot claim and the two stores
+static inline void flight_record_put(flight_record_t *ring, uint32_t size, volatile uint32_t *head,
+                                     uint8_t type, uint8_t arg, uint32_t value) {
+  #ifdef __arm__  // the host tests have no PRIMASK
+    uint32_t primask;
+    __asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+  #endif
+  uint32_t i = *head;
+  *head = (i + 1 == size) ? 0 : i + 1;
+  flight_record_t *r = &ring[i];
+  r->time = (uint16_t)systick_uptime();
+  r->type = type;
+  r->arg = arg;
+  r->value = value;
+  #ifdef __arm__
+    __asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+  #endif
+}
+
+static inline void flight_record(uint8_t type, uint8_t arg, uint32_t value) {
+  flight_record_put(flight_recorder.events, FLIGHT_RECORDER_EVENTS, &flight_recorder.event_head, type, arg, value);
+}
+
+static inline void flight_record_task(uint8_t priority, const char *name) {
+  flight_record_put(flight_recorder.tasks, FLIGHT_RECORDER_TASKS, &flight_recorder.task_head,
+                    FLIGHT_RECORD_TASK, priority, *(const uint32_t *)name);
+}
+
+static inline void flight_record_shaper(uint8_t blocks, uint32_t value) {
+  flight_record_put(flight_recorder.shaper, FLIGHT_RECORDER_SHAPER, &flight_recorder.shaper_head,
+                    FLIGHT_RECORD_SHAPER, blocks, value);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // #ifndef SNAPMAKER_FLIGHT_RECORDER_H_
@@ -30,6 +30,9 @@
 #include "event_update.h"
 #include "event_exception.h"
 #include "../module/calibtration.h"
+#include "../module/system.h"
+#include "../module/print_control.h"
+#include "../debug/flight_recorder.h"
 #include "../../../../Marlin/src/MarlinCore.h"
 
 EventHandler event_handler;
@@ -96,6 +99,8 @@ ErrCode EventHandler::parse(recv_data_info_t *recv_info) {
   }
 
   parse_event_info(recv_info, event);
+  flight_record(FLIGHT_RECORD_SACP, event->param.source,
+                (uint32_t(event->param.info.sequence) << 16) | (event->param.info.command_set << 8) | event->param.info.command_id);
   // char debug_buf[60];
   // sprintf(debug_buf, "SC:event cmd_set: 0x%x ,cmd_id:0x%x", event->param.info.command_set, event->param.info.command_id);
   // SERIAL_ECHOLN(debug_buf);
@@ -108,6 +113,13 @@ ErrCode EventHandler::parse(recv_data_info_t *recv_info) {
 
   event->cb = cb_info->cb;
   if (cb_info->type == EVENT_CB_DIRECT_RUN) {
+    // Until the deferred init is done these are answered busy, the host
+    // retries. The queued ones wait for it in loop_task().
+    if (!system_service.is_ready(SYSTEM_READY_ALL)) {
+      send_result(event->param, E_BUSY);
+      event->block_status = EVENT_CACHT_STATUS_IDLE;
+      return E_BUSY;
+    }
     (event->cb)(event->param);
     event->block_status = EVENT_CACHT_STATUS_IDLE;
     return E_SUCCESS;
@@ -146,10 +158,25 @@ void local_event_loop() {
 
 void EventHandler::loop_task() {
   event_cache_node_t *event = NULL;
+  // The handlers run here may move the axes or use the calibration data,
+  // the recv task answers the direct ones busy until then
+  while (!system_service.is_ready(SYSTEM_READY_ALL)) {
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
   while (true) {
     if (xQueueReceive(event_queue, &event, 1 ) == pdPASS) {
       if (event->block_status == EVENT_CACHT_STATUS_WAIT) {
         event->block_status = EVENT_CACHT_STATUS_BUSY;
+        // These may move the axes, a pause held in place parks the head first
+        switch (event->param.info.command_set) {
+          case COMMAND_SET_FDM:
+          case COMMAND_SET_LINEAR:
+          case COMMAND_SET_CAlIBRATION:
+            print_control.wait_feed_hold_released();
+            break;
+          default:
+            break;
+        }
         (event->cb)(event->param);
         event->block_status = EVENT_CACHT_STATUS_IDLE;
       }
@@ -163,7 +190,85 @@ void EventHandler::loop_task() {
 void EventHandler::recv_enable(event_source_e source, bool enable) {
   event_serial[source]->enable_sacp(enable);
   if (enable) {
-    event_serial[source]->begin(115200);
+    link_info_t *link = &recv_data_info[source].link;
+    link->state = LINK_BAUD_DEFAULT;
+    link->baud = LINK_DEFAULT_BAUD;
+    link->pending_baud = 0;
+    event_serial[source]->begin(LINK_DEFAULT_BAUD);
+  }
+}
+
+static const uint32_t link_bauds[] = {115200, 230400, 460800, 921600};
+
+bool EventHandler::link_baud_supported(uint32_t baud) {
+  for (uint8_t i = 0; i < COUNT(link_bauds); i++) {
+    if (link_bauds[i] == baud) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The switch itself is done by the recv task so that the ack
+// to the request still goes out at the rate it arrived at
+ErrCode EventHandler::link_request_baud(event_source_e source, uint32_t baud) {
+  if (source >= EVENT_SOURCE_ALL || !link_baud_supported(baud)) {
+    return E_PARAM;
+  }
+  recv_data_info[source].link.pending_baud = baud;
+  return E_SUCCESS;
+}
+
+void EventHandler::link_switch_baud(event_source_e source, uint32_t baud) {
+  recv_data_info_t *recv_info = &recv_data_info[source];
+  link_info_t *link = &recv_info->link;
+  event_serial[source]->flush();
+  event_serial[source]->begin(baud);
+  recv_info->sacp_params.lenght = 0;
+  link->baud = baud;
+  link->state = (baud == LINK_DEFAULT_BAUD) ? LINK_BAUD_DEFAULT : LINK_BAUD_PROBATION;
+  link->last_good_ms = millis();
+  link->window_start_ms = link->last_good_ms;
+  link->window_errors = recv_info->sacp_params.stats.resyncs;
+  LOG_I("link %d baud: %d\n", source, baud);
+}
+
+void EventHandler::link_check(event_source_e source) {
+  recv_data_info_t *recv_info = &recv_data_info[source];
+  link_info_t *link = &recv_info->link;
+  uint32_t now = millis();
+
+  if (link->pending_baud) {
+    uint32_t baud = link->pending_baud;
+    link->pending_baud = 0;
+    link_switch_baud(source, baud);
+    return;
+  }
+
+  if (link->state == LINK_BAUD_DEFAULT) {
+    return;
+  }
+
+  // Once confirmed, a quiet link is just an idle host and keeps its rate,
+  // only framing errors drop it back
+  bool fallback = false;
+  if (link->state == LINK_BAUD_PROBATION) {
+    fallback = (now - link->last_good_ms) > LINK_PROBATION_MS;
+  }
+
+  if ((now - link->window_start_ms) > LINK_ERROR_WINDOW_MS) {
+    // window_errors holds the resync count at the start of the window
+    if (recv_info->sacp_params.stats.resyncs - link->window_errors > LINK_MAX_WINDOW_ERRORS) {
+      fallback = true;
+    }
+    link->window_start_ms = now;
+    link->window_errors = recv_info->sacp_params.stats.resyncs;
+  }
+
+  if (fallback) {
+    LOG_E("link %d fall back from baud %d\n", source, link->baud);
+    link->fallbacks++;
+    link_switch_baud(source, LINK_DEFAULT_BAUD);
   }
 }
 
@@ -171,25 +276,41 @@ void EventHandler::recv_enable(event_source_e source) {
   recv_enable(source, true);
 }
 
-void EventHandler::recv_task() {
+// One pass over the ports, a byte from each, returns false if all were quiet
+bool EventHandler::recv_poll() {
   recv_data_info_t *recv_info;
-  while (true) {
-    bool need_wait = true;
-    for (uint8_t i = 0; i < EVENT_SOURCE_ALL; i++) {
-      recv_info = &recv_data_info[i];
-      if (event_serial[i]->enable_sacp()) {
-        int ch = event_read_byte[i]();
-        if (ch != -1) {
-          uint8_t data = ch&0xFF;
-          if (protocol_sacp.parse(&data, 1, recv_info->sacp_params) == E_SUCCESS) {
-            recv_info->recv_source = (event_source_e)i;
-            event_handler.parse(recv_info);
+  bool got_data = false;
+  for (uint8_t i = 0; i < EVENT_SOURCE_ALL; i++) {
+    recv_info = &recv_data_info[i];
+    if (event_serial[i]->enable_sacp()) {
+      int ch = event_read_byte[i]();
+      if (ch != -1) {
+        uint8_t data = ch&0xFF;
+        if (protocol_sacp.parse(&data, 1, recv_info->sacp_params) == E_SUCCESS) {
+          recv_info->recv_source = (event_source_e)i;
+          recv_info->link.last_good_ms = millis();
+          if (recv_info->link.state == LINK_BAUD_PROBATION) {
+            recv_info->link.state = LINK_BAUD_CONFIRMED;
+          }
+          event_handler.parse(recv_info);
+          if (first_packet) {
+            first_packet = false;
+            system_service.boot_mark(BOOT_PHASE_FIRST_SACP);
+            LOG_I("first SACP packet handled at %u ms\n", millis());
           }
-          need_wait = false;
         }
+        got_data = true;
       }
+      link_check((event_source_e)i);
     }
-    if (need_wait) {
+  }
+  return got_data;
+}
+
+void EventHandler::recv_task() {
+  system_service.boot_mark(BOOT_PHASE_SACP_RECV);
+  while (true) {
+    if (!recv_poll()) {
       vTaskDelay(pdMS_TO_TICKS(5));
     }
   }
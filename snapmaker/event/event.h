@@ -40,10 +40,32 @@ typedef struct {
   evevnt_cb_f cb;  // event callback
 } event_cache_node_t;
 
+#define LINK_DEFAULT_BAUD         115200
+#define LINK_PROBATION_MS         1000   // a good frame must arrive at the new rate within this time
+#define LINK_ERROR_WINDOW_MS      1000
+#define LINK_MAX_WINDOW_ERRORS    8      // framing errors per window tolerated at a raised rate
+
+typedef enum {
+  LINK_BAUD_DEFAULT,
+  LINK_BAUD_PROBATION,
+  LINK_BAUD_CONFIRMED,
+} link_baud_state_e;
+
+typedef struct {
+  link_baud_state_e state;
+  uint32_t baud;
+  uint32_t pending_baud;  // applied by the recv task once the ack has drained
+  uint32_t last_good_ms;
+  uint32_t window_start_ms;
+  uint32_t window_errors;
+  uint32_t fallbacks;
+} link_info_t;
+
 typedef struct {
   bool enable;
   SACP_param_t sacp_params;
   event_source_e recv_source;  // Event source
+  link_info_t link;
 } recv_data_info_t;
 
 class EventHandler {
@@ -56,18 +78,25 @@ class EventHandler {
 
     void loop_task();
     void recv_task();
+    bool recv_poll();
     void recv_enable(event_source_e source, bool enable);
     void recv_enable(event_source_e source);
+    bool link_baud_supported(uint32_t baud);
+    ErrCode link_request_baud(event_source_e source, uint32_t baud);
+    recv_data_info_t * get_recv_info(event_source_e source) {return &recv_data_info[source];}
 
   private:
     ErrCode parse(recv_data_info_t *recv_info);
     void parse_event_info(recv_data_info_t *recv_info, event_cache_node_t *event);
     event_cache_node_t * get_event_cache();
+    void link_switch_baud(event_source_e source, uint32_t baud);
+    void link_check(event_source_e source);
 
   private:
     event_cache_node_t err_result_event;
     event_cache_node_t event_cache[EVENT_CACHE_COUNT];
     recv_data_info_t recv_data_info[EVENT_SOURCE_ALL] = {0};
+    bool first_packet = true;
 };
 
 typedef enum {
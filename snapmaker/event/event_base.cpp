@@ -31,6 +31,9 @@ write_byte_f event_write_byte[EVENT_SOURCE_ALL] = {
 
 static SemaphoreHandle_t event_write_lock[EVENT_SOURCE_ALL] {NULL};
 
+static event_param_t *capture_event = NULL;
+static event_capture_f capture_cb = NULL;
+
 read_byte_f event_read_byte[EVENT_SOURCE_ALL] = {
   []()->size_t{return event_serial[EVENT_SOURCE_MARLIN]->read();},
   []()->size_t{return event_serial[EVENT_SOURCE_HMI]->read();},
@@ -88,12 +91,25 @@ bool send_data(event_source_e source, uint8_t *data, uint16_t len) {
   return true;
 }
 
+void event_capture(event_param_t *event, event_capture_f cb) {
+  capture_cb = cb;
+  capture_event = event;
+}
+
 ErrCode send_event(event_param_t &event) {
+  if (&event == capture_event) {
+    capture_cb(event.data, event.length);
+    return E_SUCCESS;
+  }
   send_event(event.source, event.info, event.data, event.length);
   return E_SUCCESS;
 }
 
 ErrCode send_event(event_param_t &event, uint8_t *data, uint16_t length) {
+  if (&event == capture_event) {
+    capture_cb(data, length);
+    return E_SUCCESS;
+  }
   send_event(event.source, event.info, data, length);
   return E_SUCCESS;
 }
@@ -70,6 +70,8 @@ typedef struct {
 
 //Types of event function callbacks
 typedef std::function<ErrCode(event_param_t&)> evevnt_cb_f;
+// Receives the payload of a send_event() on the captured parameter instead of the serial port
+typedef std::function<void(uint8_t *data, uint16_t length)> event_capture_f;
 
 // Used to specify the event callback handling method
 typedef enum {
@@ -105,6 +107,9 @@ ErrCode send_event(event_source_e source, SACP_head_base_t &sacp, uint8_t *data,
 ErrCode send_event(event_source_e source, uint8_t recever_id, uint8_t attribute, uint8_t command_set,
                    uint8_t command_id, uint8_t *data, uint16_t length, uint16_t sequence=0);
 ErrCode send_result(event_param_t &event, ErrCode result);
+// Redirect send_event() on this parameter to cb, NULL to stop. There is one
+// capture at a time, the caller holds it under its own lock
+void event_capture(event_param_t *event, event_capture_f cb);
 ErrCode write_fun_register(event_source_e source, write_byte_f cb);
 bool send_data(event_source_e source, uint8_t *data, uint16_t len);
 #endif // EVENT_BASE_H
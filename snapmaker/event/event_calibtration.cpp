@@ -23,6 +23,7 @@
 #include "../module/calibtration.h"
 #include "../module/system.h"
 #include "../module/print_control.h"
+#include "src/module/shaper/ZMesh.h"
 
 enum {
   DED_AUTO_CAlIBRATION_MODE = 0,
@@ -61,6 +62,15 @@ typedef struct {
   uint8_t extruder_count;  // 1
   z_offet_info_t info;
 } sc_get_z_offet_t;
+
+#if ENABLED(SHAPER_Z_MESH)
+typedef struct {
+  uint8_t result;
+  uint8_t grid_x;
+  uint8_t grid_y;
+  float_to_int_t z[Z_MESH_GRID_Y][Z_MESH_GRID_X];  // Rows from Y min, each from X min
+} z_mesh_info_t;
+#endif
 #pragma pack()
 
 
@@ -236,6 +246,36 @@ static ErrCode calibtration_get_z_offset(event_param_t& event) {
   return send_event(event);
 }
 
+// Reply with the result and the grid. Without a valid mesh only the result is sent.
+static ErrCode calibtration_send_z_mesh(event_param_t& event, ErrCode result) {
+  #if ENABLED(SHAPER_Z_MESH)
+    z_mesh_info_t * info = (z_mesh_info_t *)event.data;
+    if (result == E_SUCCESS && zMesh.valid) {
+      info->result = E_SUCCESS;
+      info->grid_x = Z_MESH_GRID_X;
+      info->grid_y = Z_MESH_GRID_Y;
+      LOOP_L_N(j, Z_MESH_GRID_Y) LOOP_L_N(i, Z_MESH_GRID_X)
+        info->z[j][i] = FLOAT_TO_INT(zMesh.z[j][i]);
+      event.length = sizeof(z_mesh_info_t);
+      return send_event(event);
+    }
+  #endif
+  event.data[0] = (result == E_SUCCESS) ? E_COMMON_ERROR : result;
+  event.length = 1;
+  return send_event(event);
+}
+
+static ErrCode calibtration_probe_z_mesh(event_param_t& event) {
+  LOG_V("SC req probe z mesh\n");
+  ErrCode ret = TERN(SHAPER_Z_MESH, calibtration.probe_z_mesh(), E_COMMON_ERROR);
+  LOG_I("probe z mesh result:%d\n", ret);
+  return calibtration_send_z_mesh(event, ret);
+}
+
+static ErrCode calibtration_report_z_mesh(event_param_t& event) {
+  return calibtration_send_z_mesh(event, E_SUCCESS);
+}
+
 event_cb_info_t calibtration_cb_info[CAlIBRATION_ID_CB_COUNT] = {
   {CAlIBRATION_ID_SET_MODE         , EVENT_CB_DIRECT_RUN,   calibtration_set_mode},
   {CAlIBRATION_ID_MOVE_TO_POSITION , EVENT_CB_TASK_RUN,     calibtration_move_to_pos},
@@ -250,4 +290,6 @@ event_cb_info_t calibtration_cb_info[CAlIBRATION_ID_CB_COUNT] = {
   {CAlIBRATION_ID_SET_XY_OFFSET    , EVENT_CB_TASK_RUN,     calibtration_set_xy_offset},
   {CAlIBRATION_ID_REPORT_XY_OFFSET , EVENT_CB_DIRECT_RUN,   calibtration_report_xy_offset},
   {CAlIBRATION_ID_SUBSCRIBE_Z_OFFSET , EVENT_CB_DIRECT_RUN, calibtration_get_z_offset},
+  {CAlIBRATION_ID_PROBE_Z_MESH     , EVENT_CB_TASK_RUN,     calibtration_probe_z_mesh},
+  {CAlIBRATION_ID_REPORT_Z_MESH    , EVENT_CB_DIRECT_RUN,   calibtration_report_z_mesh},
 };
@@ -37,10 +37,12 @@ enum {
   CAlIBRATION_ID_START_XY            = 0x21,
   CAlIBRATION_ID_SET_XY_OFFSET       = 0x22,
   CAlIBRATION_ID_REPORT_XY_OFFSET    = 0x23,
+  CAlIBRATION_ID_PROBE_Z_MESH        = 0x30,
+  CAlIBRATION_ID_REPORT_Z_MESH       = 0x31,
   CAlIBRATION_ID_SUBSCRIBE_Z_OFFSET    = 0xA2,
 };
 
-#define CAlIBRATION_ID_CB_COUNT 13
+#define CAlIBRATION_ID_CB_COUNT 15
 
 extern event_cb_info_t calibtration_cb_info[CAlIBRATION_ID_CB_COUNT];
 #endif
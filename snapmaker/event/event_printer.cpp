@@ -676,6 +676,13 @@ void paused_status_deal() {
     start_pause_record = true;
   }
 
+  // A head paused in place still sits on the print, park it before it cools
+  // down or when another request needs the axes
+  if (print_control.is_feed_held() &&
+      (print_control.req_release_hold || ELAPSED(millis(), start_pause_time_ms + (2 * 60 * 1000)))) {
+    print_control.release_feed_hold();
+  }
+
   if (ELAPSED(millis(), start_pause_time_ms + (2 * 60 * 1000))) {
     HOTEND_LOOP() {
       if (fdm_head.extraduer_enable(e)) {
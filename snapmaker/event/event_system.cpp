@@ -43,6 +43,14 @@ typedef struct {
   bool state;
 } motor_state_t;
 
+typedef struct {
+  uint8_t result;
+  uint32_t baud;
+  uint8_t state;
+  uint32_t fallbacks;
+  SACP_link_stats_t stats;
+} link_stats_ack_t;
+
 #pragma pack()
 
 static ErrCode subscribe_event(event_param_t& event) {
@@ -222,6 +230,7 @@ static ErrCode move_relative_home(event_param_t& event) {
 typedef struct {
   uint8_t axis;
   float_to_int_t freq;
+  uint8_t tool;  // optional, IDEX carriage of the X shaper
 } axis_inputshaper_t;
 #pragma pack(0)
 
@@ -229,8 +238,9 @@ static ErrCode inputshaper_set(event_param_t& event) {
   axis_inputshaper_t *is = (axis_inputshaper_t *)(event.data);
   uint8_t axis = is->axis - 1;
   float freq = INT_TO_FLOAT(is->freq);
-  LOG_I("SC set inputshaper, axis: %d, F: %f", axis, freq);
-  event.data[0] = axisManager.input_shaper_set(axis, DEFAULT_IS_TYPE, freq, DEFAULT_IS_DAMP);
+  uint8_t tool = event.length >= sizeof(axis_inputshaper_t) ? is->tool : X_SHAPER_ANY_TOOL;
+  LOG_I("SC set inputshaper, axis: %d, tool: %d, F: %f", axis, tool, freq);
+  event.data[0] = axisManager.input_shaper_set(axis, DEFAULT_IS_TYPE, freq, DEFAULT_IS_DAMP, tool);
   event.length = 1;
   extern bool ml_setting_need_save;
   ml_setting_need_save = true;
@@ -243,7 +253,8 @@ static ErrCode inputshaper_get(event_param_t& event) {
   int axis, type; float freq, damp;
 
   axis = event.data[0] - 1;
-  event.data[0] = axisManager.input_shaper_get(axis, type, freq, damp);
+  uint8_t tool = event.length >= 2 ? event.data[1] : X_SHAPER_ANY_TOOL;
+  event.data[0] = axisManager.input_shaper_get(axis, type, freq, damp, tool);
 
   int i_freq = FLOAT_TO_INT(freq);
   event.data[1] = i_freq & 0xff;
@@ -255,23 +266,56 @@ static ErrCode inputshaper_get(event_param_t& event) {
   return send_event(event);
 }
 
+#pragma pack(1)
+typedef struct {
+  uint8_t result;
+  uint8_t axis;
+  uint8_t type;
+  float_to_int_t freq;
+  float_to_int_t smoothing;  // mm at SHAPER_SMOOTHING_ACCEL
+  float_to_int_t max_accel;  // mm/s^2, 0 for no limit
+  uint8_t limit;             // the planner holds the axis to max_accel
+} inputshaper_limits_ack_t;
+#pragma pack(0)
+
+static ErrCode inputshaper_limits_get(event_param_t& event) {
+  uint8_t axis = event.data[0] - 1;
+  inputshaper_limits_ack_t *ack = (inputshaper_limits_ack_t *)event.data;
+  if (axis != X_AXIS && axis != Y_AXIS) {
+    ack->result = E_PARAM;
+    event.length = 1;
+    return send_event(event);
+  }
+
+  AxisInputShaper *shaper = axis == X_AXIS ? &AxisInputShaper::axis_input_shaper_x : &AxisInputShaper::axis_input_shaper_y;
+  ack->result = E_SUCCESS;
+  ack->axis = axis + 1;
+  ack->type = (uint8_t)shaper->type;
+  ack->freq = FLOAT_TO_INT(shaper->frequency);
+  ack->smoothing = FLOAT_TO_INT(shaper->smoothing);
+  ack->max_accel = FLOAT_TO_INT(shaper->max_accel);
+  ack->limit = axisManager.shaper_accel_limit;
+  event.length = sizeof(inputshaper_limits_ack_t);
+  return send_event(event);
+}
+
 static ErrCode resonance_compensation_set(event_param_t& event) {
 
   int axis, type; float freq, damp;
 
   LOG_I("SC resonance compesation set, turn %s \r\n", event.data[0] ? "on" : "off");
 
+  // Only the type is toggled on the stored X entries, a carriage with
+  // frequency 0 keeps following T0
   axis = X_AXIS;
-  if (E_SUCCESS != axisManager.input_shaper_get(axis, type, freq, damp)) {
-    event.data[0] = E_FAILURE;
-    event.length = 1;
-    return send_event(event);
-  }
-  type = event.data[0] ? type : 0;
-  if (E_SUCCESS != axisManager.input_shaper_set(axis, type, freq, damp)) {
-    event.data[0] = E_FAILURE;
-    event.length = 1;
-    return send_event(event);
+  for (uint8_t tool = 0; tool < X_SHAPER_TOOLS; tool++) {
+    const shaper_config_t &config = axisManager.x_shaper[tool];
+    type = event.data[0] ? config.type : 0;
+    if (E_SUCCESS != axisManager.input_shaper_set(axis, type, config.frequency, config.zeta, tool)) {
+      event.data[0] = E_FAILURE;
+      event.length = 1;
+      return send_event(event);
+    }
   }
 
   axis = Y_AXIS;
@@ -471,6 +515,37 @@ static ErrCode set_motor_enable(event_param_t& event) {
   return send_event(event);
 }
 
+// The ack goes out at the current rate, the recv task switches after it
+// has drained. If no good frame arrives at the new rate within
+// LINK_PROBATION_MS the link falls back to LINK_DEFAULT_BAUD.
+static ErrCode link_set_baud(event_param_t& event) {
+  uint32_t baud = 0;
+  ErrCode ret = E_PARAM;
+  if (event.length >= 4) {
+    baud = *(uint32_t *)event.data;
+    ret = event_handler.link_request_baud(event.source, baud);
+  }
+  LOG_I("SC req link baud %d, ret %d\n", baud, ret);
+  event.data[0] = ret;
+  event.length = 1;
+  return send_event(event);
+}
+
+static ErrCode link_get_stats(event_param_t& event) {
+  recv_data_info_t *recv_info = event_handler.get_recv_info(event.source);
+  link_stats_ack_t *ack = (link_stats_ack_t *)event.data;
+  ack->result = E_SUCCESS;
+  ack->baud = recv_info->link.baud;
+  ack->state = recv_info->link.state;
+  ack->fallbacks = recv_info->link.fallbacks;
+  ack->stats = recv_info->sacp_params.stats;
+  event.length = sizeof(link_stats_ack_t);
+  return send_event(event);
+}
+
+static ErrCode subscribe_status_snapshot(event_param_t& event) {
+  return subscribe.status_snapshot(event);
+}
 
 event_cb_info_t system_cb_info[SYS_ID_CB_COUNT] = {
   {SYS_ID_SUBSCRIBE             ,         EVENT_CB_DIRECT_RUN,    subscribe_event},
@@ -506,4 +581,8 @@ event_cb_info_t system_cb_info[SYS_ID_CB_COUNT] = {
   {SYS_ID_GET_BUILD_PLATE_TKNESS ,        EVENT_CB_TASK_RUN,      get_build_plate_thickness},
   {SYS_ID_GET_DISTANCE_RELATIVE_HOME ,    EVENT_CB_TASK_RUN,      req_distance_relative_home},
   {SYS_ID_SUBSCRIBE_MOTOR_ENABLE_STATUS , EVENT_CB_DIRECT_RUN,    get_motor_enable},
+  {SYS_ID_LINK_SET_BAUD ,                 EVENT_CB_DIRECT_RUN,    link_set_baud},
+  {SYS_ID_LINK_GET_STATS ,                EVENT_CB_DIRECT_RUN,    link_get_stats},
+  {SYS_ID_INPUTSHAPER_LIMITS_GET ,        EVENT_CB_TASK_RUN,      inputshaper_limits_get},
+  {SYS_ID_SUBSCRIBE_STATUS_SNAPSHOT ,     EVENT_CB_DIRECT_RUN,    subscribe_status_snapshot},
 };
\ No newline at end of file
@@ -55,11 +55,15 @@ enum : uint8_t {
   SYS_ID_GET_Z_HOME_SG                  = 0x43,
   SYS_ID_SET_BUILD_PLATE_TKNESS         = 0x44,
   SYS_ID_GET_BUILD_PLATE_TKNESS         = 0x45,
+  SYS_ID_LINK_SET_BAUD                  = 0x46,
+  SYS_ID_LINK_GET_STATS                 = 0x47,
+  SYS_ID_INPUTSHAPER_LIMITS_GET         = 0x48,
   SYS_ID_GET_DISTANCE_RELATIVE_HOME     = 0xA3,
   SYS_ID_SUBSCRIBE_MOTOR_ENABLE_STATUS  = 0xA4,
+  SYS_ID_SUBSCRIBE_STATUS_SNAPSHOT      = 0xA5,
 };
 
-#define SYS_ID_CB_COUNT 33
+#define SYS_ID_CB_COUNT 37
 
 extern event_cb_info_t system_cb_info[SYS_ID_CB_COUNT];
 
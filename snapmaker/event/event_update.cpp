@@ -21,6 +21,29 @@
 
 #include "event_update.h"
 #include "../module/update.h"
+#include "../module/system.h"
+
+#pragma pack(1)
+
+typedef struct {
+  uint32_t offset;
+  uint16_t length;
+  uint8_t data[];
+} update_stage_data_t;
+
+typedef struct {
+  uint32_t frame_offset;  // image offset the frame decodes to, page aligned
+  uint16_t frame_pos;     // position of this data in the compressed frame
+  uint16_t length;
+  uint8_t data[];
+} update_stage_compressed_t;
+
+typedef struct {
+  uint8_t result;
+  uint32_t offset;  // where the host should send the next chunk from
+} update_stage_ack_t;
+
+#pragma pack()
 
 
 static ErrCode req_start_update(event_param_t& event) {
@@ -45,6 +68,70 @@ static ErrCode req_start_update(event_param_t& event) {
   return ret;
 }
 
+static ErrCode send_stage_ack(event_param_t& event, ErrCode result) {
+  update_stage_ack_t *ack = (update_stage_ack_t *)event.data;
+  ack->result = result;
+  ack->offset = update_server.stage_offset();
+  event.length = sizeof(update_stage_ack_t);
+  return send_event(event);
+}
+
+static ErrCode req_stage_start(event_param_t& event) {
+  update_packet_info_t * head = (update_packet_info_t *)(event.data+2);
+
+  if (event.length < sizeof(update_packet_info_t) + 2) {
+    SERIAL_ECHOLNPAIR("update pack head len failed");
+    return send_stage_ack(event, E_PARAM);
+  }
+  return send_stage_ack(event, update_server.stage_start(head, event.source, event.info.recever_id));
+}
+
+static ErrCode req_stage_data(event_param_t& event) {
+  update_stage_data_t *pack = (update_stage_data_t *)event.data;
+  ErrCode result;
+
+  if (event.length < sizeof(update_stage_data_t) || event.length < sizeof(update_stage_data_t) + pack->length) {
+    result = E_PARAM;
+  } else {
+    result = update_server.stage_write(pack->offset, pack->data, pack->length);
+  }
+  ErrCode ret = send_stage_ack(event, result);
+
+  // The host is sending the next chunk while the next page is erased
+  update_server.stage_erase_ahead();
+  return ret;
+}
+
+static ErrCode req_stage_data_compressed(event_param_t& event) {
+  update_stage_compressed_t *pack = (update_stage_compressed_t *)event.data;
+  ErrCode result;
+
+  if (event.length < sizeof(update_stage_compressed_t) || event.length < sizeof(update_stage_compressed_t) + pack->length) {
+    result = E_PARAM;
+  } else {
+    result = update_server.stage_write_compressed(pack->frame_offset, pack->frame_pos, pack->data, pack->length);
+  }
+  ErrCode ret = send_stage_ack(event, result);
+  update_server.stage_erase_ahead();
+  return ret;
+}
+
+static ErrCode req_stage_finish(event_param_t& event) {
+  ErrCode result = update_server.stage_finish();
+  ErrCode ret = send_stage_ack(event, result);
+
+  // Never reboot under a running job, boot swaps in the staged image on next reset
+  if (result == E_SUCCESS && !system_service.is_working()) {
+    vTaskDelay(pdMS_TO_TICKS(100));
+    update_server.just_to_boot();
+  }
+  return ret;
+}
+
 event_cb_info_t update_cb_info[UPDATE_ID_CB_COUNT] = {
-  {UPDATE_ID_REQ_UPDATE      , EVENT_CB_DIRECT_RUN, req_start_update}
+  {UPDATE_ID_REQ_UPDATE      , EVENT_CB_DIRECT_RUN, req_start_update},
+  {UPDATE_ID_STAGE_START     , EVENT_CB_TASK_RUN  , req_stage_start},
+  {UPDATE_ID_STAGE_DATA      , EVENT_CB_TASK_RUN  , req_stage_data},
+  {UPDATE_ID_STAGE_FINISH    , EVENT_CB_TASK_RUN  , req_stage_finish},
+  {UPDATE_ID_STAGE_DATA_COMPRESSED, EVENT_CB_TASK_RUN, req_stage_data_compressed},
 };
\ No newline at end of file
@@ -28,9 +28,13 @@ enum : uint8_t {
   UPDATE_ID_REQ_UPDATE              = 0x01,
   UPDATE_ID_REQ_UPDATE_PACK         = 0x02,
   UPDATE_ID_REPORT_STATUS           = 0x03,
+  UPDATE_ID_STAGE_START             = 0x04,
+  UPDATE_ID_STAGE_DATA              = 0x05,
+  UPDATE_ID_STAGE_FINISH            = 0x06,
+  UPDATE_ID_STAGE_DATA_COMPRESSED   = 0x07,
 };
 
-#define UPDATE_ID_CB_COUNT 1
+#define UPDATE_ID_CB_COUNT 5
 extern event_cb_info_t update_cb_info[UPDATE_ID_CB_COUNT];
 
 #endif
@@ -28,12 +28,60 @@
 #include "../module/system.h"
 #include "../module/exception.h"
 #include "../module/print_control.h"
+#include "event_system.h"
+#include "event_fdm.h"
+#include "event_printer.h"
+#include "event_enclouser.h"
 
 Subscribe subscribe;
 
 extern event_cb_info_t * get_event_info(uint8_t cmd_set, uint8_t cmd_id);
 
 static event_param_t event_public_param;
+static event_param_t snapshot_param;
+// A snapshot is asked for directly by the recv task or by a subscription
+// in the subscribe task, both go through snapshot_param and the capture
+static SemaphoreHandle_t snapshot_lock = NULL;
+
+typedef struct {
+  uint8_t command_set;
+  uint8_t command_id;
+} snapshot_field_t;
+
+// Reports folded into a status snapshot, each may yield one record per extruder
+static const snapshot_field_t snapshot_fields[] = {
+  {COMMAND_SET_FDM, FDM_ID_SUBSCRIBE_MODULE_INFO},
+  {COMMAND_SET_FDM, FDM_ID_SUBSCRIBE_EXTRUDER_INFO},
+  {COMMAND_SET_FDM, FDM_ID_SUBSCRIBE_FAN_INFO},
+  {COMMAND_SET_FDM, FDM_ID_SUBSCRIBE_EXTRUSION_STATUS},
+  {COMMAND_SET_PRINTER, PRINTER_ID_SUBSCRIBE_WORK_PERCENTAGE},
+  {COMMAND_SET_PRINTER, PRINTER_ID_SUBSCRIBE_FLOW_PERCENTAGE},
+  {COMMAND_SET_PRINTER, PRINTER_ID_SUBSCRIBE_WORK_TIME},
+  {COMMAND_SET_PRINTER, PRINTER_ID_SUBSCRIBE_PRINT_MODE},
+  {COMMAND_SET_ENCLOUSER, ENCLOUSER_ID_SUBSCRIBE_INFO},
+};
+
+#pragma pack(1)
+// Snapshot payload: result, flags, then records back to back
+typedef struct {
+  uint8_t command_set;
+  uint8_t command_id;
+  uint16_t length;
+  uint8_t data[0];
+} snapshot_record_t;
+#pragma pack()
+
+#define SNAPSHOT_FLAG_KEYFRAME  (1<<0)
+#define SNAPSHOT_HEAD_LEN       2
+#define SNAPSHOT_MAX_PAYLOAD    (PACK_PARSE_MAX_SIZE - SACP_HEADER_LEN)
+
+static uint32_t snapshot_hash(uint8_t *data, uint16_t length) {
+  uint32_t hash = 2166136261UL;  // FNV-1a
+  for (uint16_t i = 0; i < length; i++) {
+    hash = (hash ^ data[i]) * 16777619UL;
+  }
+  return hash ^ length;
+}
 
 ErrCode Subscribe::enable(event_param_t &event) {
   if (sub_count >= MAX_SUBSCRIBE_COUNT) {
@@ -77,6 +125,10 @@ ErrCode Subscribe::enable(event_param_t &event) {
   sub[index].source = event.source;
   sub[index].is_available = true;
 
+  if (cmd_set == COMMAND_SET_SYS && cmd_id == SYS_ID_SUBSCRIBE_STATUS_SNAPSHOT && event.source < EVENT_SOURCE_ALL) {
+    snapshot[event.source].count = 0;  // Start over with a keyframe
+  }
+
   return E_SUCCESS;
 }
 
@@ -104,6 +156,67 @@ ErrCode Subscribe::disable(event_param_t &event) {
   return E_PARAM;
 }
 
+ErrCode Subscribe::status_snapshot(event_param_t &event) {
+  if (event.source >= EVENT_SOURCE_ALL) {
+    return E_PARAM;
+  }
+  if (xSemaphoreTake(snapshot_lock, portMAX_DELAY) != pdPASS) {
+    return E_BUSY;
+  }
+  snapshot_state_t &state = snapshot[event.source];
+  bool keyframe = (state.count % SNAPSHOT_KEYFRAME_INTERVAL) == 0;
+  uint8_t record = 0;
+
+  event.data[0] = E_SUCCESS;
+  event.data[1] = keyframe ? SNAPSHOT_FLAG_KEYFRAME : 0;
+  event.length = SNAPSHOT_HEAD_LEN;
+
+  event_capture(&snapshot_param, [&](uint8_t *data, uint16_t length) {
+    if (record >= SNAPSHOT_MAX_RECORDS) {
+      return;
+    }
+    uint32_t hash = snapshot_hash(data, length);
+    bool changed = keyframe || (hash != state.hash[record]);
+    state.hash[record++] = hash;
+    if (!changed) {
+      return;
+    }
+    if (event.length + sizeof(snapshot_record_t) + length > SNAPSHOT_MAX_PAYLOAD) {
+      send_event(event);
+      event.info.sequence = protocol_sacp.sequence_pop();
+      event.length = SNAPSHOT_HEAD_LEN;
+    }
+    snapshot_record_t *rec = (snapshot_record_t *)(event.data + event.length);
+    rec->command_set = snapshot_param.info.command_set;
+    rec->command_id = snapshot_param.info.command_id;
+    rec->length = length;
+    memcpy(rec->data, data, length);
+    event.length += sizeof(snapshot_record_t) + length;
+  });
+
+  for (uint8_t i = 0; i < COUNT(snapshot_fields); i++) {
+    event_cb_info_t *cb_info = get_event_info(snapshot_fields[i].command_set, snapshot_fields[i].command_id);
+    if (!cb_info) {
+      continue;
+    }
+    snapshot_param.info = event.info;
+    snapshot_param.info.command_set = snapshot_fields[i].command_set;
+    snapshot_param.info.command_id = snapshot_fields[i].command_id;
+    snapshot_param.source = event.source;
+    snapshot_param.write_byte = event.write_byte;
+    snapshot_param.length = 0;
+    (cb_info->cb)(snapshot_param);
+  }
+  event_capture(NULL, NULL);
+
+  state.count++;
+  xSemaphoreGive(snapshot_lock);
+  if (event.length > SNAPSHOT_HEAD_LEN) {
+    return send_event(event);
+  }
+  return E_SUCCESS;
+}
+
 void Subscribe::loop_task(void * arg) {
   while (true) {
     for (uint8_t i = 0; i < sub_count; i++) {
@@ -129,6 +242,8 @@ static void subscribe_task(void * arg) {
 }
 
 void subscribe_init(void) {
+  snapshot_lock = xSemaphoreCreateMutex();
+  configASSERT(snapshot_lock);
 
   TaskHandle_t thandle_subscribe = NULL;
   BaseType_t ret = xTaskCreate(subscribe_task, "subscribe_loop", 1024, NULL, 5, &thandle_subscribe);
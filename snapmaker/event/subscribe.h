@@ -28,6 +28,16 @@
 
 #define MAX_SUBSCRIBE_COUNT 30
 
+// Status snapshot: one frame per interval carrying the reports of several
+// subscriptions as records, each only when it differs from the last snapshot
+#define SNAPSHOT_MAX_RECORDS        16
+#define SNAPSHOT_KEYFRAME_INTERVAL  30  // every Nth snapshot carries all records
+
+typedef struct {
+  uint32_t count;
+  uint32_t hash[SNAPSHOT_MAX_RECORDS];
+} snapshot_state_t;
+
 typedef struct {
   bool is_available;
   event_source_e source;
@@ -43,9 +53,11 @@ class Subscribe {
     ErrCode enable(event_param_t &event);
     ErrCode disable(event_param_t &event);
     void loop_task(void *arg);
+    ErrCode status_snapshot(event_param_t &event);
   private:
     subscribe_node_t sub[MAX_SUBSCRIBE_COUNT];
     uint8_t sub_count;
+    snapshot_state_t snapshot[EVENT_SOURCE_ALL];
 };
 void subscribe_init(void);
 extern Subscribe subscribe;
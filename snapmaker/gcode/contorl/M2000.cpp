@@ -88,6 +88,7 @@ void GcodeSuite::M2000() {
       quickstop_stepper();
       dual_x_carriage_mode = DXC_FULL_CONTROL_MODE;
       set_duplication_enabled(false);
+      axisManager.select_x_shaper();
     }
     break;
 
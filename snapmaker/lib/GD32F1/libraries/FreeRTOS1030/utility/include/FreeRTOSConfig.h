@@ -124,5 +124,9 @@ standard names. */
 #define xPortPendSVHandler PendSV_Handler
 #define xPortSysTickHandler SysTick_Handler
 
+/* Log every task switch in the crash flight recorder. */
+#include "../../../../../../debug/flight_recorder.h"
+#define traceTASK_SWITCHED_IN() flight_record_task( ( uint8_t ) pxCurrentTCB->uxPriority, pxCurrentTCB->pcTaskName )
+
 #endif /* FREERTOS_CONFIG_H */
 
@@ -822,6 +822,8 @@ class TMC5161Stepper : public TMC5160Stepper {
 			TMC5160Stepper(pinCS, RS, pinMOSI, pinMISO, pinSCK, link_index) {}
 };
 
+extern bool st_hold_writes;
+
 class TMC2208Stepper : public TMCStepper {
 	public:
 	    TMC2208Stepper(Stream * SerialPort, float RS, uint8_t addr, uint16_t mul_pin1, uint16_t mul_pin2);
@@ -25,6 +25,9 @@ uint8_t st_slave_address = 0x03;
 
 uint8_t st_select_index = 0xff;
 
+// While set, writes only update the shadow registers, push() sends them later
+bool st_hold_writes = false;
+
 void select(uint8_t index) {
   if(st_select_index == index)
     return;
@@ -223,6 +226,7 @@ void TMC2208Stepper::postReadCommunication() {
 }
 
 void TMC2208Stepper::write(uint8_t addr, uint32_t regVal) {
+	if (st_hold_writes) return;
 	uint8_t len = 7;
 	select(slave_address);
 	delay(2);
@@ -757,6 +757,124 @@ float Calibtration::multiple_probe(uint8_t axis, float distance, uint16_t freera
   return (pos - max_ - min_) / (PROBE_TIMES - 3);
 }
 
+static float trimmed_mean(const float *v, uint8_t n) {
+  float sum = 0, max_ = v[0], min_ = v[0];
+  for (uint8_t i = 0; i < n; i++) {
+    sum += v[i];
+    if (v[i] > max_) max_ = v[i];
+    if (v[i] < min_) min_ = v[i];
+  }
+  return (n > 2) ? (sum - max_ - min_) / (n - 2) : sum / n;
+}
+
+// Queue a move along one axis, without waiting for it
+static void sweep_line(uint8_t axis, float distance, uint16_t feedrate) {
+  current_position[axis] += distance;
+  line_to_current_position(MMM_TO_MMS(feedrate));
+}
+
+/**
+ * Find the center of the probe target along an axis by sweeping between its
+ * two walls. Each pass latches where the nozzle leaves one wall without
+ * stopping, and stops when it touches the other, so there are no back-off
+ * moves. Leaving the minus wall is always seen moving plus and the plus wall
+ * moving minus, so backlash cancels in the center as it does for the
+ * stop-start probes.
+ *
+ * The first pass crosses at the fast probe speed to measure the gap. The
+ * others are queued as one run: they leave the wall at PROBE_SWEEP_FEEDRATE,
+ * cross the gap fast and slow down again PROBE_SWEEP_APPROACH before the
+ * other wall. The touch is latched from the pin edge and the abort discards
+ * the rest of the queue, so an early touch still stops the run.
+ */
+probe_result_e Calibtration::sweep_probe_center(uint8_t axis, float &center) {
+  const float steps_per_mm = planner.settings.axis_steps_per_mm[axis];
+  float edge[2][PROBE_SWEEP_SAMPLES];  // Release points of the minus and plus walls
+  uint8_t count[2] = {0, 0};
+
+  // Find the minus wall fast, with stall guard, as the stop-start probe does
+  probe_result_e ret = probe(axis, -PROBE_DISTANCE, PROBE_FAST_XY_FEEDRATE, true);
+  if (ret != PROBR_RESULT_SUCCESS) return ret;
+
+  set_calibration_move_param();
+
+  float travel = 2 * PROBE_DISTANCE, gap = 0;
+  int8_t dir = 1;
+  for (uint8_t pass = 0; pass < PROBE_SWEEP_PASSES; pass++) {
+    const float start = current_position[axis];
+
+    switch_detect.start_probe_sweep(axis);
+    if (pass == 0) {
+      probe_axis_move(axis, dir * travel, PROBE_FAST_XY_FEEDRATE);
+    }
+    else {
+      sweep_line(axis, dir * PROBE_SWEEP_MIN_TRAVEL, PROBE_SWEEP_FEEDRATE);
+      sweep_line(axis, dir * (gap - PROBE_SWEEP_MIN_TRAVEL - PROBE_SWEEP_APPROACH), PROBE_FAST_XY_FEEDRATE);
+      sweep_line(axis, dir * (travel - gap + PROBE_SWEEP_APPROACH), PROBE_SWEEP_FEEDRATE);
+      planner.synchronize();
+    }
+    const uint8_t state = switch_detect.sweep_state;
+    const int32_t release_steps = switch_detect.sweep_release_steps;
+    switch_detect.stop_probe_sweep();
+
+    current_position[axis] = stepper.position((AxisEnum)axis) / steps_per_mm;
+    sync_plan_position();
+
+    if (state != PROBE_SWEEP_TOUCHED) {
+      LOG_E("sweep pass %d: no touch within %f mm\n", pass, travel);
+      return (state == PROBE_SWEEP_WAIT_RELEASE) ? PROBR_RESULT_SENSOR_ERROR : PROBR_RESULT_NO_TRIGGER;
+    }
+
+    if (pass == 0) {
+      // Started clear of the wall, so there was no release to latch. Plan the
+      // following passes on the gap just crossed.
+      gap = fabs(current_position[axis] - start);
+      travel = gap + 4 * MAX_DELTA_DISTANCE;
+      if (gap < PROBE_SWEEP_MIN_TRAVEL + PROBE_SWEEP_APPROACH) {
+        LOG_E("sweep axis %d: gap %f mm too narrow\n", axis, gap);
+        return PROBR_RESULT_SENSOR_ERROR;
+      }
+    }
+    else {
+      const uint8_t wall = (dir > 0) ? 0 : 1;
+      edge[wall][count[wall]++] = release_steps / steps_per_mm;
+      LOG_I("sweep pass %d: wall %d left at %f\n", pass, wall, edge[wall][count[wall] - 1]);
+    }
+    dir = -dir;
+  }
+
+  const float minus = trimmed_mean(edge[0], count[0]),
+              plus = trimmed_mean(edge[1], count[1]);
+  center = (minus + plus) / 2;
+  LOG_I("sweep axis %d: walls %f %f, center %f\n", axis, minus, plus, center);
+
+  // Off the wall touched last
+  motion_control.move(axis, dir * PROBE_BACKOFF_DISTANCE, PROBE_FAST_XY_FEEDRATE);
+  return PROBR_RESULT_SUCCESS;
+}
+
+// Center of the probe target along an axis, or CAlIBRATIONING_ERR_CODE
+float Calibtration::probe_center(uint8_t axis) {
+  if (sweep_probe) {
+    float center;
+    if (sweep_probe_center(axis, center) != PROBR_RESULT_SUCCESS) {
+      xy_need_re_home = true;
+      return CAlIBRATIONING_ERR_CODE;
+    }
+    return center;
+  }
+
+  float pos = multiple_probe(axis, -PROBE_DISTANCE, PROBE_FAST_XY_FEEDRATE);
+  if (pos == CAlIBRATIONING_ERR_CODE) return CAlIBRATIONING_ERR_CODE;
+
+  goto_calibtration_position(CAlIBRATION_POS_0, PROBE_FAST_XY_FEEDRATE);
+
+  float pos_1 = multiple_probe(axis, PROBE_DISTANCE, PROBE_FAST_XY_FEEDRATE);
+  if (pos_1 == CAlIBRATIONING_ERR_CODE) return CAlIBRATIONING_ERR_CODE;
+
+  return (pos_1 + pos) / 2;
+}
+
 ErrCode Calibtration::calibtration_xy() {
 
   ErrCode ret = E_SUCCESS;
@@ -813,25 +931,15 @@ ErrCode Calibtration::calibtration_xy() {
 
     for (uint8_t axis = 0; axis <= Y_AXIS; axis++) {
 
-      float pos = multiple_probe(axis, -PROBE_DISTANCE, PROBE_FAST_XY_FEEDRATE);
-      if (pos == CAlIBRATIONING_ERR_CODE) {
+      float center = probe_center(axis);
+      if (center == CAlIBRATIONING_ERR_CODE) {
         ret = E_CAlIBRATION_PRIOBE;
-        LOG_E("e:%d axis:%d probe 0 filed\n", e, axis);
+        LOG_E("e:%d axis:%d probe filed\n", e, axis);
         z_need_re_home = true;
         break;
       }
 
-      goto_calibtration_position(CAlIBRATION_POS_0, PROBE_FAST_XY_FEEDRATE);
-
-      float pos_1 = multiple_probe(axis, PROBE_DISTANCE, PROBE_FAST_XY_FEEDRATE);
-      if (pos_1 == CAlIBRATIONING_ERR_CODE) {
-        ret = E_CAlIBRATION_PRIOBE;
-        LOG_E("e:%d axis:%d probe 1 filed\n", e, axis);
-        z_need_re_home = true;
-        break;
-      }
-
-      xy_center[e][axis] += (pos_1 + pos) / 2;
+      xy_center[e][axis] += center;
       goto_calibtration_position(CAlIBRATION_POS_0, PROBE_FAST_XY_FEEDRATE);
 
     }
@@ -904,19 +1012,13 @@ ErrCode Calibtration::calibtration_xy_center_offset() {
 
   for (uint8_t axis = 0; axis <= Y_AXIS; axis++) {
 
-    float pos = multiple_probe(axis, -PROBE_DISTANCE, PROBE_FAST_XY_FEEDRATE);
-    if (pos == CAlIBRATIONING_ERR_CODE) {
+    float center = probe_center(axis);
+    if (center == CAlIBRATIONING_ERR_CODE) {
       ret = E_CAlIBRATION_PRIOBE;
-      LOG_E("e:%d axis:%d probe 0 filed\n", 0, axis);
+      LOG_E("e:%d axis:%d probe filed\n", 0, axis);
       break;
     }
-    float pos_1 = multiple_probe(axis, PROBE_DISTANCE, PROBE_FAST_XY_FEEDRATE);
-    if (pos_1 == CAlIBRATIONING_ERR_CODE) {
-      ret = E_CAlIBRATION_PRIOBE;
-      LOG_E("e:%d axis:%d probe 1 filed\n", 0, axis);
-      break;
-    }
-    xy_center[axis] += (pos_1 + pos) / 2;
+    xy_center[axis] += center;
     goto_calibtration_position(CAlIBRATION_POS_0, PROBE_FAST_XY_FEEDRATE);
 
   }
@@ -947,6 +1049,113 @@ ErrCode Calibtration::calibtration_xy_center_offset() {
   return ret;
 }
 
+#if ENABLED(SHAPER_Z_MESH)
+
+/**
+ * Probe one Z mesh point. The lift, travel, approach and probe moves are
+ * queued back to back, so the only stop is the one at the touch. The touch
+ * is latched from the probe edge interrupt and does not depend on how far Z
+ * runs on before it stops. The sweep is armed on the bed, it takes the
+ * release on the lift and only a touch while Z goes down. expect is the
+ * native Z of the previous touch.
+ */
+probe_result_e Calibtration::probe_mesh_point(float x, float y, float expect, float &touch) {
+  const float steps_per_mm = planner.settings.axis_steps_per_mm[Z_AXIS];
+
+  switch_detect.start_probe_sweep(Z_AXIS);
+
+  current_position.z = _MAX(current_position.z, expect) + PROBE_MOVE_XY_LIFTINT_DISTANCE;
+  line_to_current_position(MMM_TO_MMS(PROBE_MOVE_Z_FEEDRATE));
+  current_position.set(x, y);
+  line_to_current_position(MMM_TO_MMS(MOTION_TRAVEL_FEADRATE));
+  current_position.z = expect + Z_MESH_PROBE_APPROACH;
+  line_to_current_position(MMM_TO_MMS(PROBE_MOVE_Z_FEEDRATE));
+  current_position.z = expect - Z_MESH_PROBE_RANGE;
+  line_to_current_position(MMM_TO_MMS(PROBE_FAST_Z_FEEDRATE / Z_PROBE_SPEED_SLOW_SCALER));
+  planner.synchronize();
+
+  const uint8_t state = switch_detect.sweep_state;
+  touch = switch_detect.sweep_touch_steps / steps_per_mm;
+  switch_detect.stop_probe_sweep();
+
+  current_position.z = stepper.position(Z_AXIS) / steps_per_mm;
+  sync_plan_position();
+
+  if (state != PROBE_SWEEP_TOUCHED) {
+    LOG_E("mesh point (%.1f, %.1f): no touch above %f\n", x, y, expect - Z_MESH_PROBE_RANGE);
+    return (state == PROBE_SWEEP_WAIT_RELEASE) ? PROBR_RESULT_SENSOR_ERROR : PROBR_RESULT_NO_TRIGGER;
+  }
+  return PROBR_RESULT_SUCCESS;
+}
+
+/**
+ * Measure the bed at every Z mesh grid point with the nozzle probe of T0.
+ * The first point is found with the stall guarded stop-start probe, the
+ * others are bounded by the touch of the previous point. The points are
+ * visited in a serpentine so each travel is one cell.
+ */
+ErrCode Calibtration::probe_z_mesh() {
+
+  ErrCode ret = E_SUCCESS;
+  uint8_t old_active_extruder = active_extruder;
+  const bool was_active = zMesh.active;
+  float mesh[Z_MESH_GRID_Y][Z_MESH_GRID_X];
+
+  if (E_SUCCESS != system_service.set_status(SYSTEM_STATUE_CAlIBRATION_Z_PROBING)) {
+    LOG_E("can NOT set to SYSTEM_STATUE_CAlIBRATION_Z_PROBING\r\n");
+    return E_PARAM;
+  }
+
+  zMesh.setActive(false);
+  switch_detect.trun_on_probe_pwr();
+  X_standby();
+  bed_preapare(0);
+  motion_control.move_to_xy(ZMesh::gridX(0), ZMesh::gridY(0), MOTION_TRAVEL_FEADRATE);
+
+  const millis_t start_ms = millis();
+  probe_result_e result = probe(Z_AXIS, -2 * PROBE_DISTANCE, PROBE_FAST_Z_FEEDRATE, true);
+  float expect = current_position.z;
+
+  for (uint8_t k = 0; k < Z_MESH_GRID_X * Z_MESH_GRID_Y && result == PROBR_RESULT_SUCCESS; k++) {
+    const uint8_t j = k / Z_MESH_GRID_X, n = k % Z_MESH_GRID_X,
+                  i = (j & 1) ? Z_MESH_GRID_X - 1 - n : n;
+    float touch;
+    result = probe_mesh_point(ZMesh::gridX(i), ZMesh::gridY(j), expect, touch);
+    expect = touch;
+    mesh[j][i] = touch + home_offset[Z_AXIS] + build_plate_thickness;
+  }
+
+  if (result != PROBR_RESULT_SUCCESS) {
+    ret = E_CAlIBRATION_PRIOBE;
+    z_need_re_home = true;
+  }
+
+  Z_prepare();
+  tool_change(old_active_extruder, true);
+
+  if (E_SUCCESS != system_service.set_status(SYSTEM_STATUE_CAlIBRATION)) {
+    LOG_E("can NOT set to SYSTEM_STATUE_CAlIBRATION\r\n");
+    ret = E_PARAM;
+  }
+
+  switch_detect.trun_on_probe_pwr();
+  if (ret == E_SUCCESS) {
+    LOOP_L_N(j, Z_MESH_GRID_Y) LOOP_L_N(i, Z_MESH_GRID_X) zMesh.setPoint(i, j, mesh[j][i]);
+    LOG_I("Z mesh probed in %d ms\n", millis() - start_ms);
+    zMesh.report();
+    settings.save();
+  }
+  else {
+    LOG_E("Z mesh probe: Fail!\n");
+  }
+
+  if (was_active) zMesh.setActive(true);
+
+  return ret;
+}
+
+#endif // SHAPER_Z_MESH
+
 ErrCode Calibtration::set_hotend_offset(uint8_t axis, float offset) {
   if (axis >= Z_AXIS) {
     return E_PARAM;
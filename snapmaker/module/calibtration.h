@@ -53,6 +53,12 @@
 #define XY_CALI_Z_POS                         (-2.0 - build_plate_thickness)
 #define XY_CENTER_OFFSET_Z_POS                (0.5)
 #define PROBE_DISTANCE                        (15)    // mm
+#define PROBE_SWEEP_FEEDRATE                  (PROBE_FAST_XY_FEEDRATE / 4)
+#define PROBE_SWEEP_SAMPLES                   (PROBE_TIMES - 1)  // per wall
+#define PROBE_SWEEP_PASSES                    (1 + 2 * PROBE_SWEEP_SAMPLES)
+#define PROBE_SWEEP_APPROACH                  (0.5)   // mm before the expected wall where a sweep slows down
+#define Z_MESH_PROBE_APPROACH                 (0.5)   // mm above the last touch where the slow probe starts
+#define Z_MESH_PROBE_RANGE                    (1.0)   // mm below the last touch before a mesh point fails
 
 #define X2_MIN_HOTEND_OFFSET (X2_MAX_POS - X2_MIN_POS - 20)
 typedef enum {
@@ -109,6 +115,9 @@ class Calibtration {
     ErrCode nozzle_calibtration_preapare(calibtration_position_e pos);
     ErrCode calibtration_xy();
     ErrCode calibtration_xy_center_offset();
+    #if ENABLED(SHAPER_Z_MESH)
+      ErrCode probe_z_mesh();
+    #endif
     ErrCode set_hotend_offset(uint8_t axis, float offset);
     float get_hotend_offset(uint8_t axis);
     float get_probe_offset();
@@ -136,6 +145,11 @@ class Calibtration {
     ErrCode probe_z_offset(calibtration_position_e pos);
     void reset_xy_calibtration_env();
     float multiple_probe(uint8_t axis, float distance, uint16_t freerate);
+    probe_result_e sweep_probe_center(uint8_t axis, float &center);
+    #if ENABLED(SHAPER_Z_MESH)
+      probe_result_e probe_mesh_point(float x, float y, float expect, float &touch);
+    #endif
+    float probe_center(uint8_t axis);
     void backup_offset();
     void restore_offset();
     ErrCode wait_and_probe_z_offset(calibtration_position_e pos, uint8_t extruder=0);
@@ -152,6 +166,7 @@ class Calibtration {
     bool need_extrude = false;
     bool xy_need_re_home = false;
     bool z_need_re_home = false;
+    bool sweep_probe = true;  // Find XY centers with sweep_probe_center() instead of stop-start probes
     uint32_t z_probe_cnt = 0;
   private:
     float last_probe_pos = 0;
@@ -40,16 +40,9 @@ void FilamentSensor::init() {
 }
 
 uint16_t FilamentSensor::get_adc_val(uint8_t e) {
-  uint32_t val = 0;
-  uint8_t times = 5;
-  for (uint8_t i = 0; i < times; i++) {
-    if (e == 0) {
-      val += analogRead(FILAMENT0_ADC_PIN);
-    } else {
-      val += analogRead(FILAMENT1_ADC_PIN);
-    }
-  }
-  return val / times;
+  // Block average from the ADC1 DMA scan, filtered like the thermistors instead
+  // of a few blocking analogRead() conversions on ADC2
+  return HAL_adc_filtered(e ? FILAMENT1_ADC_PIN : FILAMENT0_ADC_PIN) >> HAL_ADC_FILTER_FRAC;
 }
 
 void FilamentSensor::reset() {
@@ -148,6 +148,7 @@ ErrCode PowerLoss::extrude_before_resume() {
     tool_change(stash_data.active_extruder);
     set_duplication_enabled(false);
   }
+  axisManager.select_x_shaper();
 
   thermalManager.setTargetBed(stash_data.bed_temp);
   HOTEND_LOOP() {
@@ -223,6 +224,7 @@ ErrCode PowerLoss::extrude_before_resume() {
   // resume dual_x_carriage_mode
   dual_x_carriage_mode = (DualXMode)stash_data.dual_x_carriage_mode;
   idex_set_mirrored_mode(dual_x_carriage_mode == DXC_MIRRORED_MODE);
+  axisManager.select_x_shaper();
 
   return ret;
 }
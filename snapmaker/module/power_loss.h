@@ -116,7 +116,7 @@ class PowerLoss {
     uint32_t next_req = 0;
     bool power_loss_en = true;
     power_loss_status_e power_loss_status = POWER_LOSS_IDLE;
-    bool is_trigger = false;
+    volatile bool is_trigger = false;
     bool is_inited = false;
     power_loss_t stash_data;
 };
@@ -24,6 +24,7 @@
 #include "src/module/tool_change.h"
 #include "src/module/planner.h"
 #include "src/gcode/gcode.h"
+#include "src/gcode/queue.h"
 #include "motion_control.h"
 #include "../../Marlin/src/module/temperature.h"
 #include "../../Marlin/src/module/settings.h"
@@ -34,9 +35,13 @@
 #include "power_loss.h"
 #include "../module/filament_sensor.h"
 #include "exception.h"
+#if ENABLED(CANCEL_OBJECTS)
+  #include "../../Marlin/src/feature/cancel_object.h"
+#endif
 
 
 #define PAUSE_RESUME_MOVE_FEEDRATE_MMM (9000)
+#define PAUSE_IN_PLACE_Z_HOP           (0.5)  // mm, the E retract is PRINT_RETRACK_DISTANCE
 
 PrintControl print_control;
 
@@ -136,24 +141,129 @@ void PrintControl::loop() {
   }
 }
 
-bool PrintControl::get_commands(uint8_t *cmd, uint32_t &line, uint16_t max_len) {
+#if ENABLED(CANCEL_OBJECTS)
+
+/**
+ * Canceled objects are dropped while the staged gcode is read, so their moves
+ * never reach the parser or the planner. The M486 S markers from the slicer are
+ * tracked here as well as by the parser. In a canceled span, the G0-G3 lines and
+ * comments are dropped, and every other command is kept. When the span ends, a
+ * fix-up restores the modal state the dropped lines would have left: the last
+ * feedrate, Z height and E position. Relative XYZ moves can't be dropped without
+ * losing position, so under G91 the lines go through and the parser skips them.
+ * Dropped lines still count in power_loss.line_number_sum.
+ */
 
-  if (power_loss.power_loss_status != POWER_LOSS_IDLE) {
-    return false;
+#define OBJECT_SEEN_Z _BV(0)
+#define OBJECT_SEEN_E _BV(1)
+#define OBJECT_SEEN_F _BV(2)
+
+static int8_t ingest_object = -1;       // Object of the lines being read
+static bool ingest_relative_xyz = false;
+static uint8_t dropped_seen = 0;        // OBJECT_SEEN_* in the dropped span
+static float dropped_z, dropped_e, dropped_f;
+
+static char object_pending[3][MAX_CMD_SIZE];  // Fix-up lines still to return
+static uint8_t object_pending_count = 0, object_pending_index = 0;
+
+static void object_filter_reset() {
+  ingest_object = -1;
+  ingest_relative_xyz = false;
+  dropped_seen = 0;
+  object_pending_count = object_pending_index = 0;
+}
+
+// Gcode "Xnn" with no digit after it, so G1 doesn't match G10 or G92.1
+static bool is_gcode(const char *line, const char *code) {
+  const uint8_t len = strlen(code);
+  return !strncmp(line, code, len) && !NUMERIC(line[len]) && line[len] != '.';
+}
+
+bool gcode_word(const char *line, const char code, float &value) {
+  for (const char *p = line; *p && *p != ';'; p++) {
+    if (*p == code && p > line && (p[-1] == ' ' || p[-1] == '\t')) {
+      char *end;
+      value = strtof(p + 1, &end);
+      return end != p + 1;
+    }
   }
+  return false;
+}
 
-  if (system_service.get_status() != SYSTEM_STATUE_PRINTING) {
+static bool object_dropping() {
+  return !ingest_relative_xyz && WITHIN(ingest_object, 0, 31) && cancelable.is_canceled(ingest_object);
+}
+
+// Queue the fix-up for a dropped span, optionally followed by the line that ended it
+static void object_span_end(const char *held_line) {
+  char str_1[16], str_2[16];
+  if (TEST(dropped_seen, OBJECT_SEEN_E))
+    sprintf_P(object_pending[object_pending_count++], PSTR("G92 E%s"), dtostrf(dropped_e, 1, 5, str_1));
+  if (TEST(dropped_seen, OBJECT_SEEN_Z) && TEST(dropped_seen, OBJECT_SEEN_F))
+    sprintf_P(object_pending[object_pending_count++], PSTR("G1 Z%s F%s"), dtostrf(dropped_z, 1, 3, str_1), dtostrf(dropped_f, 1, 1, str_2));
+  else if (TEST(dropped_seen, OBJECT_SEEN_Z))
+    sprintf_P(object_pending[object_pending_count++], PSTR("G1 Z%s"), dtostrf(dropped_z, 1, 3, str_1));
+  else if (TEST(dropped_seen, OBJECT_SEEN_F))
+    sprintf_P(object_pending[object_pending_count++], PSTR("G1 F%s"), dtostrf(dropped_f, 1, 1, str_2));
+  if (held_line) strlcpy(object_pending[object_pending_count++], held_line, MAX_CMD_SIZE);
+  dropped_seen = 0;
+}
+
+// Copy the next queued fix-up line
+static bool object_pending_next(char *cmd, const uint16_t max_len) {
+  if (object_pending_index >= object_pending_count) return false;
+  strlcpy(cmd, object_pending[object_pending_index++], max_len);
+  if (object_pending_index == object_pending_count) object_pending_count = object_pending_index = 0;
+  return true;
+}
+
+// Return true if the line belongs to a canceled object and must not be queued
+static bool object_filter(char *line) {
+  float value;
+
+  if (is_gcode(line, "M486")) {
+    if (gcode_word(line, 'T', value)) ingest_object = -1;
+    if (gcode_word(line, 'S', value)) {
+      ingest_object = (int8_t)value;
+      // Leaving a dropped span: the fix-up follows the marker, once the parser stopped skipping
+      if (dropped_seen && !object_dropping()) object_span_end(nullptr);
+    }
     return false;
   }
 
-  if (filament_check()) {
+  if (is_gcode(line, "G91")) ingest_relative_xyz = true;
+  else if (is_gcode(line, "G90")) ingest_relative_xyz = false;
+
+  if (!object_dropping()) {
+    // Dropping stopped without a marker (G91, M486 U), so the fix-up has to go first
+    if (dropped_seen) {
+      object_span_end(line);
+      return true;
+    }
     return false;
   }
 
-  if(commands_lock_) {
+  if (!line[0] || line[0] == ';') return true;
+
+  if (is_gcode(line, "G92")) {
+    // Kept for the parser, but the span's last E is now relative to it
+    if (gcode_word(line, 'E', value)) { dropped_e = value; SBI(dropped_seen, OBJECT_SEEN_E); }
     return false;
   }
 
+  if (!(is_gcode(line, "G0") || is_gcode(line, "G1") || is_gcode(line, "G2") || is_gcode(line, "G3")))
+    return false;
+
+  if (gcode_word(line, 'Z', value)) { dropped_z = value; SBI(dropped_seen, OBJECT_SEEN_Z); }
+  if (gcode_word(line, 'E', value)) { dropped_e = value; SBI(dropped_seen, OBJECT_SEEN_E); }
+  if (gcode_word(line, 'F', value)) { dropped_f = value; SBI(dropped_seen, OBJECT_SEEN_F); }
+  return true;
+}
+
+#endif // CANCEL_OBJECTS
+
+// Read the next whole line from the staged buffer. Every line read counts in line_number_sum.
+static bool read_gcode_line(uint8_t *cmd, uint16_t max_len) {
   while (buffer_head != buffer_tail) {
     if (gcode_buffer[buffer_tail] == ' ' || gcode_buffer[buffer_tail] == '\n') {
       if (gcode_buffer[buffer_tail] == '\n') {
@@ -177,7 +287,6 @@ bool PrintControl::get_commands(uint8_t *cmd, uint32_t &line, uint16_t max_len)
     if (cmd[get_commands] == '\n') {
       cmd[get_commands] = 0;
       power_loss.line_number_sum++;
-      line = power_loss.line_number_sum;
       return true;
     }
     get_commands++;
@@ -185,6 +294,39 @@ bool PrintControl::get_commands(uint8_t *cmd, uint32_t &line, uint16_t max_len)
   return false;
 }
 
+bool PrintControl::get_commands(uint8_t *cmd, uint32_t &line, uint16_t max_len) {
+
+  if (power_loss.power_loss_status != POWER_LOSS_IDLE) {
+    return false;
+  }
+
+  if (system_service.get_status() != SYSTEM_STATUE_PRINTING) {
+    return false;
+  }
+
+  if (filament_check()) {
+    return false;
+  }
+
+  if(commands_lock_) {
+    return false;
+  }
+
+  #if ENABLED(CANCEL_OBJECTS)
+    // Fix-ups go out first, then lines of canceled objects are skipped
+    bool got = object_pending_next((char *)cmd, max_len);
+    while (!got && read_gcode_line(cmd, max_len)) {
+      got = !object_filter((char *)cmd) || object_pending_next((char *)cmd, max_len);
+    }
+    if (!got) return false;
+  #else
+    if (!read_gcode_line(cmd, max_len)) return false;
+  #endif
+
+  line = power_loss.line_number_sum;
+  return true;
+}
+
 ErrCode PrintControl::push_gcode(uint32_t start_line, uint32_t end_line, uint8_t *data, uint16_t size) {
   uint8_t gcode_count = 0;
   uint32_t free = get_buf_free();
@@ -219,6 +361,23 @@ ErrCode PrintControl::push_gcode(uint32_t start_line, uint32_t end_line, uint8_t
   return E_SUCCESS;
 }
 
+// Copy the buffered line starting offset bytes past the read position.
+// Return the bytes it spans including its '\n', or 0 without a whole line.
+uint16_t PrintControl::peek_gcode(uint16_t offset, char *line, uint16_t max_len) {
+  const uint32_t used = get_buf_used();
+  uint16_t n = 0, len = 0;
+  while (offset + n < used) {
+    const uint8_t c = gcode_buffer[(buffer_tail + offset + n) % GCODE_BUFFER_SIZE];
+    n++;
+    if (c == '\n') {
+      line[len] = 0;
+      return n;
+    }
+    if (len < max_len - 1) line[len++] = c;
+  }
+  return 0;
+}
+
 void PrintControl::start_work_time() {
   // work_time_ms = 0;
   req_clear_work_time = true;
@@ -348,10 +507,12 @@ ErrCode PrintControl::start() {
   power_loss.cur_line = power_loss.line_number_sum = 0;
   power_loss.next_req = 0;
   buffer_head = buffer_tail = 0;
+  TERN_(CANCEL_OBJECTS, object_filter_reset());
   power_loss.clear();
 
   filament_sensor.reset();
   memset(&print_err_info, 0, sizeof(print_err_info));
+  feed_held_ = req_release_hold = false;
   commands_unlock();
   start_work_time();
 
@@ -364,18 +525,51 @@ ErrCode PrintControl::start() {
   return E_SUCCESS;
 }
 
+/*
+ A pause from the screen only holds the feed: the axes ramp down where they
+ are and the planned moves and gcode stay queued, so the resume continues
+ without replaying from the power loss stash. The other sources park the head.
+*/
+bool PrintControl::holds_in_place() {
+  if (feed_held_) {
+    return true;
+  }
+  if (system_service.get_status() != SYSTEM_STATUE_PAUSING) {
+    return false;
+  }
+  switch (system_service.get_source()) {
+    case SYSTEM_STATUE_SCOURCE_SACP:
+    case SYSTEM_STATUE_SCOURCE_GCODE:
+      return true;
+    default:
+      return false;
+  }
+}
+
 ErrCode PrintControl::pause() {
 
   motion_control.wait_G28();
 
   commands_lock();
-  buffer_head = buffer_tail = 0;
+  const bool in_place = holds_in_place();
+  if (!in_place) {
+    buffer_head = buffer_tail = 0;
+  }
 
   // wait for auto park finish
   while(axisManager.T0_T1_simultaneously_move || axisManager.T0_T1_simultaneously_move_req || tool_changeing) {
     vTaskDelay(pdMS_TO_TICKS(10));
   }
 
+  // Held in place the nozzle lifts off the print and the filament retracts
+  // once the axes stand, both go back before the moves continue
+  if (in_place) {
+    if (planner.get_axis_position_mm(Z_AXIS) + PAUSE_IN_PLACE_Z_HOP < Z_MAX_POS) {
+      axisManager.setFeedHoldPark(Z_AXIS, LROUND(PAUSE_IN_PLACE_Z_HOP * planner.settings.axis_steps_per_mm[Z_AXIS]));
+    }
+    axisManager.setFeedHoldPark(E_AXIS, -LROUND(PRINT_RETRACK_DISTANCE * planner.settings.axis_steps_per_mm[E_AXIS_N(active_extruder)]));
+  }
+
   // wait for stepper slow down and stop
   // LOG_I("--- req_pause\r\n");
   stepper.req_pause = true;
@@ -384,9 +578,10 @@ ErrCode PrintControl::pause() {
     if (stepper.can_pause) {
       // LOG_I("--- can_pause\r\n");
       stepper.can_pause = false;
-      quickstop_stepper();
+      if (!in_place) {
+        quickstop_stepper();
+      }
       // LOG_I("--- pause done\r\n");
-      stepper.delta_t = 0;
       break;
     }
     else {
@@ -394,16 +589,18 @@ ErrCode PrintControl::pause() {
     }
   }
 
-  uint8_t e_en_0 = fdm_head.extraduer_enable(0);
-  uint8_t e_en_1 = fdm_head.extraduer_enable(1);
-
-  if (system_service.get_source() == SYSTEM_STATUE_SCOURCE_STOP_EXTRUDE) {
-    fdm_head.set_duplication_enabled(fdm_head.stop_single_extruder_e, fdm_head.stop_single_extruder_en);
-    print_control.temperature_lock(fdm_head.stop_single_extruder_e, !fdm_head.stop_single_extruder_en);
+  if (in_place) {
+    feed_held_ = true;
+    if (E_SUCCESS != system_service.set_status(SYSTEM_STATUE_PAUSED)) {
+      LOG_E("can NOT set to SYSTEM_STATUE_PAUSED\r\n");
+      system_service.return_to_idle();
+      return E_FAILURE;
+    }
+    LOG_I("paused in place\r\n");
+    return E_SUCCESS;
   }
 
-  vTaskDelay(pdMS_TO_TICKS(5));
-  power_loss.stash_print_env();
+  park_head();
 
   if (system_service.get_source() == SYSTEM_STATUE_SCOURCE_Z_LIVE_OFFSET) {
     // motion_control.retrack_e(Z_LIVE_OFFSET_RETRACE_D, CHANGE_FILAMENT_SPEED);
@@ -417,6 +614,35 @@ ErrCode PrintControl::pause() {
     }
   }
 
+  if (E_SUCCESS != system_service.set_status(SYSTEM_STATUE_PAUSED)) {
+    LOG_E("can NOT set to SYSTEM_STATUE_PAUSED\r\n");
+    system_service.return_to_idle();
+    return E_FAILURE;
+  }
+  else {
+    // reset to normal
+    print_control.set_noise_mode(NOISE_NOIMAL_MODE);
+    return E_SUCCESS;
+  }
+}
+
+// Stash the print environment for the resume and move the heads off the print
+void PrintControl::park_head() {
+  uint8_t e_en_0 = fdm_head.extraduer_enable(0);
+  uint8_t e_en_1 = fdm_head.extraduer_enable(1);
+
+  if (system_service.get_source() == SYSTEM_STATUE_SCOURCE_STOP_EXTRUDE) {
+    fdm_head.set_duplication_enabled(fdm_head.stop_single_extruder_e, fdm_head.stop_single_extruder_en);
+    print_control.temperature_lock(fdm_head.stop_single_extruder_e, !fdm_head.stop_single_extruder_en);
+  }
+
+  vTaskDelay(pdMS_TO_TICKS(5));
+  power_loss.stash_print_env();
+
+  if (system_service.get_source() == SYSTEM_STATUE_SCOURCE_Z_LIVE_OFFSET) {
+    return;
+  }
+
   motion_control.retrack_e(PRINT_RETRACK_DISTANCE, CHANGE_FILAMENT_SPEED);
   motion_control.synchronize();
 
@@ -469,21 +695,65 @@ ErrCode PrintControl::pause() {
 
   tool_change(save_active_extruder);
   motion_control.move_to_y(0, PAUSE_RESUME_MOVE_FEEDRATE_MMM);
+}
 
-  if (E_SUCCESS != system_service.set_status(SYSTEM_STATUE_PAUSED)) {
-    LOG_E("can NOT set to SYSTEM_STATUE_PAUSED\r\n");
-    system_service.return_to_idle();
-    return E_FAILURE;
+/*
+ Turn a pause held in place into a parked one, the moves still planned are
+ dropped and the resume replays from the stash like any other pause. Runs in
+ the printer event loop, others ask for it with wait_feed_hold_released().
+ The Z hop and E retract of the hold go back first, so the stash has the
+ print position, and the queued commands go before marlin_loop() runs them.
+*/
+void PrintControl::release_feed_hold() {
+  if (!feed_held_) {
+    return;
+  }
+  LOG_I("release the pause held in place\r\n");
+  axisManager.feedHoldUnpark();
+  while (axisManager.isFeedParked()) {
+    vTaskDelay(pdMS_TO_TICKS(1));
+  }
+  quickstop_stepper();
+  buffer_head = buffer_tail = 0;
+  queue.clear();
+  queue.injected_commands_P = nullptr;
+  queue.injected_commands[0] = '\0';
+  park_head();
+  print_control.set_noise_mode(NOISE_NOIMAL_MODE);
+  req_release_hold = false;
+  feed_held_ = false;
+}
+
+void PrintControl::wait_feed_hold_released() {
+  if (!feed_held_) {
+    return;
   }
-  else {
-    // reset to normal
-    print_control.set_noise_mode(NOISE_NOIMAL_MODE);
-    return E_SUCCESS;
+  req_release_hold = true;
+  while (feed_held_) {
+    vTaskDelay(pdMS_TO_TICKS(10));
   }
 }
 
 ErrCode PrintControl::resume() {
 
+  if (feed_held_) {
+    if (E_SUCCESS != system_service.set_status(SYSTEM_STATUE_RESUMING)) {
+      LOG_E("can NOT set to SYSTEM_STATUE_RESUMING\r\n");
+      system_service.return_to_idle();
+      return E_FAILURE;
+    }
+    // The planned moves continue from where the axes stopped
+    feed_held_ = req_release_hold = false;
+    axisManager.feedResume();
+    commands_unlock();
+    if (E_SUCCESS != system_service.set_status(SYSTEM_STATUE_PRINTING)) {
+      LOG_E("can NOT set to SYSTEM_STATUE_PRINTING\r\n");
+      system_service.return_to_idle();
+      return E_FAILURE;
+    }
+    return E_SUCCESS;
+  }
+
   buffer_head = buffer_tail = 0;
 
   if (E_SUCCESS != system_service.set_status(SYSTEM_STATUE_RESUMING)) {
@@ -545,6 +815,7 @@ ErrCode PrintControl::stop() {
     // motion_control.quickstop();
     commands_lock();
     buffer_head = buffer_tail = 0;
+    feed_held_ = req_release_hold = false;
 
     // // set to 0, do not waiting in M109 or M190
     HOTEND_LOOP() {
@@ -554,12 +825,12 @@ ErrCode PrintControl::stop() {
     }
     thermalManager.setTargetBed(0);
 
+    // Held in place or not, a stop drops whatever is still planned
     stepper.req_pause = true;
     while(1) {
       if (stepper.can_pause) {
         stepper.can_pause = false;
         quickstop_stepper();
-        stepper.delta_t = 0;
         break;
       }
       else {
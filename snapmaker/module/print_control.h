@@ -71,6 +71,7 @@ class PrintControl {
     uint32_t get_buf_used();
     uint32_t get_buf_free();
     ErrCode push_gcode(uint32_t start_line, uint32_t end_line, uint8_t *data, uint16_t size);
+    uint16_t peek_gcode(uint16_t offset, char *line, uint16_t max_len);
     uint32_t get_cur_line();
     uint32_t next_req_line();
     bool buffer_is_empty();
@@ -78,6 +79,10 @@ class PrintControl {
     ErrCode pause();
     ErrCode resume();
     ErrCode stop();
+    bool holds_in_place();
+    bool is_feed_held() {return feed_held_;}
+    void release_feed_hold();
+    void wait_feed_hold_released();
     ErrCode set_mode(print_mode_e mode);
     print_mode_e get_mode() {return mode_;}
     ErrCode set_print_offset(float x, float y, float z);
@@ -112,11 +117,14 @@ class PrintControl {
   private:
     void start_work_time();
     void stop_work_time();
+    void park_head();
 
   public:
     print_mode_e mode_ = PRINT_FULL_MODE;
     bool temperature_lock_status[EXTRUDERS] = {false, false};
     bool commands_lock_ = false;
+    volatile bool feed_held_ = false;  // paused in place, the planned moves and gcode are kept
+    volatile bool req_release_hold = false;
     print_err_info_t print_err_info = {0};
     xyz_pos_t xyz_offset = {0, 0, 0};
     uint32_t work_time_ms = 0;
@@ -131,4 +139,7 @@ class PrintControl {
 
 extern PrintControl print_control;
 
+// Value of a parameter word in a line of gcode, ignoring anything after a comment
+bool gcode_word(const char *line, const char code, float &value);
+
 #endif
@@ -458,3 +458,28 @@ void SystemService::return_to_idle() {
   }
   */
 }
+
+void SystemService::set_ready(uint8_t ready) {
+  taskENTER_CRITICAL();
+  ready_ |= ready;
+  taskEXIT_CRITICAL();
+}
+
+// Also called before the scheduler starts, so no critical section here.
+// Each phase is marked by one task only.
+void SystemService::boot_mark(boot_phase_e phase) {
+  boot_ms_[phase] = millis();
+  boot_marked_[phase] = true;
+}
+
+void SystemService::boot_report() {
+  static const char *phase_name[BOOT_PHASE_COUNT] = {
+    "setup", "settings", "hardware", "scheduler", "sacp recv", "drivers", "factory data", "first sacp",
+  };
+  // The phases after the scheduler starts overlap, so only the uptime of each
+  for (uint8_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+    if (boot_marked_[i]) {
+      LOG_I("boot %s: %u ms\n", phase_name[i], boot_ms_[i]);
+    }
+  }
+}
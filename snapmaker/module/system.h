@@ -82,6 +82,25 @@ typedef enum {
 
 #define AXIS_COUNT 4  // x x1 y z
 
+// Initialization finished after the scheduler starts, see J1_setup()
+enum : uint8_t {
+  SYSTEM_READY_DRIVERS      = BIT(0),  // TMC drivers configured from the settings
+  SYSTEM_READY_FACTORY_DATA = BIT(1),  // factory data and the calibration data taken from it
+  SYSTEM_READY_ALL          = SYSTEM_READY_DRIVERS | SYSTEM_READY_FACTORY_DATA,
+};
+
+typedef enum : uint8_t {
+  BOOT_PHASE_SETUP,         // Marlin setup() entered
+  BOOT_PHASE_SETTINGS,      // settings loaded
+  BOOT_PHASE_HARDWARE,      // heaters, endstops and steppers running
+  BOOT_PHASE_SCHEDULER,     // J1_setup() done, scheduler starting
+  BOOT_PHASE_SACP_RECV,     // SACP receive task running
+  BOOT_PHASE_DRIVERS,       // SYSTEM_READY_DRIVERS
+  BOOT_PHASE_FACTORY_DATA,  // SYSTEM_READY_FACTORY_DATA
+  BOOT_PHASE_FIRST_SACP,    // first SACP packet handled
+  BOOT_PHASE_COUNT,
+} boot_phase_e;
+
 #pragma pack(1)
 typedef struct {
   uint8_t Ji_num;  // J generation machine is 4
@@ -133,12 +152,19 @@ class SystemService {
     uint8_t get_hw_version(bool is_refresh = false);
     void save_setting();
     void return_to_idle();
+    void set_ready(uint8_t ready);
+    bool is_ready(uint8_t ready) {return (ready_ & ready) == ready;}
+    void boot_mark(boot_phase_e phase);
+    void boot_report();
 
   private:
     SemaphoreHandle_t lock_;
     system_status_e status_ = SYSTEM_STATUE_IDLE;
     system_status_source_e source_ = SYSTEM_STATUE_SCOURCE_NONE;
     uint8_t hw_version = 0xff;
+    volatile uint8_t ready_ = 0;
+    bool boot_marked_[BOOT_PHASE_COUNT] = {false};
+    uint32_t boot_ms_[BOOT_PHASE_COUNT];
 };
 
 extern SystemService system_service;
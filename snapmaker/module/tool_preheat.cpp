@@ -0,0 +1,163 @@
+/*
+ * Snapmaker 3D Printer Firmware
+ * Copyright (C) 2023 Snapmaker [https://github.com/Snapmaker]
+ *
+ * This file is part of SnapmakerController-IDEX
+ * (see https://github.com/Snapmaker/SnapmakerController-IDEX)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tool_preheat.h"
+#include "print_control.h"
+#include "system.h"
+#include "src/module/motion.h"
+#include "src/module/planner.h"
+#include "src/gcode/queue.h"
+#include "../../Marlin/src/module/temperature.h"
+#include "../debug/debug.h"
+
+ToolPreheat tool_preheat;
+
+void ToolPreheat::scan_reset() {
+  tool = active_extruder;
+  relative = relative_mode;
+  pos.set(current_position.x, current_position.y);
+  fr_mm_s = feedrate_mm_s;
+  next_tool = -1;
+  switch_ms = 0;
+  switch_temp = 0;
+  LOOP_L_N(e, EXTRUDERS) tool_temp[e] = 0;
+
+  // Time still queued in the planner
+  ahead_ms = 0;
+  for (uint8_t b = planner.block_buffer_tail; b != planner.block_buffer_head; b = BLOCK_MOD(b + 1)) {
+    const block_t &block = planner.block_buffer[b];
+    if (block.nominal_speed > 0) ahead_ms += block.millimeters * 1000 / block.nominal_speed;
+  }
+}
+
+/**
+ * Account for one line of G-code. Return false once the scan can stop:
+ * after the first tool change and the temperature commands following it.
+ */
+bool ToolPreheat::scan_line(const char *line) {
+  while (*line == ' ') line++;
+  if (*line == 'N') { // Skip a line number
+    while (*line && *line != ' ') line++;
+    while (*line == ' ') line++;
+  }
+
+  const char letter = *line;
+  if (letter != 'G' && letter != 'M' && letter != 'T') return true;
+  const int code = atoi(line + 1);
+  float v;
+
+  if (letter == 'T') {
+    if (next_tool < 0 && code != tool && WITHIN(code, 0, EXTRUDERS - 1)) {
+      next_tool = code;
+      switch_ms = ahead_ms;
+      switch_temp = tool_temp[code];
+    }
+    tool = code;
+    return true;
+  }
+
+  if (letter == 'M') {
+    if (code == 104 || code == 109) {
+      const uint8_t e = gcode_word(line, 'T', v) ? uint8_t(v) : tool;
+      if (e < EXTRUDERS && (gcode_word(line, 'S', v) || gcode_word(line, 'R', v))) {
+        tool_temp[e] = celsius_t(v);
+        if (e == next_tool) switch_temp = tool_temp[e];
+      }
+    }
+    return true;
+  }
+
+  // G-codes
+  switch (code) {
+    case 0: case 1: case 2: case 3: {
+      if (next_tool >= 0) return false; // Past the tool change and its heat-up commands
+
+      if (gcode_word(line, 'F', v) && v > 0) fr_mm_s = MMM_TO_MMS(v);
+      xy_pos_t to = pos;
+      if (gcode_word(line, 'X', v)) to.x = relative ? pos.x + v : v;
+      if (gcode_word(line, 'Y', v)) to.y = relative ? pos.y + v : v;
+      float mm = (to - pos).magnitude();
+      if (mm == 0 && gcode_word(line, 'E', v)) mm = ABS(v);
+      pos = to;
+      // Acceleration is ignored, so the estimate errs on the early side
+      const float speed = MMS_SCALED(fr_mm_s);
+      if (speed > 0) ahead_ms += mm * 1000 / speed;
+    } break;
+    case 4:
+      if (gcode_word(line, 'P', v)) ahead_ms += v;
+      else if (gcode_word(line, 'S', v)) ahead_ms += v * 1000;
+      break;
+    case 90: relative = false; break;
+    case 91: relative = true; break;
+    case 28: return false; // Homing has no position to time from
+  }
+  return true;
+}
+
+uint32_t ToolPreheat::heat_time_ms(uint8_t e, celsius_t target) {
+  const float from = thermalManager.degHotend(e);
+  if (from >= target) return 0;
+
+  #if ENABLED(MPCTEMP)
+    // Full-power heat-up of the block toward its asymptote, plus the sensor lag
+    const MPC_t &c = thermalManager.temp_hotend[e].constants;
+    const float ambient = isnan(thermalManager.temp_hotend[e].modeled_block_temp) ? 25.0f : thermalManager.temp_hotend[e].modeled_ambient_temp,
+                asymp = ambient + c.heater_power * (MPC_MAX) / 255 / c.ambient_xfer_coeff_fan0;
+    if (target >= asymp) return UINT32_MAX;
+    const float s = c.block_heat_capacity / c.ambient_xfer_coeff_fan0 * logf((asymp - from) / (asymp - target))
+                  + 1.0f / c.sensor_responsiveness;
+  #else
+    const float s = (target - from) / (TOOL_PREHEAT_RATE);
+  #endif
+  return uint32_t(s * 1000);
+}
+
+void ToolPreheat::loop() {
+  const millis_t ms = millis();
+  if (PENDING(ms, next_scan_ms)) return;
+  next_scan_ms = ms + TOOL_PREHEAT_SCAN_INTERVAL_MS;
+
+  if (system_service.get_status() != SYSTEM_STATUE_PRINTING) return;
+  if (dual_x_carriage_mode != DXC_FULL_CONTROL_MODE) return;
+
+  scan_reset();
+
+  // Commands already queued for execution come first, then the HMI buffer
+  GCodeQueue::RingBuffer &rb = queue.ring_buffer;
+  bool more = true;
+  for (uint8_t i = 0, r = rb.index_r; more && i < rb.length; i++, r = (r + 1) % BUFSIZE)
+    more = scan_line(rb.commands[r].buffer);
+  if (more && queue.held_hmi_line()) more = scan_line(queue.held_hmi_line());
+
+  char line[TOOL_PREHEAT_MAX_LINE];
+  for (uint16_t offset = 0, n; more && (n = print_control.peek_gcode(offset, line, sizeof(line))); offset += n)
+    more = scan_line(line);
+
+  if (next_tool < 0 || switch_temp <= 0 || print_control.temperature_lock(next_tool)) return;
+  if (thermalManager.degTargetHotend(next_tool) >= switch_temp) return;
+
+  // In float, so UINT32_MAX (the target is out of reach) can't wrap to a short time
+  const uint32_t need_ms = heat_time_ms(next_tool, switch_temp);
+  if (switch_ms > float(need_ms) + (TOOL_PREHEAT_MARGIN_MS)) return;
+
+  LOG_I("preheat T%d to %d, change in %dms, heat-up %dms\r\n", next_tool, switch_temp, (int)switch_ms, (int)need_ms);
+  thermalManager.setTargetHotend(switch_temp, next_tool);
+}
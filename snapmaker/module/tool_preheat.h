@@ -0,0 +1,64 @@
+/*
+ * Snapmaker 3D Printer Firmware
+ * Copyright (C) 2023 Snapmaker [https://github.com/Snapmaker]
+ *
+ * This file is part of SnapmakerController-IDEX
+ * (see https://github.com/Snapmaker/SnapmakerController-IDEX)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOOL_PREHEAT_H
+#define TOOL_PREHEAT_H
+
+#include "src/core/types.h"
+#include "src/core/millis_t.h"
+
+#define TOOL_PREHEAT_SCAN_INTERVAL_MS 200
+#define TOOL_PREHEAT_MARGIN_MS 3000     // Heat this much earlier than the estimate
+#define TOOL_PREHEAT_RATE 2.0f          // (K/s) Heat rate without a thermal model
+#define TOOL_PREHEAT_MAX_LINE 96
+
+/**
+ * Look ahead over the queued and buffered G-code of a full-control IDEX
+ * print for the next tool change. When the temperature the new tool needs
+ * is known and the planned time to the change is shorter than its heat-up
+ * time, raise the parked nozzle's target early so the change does not wait.
+ */
+class ToolPreheat {
+  public:
+    void loop();
+
+  private:
+    void scan_reset();
+    bool scan_line(const char *line);
+    uint32_t heat_time_ms(uint8_t e, celsius_t target);
+
+    millis_t next_scan_ms = 0;
+
+    // Scan state, valid during one pass
+    uint8_t tool;
+    bool relative;
+    xy_pos_t pos;
+    float fr_mm_s;
+    float ahead_ms;
+    int8_t next_tool;
+    float switch_ms;
+    celsius_t switch_temp;
+    celsius_t tool_temp[EXTRUDERS];
+};
+
+extern ToolPreheat tool_preheat;
+
+#endif
@@ -24,6 +24,13 @@
 #include "flash_stm32.h"
 #include HAL_PATH(src/HAL, HAL_watchdog_STM32F1.h)
 
+#if ENABLED(UPDATE_STAGE_COMPRESSION)
+  #include "../../Marlin/src/libs/heatshrink/heatshrink_decoder.h"
+  static heatshrink_decoder stage_hsd;
+  // Must be even so only the image tail is programmed with an odd length
+  static uint8_t stage_decode_buf[256];
+#endif
+
 UpdateServer update_server;
 
 uint32_t update_calc_checksum(uint8_t *buffer, uint32_t length) {
@@ -108,16 +115,20 @@ void UpdateServer::set_update_status(uint16_t status) {
   write_to_flash(UPDATE_DATA_FLASH_ADDR, (uint8_t*)&info, sizeof(update_packet_info_t));
 }
 
-void UpdateServer::save_update_info(update_packet_info_t * info, uint8_t usart_num, uint8_t receiver_id) {
-  info->status_flag = UPDATE_STATUS_START;
-  info->usart_num = usart_num;
-  info->receiver_id = receiver_id;
+void UpdateServer::write_update_info(update_packet_info_t * info, uint16_t status) {
+  info->status_flag = status;
   uint32_t checksum = update_packet_head_checksum(info);
   info->pack_head_checknum = checksum;
   erase_flash_page(UPDATE_DATA_FLASH_ADDR, 1);
   write_to_flash(UPDATE_DATA_FLASH_ADDR, (uint8_t*)info, sizeof(update_packet_info_t));
 }
 
+void UpdateServer::save_update_info(update_packet_info_t * info, uint8_t usart_num, uint8_t receiver_id) {
+  info->usart_num = usart_num;
+  info->receiver_id = receiver_id;
+  write_update_info(info, UPDATE_STATUS_START);
+}
+
 ErrCode UpdateServer::is_allow_update(update_packet_info_t *head) {
   ErrCode ret = update_info_check(head);
   return ret;
@@ -130,7 +141,284 @@ void UpdateServer::just_to_boot() {
 
 void UpdateServer::init() {
   update_packet_info_t *update_info =  (update_packet_info_t *)UPDATE_DATA_FLASH_ADDR;
-  if (update_info->status_flag != UPDATE_STATUS_APP_NORMAL) {
+  // Keep an interrupted staging transfer so the host can resume it, and a
+  // staged image the bootloader has not swapped in yet
+  if (update_info->status_flag != UPDATE_STATUS_APP_NORMAL &&
+      update_info->status_flag != UPDATE_STATUS_STAGING &&
+      update_info->status_flag != UPDATE_STATUS_STAGED) {
     set_update_status(UPDATE_STATUS_APP_NORMAL);
   }
 }
+
+static uint32_t stage_checksum_add(uint32_t sum, uint32_t offset, uint8_t *data, uint32_t length) {
+  // Same byte pairing as update_calc_checksum(), but resumable at any even offset
+  for (uint32_t i = 0; i < length; i++, offset++) {
+    sum += (offset & 1) ? data[i] : ((uint32_t)data[i] << 8);
+  }
+  return sum;
+}
+
+void UpdateServer::stage_erase_page() {
+  erase_flash_page(UPDATE_STAGING_FLASH_ADDR + stage.erased, 1);
+  stage.erased += UPDATE_STAGING_PAGE_SIZE;
+}
+
+/**
+ * The staging slot is programmed in order, so a transfer can resume from the
+ * last page that holds any data. That page may be only partly programmed,
+ * so it is erased again and re-received.
+ */
+uint32_t UpdateServer::stage_resume_offset() {
+  uint32_t end = stage.info.app_length;
+  uint32_t page = 0;
+  for (uint32_t offset = 0; offset < end; offset += UPDATE_STAGING_PAGE_SIZE) {
+    uint32_t *p = (uint32_t *)(UPDATE_STAGING_FLASH_ADDR + offset);
+    uint32_t words = UPDATE_STAGING_PAGE_SIZE / sizeof(uint32_t);
+    bool blank = true;
+    for (uint32_t i = 0; i < words; i++) {
+      if (p[i] != 0xFFFFFFFF) {
+        blank = false;
+        break;
+      }
+    }
+    if (blank) {
+      break;
+    }
+    page = offset;
+  }
+  return page;
+}
+
+ErrCode UpdateServer::stage_start(update_packet_info_t *head, uint8_t usart_num, uint8_t receiver_id) {
+  #if DISABLED(UPDATE_STAGE_IMAGE)
+    // Nothing would swap the staged image in, the host falls back to UPDATE_ID_REQ_UPDATE
+    UNUSED(head); UNUSED(usart_num); UNUSED(receiver_id);
+    return E_COMMAND_ID;
+  #else
+    ErrCode ret = update_info_check(head);
+    if (ret != E_SUCCESS) {
+      return ret;
+    }
+
+    if (!head->app_length || head->app_length > UPDATE_STAGING_SIZE) {
+      return E_NO_RESRC;
+    }
+
+    update_packet_info_t *flash_info = (update_packet_info_t *)UPDATE_DATA_FLASH_ADDR;
+    bool resume = flash_info->status_flag == UPDATE_STATUS_STAGING &&
+                  flash_info->app_length == head->app_length &&
+                  flash_info->app_checknum == head->app_checknum &&
+                  flash_info->app_flash_start_addr == head->app_flash_start_addr;
+
+    memcpy((uint8_t *)&stage.info, (uint8_t *)head, sizeof(update_packet_info_t));
+    stage.info.usart_num = usart_num;
+    stage.info.receiver_id = receiver_id;
+    stage.written = 0;
+    stage.erased = 0;
+    stage.checksum = 0;
+    stage.frame_size = stage.frame_decoded = 0;
+
+    if (resume) {
+      stage.written = stage_resume_offset();
+      stage.erased = stage.written;
+      stage.checksum = stage_checksum_add(0, 0, (uint8_t *)UPDATE_STAGING_FLASH_ADDR, stage.written);
+      LOG_I("update: resume staging at %u/%u\r\n", stage.written, stage.info.app_length);
+    }
+    else {
+      write_update_info(&stage.info, UPDATE_STATUS_STAGING);
+      LOG_I("update: start staging %u bytes\r\n", stage.info.app_length);
+    }
+
+    stage.active = true;
+    stage_erase_ahead();
+    return E_SUCCESS;
+  #endif
+}
+
+ErrCode UpdateServer::stage_write(uint32_t offset, uint8_t *data, uint16_t length) {
+  if (!stage.active) {
+    return E_INVALID_STATE;
+  }
+
+  // Data must arrive in order, halfword aligned except for the image tail
+  if (offset != stage.written || !length || (offset + length) > stage.info.app_length ||
+      ((length % 2) && (offset + length) != stage.info.app_length)) {
+    return E_PARAM;
+  }
+
+  // Erase-ahead fell behind the host
+  while (stage.erased < offset + length) {
+    stage_erase_page();
+  }
+
+  uint32_t addr = UPDATE_STAGING_FLASH_ADDR + offset;
+  write_to_flash(addr, data, length);
+  if (memcmp((uint8_t *)addr, data, length)) {
+    LOG_E("update: staging program failed at %u\r\n", offset);
+    return E_HARDWARE;
+  }
+
+  stage.checksum = stage_checksum_add(stage.checksum, offset, data, length);
+  stage.written += length;
+  return E_SUCCESS;
+}
+
+#if ENABLED(UPDATE_STAGE_COMPRESSION)
+
+/**
+ * Poll what the decoder has for the frame and program it. With finish the
+ * frame's data is all in: the decoder is drained with heatshrink_decoder_finish()
+ * and the frame must have decoded to exactly its size.
+ */
+ErrCode UpdateServer::stage_decode(bool finish) {
+  HSD_poll_res res;
+  size_t count;
+  do {
+    if (finish) {
+      HSD_finish_res fres = heatshrink_decoder_finish(&stage_hsd);
+      if (fres == HSDR_FINISH_DONE) {
+        break;
+      }
+      if (fres < 0) {
+        return E_PARAM;
+      }
+    }
+    res = heatshrink_decoder_poll(&stage_hsd, &stage_decode_buf[stage.decode_count],
+                                  sizeof(stage_decode_buf) - stage.decode_count, &count);
+    stage.decode_count += count;
+    stage.frame_decoded += count;
+    if (res < 0 || stage.frame_decoded > stage.frame_size) {
+      return E_PARAM;
+    }
+    if (stage.decode_count && (stage.decode_count == sizeof(stage_decode_buf) || stage.frame_decoded == stage.frame_size)) {
+      ErrCode ret = stage_write(stage.written, stage_decode_buf, stage.decode_count);
+      stage.decode_count = 0;
+      if (ret != E_SUCCESS) {
+        return ret;
+      }
+    }
+    // Out of input and still not done, the stream is cut short
+    if (finish && res == HSDR_POLL_EMPTY && !count) {
+      return E_PARAM;
+    }
+  } while (finish || res == HSDR_POLL_MORE);
+
+  if (finish && stage.frame_decoded != stage.frame_size) {
+    return E_PARAM;
+  }
+  return E_SUCCESS;
+}
+
+void UpdateServer::stage_rewind_frame() {
+  LOG_E("update: bad compressed frame at %u\r\n", stage.frame_offset);
+  stage.written = stage.frame_offset;
+  stage.checksum = stage.frame_checksum;
+  if (stage.erased > stage.frame_offset) {
+    stage.erased = stage.frame_offset;
+  }
+  stage.frame_size = stage.frame_decoded = 0;
+}
+
+#endif
+
+/**
+ * Compressed frames are independent heatshrink streams that each decode to
+ * one staging page (less for the image tail), so a transfer can still
+ * resume on any page. A frame arrives in order over several packets and is
+ * programmed as it decodes; a broken frame is rewound to its first page.
+ * The frame ends once it has decoded its page, a frame that decodes short
+ * is rejected when the next one starts.
+ */
+ErrCode UpdateServer::stage_write_compressed(uint32_t frame_offset, uint16_t frame_pos, uint8_t *data, uint16_t length) {
+  #if ENABLED(UPDATE_STAGE_COMPRESSION)
+    if (!stage.active) {
+      return E_INVALID_STATE;
+    }
+
+    if (frame_pos == 0) {
+      if (stage.frame_decoded != stage.frame_size) {
+        stage_rewind_frame();
+        return E_PARAM;
+      }
+      if (frame_offset != stage.written || (frame_offset % UPDATE_STAGING_PAGE_SIZE)) {
+        return E_PARAM;
+      }
+      heatshrink_decoder_reset(&stage_hsd);
+      stage.frame_offset = frame_offset;
+      stage.frame_checksum = stage.checksum;
+      stage.frame_pos = 0;
+      stage.frame_size = _MIN(stage.info.app_length - frame_offset, (uint32_t)UPDATE_STAGING_PAGE_SIZE);
+      stage.frame_decoded = 0;
+      stage.decode_count = 0;
+    }
+    else if (frame_offset != stage.frame_offset || frame_pos != stage.frame_pos ||
+             stage.frame_decoded == stage.frame_size) {
+      return E_PARAM;
+    }
+
+    ErrCode ret = E_SUCCESS;
+    uint16_t sunk = 0;
+    size_t count;
+    while (sunk < length && ret == E_SUCCESS) {
+      heatshrink_decoder_sink(&stage_hsd, &data[sunk], length - sunk, &count);
+      sunk += count;
+      ret = stage_decode(false);
+    }
+
+    if (ret == E_SUCCESS && stage.frame_decoded == stage.frame_size) {
+      ret = stage_decode(true);
+    }
+
+    if (ret != E_SUCCESS) {
+      stage_rewind_frame();
+      return ret;
+    }
+
+    stage.frame_pos += length;
+    return E_SUCCESS;
+  #else
+    return E_PARAM;
+  #endif
+}
+
+/**
+ * Erase one page ahead of the received data. Called after each chunk has
+ * been acknowledged, so the erase overlaps the transfer of the next chunk.
+ */
+void UpdateServer::stage_erase_ahead() {
+  if (!stage.active) {
+    return;
+  }
+  if (stage.erased < stage.info.app_length && stage.erased < stage.written + UPDATE_ERASE_AHEAD_SIZE) {
+    stage_erase_page();
+  }
+}
+
+ErrCode UpdateServer::stage_finish() {
+  if (!stage.active) {
+    return E_INVALID_STATE;
+  }
+
+  if (stage.written != stage.info.app_length) {
+    return E_PARAM;
+  }
+
+  // update_calc_checksum() adds a trailing odd byte unshifted
+  uint32_t checksum = stage.checksum;
+  if (stage.info.app_length % 2) {
+    uint8_t last = *(uint8_t *)(UPDATE_STAGING_FLASH_ADDR + stage.info.app_length - 1);
+    checksum = checksum - ((uint32_t)last << 8) + last;
+  }
+  checksum = ~checksum;
+
+  stage.active = false;
+  if (checksum != stage.info.app_checknum) {
+    LOG_E("update: staged image checksum 0x%x, expect 0x%x\r\n", checksum, stage.info.app_checknum);
+    set_update_status(UPDATE_STATUS_APP_NORMAL);
+    return E_FAILURE;
+  }
+
+  write_update_info(&stage.info, UPDATE_STATUS_STAGED);
+  LOG_I("update: image staged\r\n");
+  return E_SUCCESS;
+}
@@ -25,6 +25,13 @@
 
 #define UPDATE_STATUS_START 0xAA02
 #define UPDATE_STATUS_APP_NORMAL 0xAA05
+// image is being received into UPDATE_STAGING_FLASH_ADDR, app keeps running
+#define UPDATE_STATUS_STAGING 0xAA06
+// staged image is complete and verified, boot copies it to app_flash_start_addr
+#define UPDATE_STATUS_STAGED 0xAA07
+
+// How far page erasing runs ahead of the received data
+#define UPDATE_ERASE_AHEAD_SIZE (2 * UPDATE_STAGING_PAGE_SIZE)
 
 #pragma pack(1)
 
@@ -55,16 +62,48 @@ typedef struct {
 #pragma pack(1)
 
 
+typedef struct {
+  bool active;
+  update_packet_info_t info;
+  uint32_t written;   // bytes of the image programmed, always from offset 0
+  uint32_t erased;    // bytes of the staging slot erased, page aligned
+  uint32_t checksum;  // running sum of update_calc_checksum() over written bytes
+
+  // Compressed frames, each one decodes to one staging page
+  uint32_t frame_offset;
+  uint32_t frame_checksum;  // checksum at frame start, to rewind a broken frame
+  uint16_t frame_pos;       // compressed bytes of the frame received so far
+  uint16_t frame_size;      // bytes the frame must decode to
+  uint16_t frame_decoded;
+  uint16_t decode_count;    // decoded bytes waiting to be programmed
+} update_stage_t;
+
 class UpdateServer {
   public:
     void      init();
     ErrCode   is_allow_update(update_packet_info_t *head);
     void save_update_info(update_packet_info_t * info, uint8_t usart_num, uint8_t receiver_id);
     void just_to_boot();
+
+    // In-application update: receive the image into the staging slot while
+    // the firmware keeps running, then reboot only to swap it in
+    ErrCode stage_start(update_packet_info_t *head, uint8_t usart_num, uint8_t receiver_id);
+    ErrCode stage_write(uint32_t offset, uint8_t *data, uint16_t length);
+    ErrCode stage_write_compressed(uint32_t frame_offset, uint16_t frame_pos, uint8_t *data, uint16_t length);
+    ErrCode stage_finish();
+    void stage_erase_ahead();
+    uint32_t stage_offset() {return stage.written;}
   private:
     ErrCode update_info_check(update_packet_info_t *head);
     uint32_t update_packet_head_checksum(update_packet_info_t *head);
     void set_update_status(uint16_t status);
+    void write_update_info(update_packet_info_t * info, uint16_t status);
+    void stage_erase_page();
+    uint32_t stage_resume_offset();
+    ErrCode stage_decode(bool finish);
+    void stage_rewind_frame();
+  private:
+    update_stage_t stage = {0};
 };
 
 extern UpdateServer update_server;
@@ -78,7 +78,9 @@ ErrCode ProtocolSACP::parse(uint8_t *data, uint16_t len, SACP_param_t &out) {
       if (ch == SACP_PDU_SOF_L) {
         parse_buff[out.lenght++] = ch;
       } else {
-        out.lenght = 0;
+        out.stats.resyncs++;
+        // A repeated SOF high byte may start the frame
+        out.lenght = (ch == SACP_PDU_SOF_H) ? 1 : 0;
       }
     } else {
       parse_buff[out.lenght++] = ch;
@@ -88,7 +90,14 @@ ErrCode ProtocolSACP::parse(uint8_t *data, uint16_t len, SACP_param_t &out) {
       break;
     }
     else if (out.lenght == 7) {
+      uint16_t data_len = (parse_buff[3] << 8 | parse_buff[2]);
       if (sacp_calc_crc8(parse_buff, 6) != parse_buff[6]) {
+        out.stats.header_crc_err++;
+        out.stats.resyncs++;
+        out.lenght = 0;
+      } else if (data_len + 7 > PACK_PARSE_MAX_SIZE) {
+        out.stats.overflows++;
+        out.stats.resyncs++;
         out.lenght = 0;
       }
     }
@@ -100,12 +109,22 @@ ErrCode ProtocolSACP::parse(uint8_t *data, uint16_t len, SACP_param_t &out) {
         uint16_t checksum1 = (parse_buff[total_len - 1] << 8) | parse_buff[total_len - 2];
         if (checksum == checksum1) {
           out.lenght = 0;
+          out.stats.frames++;
+          if (out.sacp.attr == SACP_ATTR_REQ) {
+            if (out.stats.frames > 1 && out.sacp.sequence == out.last_sequence) {
+              out.stats.retransmits++;
+            }
+            out.last_sequence = out.sacp.sequence;
+          }
           return E_SUCCESS;
         } else {
+          out.stats.checksum_err++;
+          out.stats.resyncs++;
           out.lenght = 0;
           return E_PARAM;
         }
       } else if (out.lenght > total_len) {
+        out.stats.resyncs++;
         out.lenght = 0;
         return E_PARAM;
       }
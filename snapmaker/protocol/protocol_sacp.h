@@ -64,12 +64,24 @@ typedef struct {
   uint8_t command_id;
 } SACP_head_base_t;
 
+// Link quality counters, kept per receive source
+typedef struct {
+  uint32_t frames;          // frames received intact
+  uint32_t header_crc_err;  // header CRC8 mismatches
+  uint32_t checksum_err;    // payload checksum mismatches
+  uint32_t overflows;       // frames longer than PACK_PARSE_MAX_SIZE
+  uint32_t resyncs;         // partly parsed frames dropped to hunt for the next SOF
+  uint32_t retransmits;     // requests repeating the sequence of the previous one
+} SACP_link_stats_t;
+
 typedef struct {
   uint16_t lenght;  // The total length of data
   union {
     uint8_t buff[PACK_PARSE_MAX_SIZE];
     SACP_struct_t sacp;
   };
+  uint16_t last_sequence;
+  SACP_link_stats_t stats;
 } SACP_param_t;
 
 
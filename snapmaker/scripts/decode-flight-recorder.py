@@ -0,0 +1,98 @@
+import sys
+import argparse
+import re
+import struct
+
+# Prints the flight recorder (snapmaker/debug/flight_recorder.h) found in a
+# CrashCatcher hex dump, as sent on a crash or read back with M2000 S102, or
+# in a raw memory image with --raw.
+
+FLIGHT_RECORDER_EVENTS = 96
+FLIGHT_RECORDER_TASKS = 32
+FLIGHT_RECORDER_SHAPER = 32
+FLIGHT_RECORDER_MAGIC = 0x32455246
+
+HEADER = struct.Struct('<IIIII')
+RECORD = struct.Struct('<HBBI')
+
+SACP_SOURCE = {0: 'MARLIN', 1: 'HMI'}
+
+
+def describe(type, arg, value):
+    if type == 1:
+        return 'BOOT    #{}'.format(value)
+    if type == 2:
+        return 'SACP    {} set 0x{:02X} id 0x{:02X} seq {}'.format(
+            SACP_SOURCE.get(arg, arg), (value >> 8) & 0xFF, value & 0xFF, value >> 16)
+    if type == 3:
+        return 'GCODE   {}{} line {}'.format(chr(arg) if arg else '?', value >> 20, value & 0xFFFFF)
+    if type == 4:
+        return 'SHAPER  blocks {} moves {} x {} y {}'.format(
+            arg, value & 0xFF, (value >> 8) & 0xFFF, value >> 20)
+    if type == 5:
+        return 'ABORT   moves {}'.format(value)
+    if type == 6:
+        return 'TASK    {} prio {}'.format(struct.pack('<I', value).split(b'\0')[0].decode('ascii', 'replace'), arg)
+    return 'TYPE {} arg {} value 0x{:08X}'.format(type, arg, value)
+
+
+def read_ring(data, offset, size, head):
+    records = []
+    for n in range(size):
+        i = (head + n) % size  # oldest first
+        time, type, arg, value = RECORD.unpack_from(data, offset + i * RECORD.size)
+        if type:
+            records.append((time, type, arg, value))
+    return records
+
+
+def print_ring(title, records):
+    print(title)
+    last = None
+    for time, type, arg, value in records:
+        delta = '' if last is None else '+{}'.format((time - last) & 0xFFFF)
+        last = time
+        print('  {:5d} {:>7} ms  {}'.format(time, delta, describe(type, arg, value)))
+
+
+def hex_dump_bytes(text):
+    # CrashCatcher prints text lines and hex lines, keep only the hex ones
+    lines = [l.strip() for l in text.splitlines()]
+    return bytes.fromhex(''.join(l for l in lines if re.fullmatch(r'(?:[0-9A-Fa-f]{2})+', l)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode the flight recorder from a crash dump')
+    parser.add_argument('dump', help='CrashCatcher hex dump, or a memory image with --raw')
+    parser.add_argument('--raw', action='store_true', help='the dump is binary')
+    args = parser.parse_args()
+
+    with open(args.dump, 'rb') as f:
+        data = f.read()
+    if not args.raw:
+        data = hex_dump_bytes(data.decode('ascii', 'replace'))
+
+    offset = data.find(struct.pack('<I', FLIGHT_RECORDER_MAGIC))
+    size = HEADER.size + (FLIGHT_RECORDER_EVENTS + FLIGHT_RECORDER_TASKS + FLIGHT_RECORDER_SHAPER) * RECORD.size
+    if offset < 0 or offset + size > len(data):
+        print('no flight recorder in {}'.format(args.dump))
+        return 1
+
+    magic, boots, event_head, task_head, shaper_head = HEADER.unpack_from(data, offset)
+    if (event_head >= FLIGHT_RECORDER_EVENTS or task_head >= FLIGHT_RECORDER_TASKS
+            or shaper_head >= FLIGHT_RECORDER_SHAPER):
+        print('flight recorder header is corrupt')
+        return 1
+
+    print('boots: {}'.format(boots))
+    events = offset + HEADER.size
+    tasks = events + FLIGHT_RECORDER_EVENTS * RECORD.size
+    shaper = tasks + FLIGHT_RECORDER_TASKS * RECORD.size
+    print_ring('events, oldest first:', read_ring(data, events, FLIGHT_RECORDER_EVENTS, event_head))
+    print_ring('task switches, oldest first:', read_ring(data, tasks, FLIGHT_RECORDER_TASKS, task_head))
+    print_ring('shaper, oldest first:', read_ring(data, shaper, FLIGHT_RECORDER_SHAPER, shaper_head))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
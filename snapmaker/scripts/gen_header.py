@@ -44,6 +44,99 @@ def crc16(data):
 
   return checksum
 
+# heatshrink parameters, must match HEATSHRINK_STATIC_WINDOW_BITS and
+# HEATSHRINK_STATIC_LOOKAHEAD_BITS in Marlin/src/libs/heatshrink/heatshrink_config.h
+HS_WINDOW_BITS = 8
+HS_LOOKAHEAD_BITS = 4
+# each compressed frame decodes to one staging page (UPDATE_STAGING_PAGE_SIZE)
+HS_FRAME_SIZE = 4096
+
+def heatshrink_compress(data, window_bits=HS_WINDOW_BITS, lookahead_bits=HS_LOOKAHEAD_BITS):
+  window = 1 << window_bits
+  max_len = 1 << lookahead_bits
+  out = bytearray()
+  acc = 0
+  acc_bits = 0
+  recent = {}  # 2-byte prefix -> positions, newest last
+
+  def put(value, count):
+    nonlocal acc, acc_bits
+    acc = (acc << count) | value
+    acc_bits += count
+    while acc_bits >= 8:
+      acc_bits -= 8
+      out.append((acc >> acc_bits) & 0xFF)
+    acc &= (1 << acc_bits) - 1
+
+  def remember(pos):
+    if pos + 1 < len(data):
+      recent.setdefault(data[pos:pos + 2], []).append(pos)
+
+  i = 0
+  n = len(data)
+  while i < n:
+    best_len = 0
+    best_off = 0
+    for j in reversed(recent.get(data[i:i + 2], [])):
+      if i - j > window:
+        break
+      l = 0
+      while l < max_len and i + l < n and data[j + l] == data[i + l]:
+        l += 1
+      if l > best_len:
+        best_len, best_off = l, i - j
+        if l == max_len:
+          break
+
+    # a back-reference costs 1 + window + lookahead bits, a literal 9 bits
+    if best_len >= 2:
+      put(0, 1)
+      put(best_off - 1, window_bits)
+      put(best_len - 1, lookahead_bits)
+    else:
+      best_len = 1
+      put(1, 1)
+      put(data[i], 8)
+    for k in range(i, i + best_len):
+      remember(k)
+    i += best_len
+
+  if acc_bits:
+    put(0, 8 - acc_bits)
+  return bytes(out)
+
+def heatshrink_decompress(data, size, window_bits=HS_WINDOW_BITS, lookahead_bits=HS_LOOKAHEAD_BITS):
+  bits = "".join("{:08b}".format(b) for b in data)
+  pos = 0
+  out = bytearray()
+
+  def get(count):
+    nonlocal pos
+    v = int(bits[pos:pos + count], 2)
+    pos += count
+    return v
+
+  while len(out) < size:
+    if get(1):
+      out.append(get(8))
+    else:
+      offset = get(window_bits) + 1
+      for _ in range(get(lookahead_bits) + 1):
+        out.append(out[-offset])
+  return bytes(out)
+
+def compress_frames(bin):
+  # Frame: compressed length (2 bytes, little endian) + heatshrink stream
+  frames = bytearray(0)
+  for start in range(0, len(bin), HS_FRAME_SIZE):
+    raw = bin[start:start + HS_FRAME_SIZE]
+    hs = heatshrink_compress(raw)
+    if heatshrink_decompress(hs, len(raw)) != raw:
+      raise RuntimeError("heatshrink round trip failed at 0x%x" % start)
+    frames.extend(len(hs).to_bytes(2, 'little'))
+    frames.extend(hs)
+  return frames
+
 class packet_type(Enum):
   SM2_CTRL_FW = 0x0001
   A400_CTRL_FW = 0x0002
@@ -146,6 +239,7 @@ parser.add_argument('--ver',  '-v', help='version')
 parser.add_argument('--flag', '-c', help='upgrade control flag, 0 for normal, 1 for force')
 parser.add_argument('--radr', '-a', help='firmware run address')
 parser.add_argument('--output', '-o', help='output file name')
+parser.add_argument('--compress', '-z', action='store_true', help='also write heatshrink frames for staged update (<output>.hs)')
 args = parser.parse_args()
 
 try:
@@ -192,6 +286,15 @@ else:
 f = open(of, 'wb')
 f.write(head)
 f.write(bin)
+f.close()
+
+if args.compress:
+  frames = compress_frames(bin)
+  print("compressed frames: %d -> %d bytes (%.1f%%)" % (len(bin), len(frames), len(frames) * 100.0 / len(bin)))
+  f = open(of + ".hs", 'wb')
+  f.write(head)
+  f.write(frames)
+  f.close()
 
 if __name__=='__main__':
     pass
\ No newline at end of file
@@ -73,6 +73,18 @@ minor_pack_script = join(project_dir, 'snapmaker', 'scripts', 'gen_header.py')
 
 major_pack_script = join(project_dir, 'snapmaker', 'scripts', 'pack_for_hmi.py')
 
+# Compressed frames (-z) are only of use to firmware that stages updates and
+# accepts them, see UPDATE_STAGE_IMAGE in Marlin/Configuration_adv.h
+def config_enabled(name):
+  if name in [d if isinstance(d, str) else d[0] for d in projenv.get("CPPDEFINES", [])]:
+    return True
+  with open(join(project_dir, 'Marlin', 'Configuration_adv.h'), 'r', encoding='utf-8') as config_file:
+    return any(re.match(r'\s*#define\s+{}\b'.format(name), line) for line in config_file)
+
+compress_flag = ""
+if config_enabled("UPDATE_STAGE_IMAGE") and config_enabled("UPDATE_STAGE_COMPRESSION"):
+  compress_flag = " -z"
+
 
 # print(project_dir)
 # print(pack_script)
@@ -83,7 +95,7 @@ env.AddCustomTarget(
   name="pack",
   dependencies=None,
   actions=[
-    "python {} -t 3 -f {} -c 1 -v {} -o {}".format(minor_pack_script, app_fw_bin, version, minor_bin),
+    "python {} -t 3 -f {} -c 1 -v {} -o {}{}".format(minor_pack_script, app_fw_bin, version, minor_bin, compress_flag),
     "python {} -c {} -v {}".format(major_pack_script, minor_bin, version)
   ],
   title="Pack",
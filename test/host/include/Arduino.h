@@ -0,0 +1,162 @@
+/*
+ * Host stand-in for the Arduino core, used by the host unit tests only.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+enum WiringPinMode {
+  OUTPUT, OUTPUT_OPEN_DRAIN, INPUT, INPUT_ANALOG, INPUT_PULLUP, INPUT_PULLDOWN,
+  INPUT_FLOATING, PWM, PWM_OPEN_DRAIN
+};
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#ifndef _BV
+  #define _BV(b) (1UL << (b))
+#endif
+
+#define sq(x) ((x)*(x))
+// wirish_math.h's min() and max() are macros, which the standard headers undefine
+template<typename A, typename B> inline auto min(const A a, const B b) -> decltype(a < b ? a : b) { return a < b ? a : b; }
+template<typename A, typename B> inline auto max(const A a, const B b) -> decltype(a > b ? a : b) { return a > b ? a : b; }
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+#ifndef F_CPU
+  #define F_CPU 120000000UL  // Snapmaker_GD32F105RC
+#endif
+
+// Advanced by the tests, read by the code under test
+extern "C" volatile uint32_t host_millis;
+inline uint32_t millis() { return host_millis; }
+inline uint32_t micros() { return host_millis * 1000UL; }
+inline void delay(uint32_t ms) { host_millis += ms; }
+inline void delayMicroseconds(uint32_t) {}
+
+// Input levels and EXTI handlers. A test drives a pin with host_set_pin(),
+// which runs the handler attached for that edge as the EXTI would.
+typedef void (*voidFuncPtr)(void);
+typedef enum ExtIntTriggerMode { RISING, FALLING, CHANGE } ExtIntTriggerMode;
+#define HOST_PINS 128
+extern uint8_t host_pin_level[HOST_PINS];
+void host_set_pin(uint8_t pin, uint8_t level);
+void attachInterrupt(uint8_t pin, voidFuncPtr handler, ExtIntTriggerMode mode);
+void detachInterrupt(uint8_t pin);
+
+inline void pinMode(uint8_t, WiringPinMode) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline uint32_t digitalRead(uint8_t pin) { return host_pin_level[pin]; }
+inline uint32_t analogRead(uint8_t) { return 0; }
+inline void analogWrite(uint8_t, int) {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+inline void nvic_sys_reset() {}
+
+// newlib and avr-libc extras the firmware uses
+inline char *dtostrf(double val, signed char width, unsigned char prec, char *sout) {
+  sprintf(sout, "%*.*f", width, prec, val);
+  return sout;
+}
+inline size_t strlcpy(char *dst, const char *src, size_t size) {
+  const size_t len = strlen(src);
+  if (size) {
+    const size_t n = len < size ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+
+class Stream {
+ public:
+  virtual ~Stream() {}
+};
+
+/**
+ * Serial port that records what the firmware writes and replays what a
+ * test queued for it to read.
+ */
+class HardwareSerial : public Stream {
+ public:
+  void begin(uint32_t rate) { baud = rate; tx_at_begin = tx_len; }
+  void end() {}
+  void setTimeout(uint32_t) {}
+  bool connected() { return true; }
+  void flush() {}
+  void msgDone() {}
+  void enable_sacp(bool enable) { enable_sacp_ = enable; }
+  bool enable_sacp() { return enable_sacp_; }
+
+  int available(uint8_t=0) { return int(rx_len - rx_pos); }
+  int peek() { return rx_pos < rx_len ? rx[rx_pos] : -1; }
+  int read(uint8_t=0) { return rx_pos < rx_len ? rx[rx_pos++] : -1; }
+  size_t readBytes(uint8_t *buf, size_t n) {
+    size_t i = 0;
+    while (i < n && rx_pos < rx_len) buf[i++] = rx[rx_pos++];
+    return i;
+  }
+
+  size_t write(uint8_t c) {
+    if (tx_len < sizeof(tx)) tx[tx_len++] = c;
+    return 1;
+  }
+  size_t write_byte(uint8_t c) { return write(c); }
+  size_t write(const uint8_t *buf, size_t n) {
+    for (size_t i = 0; i < n; i++) write(buf[i]);
+    return n;
+  }
+  size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+
+  size_t print(const char *s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(long v, int base=DEC) { return printf_(base == HEX ? "%lx" : "%ld", v); }
+  size_t print(int v, int base=DEC) { return print((long)v, base); }
+  size_t print(unsigned long v, int base=DEC) { return printf_(base == HEX ? "%lx" : "%lu", v); }
+  size_t print(unsigned int v, int base=DEC) { return print((unsigned long)v, base); }
+  size_t print(unsigned char v, int base=DEC) { return print((unsigned long)v, base); }
+  size_t print(long long v, int=DEC) { return printf_("%lld", v); }
+  size_t print(unsigned long long v, int=DEC) { return printf_("%llu", v); }
+  size_t print(double v, int digits=2) { return printf_("%.*f", digits, v); }
+  template<typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+  template<typename T, typename U> size_t println(T v, U u) { size_t n = print(v, u); return n + println(); }
+  size_t println() { return write((uint8_t)'\n'); }
+
+  // Test side
+  void feed(const uint8_t *buf, size_t n) {
+    for (size_t i = 0; i < n && rx_len < sizeof(rx); i++) rx[rx_len++] = buf[i];
+  }
+  void clear() { rx_len = rx_pos = tx_len = 0; }
+
+  uint8_t rx[4096];
+  size_t rx_len = 0, rx_pos = 0;
+  uint8_t tx[4096];
+  size_t tx_len = 0;
+  uint32_t baud = 0;
+  size_t tx_at_begin = 0;  // what had been written when the rate last changed
+
+ private:
+  bool enable_sacp_ = false;
+  template<typename... Args> size_t printf_(const char *fmt, Args... args) {
+    char buf[64];
+    int n = snprintf(buf, sizeof(buf), fmt, args...);
+    return write((const uint8_t *)buf, n < 0 ? 0 : size_t(n) < sizeof(buf) ? size_t(n) : sizeof(buf) - 1);
+  }
+};
+
+extern HardwareSerial Serial, Serial1, Serial2;
+#define MSerial1 Serial
+#define MSerial2 Serial1
@@ -0,0 +1,8 @@
+/*
+ * Host stand-in for the EEPROM library, used by the host unit tests only.
+ * The firmware headers include it for the flash layout constants in
+ * flash_stm32.h, nothing here reads or writes it.
+ */
+#pragma once
+
+#include "flash_stm32.h"
@@ -0,0 +1,61 @@
+/*
+ * Host stand-in for the FreeRTOS port, used by the host unit tests only.
+ * The tests are single threaded: semaphores always succeed and delays only
+ * advance the fake clock.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+typedef void *SemaphoreHandle_t;
+typedef void *QueueHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE  ((BaseType_t)1)
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ 1000
+#define configMAX_TASK_NAME_LEN 16
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define configASSERT(x)
+
+#define taskSCHEDULER_SUSPENDED   ((BaseType_t)0)
+#define taskSCHEDULER_NOT_STARTED ((BaseType_t)1)
+#define taskSCHEDULER_RUNNING     ((BaseType_t)2)
+
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern volatile uint32_t host_millis;
+
+static inline void vTaskDelay(TickType_t ticks) { host_millis += ticks; }
+static inline BaseType_t xTaskGetSchedulerState(void) { return taskSCHEDULER_NOT_STARTED; }
+static inline TaskHandle_t xTaskGetCurrentTaskHandle(void) { return NULL; }
+static inline TickType_t xTaskGetTickCount(void) { return host_millis; }
+static inline void vTaskSuspendAll(void) {}
+static inline BaseType_t xTaskResumeAll(void) { return pdFALSE; }
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void) { return (SemaphoreHandle_t)1; }
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+
+// No task ever runs, and nothing waits in a queue
+static inline BaseType_t xTaskCreate(TaskFunction_t, const char *, uint16_t, void *, UBaseType_t, TaskHandle_t *) { return pdPASS; }
+static inline QueueHandle_t xQueueCreate(UBaseType_t, UBaseType_t) { return (QueueHandle_t)1; }
+static inline BaseType_t xQueueSend(QueueHandle_t, const void *, TickType_t) { return pdPASS; }
+static inline BaseType_t xQueueReceive(QueueHandle_t, void *, TickType_t) { return pdFAIL; }
+
+#ifdef __cplusplus
+}
+#endif
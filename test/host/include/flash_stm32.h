@@ -0,0 +1,44 @@
+/*
+ * Host stand-in for the flash driver, backed by the simulated flash in
+ * support/host_flash.cpp.
+ */
+#ifndef __FLASH_STM32_H
+#define __FLASH_STM32_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+typedef enum
+	{
+	FLASH_BUSY = 1,
+	FLASH_ERROR_PG,
+	FLASH_ERROR_WRP,
+	FLASH_ERROR_OPT,
+	FLASH_COMPLETE,
+	FLASH_TIMEOUT,
+	FLASH_BAD_ADDRESS
+	} FLASH_Status;
+
+#define IS_FLASH_ADDRESS(ADDRESS) (((ADDRESS) >= 0x08000000) && ((ADDRESS) < 0x080FFFFF))
+
+FLASH_Status FLASH_ErasePage(uint32_t Page_Address);
+FLASH_Status FLASH_ProgramHalfWord(uint32_t Address, uint16_t Data);
+
+void FLASH_Unlock(void);
+void FLASH_Lock(void);
+
+// Test side: map the simulated flash at its real address, erased
+bool host_flash_init(void);
+// Halfwords programmed over ones already programmed
+extern uint32_t host_flash_overwrites;
+// Page erases and halfwords programmed since host_flash_init()
+extern uint32_t host_flash_erases, host_flash_halfwords;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FLASH_STM32_H */
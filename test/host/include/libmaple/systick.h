@@ -0,0 +1,17 @@
+/*
+ * Host stand-in for libmaple/systick.h, used by the host unit tests only.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern volatile uint32_t host_millis;
+static inline uint32_t systick_uptime(void) { return host_millis; }
+
+#ifdef __cplusplus
+}
+#endif
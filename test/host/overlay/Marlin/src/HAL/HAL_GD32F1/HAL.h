@@ -0,0 +1,112 @@
+/**
+ * Marlin 3D Printer Firmware
+ * Copyright (c) 2020 MarlinFirmware [https://github.com/MarlinFirmware/Marlin]
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+/**
+ * Host stand-in for the GD32F1 HAL, used by the host unit tests only.
+ * Provides the types and macros the shared code expects; anything touching
+ * real hardware is a no-op or lives in test/host/support/host_support.cpp.
+ */
+
+#define CPU_32_BIT
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "../shared/progmem.h"
+
+#include "../shared/math_32bit.h"
+#include "fastio_STM32F1.h"
+#include "HAL_timers_STM32F1.h"
+#include "../../inc/MarlinConfigPre.h"
+
+#define HAL_ADC_RESOLUTION  12
+#define HAL_ADC_RANGE _BV(HAL_ADC_RESOLUTION)
+
+#define NUM_SERIAL 1
+#define MYSERIAL0 Serial
+#define MYSERIAL1 Serial
+#define HMISERIAL Serial1
+
+#define HAL_INIT
+inline void HAL_init() {}
+
+#ifndef analogInputToDigitalPin
+  #define analogInputToDigitalPin(p) (p)
+#endif
+
+#define CRITICAL_SECTION_START
+#define CRITICAL_SECTION_END
+
+#define ISRS_ENABLED() true
+#define ENABLE_ISRS()
+#define DISABLE_ISRS()
+
+#define square(x) ((x)*(x))
+
+#ifndef strncpy_P
+  #define strncpy_P(dest, src, num) strncpy((dest), (src), (num))
+#endif
+
+#ifndef PGMSTR
+  #define PGMSTR(NAM,STR) const char NAM[] = STR
+#endif
+
+#define RST_POWER_ON   1
+#define RST_EXTERNAL   2
+#define RST_BROWN_OUT  4
+#define RST_WATCHDOG   8
+#define RST_JTAG       16
+#define RST_SOFTWARE   32
+#define RST_BACKUP     64
+
+typedef int8_t pin_t;
+
+extern uint16_t HAL_adc_result;
+
+#define cli()
+#define sei()
+
+inline void HAL_clear_reset_source() {}
+inline uint8_t HAL_get_reset_source() { return RST_POWER_ON; }
+inline void _delay_ms(const int) {}
+#define DELAY_CYCLES(x) NOOP
+inline int freeMemory() { return 0; }
+
+#define HAL_ANALOG_SELECT(pin)
+inline void HAL_adc_init() {}
+#define HAL_START_ADC(pin)
+#define HAL_READ_ADC()      HAL_adc_result
+#define HAL_ADC_READY()     true
+inline void HAL_adc_start_conversion(const uint8_t) {}
+inline uint16_t HAL_adc_get_result() { return HAL_adc_result; }
+
+#define HAL_ADC_FILTERED
+#define HAL_ADC_FILTER_FRAC 4
+extern volatile uint32_t HAL_adc_sequence;
+const uint16_t* HAL_adc_snapshot();
+uint16_t HAL_adc_filtered(const uint8_t adc_pin, const uint16_t *snapshot=HAL_adc_snapshot());
+
+#define GET_PIN_MAP_PIN(index) index
+#define GET_PIN_MAP_INDEX(pin) pin
+#define PARSED_PIN_INDEX(code, dval) parser.intval(code, dval)
+
+#define JTAG_DISABLE()
+#define JTAGSWD_DISABLE()
+
+inline void watchdog_refresh() {}
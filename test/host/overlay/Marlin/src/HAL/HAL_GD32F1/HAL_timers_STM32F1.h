@@ -0,0 +1,70 @@
+/**
+ * Marlin 3D Printer Firmware
+ * Copyright (c) 2020 MarlinFirmware [https://github.com/MarlinFirmware/Marlin]
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+/**
+ * Host stand-in for the GD32F1 timers: same rates, no hardware.
+ */
+
+#include <stdint.h>
+
+#define FORCE_INLINE __attribute__((always_inline)) inline
+
+typedef uint16_t hal_timer_t;
+#define HAL_TIMER_TYPE_MAX 0xFFFF
+
+#define HAL_TIMER_RATE         uint32_t(F_CPU)
+
+#define STEP_TIMER_CHAN 1
+#define TEMP_TIMER_CHAN 1
+#define STEP_TIMER_NUM 5
+#define TEMP_TIMER_NUM 2
+#define PULSE_TIMER_NUM STEP_TIMER_NUM
+
+#define TEMP_TIMER_PRESCALE     1000
+#define TEMP_TIMER_FREQUENCY    1000
+
+#define STEPPER_TIMER_PRESCALE 40
+#define STEPPER_TIMER_RATE     (HAL_TIMER_RATE / STEPPER_TIMER_PRESCALE)
+#define STEPPER_TIMER_TICKS_PER_US ((STEPPER_TIMER_RATE) / 1000000)
+#define STEPPER_TIMER_TICKS_PER_MS ((STEPPER_TIMER_RATE) / 1000)
+
+#define PULSE_TIMER_RATE       STEPPER_TIMER_RATE
+#define PULSE_TIMER_PRESCALE   STEPPER_TIMER_PRESCALE
+#define PULSE_TIMER_TICKS_PER_US STEPPER_TIMER_TICKS_PER_US
+
+#define ENABLE_STEPPER_DRIVER_INTERRUPT()
+#define DISABLE_STEPPER_DRIVER_INTERRUPT()
+#define STEPPER_ISR_ENABLED() true
+#define ENABLE_TEMPERATURE_INTERRUPT()
+#define DISABLE_TEMPERATURE_INTERRUPT()
+
+#define HAL_timer_get_count(timer_num) 0
+
+#define HAL_TEMP_TIMER_ISR() extern "C" void tempTC_Handler(void)
+#define HAL_STEP_TIMER_ISR() extern "C" void stepTC_Handler(void)
+
+inline void HAL_timer_start(const uint8_t, const uint32_t) {}
+inline void HAL_timer_enable_interrupt(const uint8_t) {}
+inline void HAL_timer_disable_interrupt(const uint8_t) {}
+inline bool HAL_timer_interrupt_enabled(const uint8_t) { return false; }
+FORCE_INLINE static void HAL_timer_set_compare(const uint8_t, const hal_timer_t) {}
+FORCE_INLINE static hal_timer_t HAL_timer_get_compare(const uint8_t) { return 0; }
+FORCE_INLINE static void HAL_timer_isr_prologue(const uint8_t) {}
+#define HAL_timer_isr_epilogue(TIMER_NUM)
@@ -0,0 +1,59 @@
+/**
+ * Marlin 3D Printer Firmware
+ * Copyright (c) 2020 MarlinFirmware [https://github.com/MarlinFirmware/Marlin]
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+/**
+ * Host stand-in for the GD32F1 fast I/O. Pins are plain numbers in the
+ * order of the board's pin map. Inputs read the levels a test drives with
+ * host_set_pin() and outputs do nothing, so modules that set up their pins
+ * (temperature.cpp) build for the host tests.
+ */
+
+enum {
+  PA0, PA1, PA2, PA3, PA4, PA5, PA6, PA7, PA8, PA9, PA10, PA11, PA12, PA13, PA14, PA15,
+  PB0, PB1, PB2, PB3, PB4, PB5, PB6, PB7, PB8, PB9, PB10, PB11, PB12, PB13, PB14, PB15,
+  PC0, PC1, PC2, PC3, PC4, PC5, PC6, PC7, PC8, PC9, PC10, PC11, PC12, PC13, PC14, PC15,
+  PD0, PD1, PD2, PD3, PD4, PD5, PD6, PD7, PD8, PD9, PD10, PD11, PD12, PD13, PD14, PD15,
+  PE0, PE1, PE2, PE3, PE4, PE5, PE6, PE7, PE8, PE9, PE10, PE11, PE12, PE13, PE14, PE15
+};
+
+#define READ(IO)              digitalRead(IO)
+#define WRITE(IO,V)           NOOP
+#define TOGGLE(IO)            NOOP
+#define WRITE_VAR(IO,V)       WRITE(IO,V)
+
+#define OUT_WRITE(IO,V)       NOOP
+#define SET_INPUT(IO)         NOOP
+#define SET_INPUT_PULLUP(IO)  NOOP
+#define SET_OUTPUT(IO)        NOOP
+#define SET_PWM(IO)           NOOP
+
+#define GET_INPUT(IO)         true
+#define GET_OUTPUT(IO)        false
+#define GET_TIMER(IO)         false
+
+#define digitalPinHasPWM(p)     (((p) == PC7) || ((p) == PC9) || ((p) == PA8) || ((p) == PB8))
+#define PWM_PIN(P)              digitalPinHasPWM(P)
+#define USEABLE_HARDWARE_PWM(P) PWM_PIN(P)
+
+inline void pwmInit(uint8_t, uint16_t, uint32_t) {}
+inline void pwmWrite(uint8_t, uint16_t) {}
+
+#define extDigitalRead(IO)    digitalRead(IO)
+#define extDigitalWrite(IO,V) digitalWrite(IO,V)
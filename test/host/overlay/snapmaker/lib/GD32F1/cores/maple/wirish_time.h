@@ -0,0 +1,7 @@
+/*
+ * Host stand-in for the maple core's timing header, used by the host unit
+ * tests only. millis() and delay() come from the host Arduino.h.
+ */
+#pragma once
+
+#include <Arduino.h>
@@ -0,0 +1,83 @@
+/*
+ * Host stand-ins for the modules the SACP handlers call into. Only the link
+ * handlers are exercised, the rest answer with nothing.
+ */
+#include "src/inc/MarlinConfig.h"
+#include "src/MarlinCore.h"
+#include "src/module/AxisManager.h"
+#include "snapmaker/event/event.h"
+#include "snapmaker/event/subscribe.h"
+#include "snapmaker/event/event_fdm.h"
+#include "snapmaker/event/event_bed.h"
+#include "snapmaker/event/event_calibtration.h"
+#include "snapmaker/event/event_printer.h"
+#include "snapmaker/event/event_enclouser.h"
+#include "snapmaker/event/event_update.h"
+#include "snapmaker/event/event_exception.h"
+#include "snapmaker/module/system.h"
+#include "snapmaker/module/motion_control.h"
+#include "snapmaker/module/bed_control.h"
+#include "snapmaker/module/enclosure.h"
+#include "snapmaker/module/fdm.h"
+#include "snapmaker/module/calibtration.h"
+#include "snapmaker/module/print_control.h"
+#include "snapmaker/module/factory_data.h"
+
+event_cb_info_t fdm_cb_info[FDM_ID_CB_COUNT];
+event_cb_info_t bed_cb_info[BED_ID_CB_COUNT];
+event_cb_info_t calibtration_cb_info[CAlIBRATION_ID_CB_COUNT];
+event_cb_info_t printer_cb_info[PRINTER_ID_CB_COUNT];
+event_cb_info_t enclouser_cb_info[ENCLOUSER_ID_CB_COUNT];
+event_cb_info_t update_cb_info[UPDATE_ID_CB_COUNT];
+event_cb_info_t exception_cb_info[EXCEPTION_ID_CB_COUNT];
+
+SystemService system_service;
+void SystemService::set_ready(uint8_t ready) { ready_ |= ready; }
+void SystemService::boot_mark(boot_phase_e phase) { boot_marked_[phase] = true; }
+void SystemService::factory_reset() {}
+void SystemService::get_coordinate_system_info(coordinate_system_t *, bool) {}
+void SystemService::get_machine_info(machine_info_t *) {}
+void SystemService::get_machine_size(machine_size_t *) {}
+uint8_t *SystemService::get_sn_addr(uint16_t *sn_len) { *sn_len = 0; return nullptr; }
+void SystemService::save_setting() {}
+
+MotionControl motion_control;
+ErrCode MotionControl::move_axis(mobile_instruction_t *) { return E_SUCCESS; }
+ErrCode MotionControl::move_axis_to(mobile_instruction_t *) { return E_SUCCESS; }
+ErrCode MotionControl::home() { return E_SUCCESS; }
+void MotionControl::get_home_pos(float *) {}
+void MotionControl::get_xyz_pos(float *) {}
+void MotionControl::move_x_to_relative_home(float, uint16_t) {}
+void MotionControl::synchronize() {}
+void MotionControl::motor_enable(uint8_t, uint8_t) {}
+void MotionControl::motor_disable(uint8_t, uint8_t) {}
+bool MotionControl::is_motor_enable(uint8_t, uint8_t) { return false; }
+
+Subscribe subscribe;
+ErrCode Subscribe::enable(event_param_t &) { return E_SUCCESS; }
+ErrCode Subscribe::disable(event_param_t &) { return E_SUCCESS; }
+ErrCode Subscribe::status_snapshot(event_param_t &) { return E_SUCCESS; }
+
+BedControl bed_control;
+ErrCode BedControl::get_module_info(module_info_t &) { return E_SUCCESS; }
+Enclosure enclosure;
+void Enclosure::get_module_info(module_info_t &) {}
+FDM_Head fdm_head;
+ErrCode FDM_Head::get_module_info(uint8_t, module_info_t &) { return E_SUCCESS; }
+Calibtration calibtration;
+void Calibtration::updateBuildPlateThickness(float) {}
+PrintControl print_control;
+
+factory_data_srv fd_srv;
+bool factory_data_srv::save() { return true; }
+bool factory_data_srv::setBuildPlateThickness(float) { return true; }
+float factory_data_srv::getBuildPlateThickness() { return DEFAULT_BUILD_PLATE_THICKNESS; }
+
+AxisManager axisManager;
+AxisInputShaper AxisInputShaper::axis_input_shaper_x, AxisInputShaper::axis_input_shaper_y;
+ErrCode AxisManager::input_shaper_set(int, int, float, float, uint8_t) { return E_SUCCESS; }
+ErrCode AxisManager::input_shaper_get(int, int &, float &, float &, uint8_t) { return E_SUCCESS; }
+
+void SnapDebug::set_level(debug_level_e) {}
+bool ml_setting_need_save;
+bool req_run_gcode(char *) { return false; }
@@ -0,0 +1,55 @@
+/*
+ * Simulated GD32F105 flash, mapped at its real address since the firmware
+ * reads it through plain pointers. Programming can only clear bits, as on
+ * the part, and a page must be erased before it is programmed again.
+ */
+#include <sys/mman.h>
+#include <string.h>
+#include "src/inc/MarlinConfig.h"
+#include "flash_stm32.h"
+
+uint32_t host_flash_overwrites, host_flash_erases, host_flash_halfwords;
+static bool locked = true;
+
+bool host_flash_init() {
+  static void *flash = MAP_FAILED;
+  if (flash == MAP_FAILED) {
+    flash = mmap((void *)FLASH_BASE, FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (flash != MAP_FAILED && flash != (void *)FLASH_BASE) {
+      munmap(flash, FLASH_SIZE);
+      flash = MAP_FAILED;
+    }
+    if (flash == MAP_FAILED) return false;
+  }
+  memset(flash, 0xFF, FLASH_SIZE);
+  host_flash_overwrites = host_flash_erases = host_flash_halfwords = 0;
+  locked = true;
+  return true;
+}
+
+void FLASH_Unlock() { locked = false; }
+void FLASH_Lock() { locked = true; }
+
+FLASH_Status FLASH_ErasePage(uint32_t addr) {
+  if (locked) return FLASH_ERROR_WRP;
+  if (!IS_FLASH_ADDRESS(addr)) return FLASH_BAD_ADDRESS;
+  // 2K pages in the first 512K, 4K after
+  const uint32_t page = addr < FLASH_BASE + 512 * 1024 ? APP_FLASH_PAGE_SIZE : DATA_FLASH_PAGE_SIZE;
+  memset((void *)(uintptr_t)(addr & ~(page - 1)), 0xFF, page);
+  host_flash_erases++;
+  return FLASH_COMPLETE;
+}
+
+FLASH_Status FLASH_ProgramHalfWord(uint32_t addr, uint16_t data) {
+  if (locked) return FLASH_ERROR_WRP;
+  if (!IS_FLASH_ADDRESS(addr) || (addr & 1)) return FLASH_BAD_ADDRESS;
+  volatile uint16_t *p = (volatile uint16_t *)(uintptr_t)addr;
+  host_flash_halfwords++;
+  if (*p != 0xFFFF) {
+    host_flash_overwrites++;
+    *p &= data;
+    return FLASH_ERROR_PG;
+  }
+  *p = data;
+  return FLASH_COMPLETE;
+}
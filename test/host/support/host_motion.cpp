@@ -0,0 +1,13 @@
+/*
+ * Host stand-ins for the motion globals the shaper sources reference.
+ * The tests set what they need.
+ */
+#include "src/inc/MarlinConfig.h"
+#include "src/module/motion.h"
+
+xyze_pos_t current_position;
+uint8_t active_extruder;
+#if ENABLED(DUAL_X_CARRIAGE)
+  DualXMode dual_x_carriage_mode;
+#endif
+void sync_plan_position() {}
@@ -0,0 +1,20 @@
+/*
+ * Host stand-ins for the planner globals the shaper and calibration sources
+ * reference, left out of the link when a test builds planner.cpp itself.
+ * The tests set what they need; nothing here plans or steps, a test that
+ * simulates the moves runs them from host_synchronize.
+ */
+#include "src/inc/MarlinConfig.h"
+#include "src/module/planner.h"
+
+block_t Planner::block_buffer[BLOCK_BUFFER_SIZE];
+volatile uint8_t Planner::block_buffer_head, Planner::block_buffer_tail;
+planner_settings_t Planner::settings;
+float Planner::steps_to_mm[DISTINCT_AXES];
+#if ENABLED(LIN_ADVANCE)
+  float Planner::extruder_advance_K[EXTRUDERS];
+#endif
+// Set by a test that runs the queued moves
+void (*host_synchronize)();
+void Planner::synchronize() { if (host_synchronize) host_synchronize(); }
+uint32_t statistics_funcgen_runout_cnt;
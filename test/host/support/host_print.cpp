@@ -0,0 +1,22 @@
+/*
+ * Host stand-ins for the services PrintControl::get_commands() checks
+ * before it reads the staged gcode.
+ */
+#include "src/inc/MarlinConfig.h"
+#include "snapmaker/module/system.h"
+#include "snapmaker/module/power_loss.h"
+#include "snapmaker/module/filament_sensor.h"
+#include "src/feature/cancel_object.h"
+
+SystemService system_service;
+PowerLoss power_loss;
+FilamentSensor filament_sensor;
+uint32_t CancelObject::canceled;
+
+ErrCode SystemService::set_status(system_status_e status, system_status_source_e source) {
+  status_ = status;
+  source_ = source;
+  return E_SUCCESS;
+}
+void SystemService::return_to_idle() { status_ = SYSTEM_STATUE_IDLE; }
+void FilamentSensor::reset() {}
@@ -0,0 +1,20 @@
+/*
+ * Host stand-ins for what the command queue reaches outside of reading
+ * and storing lines: the serial error paths and the tool-change scan.
+ */
+#include "src/inc/MarlinConfig.h"
+#include "src/MarlinCore.h"
+#include "src/module/temperature.h"
+#include "src/module/stepper.h"
+#include "snapmaker/module/tool_preheat.h"
+
+PGMSTR(M112_KILL_STR, "M112 Shutdown");
+MarlinState marlin_state = MF_RUNNING;
+bool wait_for_heatup = true;
+void kill(PGM_P const, PGM_P const, const bool) {}
+void quickstop_stepper() {}
+void MarlinUI::set_status_P(PGM_P const, const int8_t) {}
+void Temperature::manage_heater() {}
+
+ToolPreheat tool_preheat;
+void ToolPreheat::loop() {}
@@ -0,0 +1,41 @@
+/*
+ * Host stand-ins for firmware globals the sources under test reference.
+ */
+#include <stdarg.h>
+#include <Arduino.h>
+#include "src/HAL/HAL_GD32F1/HAL.h"
+#include "snapmaker/debug/debug.h"
+
+extern "C" { volatile uint32_t host_millis; }
+HardwareSerial Serial, Serial1, Serial2;
+
+uint16_t HAL_adc_result;
+volatile uint32_t HAL_adc_sequence;
+const uint16_t* HAL_adc_snapshot() { return nullptr; }
+uint16_t HAL_adc_filtered(const uint8_t, const uint16_t*) { return 0; }
+
+uint8_t host_pin_level[HOST_PINS];
+static voidFuncPtr pin_handler[HOST_PINS];
+static ExtIntTriggerMode pin_mode[HOST_PINS];
+
+void attachInterrupt(uint8_t pin, voidFuncPtr handler, ExtIntTriggerMode mode) {
+  pin_handler[pin] = handler;
+  pin_mode[pin] = mode;
+}
+void detachInterrupt(uint8_t pin) { pin_handler[pin] = nullptr; }
+
+void host_set_pin(uint8_t pin, uint8_t level) {
+  if (host_pin_level[pin] == level) return;
+  host_pin_level[pin] = level;
+  const ExtIntTriggerMode m = pin_mode[pin];
+  if (pin_handler[pin] && (m == CHANGE || (m == RISING) == (level == HIGH))) pin_handler[pin]();
+}
+
+SnapDebug debug;
+void SnapDebug::Log(debug_level_e level, const char *fmt, ...) {
+  if (level < SNAP_DEBUG_LEVEL_WARNING && !getenv("HOST_TEST_VERBOSE")) return;
+  va_list args;
+  va_start(args, fmt);
+  vprintf(fmt, args);
+  va_end(args);
+}
@@ -0,0 +1,27 @@
+#!/usr/bin/env python3
+#
+# Write a made-up firmware image for the update test: text that compresses
+# well, noise that does not and runs of erased flash, with an odd length so
+# the image tail is a short, odd frame.
+#
+import sys
+
+PAGE = 4096
+
+def noise(n, seed):
+  out = bytearray()
+  x = seed
+  for _ in range(n):
+    x = (x * 1103515245 + 12345) & 0x7FFFFFFF
+    out.append(x >> 16 & 0xFF)
+  return bytes(out)
+
+text = b"".join(b"G1 X%d.%02d Y%d.%d E%d.%03d F1800\n" % (i % 300, i % 97, i % 200, i % 10, i, i * 7 % 1000)
+                for i in range(400))
+image = (text[:PAGE + 1500] + noise(PAGE - 700, 7) + b"\xFF" * (PAGE + 300) + b"\x00" * 200
+         + noise(1200, 11) + text[:PAGE - 600])
+image = image[:4 * PAGE + 1001]
+assert len(image) == 4 * PAGE + 1001
+
+with open(sys.argv[1], "wb") as f:
+  f.write(image)
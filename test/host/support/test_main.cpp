@@ -0,0 +1,25 @@
+/*
+ * Runs every TEST registered by the test binary.
+ */
+#include "test.h"
+
+int host_test_failures;
+static HostTest *tests, **tests_tail = &tests;
+
+HostTest::HostTest(const char *name, void (*fn)()) : name(name), fn(fn), next(nullptr) {
+  *tests_tail = this;
+  tests_tail = &next;
+}
+
+int main() {
+  int failed_tests = 0, count = 0;
+  for (HostTest *t = tests; t; t = t->next, ++count) {
+    const int before = host_test_failures;
+    t->fn();
+    const bool ok = host_test_failures == before;
+    if (!ok) ++failed_tests;
+    printf("[%s] %s\n", ok ? "  OK  " : " FAIL ", t->name);
+  }
+  printf("%d of %d tests passed\n", count - failed_tests, count);
+  return failed_tests ? 1 : 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * Minimal test runner for the host unit tests.
+ *
+ *   TEST_CASE(name) { CHECK(...); CHECK_NEAR(a, b, tol); }
+ *
+ * Each test binary runs all of its TEST_CASEs and exits non-zero on any failed
+ * check, which is all ctest needs.
+ */
+#pragma once
+
+#include <stdio.h>
+#include <math.h>
+
+struct HostTest {
+  const char *name;
+  void (*fn)();
+  HostTest *next;
+  HostTest(const char *name, void (*fn)());
+};
+
+extern int host_test_failures;
+
+#define TEST_CASE(NAME) \
+  static void NAME(); \
+  static HostTest NAME##_test(#NAME, NAME); \
+  static void NAME()
+
+#define CHECK(COND) do{ \
+  if (!(COND)) { \
+    ++host_test_failures; \
+    printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #COND); \
+  } \
+}while(0)
+
+#define CHECK_EQ(A, B) do{ \
+  const long long a_ = (long long)(A), b_ = (long long)(B); \
+  if (a_ != b_) { \
+    ++host_test_failures; \
+    printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #A, #B, a_, b_); \
+  } \
+}while(0)
+
+#define CHECK_NEAR(A, B, TOL) do{ \
+  const double a_ = (A), b_ = (B); \
+  if (!(fabs(a_ - b_) <= (TOL))) { \
+    ++host_test_failures; \
+    printf("%s:%d: CHECK_NEAR(%s, %s, %s) failed: %g vs %g\n", __FILE__, __LINE__, #A, #B, #TOL, a_, b_); \
+  } \
+}while(0)
@@ -0,0 +1,112 @@
+/*
+ * plan_arc() with ARC_CHORD_TOLERANCE, the segments caught at
+ * Planner::buffer_line(). Every arc is measured for the blocks it queues and
+ * how far its points and chords stray from the true arc, against the fixed
+ * MM_PER_ARC_SEGMENT segments it replaces.
+ */
+#include <math.h>
+#include <vector>
+#include "test.h"
+#include "src/inc/MarlinConfig.h"
+#include "src/module/motion.h"
+#include "src/module/planner.h"
+#include "src/module/temperature.h"
+
+void plan_arc(const xyze_pos_t &cart, const ab_float_t &offset, const bool clockwise, const uint8_t circles);
+
+// What plan_arc() reaches outside of the arc
+feedRate_t feedrate_mm_s;
+int16_t feedrate_percentage = 100;
+Temperature thermalManager;
+void Temperature::manage_heater() {}
+void idle(bool) {}
+void apply_motion_limits(xyz_pos_t &) {}
+
+static std::vector<xy_pos_t> points;
+bool Planner::buffer_line(const xyze_pos_t &cart, const_feedRate_t, const uint8_t, const float) {
+  points.push_back(cart);
+  return true;
+}
+
+struct Arc { int blocks; float max_dev, mean_len; };
+
+/**
+ * Largest distance from the circle of a point, or of the middle of a chord.
+ * The chord midpoint is where a chord strays furthest inside the arc.
+ */
+static Arc measure(const xy_pos_t &start, const xy_pos_t &center, const float r) {
+  Arc a = { int(points.size()), 0, 0 };
+  xy_pos_t prev = start;
+  for (const xy_pos_t &p : points) {
+    NOLESS(a.max_dev, ABS((p - center).magnitude() - r));
+    NOLESS(a.max_dev, ABS(((p + prev) * 0.5f - center).magnitude() - r));
+    a.mean_len += (p - prev).magnitude() / points.size();
+    prev = p;
+  }
+  return a;
+}
+
+// A counterclockwise arc of sweep radians from the +X side of a circle at 150, 150
+static Arc run(const float r, const float sweep, const uint8_t queued) {
+  const xy_pos_t center = { 150, 150 }, start = { 150 + r, 150 };
+  current_position.set(start.x, start.y, 0.2f);
+  current_position.e = 0;
+  xyze_pos_t to = current_position;
+  // A whole circle ends exactly where it starts
+  if (sweep < RADIANS(360)) {
+    to.x = center.x + r * cosf(sweep);
+    to.y = center.y + r * sinf(sweep);
+  }
+  to.e = 0.033f * r * sweep;
+  planner.block_buffer_tail = 0;
+  planner.block_buffer_head = queued;
+  points.clear();
+  plan_arc(to, ab_float_t({ -r, 0 }), false, 0);
+  return measure(start, center, r);
+}
+
+// The 1 mm chords of MM_PER_ARC_SEGMENT, as plan_arc() sized them before
+static Arc fixed_segments(const float r, const float sweep) {
+  const uint16_t segments = _MAX(uint16_t(FLOOR(r * sweep / (MM_PER_ARC_SEGMENT))),
+                                 uint16_t(CEIL(MIN_ARC_SEGMENTS * sweep / RADIANS(360))), uint16_t(1));
+  const float theta = sweep / segments, chord = 2 * r * sinf(theta / 2);
+  const Arc a = { segments, r - SQRT(sq(r) - sq(chord / 2)), chord };
+  return a;
+}
+
+TEST_CASE(chords_stay_within_tolerance) {
+  feedrate_mm_s = 100;
+  printf("Arcs at %.0f mm/s, chord tolerance %.3f mm, planner over half full\n", feedrate_mm_s, ARC_CHORD_TOLERANCE);
+  printf("  radius  sweep | %.0f mm segments: blocks  deviation | tolerance: blocks  length  deviation\n", float(MM_PER_ARC_SEGMENT));
+  const float radii[] = { 0.5f, 2, 10, 50, 100 }, sweeps[] = { RADIANS(90), RADIANS(360) };
+  int fixed_total = 0, total = 0;
+  for (const float r : radii) for (const float sweep : sweeps) {
+    const Arc f = fixed_segments(r, sweep), a = run(r, sweep, BLOCK_BUFFER_SIZE - 2);
+    printf("  %5.1f  %4.0f  |            %6d   %7.4f mm |       %6d  %5.2f mm  %7.4f mm\n",
+           r, DEGREES(sweep), f.blocks, f.max_dev, a.blocks, a.mean_len, a.max_dev);
+    fixed_total += f.blocks;
+    total += a.blocks;
+
+    // Within the tolerance and a float rounding at 250 mm, never coarser than MAX_ARC_SEGMENT_MM
+    CHECK(a.max_dev <= ARC_CHORD_TOLERANCE + 1e-4f);
+    CHECK(a.mean_len <= MAX_ARC_SEGMENT_MM + 1e-3f);
+    CHECK(a.blocks >= int(CEIL(MIN_ARC_SEGMENTS * sweep / RADIANS(360))));
+    // Tight arcs get more blocks than the fixed segments, which strayed further
+    if (f.max_dev > ARC_CHORD_TOLERANCE) CHECK(a.blocks > f.blocks);
+    // Wide arcs get a third fewer at least
+    if (r >= 50) CHECK(a.blocks * 3 < f.blocks * 2);
+  }
+  printf("  all arcs: %d blocks against %d\n", total, fixed_total);
+  CHECK(total < fixed_total);
+}
+
+TEST_CASE(low_planner_trades_accuracy_for_block_rate) {
+  // At 200 mm/s a 10 mm arc in tolerance would queue 0.9 mm blocks, 220 a second
+  feedrate_mm_s = 200;
+  const Arc full = run(10, RADIANS(360), BLOCK_BUFFER_SIZE - 2), low = run(10, RADIANS(360), 2);
+  printf("10 mm circle at 200 mm/s: %d blocks of %.2f mm with the planner full, %d of %.2f mm nearly empty (%.3f mm off)\n",
+         full.blocks, full.mean_len, low.blocks, low.mean_len, low.max_dev);
+  CHECK(full.max_dev <= ARC_CHORD_TOLERANCE + 1e-4f);
+  CHECK(low.blocks < full.blocks);
+  CHECK(low.blocks <= int(CEIL(RADIANS(360) * 10 / (feedrate_mm_s / ARC_LOW_BUFFER_SEGMENTS_PER_SEC))));
+}
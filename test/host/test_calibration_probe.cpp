@@ -0,0 +1,377 @@
+/*
+ * Calibration probing against a simulated machine. Moves run in real time
+ * with the calibration acceleration and the planner's start delay, the
+ * stepper counts whole steps and the nozzle follows the motor through a
+ * backlash dead band. The probe reads LOW while the nozzle touches the
+ * target or the bed, switching a few microns either side of the surface
+ * each time, and its edges run the handlers switch_detect attached to the
+ * pin.
+ */
+#include <stdlib.h>
+#include <math.h>
+#include "test.h"
+#include "src/inc/MarlinConfig.h"
+#include "src/module/motion.h"
+#include "src/module/planner.h"
+#include "src/module/stepper.h"
+#include "snapmaker/J1/switch_detect.h"
+#include "snapmaker/module/motion_control.h"
+#include "src/module/shaper/ZMesh.h"
+#define private public    // The probe routines are private to Calibtration
+#include "snapmaker/module/calibtration.h"
+#undef private
+
+#define MOVE_START_MS   100     // planner.cpp's BLOCK_DELAY_FOR_1ST_MOVE, every blocking move starts on an empty queue
+#define SIM_DT          20e-6f  // s
+#define TARGET_RADIUS   4.0f    // mm, the hole the nozzle probes
+#define SWITCH_SIGMA    0.002f  // mm, where the contact makes or breaks around the wall
+
+uint16_t x0_sg_value, x1_sg_value, y_sg_value, z_sg_value;
+bool Stepper::abort_current_block;
+uint8_t Stepper::last_direction_bits;
+Stepper stepper;
+MotionControl motion_control;
+
+/**
+ * The active carriage. Positions are in native mm, the nozzle lags the
+ * motor by half the backlash in the direction it last moved.
+ */
+static struct Machine {
+  int32_t steps[XYZ];
+  float nozzle[XYZ];
+  float center[2];        // of the target
+  bool on_bed;            // probing the bed instead of the target
+  float backlash;
+  float make, brk;        // contact thresholds past the wall, redrawn at every edge
+  bool touched;
+  double clock_s;
+  uint32_t moves, starts;
+  uint32_t seed;
+
+  // Native Z of the bed under the nozzle, tilted along X (mm/mm) and sagging in the middle (mm)
+  static float tilt, warp;
+  static float bed(const float x, const float y) {
+    const float u = x / X_BED_SIZE - 0.5f, v = y / Y_BED_SIZE - 0.5f;
+    return -1.2f + tilt * x - warp * (1 - 4 * (sq(u) + sq(v)));
+  }
+
+  float gauss() {
+    float s = 0;
+    for (int i = 0; i < 12; i++) {
+      seed = seed * 1103515245 + 12345;
+      s += (seed >> 8 & 0xFFFF) / 65536.0f;
+    }
+    return s - 6;
+  }
+
+  void reset(const float x, const float y, const float cx, const float cy, const float lash, const uint32_t s) {
+    const float pos[XYZ] = { x, y, 0 };
+    LOOP_L_N(i, XYZ) {
+      steps[i] = LROUND(pos[i] * planner.settings.axis_steps_per_mm[i]);
+      nozzle[i] = pos[i];
+    }
+    center[0] = cx; center[1] = cy;
+    backlash = lash;
+    seed = s;
+    make = SWITCH_SIGMA * gauss();
+    brk = SWITCH_SIGMA * gauss();
+    touched = false;
+    on_bed = false;
+    queued = 0;
+    clock_s = 0;
+    moves = starts = 0;
+    host_millis = 0;
+    Stepper::abort_current_block = false;
+    Stepper::last_direction_bits = 0;
+    current_position.set(x, y, 0);
+    host_pin_level[X0_CAL_PIN] = host_pin_level[X1_CAL_PIN] = HIGH;
+  }
+
+  // Over the bed at z, the nozzle clear of it
+  void reset_bed(const float x, const float y, const float z, const float lash, const uint32_t s) {
+    reset(x, y, 0, 0, lash, s);
+    on_bed = true;
+    steps[Z_AXIS] = LROUND(z * planner.settings.axis_steps_per_mm[Z_AXIS]);
+    nozzle[Z_AXIS] = z;
+    current_position.z = z;
+  }
+
+  // The target plate and the bed are common to both probe inputs
+  void sense() {
+    const float r = on_bed ? bed(nozzle[0], nozzle[1]) - nozzle[2]
+                           : HYPOT(nozzle[0] - center[0], nozzle[1] - center[1]) - TARGET_RADIUS;
+    const bool t = touched ? r > brk : r > make;
+    if (t == touched) return;
+    touched = t;
+    (touched ? brk : make) = SWITCH_SIGMA * gauss();
+    host_set_pin(X1_CAL_PIN, touched ? LOW : HIGH);
+    host_set_pin(X0_CAL_PIN, touched ? LOW : HIGH);
+  }
+
+  void step_to(const uint8_t i, const int32_t s) {
+    if (s == steps[i]) return;
+    SET_BIT_TO(Stepper::last_direction_bits, i, s < steps[i]);
+    steps[i] = s;
+    const float m = s / planner.settings.axis_steps_per_mm[i], half = backlash / 2;
+    nozzle[i] = constrain(nozzle[i], m - half, m + half);
+    sense();
+  }
+
+  // Moves queued since the last run, as the planner holds them
+  struct Line { float to[XYZ], fr_mm_s; } queue[BLOCK_BUFFER_SIZE];
+  uint8_t queued;
+
+  void line_to(const xyz_pos_t &to, const float fr_mm_s) {
+    if (queued == COUNT(queue)) run();
+    queue[queued++] = { { to.x, to.y, to.z }, fr_mm_s };
+  }
+
+  // Feedrate and acceleration of a move within the limits of every axis in it
+  static void limits(const float *d, const float len, float &fr, float &acc) {
+    LOOP_L_N(i, XYZ) if (d[i] != 0) {
+      NOMORE(fr, planner.settings.max_feedrate_mm_s[i] * len / ABS(d[i]));
+      NOMORE(acc, planner.settings.max_acceleration_mm_per_s2[i] * len / ABS(d[i]));
+    }
+  }
+
+  /**
+   * Run the queue from a standstill. Moves join at the slower of their
+   * speeds, the last one ends at rest. quick_stop() discards the rest of
+   * the queue, as the abort does with cleaning_buffer_counter.
+   */
+  void run() {
+    if (!queued) return;
+    clock_s += MOVE_START_MS / 1000.0;
+    starts++;
+    float v = 0;
+    for (uint8_t k = 0; k < queued && !Stepper::abort_current_block; k++) {
+      moves++;
+      const Line &l = queue[k];
+      float from[XYZ], d[XYZ];
+      LOOP_L_N(i, XYZ) {
+        from[i] = steps[i] / planner.settings.axis_steps_per_mm[i];
+        d[i] = l.to[i] - from[i];
+      }
+      const float len = SQRT(sq(d[0]) + sq(d[1]) + sq(d[2]));
+      if (len == 0) continue;
+      float fr = l.fr_mm_s, acc = planner.settings.acceleration, v_exit = 0;
+      limits(d, len, fr, acc);
+      if (k + 1 < queued) {
+        // Junctions as slow as the slower side, stopping where the path turns
+        const Line &n = queue[k + 1];
+        float dn[XYZ], next_fr = n.fr_mm_s, next_acc = acc, dot = 0;
+        LOOP_L_N(i, XYZ) dn[i] = n.to[i] - l.to[i];
+        const float next_len = SQRT(sq(dn[0]) + sq(dn[1]) + sq(dn[2]));
+        if (next_len > 0) {
+          limits(dn, next_len, next_fr, next_acc);
+          LOOP_L_N(i, XYZ) dot += d[i] * dn[i];
+          if (dot > 0.9999f * len * next_len) v_exit = _MIN(fr, next_fr);
+        }
+      }
+      v = _MIN(v, fr);
+      for (float s = 0; s < len && !Stepper::abort_current_block; ) {
+        // Accelerate toward the feedrate, brake in time for the exit speed
+        v = _MIN(v + acc * SIM_DT, fr, SQRT(sq(v_exit) + 2 * acc * (len - s)));
+        s = _MIN(s + _MAX(v, acc * SIM_DT) * SIM_DT, len);
+        LOOP_L_N(i, XYZ) step_to(i, LROUND((from[i] + d[i] * s / len) * planner.settings.axis_steps_per_mm[i]));
+        clock_s += SIM_DT;
+      }
+    }
+    queued = 0;
+    Stepper::abort_current_block = false;
+    host_millis = uint32_t(clock_s * 1000);
+  }
+
+  // A blocking move. After an abort the planner believes it got there.
+  void move_to(const float x, const float y, const float z, const float fr_mm_s) {
+    current_position.set(x, y, z);
+    line_to(current_position, fr_mm_s);
+    run();
+  }
+} machine;
+
+float Machine::tilt, Machine::warp;
+
+int32_t Stepper::position(const AxisEnum axis) { return machine.steps[axis]; }
+void line_to_current_position(const_feedRate_t fr_mm_s) { machine.line_to(current_position, fr_mm_s); }
+extern void (*host_synchronize)();
+
+void MotionControl::move(uint8_t axis, float distance, uint16_t feedrate) {
+  xyz_pos_t to = current_position;
+  to[axis] += distance;
+  machine.move_to(to.x, to.y, to.z, MMM_TO_MMS(feedrate));
+}
+void MotionControl::move_x(float x, uint16_t feedrate) { move(X_AXIS, x, feedrate); }
+void MotionControl::move_y(float y, uint16_t feedrate) { move(Y_AXIS, y, feedrate); }
+void MotionControl::move_z(float z, uint16_t feedrate) { move(Z_AXIS, z, feedrate); }
+void MotionControl::move_to_z_no_limit(float z, uint16_t feedrate) {
+  machine.move_to(current_position.x, current_position.y, z, MMM_TO_MMS(feedrate));
+}
+void MotionControl::move_to_xy(float x, float y, uint16_t feedrate) {
+  machine.move_to(x, y, current_position.z, MMM_TO_MMS(feedrate));
+}
+void MotionControl::synchronize() {}
+void MotionControl::enable_stall_guard_only_axis(uint8_t, uint8_t, uint8_t) {}
+void MotionControl::disable_stall_guard_all() {}
+
+struct Stats { float max_err, mean_err, time_s, moves; };
+
+// Centers of a target off the calibration position by up to a millimeter
+static Stats run(const bool sweep, const float backlash, const int trials) {
+  Stats st = { 0, 0, 0, 0 };
+  calibtration.sweep_probe = sweep;
+  for (int n = 0; n < trials; n++) {
+    const float x0 = X_BED_SIZE / 2, y0 = Y_BED_SIZE / 2,
+                off[2] = { (n % 7 - 3) * 0.31f, (n % 5 - 2) * 0.43f };
+    machine.reset(x0, y0, x0 + off[0], y0 + off[1], backlash, 1000 + n);
+    planner.settings.acceleration = CALIBRATION_ACC;
+    LOOP_L_N(axis, 2) {
+      const float c = calibtration.probe_center(axis);
+      CHECK(c != CAlIBRATIONING_ERR_CODE);
+      const float err = ABS(c - machine.center[axis]);
+      NOLESS(st.max_err, err);
+      st.mean_err += err / (2 * trials);
+      // calibtration_xy() returns to the calibration position for the next axis
+      motion_control.move_to_xy(x0, y0, PROBE_FAST_XY_FEEDRATE);
+    }
+    st.time_s += machine.clock_s / trials;
+    st.moves += float(machine.moves) / trials;
+  }
+  return st;
+}
+
+static void setup_axes() {
+  constexpr float steps_per_mm[] = DEFAULT_AXIS_STEPS_PER_UNIT, max_fr[] = DEFAULT_MAX_FEEDRATE;
+  constexpr uint32_t max_acc[] = DEFAULT_MAX_ACCELERATION;
+  LOOP_L_N(i, XYZ) {
+    planner.settings.axis_steps_per_mm[i] = steps_per_mm[i];
+    planner.settings.max_feedrate_mm_s[i] = max_fr[i];
+    planner.settings.max_acceleration_mm_per_s2[i] = max_acc[i];
+  }
+}
+
+TEST_CASE(sweeps_find_the_center_faster) {
+  constexpr float steps_per_mm[] = DEFAULT_AXIS_STEPS_PER_UNIT;
+  setup_axes();
+  active_extruder = 0;
+  host_synchronize = [] { machine.run(); };
+  const int trials = 20;
+  const float step = 1 / steps_per_mm[X_AXIS];
+
+  printf("XY center of a %.0f mm hole, %d targets, %.1f um steps, switch sigma %.0f um\n",
+         TARGET_RADIUS * 2, trials, step * 1000, SWITCH_SIGMA * 1000);
+  printf("  backlash | stop-start max   mean     time   moves | sweep max   mean     time   moves\n");
+  const float lash[] = { 0, 0.05f, 0.1f };
+  for (const float b : lash) {
+    const Stats ss = run(false, b, trials), sw = run(true, b, trials);
+    printf("  %4.2f mm  |  %6.1f um %6.1f um %6.2f s %5.1f  |  %6.1f um %6.1f um %6.2f s %5.1f\n", b,
+           ss.max_err * 1000, ss.mean_err * 1000, ss.time_s, ss.moves,
+           sw.max_err * 1000, sw.mean_err * 1000, sw.time_s, sw.moves);
+
+    // Backlash cancels in both, and both are good to a step
+    CHECK(ss.max_err < 1.5f * step);
+    CHECK(sw.max_err < 1.5f * step);
+    CHECK(sw.mean_err <= ss.mean_err + 0.25f * step);
+    // Crossing the hole ten times costs most of what the back-offs saved
+    CHECK(sw.time_s < ss.time_s * 0.85f);
+  }
+}
+
+#if ENABLED(SHAPER_Z_MESH)
+
+/**
+ * The sweep as it was before the travel was planned into it: lift and
+ * travel, stop, arm the sweep, then approach and probe.
+ */
+static probe_result_e probe_mesh_point_stopped(const float x, const float y, const float expect, float &touch) {
+  current_position.z = _MAX(current_position.z, expect) + PROBE_MOVE_XY_LIFTINT_DISTANCE;
+  line_to_current_position(MMM_TO_MMS(PROBE_MOVE_Z_FEEDRATE));
+  current_position.set(x, y);
+  line_to_current_position(MMM_TO_MMS(MOTION_TRAVEL_FEADRATE));
+  planner.synchronize();
+  switch_detect.start_probe_sweep(Z_AXIS);
+  current_position.z = expect + Z_MESH_PROBE_APPROACH;
+  line_to_current_position(MMM_TO_MMS(PROBE_MOVE_Z_FEEDRATE));
+  current_position.z = expect - Z_MESH_PROBE_RANGE;
+  line_to_current_position(MMM_TO_MMS(PROBE_FAST_Z_FEEDRATE / Z_PROBE_SPEED_SLOW_SCALER));
+  planner.synchronize();
+  const uint8_t state = switch_detect.sweep_state;
+  touch = switch_detect.sweep_touch_steps / planner.settings.axis_steps_per_mm[Z_AXIS];
+  switch_detect.stop_probe_sweep();
+  current_position.z = stepper.position(Z_AXIS) / planner.settings.axis_steps_per_mm[Z_AXIS];
+  return state == PROBE_SWEEP_TOUCHED ? PROBR_RESULT_SUCCESS : PROBR_RESULT_NO_TRIGGER;
+}
+
+struct MeshStats { float max_err, spread, time_s, starts; int failed; };
+
+/**
+ * Every grid point in probe_z_mesh()'s serpentine, from a first touch at
+ * the first point. The error is the touch against the bed under the nozzle.
+ */
+template<typename F>
+static MeshStats probe_mesh(F probe_point, const float backlash, const int trials) {
+  MeshStats st = { 0, 0, 0, 0, 0 };
+  for (int n = 0; n < trials; n++) {
+    const float x0 = ZMesh::gridX(0), y0 = ZMesh::gridY(0);
+    machine.reset_bed(x0, y0, Machine::bed(x0, y0) + 0.3f, backlash, 2000 + n);
+    float expect = Machine::bed(x0, y0), lo = 1e9, hi = -1e9;
+    for (uint8_t k = 0; k < Z_MESH_GRID_X * Z_MESH_GRID_Y; k++) {
+      const uint8_t j = k / Z_MESH_GRID_X, c = k % Z_MESH_GRID_X,
+                    i = (j & 1) ? Z_MESH_GRID_X - 1 - c : c;
+      float touch;
+      if (probe_point(ZMesh::gridX(i), ZMesh::gridY(j), expect, touch) != PROBR_RESULT_SUCCESS) {
+        st.failed++;
+        break;
+      }
+      expect = touch;
+      const float err = touch - Machine::bed(ZMesh::gridX(i), ZMesh::gridY(j));
+      NOLESS(st.max_err, ABS(err));
+      NOLESS(hi, err);
+      NOMORE(lo, err);
+    }
+    NOLESS(st.spread, hi - lo);
+    st.time_s += machine.clock_s / trials;
+    st.starts += float(machine.starts) / trials;
+  }
+  return st;
+}
+
+TEST_CASE(mesh_sweep_plans_the_travel_in) {
+  constexpr float steps_per_mm[] = DEFAULT_AXIS_STEPS_PER_UNIT;
+  setup_axes();
+  active_extruder = 0;
+  host_synchronize = [] { machine.run(); };
+  planner.settings.acceleration = DEFAULT_ACCELERATION;
+  const int trials = 10;
+  const float step = 1 / steps_per_mm[Z_AXIS];
+
+  printf("%dx%d Z mesh, %d runs, %.2f um steps, switch sigma %.0f um\n",
+         Z_MESH_GRID_X, Z_MESH_GRID_Y, trials, step * 1000, SWITCH_SIGMA * 1000);
+  printf("  bed     backlash | stopped at the lift: max    spread   time   starts | planned in: max    spread   time   starts\n");
+  const struct { const char *name; float tilt, warp, lash; } beds[] = {
+    { "flat  ", 0, 0, 0 }, { "warped", 0.004f, 0.15f, 0 }, { "warped", 0.004f, 0.15f, 0.02f }
+  };
+  for (const auto &b : beds) {
+    Machine::tilt = b.tilt;
+    Machine::warp = b.warp;
+    const MeshStats stopped = probe_mesh(probe_mesh_point_stopped, b.lash, trials),
+                    planned = probe_mesh([](float x, float y, float e, float &t) { return calibtration.probe_mesh_point(x, y, e, t); }, b.lash, trials);
+    printf("  %s  %4.2f mm |          %6.1f um %6.1f um %6.2f s %5.1f  |     %6.1f um %6.1f um %6.2f s %5.1f\n", b.name, b.lash,
+           stopped.max_err * 1000, stopped.spread * 1000, stopped.time_s, stopped.starts,
+           planned.max_err * 1000, planned.spread * 1000, planned.time_s, planned.starts);
+
+    // A touch at the height the bed was left is not taken for bounce, and the touches are as good
+    CHECK_EQ(stopped.failed, 0);
+    CHECK_EQ(planned.failed, 0);
+    CHECK(planned.spread < 4 * SWITCH_SIGMA + 2 * step);
+    CHECK(planned.spread <= stopped.spread + step);
+    // Backlash only shifts every touch by the same amount
+    CHECK(planned.max_err < b.lash / 2 + 4 * SWITCH_SIGMA + 2 * step);
+    // One start a point instead of two, the planner's start delay saved each time
+    CHECK_NEAR(planned.starts, Z_MESH_GRID_X * Z_MESH_GRID_Y, 0.01);
+    CHECK_NEAR(stopped.starts, 2 * Z_MESH_GRID_X * Z_MESH_GRID_Y, 0.01);
+    CHECK(planned.time_s < stopped.time_s - (Z_MESH_GRID_X * Z_MESH_GRID_Y - 1) * MOVE_START_MS / 1000.0f);
+  }
+}
+
+#endif // SHAPER_Z_MESH
@@ -0,0 +1,243 @@
+/*
+ * The command queue arena: HMI and serial lines take only their own length,
+ * and a benchmark of planner starvation on dense G-code from a host that
+ * refills the queue with some latency.
+ */
+#include <string.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <initializer_list>
+#include "test.h"
+#include "src/inc/MarlinConfig.h"
+#include "src/gcode/queue.h"
+#include "snapmaker/module/print_control.h"
+#include "snapmaker/module/power_loss.h"
+#include "snapmaker/module/system.h"
+
+typedef std::vector<std::string> lines_t;
+
+// Dense sliced G-code, mostly short extruding moves with a few longer lines
+static lines_t sliced(const int count, const uint32_t seed=1) {
+  lines_t out;
+  uint32_t r = seed;
+  char line[MAX_CMD_SIZE];
+  for (int i = 0; i < count; i++) {
+    r = r * 1103515245 + 12345;
+    const float x = 50 + (r >> 8) % 20000 / 100.0f, y = 50 + (r >> 12) % 20000 / 100.0f;
+    if (i % 17 == 16)
+      snprintf(line, sizeof(line), "G1 F2400 X%.3f Y%.3f E%.5f ; perimeter %d", x, y, 0.01234f, i);
+    else
+      snprintf(line, sizeof(line), "G1 X%.3f Y%.3f E%.5f", x, y, (r >> 4) % 5000 / 100000.0f);
+    out.push_back(line);
+  }
+  return out;
+}
+
+static void fresh() {
+  queue.clear();
+  system_service.set_status(SYSTEM_STATUE_PRINTING);
+  print_control.clear_gcode_buf();
+  power_loss.line_number_sum = power_loss.next_req = 0;
+}
+
+static void push(const lines_t &lines) {
+  std::string text;
+  for (const std::string &l : lines) text += l + "\n";
+  const uint32_t start = power_loss.next_req;
+  CHECK_EQ(print_control.push_gcode(start, start + lines.size() - 1, (uint8_t *)text.data(), text.size()), E_SUCCESS);
+}
+
+// The HMI sends more lines while the staging buffer has room
+static void refill(const lines_t &lines, size_t &sent) {
+  while (sent < lines.size() && print_control.get_buf_free() > 20 * MAX_CMD_SIZE) {
+    const size_t n = _MIN(size_t(20), lines.size() - sent);
+    push(lines_t(lines.begin() + sent, lines.begin() + sent + n));
+    sent += n;
+  }
+}
+
+static std::string pop(uint32_t *line=nullptr) {
+  GCodeQueue::RingBuffer &rb = queue.ring_buffer;
+  const std::string cmd = rb.peek_next_command_string();
+  if (line) *line = rb.peek_next_command().lines;
+  rb.advance_pos(rb.index_r, -1);
+  return cmd;
+}
+
+TEST_CASE(hmi_lines_keep_order_and_numbers) {
+  fresh();
+  // Lengths from 1 to the longest line the HMI may send
+  lines_t lines;
+  for (int i = 0; i < 300; i++) lines.push_back(std::string("M117 ") + std::string((i * 37) % (MAX_CMD_SIZE - 6), 'a' + i % 26));
+  uint32_t expect_line = 0;
+  size_t got = 0;
+  for (size_t sent = 0; got < lines.size();) {
+    refill(lines, sent);
+    queue.get_available_commands();
+    // Take a varying number so the arena wraps at every kind of offset
+    for (size_t k = got % 5 + 1; k && queue.ring_buffer.occupied(); k--) {
+      uint32_t line;
+      const std::string cmd = pop(&line);
+      CHECK(cmd == lines[got]);
+      CHECK_EQ(line, ++expect_line);
+      got++;
+    }
+  }
+  CHECK(!queue.has_commands_queued());
+}
+
+TEST_CASE(typical_moves_fill_every_slot) {
+  fresh();
+  const lines_t lines = sliced(2000);
+  size_t sent = 0, got = 0, short_fills = 0;
+  while (got < lines.size()) {
+    refill(lines, sent);
+    queue.get_available_commands();
+    if (queue.ring_buffer.length < _MIN(size_t(BUFSIZE), sent - got)) short_fills++;
+    for (size_t k = got % 3 + 1; k && queue.ring_buffer.occupied(); k--) CHECK(pop() == lines[got++]);
+  }
+  // Reserving MAX_CMD_SIZE per command, as few as 4 of these fit near a wrap
+  CHECK_EQ(short_fills, 0);
+}
+
+TEST_CASE(held_line_waits_and_clears) {
+  fresh();
+  const std::string long_line = "M117 " + std::string(MAX_CMD_SIZE - 7, 'x');
+  const lines_t lines(BUFSIZE, long_line);
+  push(lines);
+  queue.get_available_commands();
+  // The arena takes three of these, the fourth is held out of the HMI buffer
+  CHECK_EQ(queue.ring_buffer.length, CMD_ARENA_SIZE / MAX_CMD_SIZE);
+  CHECK(queue.held_hmi_line() && long_line == queue.held_hmi_line());
+  // and goes in once the command ahead of it frees a contiguous run
+  size_t got = 0;
+  for (int pass = 0; pass < 2 * BUFSIZE && got < lines.size(); pass++) {
+    queue.get_available_commands();
+    if (queue.ring_buffer.occupied() && pop() == long_line) got++;
+  }
+  CHECK_EQ(got, lines.size());
+
+  // A stopped print drops it along with the queue
+  push(lines);
+  queue.get_available_commands();
+  CHECK(queue.held_hmi_line());
+  queue.clear();
+  CHECK(!queue.held_hmi_line());
+  CHECK(!queue.has_commands_queued());
+}
+
+TEST_CASE(serial_line_held_until_it_fits) {
+  fresh();
+  system_service.set_status(SYSTEM_STATUE_IDLE);
+  const std::string long_line = "M117 " + std::string(MAX_CMD_SIZE - 7, 's');
+  std::string text;
+  for (int i = 0; i < 6; i++) text += long_line + "\n";
+  text += "G28\n";
+  Serial.clear();
+  Serial.feed((const uint8_t *)text.data(), text.size());
+  lines_t got;
+  for (int pass = 0; pass < 20 && got.size() < 7; pass++) {
+    queue.get_available_commands();
+    if (queue.ring_buffer.occupied()) got.push_back(pop());
+  }
+  CHECK_EQ(got.size(), 7);
+  if (got.size() == 7) {
+    for (int i = 0; i < 6; i++) CHECK(got[i] == long_line);
+    CHECK(got[6] == "G28");
+  }
+  CHECK(!queue.has_commands_queued());
+}
+
+/**
+ * Starvation benchmark. Each pass of the main loop queues the lines that
+ * have arrived and runs one command, which plans one block when the planner
+ * has room. The host keeps the queue topped up from the free count in each
+ * "ok" (ADVANCED_OK), and its lines arrive host_latency_us after the ok.
+ * A starvation event is the planner running out of blocks before the end.
+ */
+enum Reserve { FIXED_4_SLOTS, RESERVE_MAX, RESERVE_EXACT };
+
+struct Starvation { int events; float stalled_ms, mean_depth; };
+
+static bool store(const Reserve how, const std::string &line) {
+  GCodeQueue::RingBuffer &rb = queue.ring_buffer;
+  if (how == FIXED_4_SLOTS && rb.length >= 4) return false;
+  if (how == RESERVE_EXACT) return rb.enqueue(line.c_str(), false);
+  // The arena as first written: every command reserves MAX_CMD_SIZE
+  char * const buffer = rb.reserve_command();
+  if (!buffer) return false;
+  strcpy(buffer, line.c_str());
+  rb.commands[rb.index_w].lines = INVALID_CMD_LINE;
+  rb.commit_command(false);
+  return true;
+}
+
+static Starvation starvation(const Reserve how, const lines_t &lines, const uint32_t block_us, const uint32_t host_latency_us) {
+  const uint32_t loop_us = 200, planner_blocks = BLOCK_BUFFER_SIZE;
+  fresh();
+  std::deque<uint32_t> arrivals;        // Arrival time of each line sent
+  std::deque<uint32_t> blocks;          // End time of each planned block
+  const uint8_t depth = how == FIXED_4_SLOTS ? 4 : BUFSIZE;
+  size_t sent = 0, queued = 0, done = 0;
+  Starvation st = { 0, 0, 0 };
+  uint64_t depth_sum = 0, passes = 0;
+  uint32_t last_empty = UINT32_MAX;
+  // The host fills the queue once at the start
+  for (; sent < depth; sent++) arrivals.push_back(host_latency_us);
+
+  for (uint32_t now = 0; done < lines.size(); now += loop_us) {
+    while (!blocks.empty() && blocks.front() <= now) blocks.pop_front();
+    if (blocks.empty() && done > 0) {
+      // Count each run of empty passes once
+      if (last_empty != now - loop_us) st.events++;
+      last_empty = now;
+      st.stalled_ms += loop_us / 1000.0f;
+    }
+
+    while (!arrivals.empty() && arrivals.front() <= now && store(how, lines[queued])) {
+      arrivals.pop_front();
+      queued++;
+    }
+
+    depth_sum += queue.ring_buffer.length;
+    passes++;
+
+    if (queue.ring_buffer.occupied() && blocks.size() < planner_blocks) {
+      pop();
+      const uint32_t start = blocks.empty() ? now : blocks.back();
+      blocks.push_back(start + block_us);
+      done++;
+      // The ok tells the host how many more commands the queue takes
+      const size_t in_flight = sent - queued, space = depth - queue.ring_buffer.length;
+      for (size_t n = space > in_flight ? space - in_flight : 0; n && sent < lines.size(); n--, sent++)
+        arrivals.push_back(now + host_latency_us);
+    }
+  }
+  st.mean_depth = float(depth_sum) / passes;
+  return st;
+}
+
+TEST_CASE(planner_starvation_benchmark) {
+  // 0.2 mm segments at 150 mm/s plan one block every 1.33 ms
+  const lines_t lines = sliced(20000);
+  const uint32_t block_us = 1333;
+  printf("dense G-code, %d lines, %.2f ms blocks, BUFSIZE %d, CMD_ARENA_SIZE %d\n",
+         int(lines.size()), block_us / 1000.0f, BUFSIZE, CMD_ARENA_SIZE);
+  printf("  latency | 4 fixed slots       | arena, reserve 96   | arena, exact length\n");
+  printf("          | events stall  depth | events stall  depth | events stall  depth\n");
+  for (uint32_t latency_ms : { 2, 4, 6, 8, 10, 12 }) {
+    Starvation st[3];
+    for (int how = FIXED_4_SLOTS; how <= RESERVE_EXACT; how++)
+      st[how] = starvation(Reserve(how), lines, block_us, latency_ms * 1000);
+    printf("  %4d ms ", int(latency_ms));
+    for (const Starvation &s : st) printf("| %6d %4.0fs %5.1f ", s.events, s.stalled_ms / 1000, s.mean_depth);
+    printf("\n");
+
+    // Packing by length never does worse, and keeps up while the queue
+    // covers the round trip
+    CHECK(st[RESERVE_EXACT].stalled_ms <= st[RESERVE_MAX].stalled_ms);
+    CHECK(st[RESERVE_EXACT].stalled_ms <= st[FIXED_4_SLOTS].stalled_ms);
+    if (latency_ms * 1000 < (BUFSIZE - 1) * block_us) CHECK_EQ(st[RESERVE_EXACT].events, 0);
+  }
+}
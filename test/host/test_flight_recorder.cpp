@@ -0,0 +1,190 @@
+/*
+ * Flight recorder rings filled by the firmware's own flight_record() and
+ * printed back by decode-flight-recorder.py, from a raw memory image and
+ * from a CrashCatcher hex dump.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <string>
+#include <vector>
+#include "test.h"
+#include "snapmaker/debug/flight_recorder.h"
+
+typedef std::vector<std::string> lines_t;
+
+// Padding around the recorder, as in a dump of the whole RAM
+static const uint8_t before[] = { 0x00, 0x20, 0x00, 0x20, 0x46, 0x52, 0x45, 0xDE, 0x11, 0x22 };
+
+static void write_dump(const char *path, const bool hex) {
+  FILE *f = fopen(path, "wb");
+  std::vector<uint8_t> data(before, before + sizeof(before));
+  const uint8_t *p = (const uint8_t *)&flight_recorder;
+  data.insert(data.end(), p, p + sizeof(flight_recorder));
+  data.insert(data.end(), 7, 0xEE);
+  if (!hex) {
+    fwrite(data.data(), 1, data.size(), f);
+  }
+  else {
+    // CrashCatcher prints text lines between the hex lines
+    fprintf(f, "\r\n\r\n###CRASH###\r\n");
+    for (size_t i = 0; i < data.size(); i += 32) {
+      if (i == 64) fprintf(f, "###RANGE###\r\n");
+      for (size_t j = i; j < data.size() && j < i + 32; j++) fprintf(f, "%02X", data[j]);
+      fprintf(f, "\r\n");
+    }
+    fprintf(f, "###END###\r\n");
+  }
+  fclose(f);
+}
+
+static lines_t decode(const bool hex, int *status=nullptr) {
+  const std::string path = std::string(FLIGHT_DUMP_DIR) + (hex ? "/flight.txt" : "/flight.bin");
+  write_dump(path.c_str(), hex);
+  const std::string cmd = std::string(PYTHON3 " " DECODER " ") + (hex ? "" : "--raw ") + path;
+  FILE *p = popen(cmd.c_str(), "r");
+  lines_t out;
+  char line[256];
+  while (fgets(line, sizeof(line), p)) {
+    line[strcspn(line, "\r\n")] = 0;
+    out.push_back(line);
+  }
+  const int ret = pclose(p);
+  if (status) *status = WEXITSTATUS(ret);
+  return out;
+}
+
+static std::string row(const uint16_t time, const int delta, const char *what) {
+  char delta_str[16] = "", line[128];
+  if (delta >= 0) sprintf(delta_str, "+%d", delta);
+  sprintf(line, "  %5d %7s ms  %s", time, delta_str, what);
+  return line;
+}
+
+static bool same(const lines_t &got, const lines_t &expect) {
+  if (got == expect) return true;
+  printf("got:\n");
+  for (const std::string &s : got) printf("%s\n", s.c_str());
+  printf("expected:\n");
+  for (const std::string &s : expect) printf("%s\n", s.c_str());
+  return false;
+}
+
+static void power_on() {
+  // RAM holds garbage after power on, init must not take it for a ring
+  memset(&flight_recorder, 0xA5, sizeof(flight_recorder));
+  host_millis = 1000;
+  flight_recorder_init();
+}
+
+TEST_CASE(decodes_each_record_type) {
+  power_on();
+  host_millis = 1005;
+  flight_record(FLIGHT_RECORD_SACP, 1, 0x1234UL << 16 | 0x10 << 8 | 0x02);
+  host_millis = 1012;
+  flight_record(FLIGHT_RECORD_GCODE, 'G', 28UL << 20 | 4711);
+  flight_record_shaper(7, 5UL << 20 | 9UL << 8 | 3);
+  host_millis = 1300;
+  flight_record(FLIGHT_RECORD_ABORT, 0, 12);
+  flight_record(0x2A, 3, 0xDEADBEEF);
+  host_millis = 1301;
+  flight_record_task(5, "Marlin");
+  host_millis = 1302;
+  flight_record_task(0, "IDLE");
+
+  const lines_t expect = {
+    "boots: 1",
+    "events, oldest first:",
+    row(1000, -1, "BOOT    #1"),
+    row(1005, 5, "SACP    HMI set 0x10 id 0x02 seq 4660"),
+    row(1012, 7, "GCODE   G28 line 4711"),
+    row(1300, 288, "ABORT   moves 12"),
+    row(1300, 0, "TYPE 42 arg 3 value 0xDEADBEEF"),
+    "task switches, oldest first:",
+    row(1301, -1, "TASK    Marl prio 5"),
+    row(1302, 1, "TASK    IDLE prio 0"),
+    "shaper, oldest first:",
+    row(1012, -1, "SHAPER  blocks 7 moves 3 x 9 y 5"),
+  };
+  CHECK(same(decode(false), expect));
+  CHECK(same(decode(true), expect));
+}
+
+TEST_CASE(wrapped_ring_oldest_first) {
+  power_on();
+  // Past the end of the ring, and across the 16-bit time rolling over
+  host_millis = 65536 - 50;
+  for (uint32_t n = 0; n < FLIGHT_RECORDER_EVENTS + 10; n++) {
+    flight_record(FLIGHT_RECORD_GCODE, 'M', 400UL << 20 | n);
+    host_millis++;
+  }
+  CHECK_EQ(flight_recorder.event_head, 11);
+
+  const lines_t out = decode(true);
+  CHECK_EQ(out.size(), 4 + FLIGHT_RECORDER_EVENTS);
+  if (out.size() != 4 + FLIGHT_RECORDER_EVENTS) return;
+  // The boot record and the first ten are gone
+  CHECK(same({ out[2], out[3] }, { row(65536 - 40, -1, "GCODE   M400 line 10"), row(65536 - 39, 1, "GCODE   M400 line 11") }));
+  CHECK(same({ out[2 + 40] }, { row(0, 1, "GCODE   M400 line 50") }));
+  CHECK(same({ out[1 + FLIGHT_RECORDER_EVENTS], out[2 + FLIGHT_RECORDER_EVENTS], out.back() },
+             { row(55, 1, "GCODE   M400 line 105"), "task switches, oldest first:", "shaper, oldest first:" }));
+}
+
+TEST_CASE(shaper_records_keep_out_of_events) {
+  power_on();
+  host_millis = 1001;
+  flight_record(FLIGHT_RECORD_GCODE, 'G', 1UL << 20 | 42);
+  // A block a ms for a second, as short arc segments queue them
+  for (uint32_t n = 0; n < 1000; n++) {
+    host_millis++;
+    flight_record_shaper(n % 30, n);
+  }
+  CHECK_EQ(flight_recorder.event_head, 2);
+  CHECK_EQ(flight_recorder.shaper_head, 1000 % FLIGHT_RECORDER_SHAPER);
+
+  const lines_t out = decode(false);
+  CHECK_EQ(out.size(), 6 + FLIGHT_RECORDER_SHAPER);
+  if (out.size() != 6 + FLIGHT_RECORDER_SHAPER) return;
+  CHECK(same({ out[2], out[3], out[4], out[5] }, {
+    row(1000, -1, "BOOT    #1"),
+    row(1001, 1, "GCODE   G1 line 42"),
+    "task switches, oldest first:",
+    "shaper, oldest first:",
+  }));
+  // The last of them, oldest first
+  CHECK(same({ out[6], out.back() },
+             { row(2001 - FLIGHT_RECORDER_SHAPER + 1, -1, "SHAPER  blocks 8 moves 200 x 3 y 0"),
+               row(2001, 1, "SHAPER  blocks 9 moves 231 x 3 y 0") }));
+}
+
+TEST_CASE(ring_survives_reset) {
+  power_on();
+  host_millis = 2000;
+  flight_record(FLIGHT_RECORD_ABORT, 0, 1);
+  // A reset leaves .noinit alone, the boot count goes on
+  host_millis = 10;
+  flight_recorder_init();
+  const lines_t out = decode(false);
+  CHECK(same(out, {
+    "boots: 2",
+    "events, oldest first:",
+    row(1000, -1, "BOOT    #1"),
+    row(2000, 1000, "ABORT   moves 1"),
+    row(10, 65536 + 10 - 2000, "BOOT    #2"),
+    "task switches, oldest first:",
+    "shaper, oldest first:",
+  }));
+}
+
+TEST_CASE(corrupt_or_missing_recorder) {
+  power_on();
+  int status;
+  flight_recorder.event_head = FLIGHT_RECORDER_EVENTS;
+  CHECK(same(decode(false, &status), { "flight recorder header is corrupt" }));
+  CHECK_EQ(status, 1);
+
+  flight_recorder.magic = 0;
+  const lines_t out = decode(true, &status);
+  CHECK(out.size() == 1 && out[0].find("no flight recorder in") == 0);
+  CHECK_EQ(status, 1);
+}
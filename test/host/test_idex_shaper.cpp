@@ -0,0 +1,193 @@
+/*
+ * The X shaper of the IDEX carriages: M593 X changing each carriage from its
+ * own model, and a tool change while X moves are queued. The stepper is
+ * emulated from idle() as block_phase_isr() runs it: the shaper fills the
+ * steppers, steps are taken with getNextStepBundle() and a block retires
+ * when the steps pass its end or run out.
+ */
+#include "test.h"
+#include "src/inc/MarlinConfig.h"
+#include "src/module/planner.h"
+#include "src/module/stepper.h"
+#include "src/module/temperature.h"
+#include "src/module/AxisManager.h"
+#include "src/feature/cancel_object.h"
+#define private public    // The G-code handlers are private to GcodeSuite
+#include "src/gcode/gcode.h"
+#undef private
+#include "src/gcode/parser.h"
+#include "src/gcode/queue.h"
+#include "snapmaker/module/print_control.h"
+#include "snapmaker/module/system.h"
+
+// What planner.cpp reaches outside of the plan
+bool CancelObject::skipping;
+GCodeQueue::RingBuffer GCodeQueue::ring_buffer;
+uint8_t Temperature::fan_speed[FAN_COUNT];
+xyze_pos_t destination;
+PrintControl print_control;
+SystemService system_service;
+bool SystemService::is_working() { return false; }
+bool Stepper::is_block_busy(const block_t * const) { return false; }
+void Stepper::set_position(const xyze_long_t &) {}
+bool got_stepper_debug_info;
+xyze_pos_t stepper_cur_position;
+
+#define X_FEEDRATE  150   // mm/s
+
+// The X steps as they went out, and the X frequency the shaper had then
+static struct Stepping {
+  block_t *block;
+  step_time_t block_end;
+  int32_t x;                   // absolute, the shaper counts from every abort
+  uint32_t steps, old_steps;
+  float old_freq;
+  step_time_t last, min_interval;
+} st;
+
+static void block_phase() {
+  if (!st.block) {
+    while ((st.block = planner.get_current_block()) && st.block->shaper_data.is_zero_speed) planner.release_current_block();
+    if (!st.block) return;
+    st.block_end = AxisManager::timeToTicks(st.block->shaper_data.last_print_time);
+  }
+  AxisStepper s;
+  if (axisManager.getNextStepBundle(&s)) {
+    if (TEST(s.axis_bits, X_AXIS)) {
+      st.x += TEST(s.dir_bits, X_AXIS) ? -1 : 1;
+      if (st.steps++) NOMORE(st.min_interval, s.print_ticks - st.last);
+      st.last = s.print_ticks;
+      if (AxisInputShaper::axis_input_shaper_x.frequency == st.old_freq) st.old_steps++;
+    }
+    if (!STEP_TIME_BEFORE(s.print_ticks, st.block_end)) {
+      planner.release_current_block();
+      st.block = nullptr;
+    }
+  }
+  else if (!axisManager.step_stalled) {
+    // The steps ran out in the last block, the stepper asks for the abort
+    planner.release_current_block();
+    st.block = nullptr;
+    axisManager.req_abort = true;
+  }
+}
+
+void idle(bool) {
+  planner.shaped_loop();
+  axisManager.fillAxisSteppers();
+  for (int n = 0; n < 64; n++) block_phase();
+}
+
+static void setup() {
+  constexpr float steps_per_mm[] = DEFAULT_AXIS_STEPS_PER_UNIT, max_fr[] = DEFAULT_MAX_FEEDRATE;
+  constexpr uint32_t max_acc[] = DEFAULT_MAX_ACCELERATION;
+  LOOP_L_N(i, DISTINCT_AXES) {
+    planner.settings.axis_steps_per_mm[i] = steps_per_mm[i];
+    planner.settings.max_feedrate_mm_s[i] = max_fr[i];
+    planner.settings.max_acceleration_mm_per_s2[i] = max_acc[i];
+  }
+  planner.settings.acceleration = planner.settings.travel_acceleration = DEFAULT_ACCELERATION;
+  planner.settings.min_feedrate_mm_s = planner.settings.min_travel_feedrate_mm_s = 0;
+  planner.junction_deviation_mm = JUNCTION_DEVIATION_MM;
+  planner.refresh_positioning();
+  active_extruder = 0;
+  axisManager.input_shaper_reset();
+  axisManager.init();
+}
+
+static void m593(const char *cmd) {
+  char line[MAX_CMD_SIZE];
+  strcpy(line, cmd);
+  parser.parse(line);
+  GcodeSuite::M593();
+}
+
+static void check_x(const uint8_t tool, const int type, const float freq, const float zeta) {
+  int t; float f, z;
+  CHECK_EQ(axisManager.input_shaper_get(X_AXIS, t, f, z, tool), E_SUCCESS);
+  CHECK_EQ(t, type);
+  CHECK_NEAR(f, freq, 1e-4);
+  CHECK_NEAR(z, zeta, 1e-4);
+}
+
+TEST_CASE(m593_x_changes_each_carriage_from_its_own_model) {
+  setup();
+  const int mzv = (int)InputShaperType::mzv, zv = (int)InputShaperType::zv;
+  axisManager.input_shaper_set(X_AXIS, mzv, 40, 0.1f, 0);
+  axisManager.input_shaper_set(X_AXIS, zv, 70, 0.05f, 1);
+
+  // F alone keeps the type and damping of each carriage
+  m593("M593 X F50");
+  check_x(0, mzv, 50, 0.1f);
+  check_x(1, zv, 50, 0.05f);
+  m593("M593 X D0.2");
+  check_x(0, mzv, 50, 0.2f);
+  check_x(1, zv, 50, 0.2f);
+  // T changes only its own carriage
+  m593("M593 T1 F60");
+  check_x(0, mzv, 50, 0.2f);
+  check_x(1, zv, 60, 0.2f);
+  m593("M593 T2 F60");
+  check_x(1, zv, 60, 0.2f);
+
+  // A carriage without a model of its own keeps following T0
+  axisManager.input_shaper_set(X_AXIS, mzv, 0, 0.1f, 1);
+  m593("M593 X D0.15");
+  CHECK_NEAR(axisManager.x_shaper[1].frequency, 0, 1e-6);
+  check_x(1, mzv, 50, 0.15f);
+  // The loaded model is the active carriage's
+  CHECK_NEAR(AxisInputShaper::axis_input_shaper_x.frequency, 50, 1e-4);
+  CHECK_NEAR(AxisInputShaper::axis_input_shaper_x.zeta, 0.15f, 1e-4);
+}
+
+TEST_CASE(tool_change_switches_x_shaper_between_blocks) {
+  setup();
+  const int mzv = (int)InputShaperType::mzv;
+  axisManager.input_shaper_set(X_AXIS, mzv, 40, 0.1f, 0);
+  axisManager.input_shaper_set(X_AXIS, mzv, 65, 0.1f, 1);
+  const float steps_per_mm = planner.settings.axis_steps_per_mm[X_AXIS];
+
+  planner.clear_block_buffer();
+  xyze_pos_t p; p.reset();
+  p.x = 20; p.y = 50;
+  planner.set_position_mm(p);
+  st = Stepping();
+  st.x = LROUND(p.x * steps_per_mm);
+  st.min_interval = UINT32_MAX;
+  st.old_freq = 40;
+
+  // A zigzag queued and not yet run when the tool changes
+  for (int k = 1; k <= 11; k++) {
+    p.x = (k & 1) ? 120 : 20; p.y += 2;
+    planner.buffer_line(p, X_FEEDRATE, 0);
+  }
+  const int32_t x1 = LROUND(p.x * steps_per_mm);
+  CHECK(planner.movesplanned() > 0);
+
+  active_extruder = 1;
+  axisManager.select_x_shaper();
+
+  // Every queued block ran out on the old model before the new one was loaded
+  CHECK(!planner.has_blocks_queued());
+  CHECK_EQ(st.x, x1);
+  CHECK(st.steps > 0);
+  CHECK_EQ(st.old_steps, st.steps);
+  const uint32_t old_steps = st.steps;
+  CHECK_NEAR(AxisInputShaper::axis_input_shaper_x.frequency, 65, 1e-4);
+
+  // The next moves start where the carriage is
+  for (int k = 1; k <= 5; k++) {
+    p.x = (k & 1) ? 60 : 20; p.y += 2;
+    planner.buffer_line(p, X_FEEDRATE, 0);
+  }
+  planner.synchronize();
+  CHECK_EQ(st.x, LROUND(p.x * steps_per_mm));
+  CHECK(st.steps > old_steps);
+  CHECK_EQ(st.old_steps, old_steps);
+
+  // No burst of steps at the switch: none faster than the top speed allows
+  const float min_ticks = STEPPER_TIMER_RATE / (X_FEEDRATE * steps_per_mm);
+  printf("X steps %u, %u on the old model, shortest interval %u ticks, top speed %.0f\n",
+         st.steps, st.old_steps, st.min_interval, min_ticks);
+  CHECK(st.min_interval > min_ticks / 2);
+}
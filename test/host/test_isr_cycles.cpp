@@ -0,0 +1,142 @@
+/*
+ * Cycle-count model of the housekeeping in the stepper ISR, before and
+ * after it left the pulse path, and of a flight recorder record. Each path
+ * is written as the instructions its source compiles to at -Os and costed
+ * from the Cortex-M3 instruction timings. DEBUG_ISR_CPU_USAGE on the board
+ * gives the real total; this gives the share of it the housekeeping takes.
+ */
+#include <stdint.h>
+#include <initializer_list>
+#include "test.h"
+#include "snapmaker/debug/flight_recorder.h"
+
+#define F_CPU_MHZ 120
+
+/**
+ * Cortex-M3 TRM cycle counts, with a branch refill of 2 (flash at zero
+ * wait states). A global costs an LDR of its address from the literal pool
+ * and an LDR of the value. GPIO IDR reads go out on APB2 with one wait.
+ */
+enum Op { LDR, LDR_IO, STR, ALU, BR, BR_TAKEN, CALL, RET };
+static const uint8_t op_cycles[] = { 2, 3, 2, 1, 1, 3, 6, 6 };   // CALL: BL + PUSH {r4,lr}, RET: POP {r4,pc}
+
+static uint32_t cycles(std::initializer_list<Op> ops) {
+  uint32_t c = 0;
+  for (const Op op : ops) c += op_cycles[op];
+  return c;
+}
+
+// power_loss.check() while no loss is confirmed: the && chain ends at is_trigger
+static uint32_t power_loss_check() { return cycles({ CALL, LDR, LDR, BR_TAKEN, ALU, RET }); }
+
+// switch_detect.check(), with nothing enabled or with both probes enabled
+// and untouched: each probe reads its pin and compares it with the level
+static uint32_t switch_check(const bool probing) {
+  if (!probing) return cycles({ CALL, LDR, LDR, BR_TAKEN, RET });
+  const uint32_t probe = cycles({ ALU, BR, LDR, LDR_IO, ALU, LDR, ALU, BR, ALU, BR });
+  return cycles({ CALL, LDR, LDR, BR, STR }) + 2 * probe + cycles({ STR, BR, RET });
+}
+
+// The pause bookkeeping Stepper::isr() ran after every block phase, for an
+// XY move that is still stepping
+static uint32_t pause_inline(const bool pausing) {
+  if (!pausing) return cycles({ LDR, LDR, BR_TAKEN });
+  return cycles({ LDR, LDR, BR,
+                  LDR, ALU, BR, ALU, BR,              // axis_is_moving(X) / (Y)
+                  LDR, ALU, STR, ALU,                 // delta_t and nextMainISR
+                  ALU, BR, ALU, BR,                   // !axis_is_moving() resets
+                  LDR, ALU, BR, STR, ALU, BR, STR,    // axis_bits X / Y intervals
+                  LDR, ALU, LDR, ALU, BR });          // both above STOP_TIME_INTERVAL
+}
+
+struct Scenario { const char *name; bool probing, pausing; };
+
+static const Scenario scenarios[] = {
+  { "printing", false, false },
+  { "probing",  true,  false },
+  { "pausing",  false, true  },
+};
+
+// Each entry ran power_loss.check() in isr() and again in the pulse phase,
+// the switches in the pulse phase and the pause after the block phase
+static uint32_t before_entry(const Scenario &s) {
+  return 2 * power_loss_check() + switch_check(s.probing) + pause_inline(s.pausing);
+}
+
+// A load of is_trigger, and the pause reduced to stretching the interval
+static uint32_t after_entry(const Scenario &s) {
+  return cycles({ LDR, LDR, BR }) + (s.pausing ? cycles({ LDR, LDR, BR, LDR, ALU, STR, ALU }) : cycles({ LDR, LDR, BR_TAKEN }));
+}
+
+// Stepper::housekeeping_isr() once per Temperature::isr(), ~1 kHz
+static uint32_t housekeeping(const Scenario &s) {
+  return cycles({ CALL }) + switch_check(s.probing) + cycles({ LDR, LDR, BR_TAKEN, RET })
+         + (s.pausing ? cycles({ CALL, RET, LDR, BR, LDR, BR, CALL, RET }) : 0);
+}
+
+TEST_CASE(housekeeping_cycle_model) {
+  // ISR entries/s from the step replay: a 300 mm/s zigzag, and the 70 kHz
+  // sustainable X rate at 1.95 steps an entry
+  const uint32_t rates[] = { 13846, 35900 };
+  printf("Cortex-M3 at %d MHz, housekeeping cycles in the stepper ISR\n", F_CPU_MHZ);
+  printf("  scenario | before/entry  after/entry  +1 kHz pass | CPU at %5u/s     | CPU at %5u/s\n", rates[0], rates[1]);
+  printf("           |                                        | before    after    | before    after\n");
+  for (const Scenario &s : scenarios) {
+    const uint32_t before = before_entry(s), after = after_entry(s), hk = housekeeping(s);
+    printf("  %-8s |   %4u         %4u         %4u      ", s.name, before, after, hk);
+    for (const uint32_t rate : rates) {
+      const float b = 100.0f * before * rate / (F_CPU_MHZ * 1e6f),
+                  a = 100.0f * (after * rate + hk * 1000.0f) / (F_CPU_MHZ * 1e6f);
+      printf("| %5.2f%%   %5.2f%%   ", b, a);
+      CHECK(a < b);
+    }
+    printf("\n");
+    // The pulse path is left with a few loads and branches
+    CHECK(after < before / 3);
+  }
+}
+
+// flight_record_put() inlined with a constant ring: MRS and CPSID, the head
+// claimed, the uptime loaded and the four fields stored, MSR
+static uint32_t record_masked() {
+  return cycles({ LDR, LDR, ALU, ALU, ALU, STR,    // head: load, wrap, store
+                  ALU, LDR, LDR,                   // slot address, systick_uptime_millis
+                  STR, STR, STR, STR });           // time, type, arg, value
+}
+static uint32_t record_put() { return cycles({ ALU, ALU }) + record_masked() + cycles({ ALU }); }
+
+// The SHAPER record in Planner::shaped_loop(): the index compare, and
+// movesplanned(), both func_manager sizes and the move count packed
+static uint32_t shaper_record() {
+  const uint32_t size = cycles({ LDR, LDR, LDR, ALU, ALU });
+  return cycles({ LDR, LDR, ALU, BR }) + 4 * size + cycles({ ALU, ALU, ALU, ALU }) + record_put();
+}
+
+// traceTASK_SWITCHED_IN() in the PendSV handler: pxCurrentTCB, its priority
+// and the first word of the name, unaligned
+static uint32_t task_record() { return cycles({ LDR, LDR, LDR, ALU, LDR, ALU }) + record_put(); }
+
+TEST_CASE(flight_record_cycle_model) {
+  // Record rates: 0.9 mm arc blocks at 200 mm/s (test_arc_segments) queue
+  // 220 blocks and G-code lines a second, the FreeRTOS tick switches tasks
+  // at 1 kHz and the queues wake them about as often again
+  const float blocks = 220, lines = 220, switches = 2000;
+  const uint32_t masked = record_masked() + 1, shaper = shaper_record(), task = task_record();
+  const float cpu = 100.0f * (shaper * blocks + task * switches + record_put() * lines) / (F_CPU_MHZ * 1e6f);
+  printf("Cortex-M3 at %d MHz, flight recorder records\n", F_CPU_MHZ);
+  printf("  record %u cycles, %u masked (%.2f us), shaper %u, task switch %u\n",
+         record_put(), masked, masked / float(F_CPU_MHZ), shaper, task);
+  printf("  %.0f blocks/s, %.0f lines/s, %.0f switches/s: %.3f%% CPU\n", blocks, lines, switches, cpu);
+
+  // What the event ring holds with the shaper records in it, and in a ring of their own
+  const float shared_s = FLIGHT_RECORDER_EVENTS / (lines + blocks), own_s = FLIGHT_RECORDER_EVENTS / lines,
+              shaper_s = FLIGHT_RECORDER_SHAPER / blocks;
+  printf("  event history %.0f ms shared with the shaper, %.0f ms apart; shaper history %.0f ms\n",
+         shared_s * 1000, own_s * 1000, shaper_s * 1000);
+
+  // Interrupts masked for well under a us, the recorder costs little CPU
+  CHECK(masked < F_CPU_MHZ / 2);
+  CHECK(cpu < 0.5f);
+  // The shaper no longer halves the event history
+  CHECK(own_s >= 2 * shared_s - 1e-6f);
+}
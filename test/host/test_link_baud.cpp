@@ -0,0 +1,280 @@
+/*
+ * SACP link rate negotiation end to end: requests from a simulated HMI go
+ * through the recv task's polling, the SYS handlers and the link checks,
+ * and the answers are read back from the port. The same link times the
+ * first answer after a boot, with the driver init before the scheduler and
+ * deferred to after it.
+ */
+#include <string.h>
+#include <vector>
+#include "test.h"
+#include "snapmaker/event/event.h"
+#include "snapmaker/event/event_system.h"
+#include "snapmaker/module/system.h"
+
+static HardwareSerial &port = *event_serial[EVENT_SOURCE_HMI];
+
+struct Ack { bool got; uint8_t command_id; std::vector<uint8_t> data; };
+
+/**
+ * The HMI end of the wire. Bytes sent at a rate the UART is not set to
+ * arrive as garbage, which is all a mismatched UART makes of them.
+ */
+struct Hmi {
+  uint32_t baud = LINK_DEFAULT_BAUD;
+  uint16_t sequence = 1;
+  size_t tx_read = 0;
+  SACP_param_t rx;
+
+  void send_raw(const uint8_t *data, const uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) {
+      uint8_t ch = data[i];
+      if (baud != port.baud) ch = uint8_t(ch * 0x9D + 0x37);
+      port.feed(&ch, 1);
+    }
+  }
+  uint16_t frame(uint8_t *out, const uint8_t command_id, const uint8_t *payload, const uint16_t len) {
+    SACP_head_base_t head = { SACP_ID_CONTROLLER, SACP_ATTR_REQ, sequence++, COMMAND_SET_SYS, command_id };
+    return protocol_sacp.package(head, (uint8_t *)payload, len, out);
+  }
+  void send(const uint8_t command_id, const uint8_t *payload=nullptr, const uint16_t len=0) {
+    uint8_t buf[PACK_PACKET_MAX_SIZE];
+    send_raw(buf, frame(buf, command_id, payload, len));
+  }
+  void request_baud(const uint32_t rate, const uint16_t len=4) { send(SYS_ID_LINK_SET_BAUD, (const uint8_t *)&rate, len); }
+
+  // The next frame the printer wrote, the rate it went out at is checked
+  // through tx_at_begin
+  Ack ack() {
+    Ack a = { false, 0, {} };
+    for (; tx_read < port.tx_len && !a.got; tx_read++) {
+      uint8_t ch = port.tx[tx_read];
+      if (protocol_sacp.parse(&ch, 1, rx) == E_SUCCESS) {
+        a.got = true;
+        a.command_id = rx.sacp.command_id;
+        a.data.assign(rx.sacp.data, rx.sacp.data + rx.sacp.length - 8);
+      }
+    }
+    return a;
+  }
+};
+
+static link_info_t &link() { return event_handler.get_recv_info(EVENT_SOURCE_HMI)->link; }
+
+// The recv task runs until the port is drained, then naps as it does
+static void poll(const uint32_t ms=0) {
+  while (event_handler.recv_poll()) {}
+  for (uint32_t t = 0; t < ms; t += 5) {
+    host_millis += 5;
+    event_handler.recv_poll();
+  }
+}
+
+static void connect() {
+  port.clear();
+  port.tx_at_begin = 0;
+  memset(event_handler.get_recv_info(EVENT_SOURCE_HMI), 0, sizeof(recv_data_info_t));
+  event_handler.recv_enable(EVENT_SOURCE_HMI, true);
+  system_service.set_ready(SYSTEM_READY_ALL);
+}
+
+TEST_CASE(raise_and_confirm) {
+  connect();
+  Hmi hmi;
+  hmi.request_baud(921600);
+  poll();
+  // Acked at the rate the request came in at, then switched
+  CHECK_EQ(port.baud, 921600);
+  CHECK_EQ(port.tx_at_begin, port.tx_len);
+  const Ack a = hmi.ack();
+  CHECK(a.got && a.command_id == SYS_ID_LINK_SET_BAUD && a.data.size() == 1 && a.data[0] == E_SUCCESS);
+  CHECK_EQ(link().state, LINK_BAUD_PROBATION);
+
+  // The HMI follows, and its first frame at the new rate confirms it
+  hmi.baud = 921600;
+  poll(LINK_PROBATION_MS / 2);
+  hmi.send(SYS_ID_HEARTBEAT);
+  poll();
+  CHECK_EQ(link().state, LINK_BAUD_CONFIRMED);
+  CHECK(hmi.ack().got);
+
+  // Once confirmed an idle host keeps the rate
+  poll(3 * LINK_PROBATION_MS);
+  CHECK_EQ(port.baud, 921600);
+  CHECK_EQ(link().fallbacks, 0);
+}
+
+TEST_CASE(host_that_never_follows) {
+  connect();
+  Hmi hmi;
+  hmi.request_baud(460800);
+  poll();
+  CHECK(hmi.ack().got);
+  // The HMI missed the ack and goes on at the old rate
+  const uint32_t switched = host_millis;
+  for (int i = 0; i < 40 && port.baud != LINK_DEFAULT_BAUD; i++) {
+    hmi.send(SYS_ID_HEARTBEAT);
+    poll(50);
+  }
+  CHECK_EQ(port.baud, LINK_DEFAULT_BAUD);
+  CHECK_EQ(link().state, LINK_BAUD_DEFAULT);
+  CHECK_EQ(link().fallbacks, 1);
+  CHECK(host_millis - switched > LINK_PROBATION_MS);
+  CHECK(host_millis - switched <= LINK_PROBATION_MS + 50);
+
+  // and is understood again
+  port.rx_len = port.rx_pos = 0;
+  hmi.send(SYS_ID_HEARTBEAT);
+  poll();
+  const Ack a = hmi.ack();
+  CHECK(a.got && a.command_id == SYS_ID_HEARTBEAT);
+}
+
+TEST_CASE(noisy_link_falls_back) {
+  connect();
+  Hmi hmi;
+  hmi.request_baud(921600);
+  poll();
+  hmi.baud = 921600;
+  hmi.send(SYS_ID_HEARTBEAT);
+  poll();
+  CHECK_EQ(link().state, LINK_BAUD_CONFIRMED);
+
+  // A burst of frames with damaged headers, more than a window tolerates
+  for (int i = 0; i <= LINK_MAX_WINDOW_ERRORS; i++) {
+    uint8_t buf[PACK_PACKET_MAX_SIZE];
+    const uint16_t n = hmi.frame(buf, SYS_ID_HEARTBEAT, nullptr, 0);
+    buf[4] ^= 0x40;
+    hmi.send_raw(buf, n);
+    poll(20);
+  }
+  poll(LINK_ERROR_WINDOW_MS);
+  CHECK_EQ(port.baud, LINK_DEFAULT_BAUD);
+  CHECK_EQ(link().fallbacks, 1);
+
+  // A few errors a window are not enough
+  connect();
+  hmi = Hmi();
+  hmi.request_baud(921600);
+  poll();
+  hmi.baud = 921600;
+  for (int w = 0; w < 4; w++) {
+    for (int i = 0; i < LINK_MAX_WINDOW_ERRORS / 2; i++) {
+      uint8_t buf[PACK_PACKET_MAX_SIZE];
+      const uint16_t n = hmi.frame(buf, SYS_ID_HEARTBEAT, nullptr, 0);
+      buf[4] ^= 0x40;
+      hmi.send_raw(buf, n);
+    }
+    hmi.send(SYS_ID_HEARTBEAT);
+    poll(LINK_ERROR_WINDOW_MS + 5);
+  }
+  CHECK_EQ(port.baud, 921600);
+  CHECK_EQ(link().fallbacks, 0);
+}
+
+TEST_CASE(bad_requests_keep_the_rate) {
+  connect();
+  Hmi hmi;
+  // A full request leaves its bytes in the event cache
+  hmi.request_baud(LINK_DEFAULT_BAUD);
+  poll();
+  CHECK(hmi.ack().data == std::vector<uint8_t>{ E_SUCCESS });
+
+  // A short one must not pick up the rest of them
+  for (uint16_t len = 0; len < 4; len++) {
+    hmi.request_baud(LINK_DEFAULT_BAUD, len);
+    poll();
+    CHECK(hmi.ack().data == std::vector<uint8_t>{ E_PARAM });
+  }
+  hmi.request_baud(9600);
+  hmi.request_baud(1000000);
+  poll();
+  CHECK(hmi.ack().data == std::vector<uint8_t>{ E_PARAM });
+  CHECK(hmi.ack().data == std::vector<uint8_t>{ E_PARAM });
+  CHECK_EQ(port.baud, LINK_DEFAULT_BAUD);
+  CHECK_EQ(link().state, LINK_BAUD_DEFAULT);
+}
+
+// The boot of six TMC2209 drivers (X, X2, Y, Z, E0, E1), each written
+// 9 registers by tmc_init() over the 4 ms UART and given 200 ms to settle
+#define BOOT_SETUP_MS   150   // setup() up to the drivers, the same either way
+#define TMC_DRIVERS     6
+#define TMC_INIT_MS     (9 * 4)
+#define TMC_SETTLE_MS   200
+#define HMI_RETRY_MS    100   // the HMI repeats an unanswered heartbeat
+
+struct Boot { uint32_t scheduler, ready, first_ack, first_success; uint8_t first_result; };
+
+/**
+ * Power on with the HMI sending heartbeats until one succeeds. The port
+ * buffers them until the recv task polls it, which starts with the
+ * scheduler; the readiness flags are set when the drivers and factory data
+ * are done.
+ */
+static Boot boot(const bool deferred) {
+  connect();
+  system_service = SystemService();
+  host_millis = 0;
+  Boot b = { BOOT_SETUP_MS, 0, 0, 0, 0 };
+  if (deferred) b.ready = b.scheduler + TMC_DRIVERS * TMC_INIT_MS + TMC_SETTLE_MS;
+  else b.ready = b.scheduler += TMC_DRIVERS * (TMC_INIT_MS + TMC_SETTLE_MS);
+
+  Hmi hmi;
+  for (; host_millis < 5000 && !b.first_success; host_millis += 5) {
+    if (host_millis % HMI_RETRY_MS == 0) hmi.send(SYS_ID_HEARTBEAT);
+    if (host_millis < b.scheduler) continue;
+    if (host_millis >= b.ready) system_service.set_ready(SYSTEM_READY_ALL);
+    while (event_handler.recv_poll()) {}
+    for (Ack a = hmi.ack(); a.got; a = hmi.ack()) {
+      if (!b.first_ack) {
+        b.first_ack = host_millis;
+        b.first_result = a.data[0];
+      }
+      if (a.data[0] == E_SUCCESS && !b.first_success) b.first_success = host_millis;
+    }
+  }
+  return b;
+}
+
+TEST_CASE(boot_answers_before_the_drivers_settle) {
+  const Boot before = boot(false), after = boot(true);
+  printf("First SACP answer after power on: %u ms with the drivers before the scheduler,\n", before.first_ack);
+  printf("  %u ms (busy) deferred, heartbeat served at %u ms, ready at %u ms\n",
+         after.first_ack, after.first_success, after.ready);
+
+  // The first poll answers the heartbeats queued during setup
+  CHECK(before.first_ack < before.scheduler + 5);
+  CHECK_EQ(before.first_result, E_SUCCESS);
+  CHECK(after.first_ack < after.scheduler + 5);
+  CHECK_EQ(after.first_result, E_BUSY);
+  // and served on the next retry once the init is done
+  CHECK(after.first_success >= after.ready);
+  CHECK(after.first_success < after.ready + HMI_RETRY_MS);
+  // One settle for all drivers instead of one each
+  CHECK(after.first_ack + 1000 < before.first_ack);
+  CHECK(after.first_success + 900 < before.first_success);
+}
+
+TEST_CASE(direct_requests_wait_for_the_deferred_init) {
+  connect();
+  system_service = SystemService();
+  Hmi hmi;
+  // A handler that would change the link is not run before the init
+  hmi.request_baud(921600);
+  poll();
+  CHECK(hmi.ack().data == std::vector<uint8_t>{ E_BUSY });
+  poll(50);
+  CHECK_EQ(port.baud, LINK_DEFAULT_BAUD);
+  CHECK_EQ(link().state, LINK_BAUD_DEFAULT);
+
+  system_service.set_ready(SYSTEM_READY_DRIVERS);
+  hmi.request_baud(921600);
+  poll();
+  CHECK(hmi.ack().data == std::vector<uint8_t>{ E_BUSY });
+
+  system_service.set_ready(SYSTEM_READY_FACTORY_DATA);
+  hmi.request_baud(921600);
+  poll();
+  CHECK(hmi.ack().data == std::vector<uint8_t>{ E_SUCCESS });
+  CHECK_EQ(port.baud, 921600);
+}
@@ -0,0 +1,122 @@
+/*
+ * Hotend control against a simulated hotend: the heater block, the sensor
+ * behind it, losses to the air and to the filament. The controller is the
+ * firmware's get_pid_output_hotend(), run every MPC_dT as manage_heater()
+ * does, with PID and with MPC. The simulated hotend is not the one MPC
+ * models: its constants are off by what a tune leaves over.
+ */
+#include <stdint.h>
+#include "test.h"
+#include "src/inc/MarlinConfig.h"
+#define private public    // The controllers are private to Temperature
+#include "src/module/temperature.h"
+#undef private
+#include "src/module/planner.h"
+#include "src/module/stepper.h"
+
+#define E_STEPS_PER_MM       400.0f
+#define FILAMENT_AREA        2.405f   // mm^2 of 1.75 mm filament
+#define TARGET               210
+#define SETTLED_BAND         1.5f     // K
+
+static int32_t e_steps;
+int32_t Stepper::position_e_live() { return e_steps; }
+Stepper stepper;
+
+// The hotend. Heater power 5% below the configured one, a heavier block,
+// a slower sensor and more loss to the air than the defaults model.
+struct Hotend {
+  float power = 38.0f, capacity = 18.0f, responsiveness = 0.2f,
+        xfer_fan0 = 0.075f, xfer_fan255 = 0.11f, filament_permm = 6.0e-3f;
+  float ambient = 25.0f, block = 25.0f, sensor = 25.0f;
+  uint32_t noise = 12345;
+
+  void step(const float duty, const uint8_t fan, const float feed_mm_s, const float dt) {
+    const float xfer = xfer_fan0 + (xfer_fan255 - xfer_fan0) * fan / 255.0f + feed_mm_s * filament_permm;
+    for (uint8_t i = 0; i < 10; i++) {
+      block += (power * duty - (block - ambient) * xfer) * (dt / 10) / capacity;
+      sensor += (block - sensor) * responsiveness * (dt / 10);
+    }
+  }
+  // The sensor with ±0.25 K of ADC noise
+  float reading() {
+    noise = noise * 1103515245 + 12345;
+    return sensor + (int((noise >> 16) % 51) - 25) / 100.0f;
+  }
+};
+
+struct Response { float overshoot, settle_s, dip, recover_s; };
+
+/**
+ * Heat from cold with the fan off, then print: the fan goes to full and the
+ * filament starts flowing at once, as on the second layer.
+ */
+static Response run(const bool use_mpc, const float flow_mm3_s) {
+  // The defaults settings.reset() gives hotend 0
+  hotend_info_t &he = thermalManager.temp_hotend[0];
+  constexpr float heater_power[] = MPC_HEATER_POWER, block_heat_capacity[] = MPC_BLOCK_HEAT_CAPACITY,
+                  sensor_responsiveness[] = MPC_SENSOR_RESPONSIVENESS, ambient_xfer_coeff_fan0[] = MPC_AMBIENT_XFER_COEFF,
+                  ambient_xfer_coeff_fan255[] = MPC_AMBIENT_XFER_COEFF_FAN255,
+                  filament_heat_capacity_permm[] = FILAMENT_HEAT_CAPACITY_PERMM;
+  he.constants = { heater_power[0], block_heat_capacity[0], sensor_responsiveness[0], ambient_xfer_coeff_fan0[0],
+                   ambient_xfer_coeff_fan255[0] - ambient_xfer_coeff_fan0[0], filament_heat_capacity_permm[0] };
+  he.pid.Kp = DEFAULT_Kp;
+  he.pid.Ki = scalePID_i(DEFAULT_Ki);
+  he.pid.Kd = scalePID_d(DEFAULT_Kd);
+  he.modeled_block_temp = NAN;
+  he.use_mpc = use_mpc;
+  he.target = TARGET;
+  he.soft_pwm_amount = 0;
+  thermalManager.fan_speed[0] = 0;
+  e_steps = 0;
+
+  Hotend h;
+  Response r = { 0, 0, 0, 0 };
+  const float dt = MPC_dT, print_s = 300, end_s = 600;
+  float feed = 0, e_pos = 0;
+  for (float t = 0; t < end_s; t += dt) {
+    if (t >= print_s && !feed) {
+      feed = flow_mm3_s / FILAMENT_AREA;
+      thermalManager.fan_speed[0] = 255;
+    }
+    he.celsius = h.reading();
+    he.soft_pwm_amount = (int)Temperature::get_pid_output_hotend(0) >> 1;
+    h.step(he.soft_pwm_amount / 127.0f, thermalManager.fan_speed[0], feed, dt);
+    e_pos += feed * dt;
+    e_steps = LROUND(e_pos * E_STEPS_PER_MM);
+
+    const float err = h.sensor - TARGET;
+    if (t < print_s) {
+      NOLESS(r.overshoot, err);
+      if (ABS(err) > SETTLED_BAND) r.settle_s = t + dt;
+    }
+    else {
+      NOLESS(r.dip, -err);
+      if (ABS(err) > SETTLED_BAND) r.recover_s = t + dt - print_s;
+    }
+  }
+  return r;
+}
+
+TEST_CASE(mpc_settles_and_holds_through_flow) {
+  planner.steps_to_mm[E_AXIS] = 1.0f / E_STEPS_PER_MM;
+  planner.settings.max_feedrate_mm_s[E_AXIS] = 120;
+
+  printf("Heat to %d C, then fan on full and flow (settled within %.1f K)\n", TARGET, SETTLED_BAND);
+  printf("  flow mm3/s | PID overshoot settle  dip    recover | MPC overshoot settle  dip    recover\n");
+  const float flows[] = { 0, 5, 10, 20, 30 };
+  for (const float flow : flows) {
+    const Response pid = run(false, flow), mpc = run(true, flow);
+    printf("  %5.0f      |   %5.1f K   %5.1f s %5.1f K %5.1f s  |   %5.1f K   %5.1f s %5.1f K %5.1f s\n",
+           flow, pid.overshoot, pid.settle_s, pid.dip, pid.recover_s,
+                 mpc.overshoot, mpc.settle_s, mpc.dip, mpc.recover_s);
+
+    // From cold the model stops heating in time, without PID's overshoot
+    CHECK(mpc.overshoot < 1);
+    CHECK(mpc.settle_s < pid.settle_s);
+    // The fan and the flow are fed forward, MPC stays in the band
+    CHECK(mpc.dip < SETTLED_BAND);
+    CHECK(mpc.dip < pid.dip);
+    CHECK(mpc.recover_s <= pid.recover_s);
+  }
+}
@@ -0,0 +1,116 @@
+/*
+ * Canceled objects dropped while PrintControl reads the staged HMI gcode:
+ * which lines go, the fix-up that follows a dropped span and the line
+ * numbers the host sees.
+ */
+#include <string>
+#include <vector>
+#include "test.h"
+#include "src/inc/MarlinConfig.h"
+#include "src/feature/cancel_object.h"
+#include "snapmaker/module/print_control.h"
+#include "snapmaker/module/power_loss.h"
+#include "snapmaker/module/system.h"
+
+typedef std::vector<std::string> lines_t;
+
+static void fresh(const uint32_t canceled) {
+  system_service.set_status(SYSTEM_STATUE_PRINTING);
+  print_control.clear_gcode_buf();
+  power_loss.line_number_sum = power_loss.next_req = 0;
+  CancelObject::canceled = canceled;
+}
+
+// Stage text the way the HMI sends it, whole lines numbered from next_req
+static void push(const char *text) {
+  uint32_t count = 0;
+  for (const char *p = text; *p; p++) count += *p == '\n';
+  const uint32_t start = power_loss.next_req;
+  CHECK_EQ(print_control.push_gcode(start, start + count - 1, (uint8_t *)text, strlen(text)), E_SUCCESS);
+}
+
+static lines_t read_all(std::vector<uint32_t> *numbers=nullptr) {
+  lines_t out;
+  uint8_t cmd[MAX_CMD_SIZE];
+  uint32_t line;
+  while (print_control.get_commands(cmd, line, sizeof(cmd))) {
+    out.push_back((char *)cmd);
+    if (numbers) numbers->push_back(line);
+  }
+  return out;
+}
+
+static bool same(const lines_t &got, const lines_t &expect) {
+  if (got == expect) return true;
+  printf("got:\n");
+  for (const std::string &s : got) printf("  %s\n", s.c_str());
+  return false;
+}
+
+TEST_CASE(nothing_canceled_passes_everything) {
+  fresh(0);
+  push("M486 S0\nG1 X10 Y10 F3000\n; perimeter\nG1 X20 Y10 E1.5\nM486 S-1\n");
+  CHECK(same(read_all(), { "M486 S0", "G1 X10 Y10 F3000", "; perimeter", "G1 X20 Y10 E1.5", "M486 S-1" }));
+}
+
+TEST_CASE(canceled_moves_are_dropped) {
+  fresh(_BV(1));
+  push("M486 S0\nG1 X10 Y10 E1.5\nM486 S1\nG1 X30 Y30 E2.25\n; infill\nG0 X40 Y40\nM486 S0\nG1 X12 Y12 E3\n");
+  // The fix-up follows the marker that ends the span
+  CHECK(same(read_all(), { "M486 S0", "G1 X10 Y10 E1.5", "M486 S1", "M486 S0", "G92 E2.25000", "G1 X12 Y12 E3" }));
+}
+
+TEST_CASE(fixup_restores_z_and_feedrate) {
+  fresh(_BV(2));
+  push("M486 S2\nG1 Z0.4 F600\nG1 X5 Y5 F1800 E0.5\nM486 S-1\n");
+  CHECK(same(read_all(), { "M486 S2", "M486 S-1", "G92 E0.50000", "G1 Z0.400 F1800.0" }));
+
+  fresh(_BV(2));
+  push("M486 S2\nG1 X5 Y5 F2400\nM486 S-1\n");
+  CHECK(same(read_all(), { "M486 S2", "M486 S-1", "G1 F2400.0" }));
+
+  fresh(_BV(2));
+  push("M486 S2\nG0 Z1.2\nM486 S-1\n");
+  CHECK(same(read_all(), { "M486 S2", "M486 S-1", "G1 Z1.200" }));
+
+  // A span with only travel leaves nothing to fix up
+  fresh(_BV(2));
+  push("M486 S2\nG0 X5 Y5\nG0 X6 Y6\nM486 S-1\n");
+  CHECK(same(read_all(), { "M486 S2", "M486 S-1" }));
+}
+
+TEST_CASE(other_commands_are_kept) {
+  fresh(_BV(0));
+  push("M486 S0\nM106 S255\nG92 E0\nG1 X1 E1.2\nG10\nG92.1\nG28 X\nM486 S-1\n");
+  CHECK(same(read_all(), { "M486 S0", "M106 S255", "G92 E0", "G10", "G92.1", "G28 X", "M486 S-1", "G92 E1.20000" }));
+}
+
+TEST_CASE(words_after_a_comment_are_ignored) {
+  fresh(_BV(0));
+  push("M486 S0\nG1 X1 E0.7 ; Z9 F9\nM486 S-1\n");
+  CHECK(same(read_all(), { "M486 S0", "M486 S-1", "G92 E0.70000" }));
+}
+
+TEST_CASE(relative_moves_go_through) {
+  // Under G91 the lines can't be dropped without losing position
+  fresh(_BV(3));
+  push("G91\nM486 S3\nG1 X1 E0.1\nG90\nM486 S-1\n");
+  CHECK(same(read_all(), { "G91", "M486 S3", "G1 X1 E0.1", "G90", "M486 S-1" }));
+
+  // G91 in a dropped span ends it, the fix-up goes before it
+  fresh(_BV(3));
+  push("M486 S3\nG1 X1 E0.3\nG91\nG1 X1\nG90\nM486 S-1\n");
+  CHECK(same(read_all(), { "M486 S3", "G92 E0.30000", "G91", "G1 X1", "G90", "M486 S-1" }));
+}
+
+TEST_CASE(dropped_lines_keep_line_numbers) {
+  fresh(_BV(1));
+  push("M486 S1\nG1 X1 E1\n\nG1 X2 E2\nM486 S-1\nM400\n");
+  std::vector<uint32_t> numbers;
+  CHECK(same(read_all(&numbers), { "M486 S1", "M486 S-1", "G92 E2.00000", "M400" }));
+  // The fix-up reports the line of the marker it follows
+  const uint32_t expect[] = { 1, 5, 5, 6 };
+  CHECK_EQ(numbers.size(), 4);
+  for (uint8_t i = 0; i < 4 && i < numbers.size(); i++) CHECK_EQ(numbers[i], expect[i]);
+  CHECK_EQ(power_loss.line_number_sum, 6);
+}
@@ -0,0 +1,167 @@
+/*
+ * Planner::recalculate() fed through buffer_line() as G-code would. After
+ * every block the plan of the blocks not yet handed to the shaper is checked
+ * against the optimal one, computed from scratch here: every junction as
+ * fast as its limit and the blocks around it allow, ending at
+ * MINIMUM_PLANNER_SPEED. The kernel calls per block are measured against
+ * the blocks after the planned one, which bounds the reverse pass.
+ */
+#include <math.h>
+#include "test.h"
+#include "src/inc/MarlinConfig.h"
+#define private public    // The plan pointers are private to Planner
+#include "src/module/planner.h"
+#undef private
+#include "src/module/stepper.h"
+#include "src/module/temperature.h"
+#include "src/module/AxisManager.h"
+#include "src/feature/cancel_object.h"
+#include "src/gcode/queue.h"
+#include "snapmaker/module/print_control.h"
+#include "snapmaker/module/system.h"
+
+// What planner.cpp reaches outside of the plan
+bool CancelObject::skipping;
+GCodeQueue::RingBuffer GCodeQueue::ring_buffer;
+uint8_t Temperature::fan_speed[FAN_COUNT];
+xyze_pos_t destination;
+PrintControl print_control;
+SystemService system_service;
+bool SystemService::is_working() { return false; }
+bool Stepper::is_block_busy(const block_t * const) { return false; }
+void Stepper::set_position(const xyze_long_t &) {}
+
+// Blocks up to the planned one are handed to the shaper; their plan is final
+static uint32_t full_reverse;
+static void hand_over_tail() {
+  if (planner.block_buffer_tail == planner.block_buffer_planned)
+    planner.block_buffer_planned = Planner::next_block_index(planner.block_buffer_planned);
+  planner.block_buffer_tail = Planner::next_block_index(planner.block_buffer_tail);
+}
+void idle(bool) { hand_over_tail(); }
+
+/**
+ * The optimal entry speeds of the blocks after the planned one, which
+ * keeps its own: the lowest of each junction's limit, what the block before
+ * can reach accelerating and what the block after can reach braking.
+ */
+static bool plan_is_optimal(float &worst) {
+  const uint8_t first = planner.block_buffer_planned, head = planner.block_buffer_head;
+  const uint8_t n = BLOCK_MOD(head - first);
+  if (n < 2) return true;
+  float v2[BLOCK_BUFFER_SIZE + 1];
+  const block_t *b[BLOCK_BUFFER_SIZE];
+  LOOP_L_N(k, n) b[k] = &planner.block_buffer[BLOCK_MOD(first + k)];
+  v2[0] = b[0]->entry_speed_sqr;
+  for (uint8_t k = 1; k < n; k++) v2[k] = b[k]->max_entry_speed_sqr;
+  v2[n] = sq(float(MINIMUM_PLANNER_SPEED));
+  for (int k = n - 1; k >= 1; k--) NOMORE(v2[k], v2[k + 1] + 2 * b[k]->acceleration * b[k]->millimeters);
+  for (uint8_t k = 1; k < n; k++) NOMORE(v2[k], v2[k - 1] + 2 * b[k - 1]->acceleration * b[k - 1]->millimeters);
+
+  bool ok = true;
+  for (uint8_t k = 1; k < n; k++) {
+    const float err = ABS(b[k]->entry_speed_sqr - v2[k]) / _MAX(v2[k], 1.0f);
+    NOLESS(worst, err);
+    if (err > 1e-4f) ok = false;
+    // The trapezoid was built on the entry speeds at both ends
+    if (TEST(b[k - 1]->flag, BLOCK_BIT_RECALCULATE)) ok = false;
+    if (ABS(sq(b[k - 1]->final_speed) - b[k]->entry_speed_sqr) > 1e-3f * _MAX(b[k]->entry_speed_sqr, 1.0f)) ok = false;
+  }
+  return ok;
+}
+
+struct Counts { float reverse, forward, trapezoid, full_reverse, worst; int bad; };
+
+// Queue points, keeping queued the blocks the shaper would still hold back
+template<typename F>
+static Counts run(const int blocks, F point, const float fr_mm_s, const uint8_t keep) {
+  planner.clear_block_buffer();
+  xyze_pos_t p = point(0);
+  planner.set_position_mm(p);
+  memset(axisManager.counts, 0, sizeof(axisManager.counts));
+  full_reverse = 0;
+
+  Counts c = { 0, 0, 0, 0, 0, 0 };
+  for (int i = 1; i <= blocks; i++) {
+    while (planner.movesplanned() >= keep) hand_over_tail();
+    // The reverse pass can't go back further than the planned block
+    full_reverse += BLOCK_MOD(planner.block_buffer_head - planner.block_buffer_planned);
+    p = point(i);
+    planner.buffer_line(p, fr_mm_s, 0);
+    if (!plan_is_optimal(c.worst)) c.bad++;
+  }
+  const float n = axisManager.counts[SHAPER_DBG_PLAN_BLOCKS];
+  c.reverse = axisManager.counts[SHAPER_DBG_PLAN_REVERSE] / n;
+  c.forward = axisManager.counts[SHAPER_DBG_PLAN_FORWARD] / n;
+  c.trapezoid = axisManager.counts[SHAPER_DBG_PLAN_TRAPEZOID] / n;
+  c.full_reverse = full_reverse / n;
+  return c;
+}
+
+static void report(const char *name, const Counts &c) {
+  printf("  %-26s | %5.2f    %5.2f    %5.2f      | %5.2f          | %.1e     %d\n",
+         name, c.reverse, c.forward, c.trapezoid, c.full_reverse, c.worst, c.bad);
+}
+
+TEST_CASE(replan_is_optimal_and_bounded) {
+  constexpr float steps_per_mm[] = DEFAULT_AXIS_STEPS_PER_UNIT, max_fr[] = DEFAULT_MAX_FEEDRATE;
+  constexpr uint32_t max_acc[] = DEFAULT_MAX_ACCELERATION;
+  LOOP_L_N(i, DISTINCT_AXES) {
+    planner.settings.axis_steps_per_mm[i] = steps_per_mm[i];
+    planner.settings.max_feedrate_mm_s[i] = max_fr[i];
+    planner.settings.max_acceleration_mm_per_s2[i] = max_acc[i];
+  }
+  planner.settings.acceleration = planner.settings.travel_acceleration = DEFAULT_ACCELERATION;
+  planner.settings.min_feedrate_mm_s = planner.settings.min_travel_feedrate_mm_s = 0;
+  planner.junction_deviation_mm = JUNCTION_DEVIATION_MM;
+  planner.refresh_positioning();
+
+  printf("Kernel calls per queued block, %d blocks queued\n", BLOCK_BUFFER_SIZE - 2);
+  printf("  path                       | reverse  forward  trapezoid  | full reverse   | worst error  not optimal\n");
+
+  // Short segments of a large circle, cruising
+  const Counts arc = run(2000, [](int i) {
+    xyze_pos_t p; p.reset();
+    p.x = 150 + 100 * cosf(i * 0.005f); p.y = 150 + 100 * sinf(i * 0.005f);
+    return p;
+  }, 150, BLOCK_BUFFER_SIZE - 2);
+  report("0.5 mm arc segments", arc);
+
+  // Sharp corners, every block starts and ends slow
+  const Counts zigzag = run(2000, [](int i) {
+    xyze_pos_t p; p.reset();
+    p.x = 100 + (i & 1) * 20; p.y = 100 + i * 0.4f;
+    return p;
+  }, 150, BLOCK_BUFFER_SIZE - 2);
+  report("20 mm zigzag", zigzag);
+
+  // Lengths from 0.1 to 10 mm at changing angles
+  const Counts mixed = run(2000, [](int i) {
+    static float x, y, a;
+    static uint32_t seed;
+    if (!i) { x = y = 150; a = 0; seed = 1; }
+    else {
+      seed = seed * 1103515245 + 12345;
+      const float len = 0.1f + (seed >> 16) % 1000 / 100.0f;
+      a += ((seed >> 8) % 90 - 45) * float(M_PI) / 180;
+      x = constrain(x + len * cosf(a), 10, 290);
+      y = constrain(y + len * sinf(a), 10, 290);
+    }
+    xyze_pos_t p; p.reset(); p.x = x; p.y = y;
+    return p;
+  }, 200, BLOCK_BUFFER_SIZE - 2);
+  report("0.1-10 mm at random angles", mixed);
+
+  // Every plan is the optimal one
+  CHECK_EQ(arc.bad, 0);
+  CHECK_EQ(zigzag.bad, 0);
+  CHECK_EQ(mixed.bad, 0);
+  // The planned pointer keeps a cruise from going back over the whole queue,
+  // and the trapezoids are rebuilt only where the forward pass went
+  const Counts paths[] = { arc, zigzag, mixed };
+  for (const Counts &c : paths) {
+    CHECK(c.reverse <= c.full_reverse + 0.01f);
+    CHECK(c.trapezoid <= c.forward + 0.01f);
+    CHECK(c.reverse < (BLOCK_BUFFER_SIZE - 2) / 4);
+  }
+}
@@ -0,0 +1,177 @@
+/*
+ * SACP framing: ProtocolSACP::package() output parsed back one byte at a
+ * time, as event.cpp feeds it, and the link counters for damaged input.
+ */
+#include <string.h>
+#include <initializer_list>
+#include "test.h"
+#include "snapmaker/protocol/protocol_sacp.h"
+
+static uint16_t make_frame(uint8_t *out, uint16_t sequence, const uint16_t payload_len,
+                           uint8_t attr=SACP_ATTR_REQ, uint8_t fill=0x5A) {
+  static uint8_t payload[PACK_PACKET_MAX_SIZE];
+  for (uint16_t i = 0; i < payload_len; i++) payload[i] = uint8_t(fill + i);
+  SACP_head_base_t head = { SACP_ID_HMI, attr, sequence, 0x10, 0x02 };
+  return protocol_sacp.package(head, payload, payload_len, out);
+}
+
+struct Feed {
+  int frames = 0, errors = 0;
+  ErrCode last = E_IN_PROGRESS;
+};
+
+static Feed feed(SACP_param_t &p, const uint8_t *data, const uint16_t len) {
+  Feed f;
+  for (uint16_t i = 0; i < len; i++) {
+    uint8_t ch = data[i];
+    f.last = protocol_sacp.parse(&ch, 1, p);
+    if (f.last == E_SUCCESS) f.frames++;
+    else if (f.last != E_IN_PROGRESS) f.errors++;
+  }
+  return f;
+}
+
+static void reset(SACP_param_t &p) { memset(&p, 0, sizeof(p)); }
+
+TEST_CASE(round_trip) {
+  static SACP_param_t p;
+  for (uint16_t payload_len : { 0, 1, 2, 7, 100 }) {
+    reset(p);
+    uint8_t frame[PACK_PACKET_MAX_SIZE];
+    const uint16_t n = make_frame(frame, 0x1234, payload_len);
+    CHECK_EQ(n, SACP_HEADER_LEN + payload_len);
+
+    const Feed head = feed(p, frame, n - 1);
+    CHECK_EQ(head.frames, 0);
+    CHECK_EQ(head.last, E_IN_PROGRESS);
+    const Feed tail = feed(p, frame + n - 1, 1);
+    CHECK_EQ(tail.last, E_SUCCESS);
+
+    CHECK_EQ(p.sacp.length, payload_len + 8);
+    CHECK_EQ(p.sacp.recever_id, SACP_ID_HMI);
+    CHECK_EQ(p.sacp.sender_id, SACP_ID_CONTROLLER);
+    CHECK_EQ(p.sacp.sequence, 0x1234);
+    CHECK_EQ(p.sacp.command_set, 0x10);
+    CHECK_EQ(p.sacp.command_id, 0x02);
+    CHECK(memcmp(p.sacp.data, frame + sizeof(SACP_struct_t), payload_len) == 0);
+    CHECK_EQ(p.stats.frames, 1);
+    CHECK_EQ(p.stats.resyncs, 0);
+  }
+}
+
+TEST_CASE(largest_frame_fits) {
+  static SACP_param_t p;
+  reset(p);
+  uint8_t frame[PACK_PACKET_MAX_SIZE];
+  const uint16_t n = make_frame(frame, 1, PACK_PARSE_MAX_SIZE - SACP_HEADER_LEN);
+  CHECK_EQ(n, PACK_PARSE_MAX_SIZE);
+  CHECK_EQ(feed(p, frame, n).frames, 1);
+  CHECK_EQ(p.stats.overflows, 0);
+}
+
+TEST_CASE(oversized_frame_is_dropped) {
+  static SACP_param_t p;
+  reset(p);
+  uint8_t frame[PACK_PACKET_MAX_SIZE], good[64];
+  const uint16_t n = make_frame(frame, 1, PACK_PARSE_MAX_SIZE - SACP_HEADER_LEN + 1, SACP_ATTR_REQ, 0x11);
+  CHECK_EQ(feed(p, frame, n).frames, 0);
+  CHECK_EQ(p.stats.overflows, 1);
+  // The payload holds no SOF pair, so the next frame is found right away
+  const uint16_t m = make_frame(good, 2, 4);
+  CHECK_EQ(feed(p, good, m).frames, 1);
+  CHECK_EQ(p.sacp.sequence, 2);
+}
+
+TEST_CASE(noise_before_frame) {
+  static SACP_param_t p;
+  reset(p);
+  const uint8_t noise[] = { 0x00, 0x55, 0xAA, 0x00, 0xAA, 0xAA, 0x13 };
+  uint8_t frame[64];
+  const uint16_t n = make_frame(frame, 7, 3);
+  CHECK_EQ(feed(p, noise, sizeof(noise)).frames, 0);
+  CHECK_EQ(feed(p, frame, n).frames, 1);
+  CHECK_EQ(p.sacp.sequence, 7);
+  CHECK_EQ(p.stats.resyncs, 3);
+  CHECK_EQ(p.stats.header_crc_err + p.stats.checksum_err, 0);
+}
+
+TEST_CASE(stray_sof_right_before_frame) {
+  static SACP_param_t p;
+  reset(p);
+  uint8_t stream[64] = { SACP_PDU_SOF_H };
+  const uint16_t n = 1 + make_frame(stream + 1, 8, 5);
+  CHECK_EQ(feed(p, stream, n).frames, 1);
+  CHECK_EQ(p.sacp.sequence, 8);
+  CHECK_EQ(p.stats.resyncs, 1);
+}
+
+TEST_CASE(header_crc_error) {
+  static SACP_param_t p;
+  reset(p);
+  uint8_t frame[64];
+  const uint16_t n = make_frame(frame, 3, 4, SACP_ATTR_REQ, 0x20);
+  frame[6] ^= 0x01;
+  CHECK_EQ(feed(p, frame, n).frames, 0);
+  CHECK_EQ(p.stats.header_crc_err, 1);
+  frame[6] ^= 0x01;
+  CHECK_EQ(feed(p, frame, n).frames, 1);
+}
+
+TEST_CASE(payload_checksum_error) {
+  static SACP_param_t p;
+  reset(p);
+  uint8_t frame[64];
+  const uint16_t n = make_frame(frame, 4, 6, SACP_ATTR_REQ, 0x20);
+  frame[sizeof(SACP_struct_t) + 2] ^= 0x40;
+  const Feed f = feed(p, frame, n);
+  CHECK_EQ(f.frames, 0);
+  CHECK_EQ(f.last, E_PARAM);
+  CHECK_EQ(p.stats.checksum_err, 1);
+  CHECK_EQ(p.stats.frames, 0);
+}
+
+TEST_CASE(truncated_frame_then_next) {
+  // A frame cut short swallows the start of the next one, which is then lost too
+  static SACP_param_t p;
+  reset(p);
+  uint8_t a[64], b[64], c[64];
+  const uint16_t na = make_frame(a, 1, 10, SACP_ATTR_REQ, 0x20),
+                 nb = make_frame(b, 2, 10, SACP_ATTR_REQ, 0x20),
+                 nc = make_frame(c, 3, 10, SACP_ATTR_REQ, 0x20);
+  CHECK_EQ(feed(p, a, na - 3).frames, 0);
+  CHECK_EQ(feed(p, b, nb).frames, 0);
+  CHECK_EQ(feed(p, c, nc).frames, 1);
+  CHECK_EQ(p.sacp.sequence, 3);
+  CHECK_EQ(p.stats.checksum_err, 1);
+}
+
+TEST_CASE(retransmits_counted_for_requests) {
+  static SACP_param_t p;
+  reset(p);
+  uint8_t frame[64];
+  uint16_t n = make_frame(frame, 9, 2);
+  CHECK_EQ(feed(p, frame, n).frames, 1);
+  CHECK_EQ(feed(p, frame, n).frames, 1);
+  CHECK_EQ(p.stats.retransmits, 1);
+
+  // ACKs do not carry the request sequence
+  n = make_frame(frame, 9, 2, SACP_ATTR_ACK);
+  CHECK_EQ(feed(p, frame, n).frames, 1);
+  CHECK_EQ(p.stats.retransmits, 1);
+
+  n = make_frame(frame, 10, 2);
+  CHECK_EQ(feed(p, frame, n).frames, 1);
+  CHECK_EQ(p.stats.retransmits, 1);
+  CHECK_EQ(p.stats.frames, 4);
+}
+
+TEST_CASE(back_to_back_frames) {
+  static SACP_param_t p;
+  reset(p);
+  uint8_t stream[PACK_PACKET_MAX_SIZE];
+  uint16_t n = 0;
+  for (uint16_t s = 0; s < 8; s++) n += make_frame(stream + n, s, s * 3);
+  CHECK_EQ(feed(p, stream, n).frames, 8);
+  CHECK_EQ(p.stats.resyncs, 0);
+  CHECK_EQ(p.sacp.sequence, 7);
+}
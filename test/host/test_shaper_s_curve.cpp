@@ -0,0 +1,199 @@
+/*
+ * MoveQueue::calculateMoves() with SHAPER_S_CURVE, the moves replayed
+ * through the X and Y functions to steps. Every block is built twice: with
+ * room in the move ring, and with the ring nearly full, where it stays
+ * trapezoidal as in the firmware. The profiles are compared on the largest
+ * acceleration step, the print time and the step times.
+ */
+#include <vector>
+#include <initializer_list>
+#include "test.h"
+#include "src/inc/MarlinConfig.h"
+#include "src/module/planner.h"
+#include "src/module/AxisManager.h"
+#include "src/module/shaper/MoveQueue.h"
+
+#define XY_STEPS  80.0f
+
+static block_t blocks[600];
+static int block_count;
+
+/**
+ * Blocks between points at speed v, planned as the planner would: a
+ * junction at most corner (mm/s) where the path turns, every entry reachable
+ * braking from the one after and accelerating from the one before.
+ */
+static void plan(const std::vector<xy_pos_t> &pts, const float v, const float corner, const float accel) {
+  block_count = pts.size() - 1;
+  float entry[COUNT(blocks) + 1];
+  entry[0] = entry[block_count] = 0;
+  for (int k = 0; k < block_count; k++) {
+    block_t &b = blocks[k];
+    const xy_pos_t d = pts[k + 1] - pts[k];
+    b.millimeters = d.magnitude();
+    b.axis_r.set(d.x * XY_STEPS / b.millimeters, d.y * XY_STEPS / b.millimeters, 0, 0);
+    b.acceleration = accel;
+    b.cruise_speed = v;
+    b.shaper_data.start_steps[0] = b.shaper_data.start_steps[1] = 0;
+    if (k) {
+      const xy_pos_t p = pts[k] - pts[k - 1];
+      const float turn = (p.x * d.x + p.y * d.y) / (p.magnitude() * b.millimeters);
+      entry[k] = turn > 0.9998f ? v : corner;
+    }
+  }
+  for (int k = block_count - 1; k > 0; k--) NOMORE(entry[k], SQRT(sq(entry[k + 1]) + 2 * accel * blocks[k].millimeters));
+  for (int k = 1; k < block_count; k++) NOMORE(entry[k], SQRT(sq(entry[k - 1]) + 2 * accel * blocks[k - 1].millimeters));
+  for (int k = 0; k < block_count; k++) {
+    blocks[k].initial_speed = entry[k];
+    blocks[k].final_speed = entry[k + 1];
+  }
+}
+
+struct Profile {
+  float time_ms, peak_acc, max_jump;  // mm/s^2
+  int split;
+  int32_t end_err;                    // steps
+  double step_err_us;
+};
+
+// Axis position in steps of a move t ms after its start
+static double move_pos(const Move &m, const uint8_t i, const double t) {
+  return m.start_pos[i] + m.axis_r[i] * (m.start_v * t + 0.5 * m.accelerate * t * t);
+}
+
+/**
+ * The steps of one axis against the moves: a step to k goes out where the
+ * position crosses k - 0.5 going up, k + 0.5 going down. Returns the largest
+ * difference to the exact crossing time.
+ */
+static double step_error_us(const std::vector<Move> &moves, const uint8_t i, int32_t &end_steps) {
+  Axis ax;
+  ax.init(i, XY_STEPS);
+  double err = 0;
+  size_t fed = 0, cursor = 0;
+  int32_t pos = 0;
+  for (;;) {
+    while (fed < moves.size() && ax.func_manager.getFreeSize() >= 3) {
+      Move m = moves[fed++];
+      ax.generateLineFuncParams(&m);
+    }
+    bool stepped = false;
+    for (int n = 0; n < 64 && ax.getNextStep(); n++) {
+      stepped = true;
+      pos += ax.dir;
+      const double cross = pos - 0.5 * ax.dir;
+      // The move that passes the crossing in the direction of the step
+      while (cursor < moves.size()) {
+        const Move &m = moves[cursor];
+        const double lo = _MIN(m.start_pos[i], m.end_pos[i]) - 1e-3, hi = _MAX(m.start_pos[i], m.end_pos[i]) + 1e-3;
+        if (m.axis_r[i] * ax.dir > 0 && WITHIN(cross, lo, hi)) break;
+        cursor++;
+      }
+      if (cursor == moves.size()) return 1e9;
+      Move m = moves[cursor];
+      double t0 = 0, t1 = m.t;
+      for (int it = 0; it < 60; it++) {
+        const double t = 0.5 * (t0 + t1);
+        ((move_pos(m, i, t) - cross) * ax.dir < 0 ? t0 : t1) = t;
+      }
+      NOLESS(err, ABS(ax.print_time.toDouble() - (m.start_t.toDouble() + t0)) * 1000);
+    }
+    if (!stepped && fed == moves.size()) break;
+  }
+  end_steps = pos;
+  return err;
+}
+
+static Profile run(const bool ring_full) {
+  Profile p = { 0, 0, 0, 0, 0, 0 };
+  std::vector<Move> moves;
+  moveQueue.reset();
+  float last_acc = 0;
+  for (int k = 0; k < block_count; k++) {
+    block_t b = blocks[k];
+    // Room for fewer moves than a split block needs, or for all of them
+    moveQueue.move_tail = ring_full ? MOVE_MOD(moveQueue.move_head + MOVE_S_CURVE_BLOCK_MOVES) : moveQueue.move_head;
+    moveQueue.calculateMoves(&b);
+    int n = 0;
+    for (uint8_t i = b.shaper_data.move_start; i != moveQueue.move_head; i = moveQueue.nextMoveIndex(i), n++) {
+      const Move &m = moveQueue.moves[i];
+      moves.push_back(m);
+      const float acc = m.accelerate * 1e6f;
+      NOLESS(p.peak_acc, ABS(acc));
+      NOLESS(p.max_jump, ABS(acc - last_acc));
+      last_acc = acc;
+    }
+    if (n > 3) p.split++;
+    p.time_ms += b.shaper_data.block_time;
+  }
+  NOLESS(p.max_jump, ABS(last_acc));
+
+  // Both axes end on the last point, every step on time
+  LOOP_L_N(i, 2) {
+    int32_t end = 0;
+    NOLESS(p.step_err_us, step_error_us(moves, i, end));
+    NOLESS(p.end_err, ABS(end - int32_t(LROUND(moves.back().end_pos[i]))));
+  }
+  return p;
+}
+
+static void report(const char *name, const Profile &t, const Profile &s) {
+  printf("  %-22s | %6.0f %6.0f %8.1f | %6.0f %6.0f %8.1f  %3d/%-3d | %.2f / %.2f us\n", name,
+         t.peak_acc, t.max_jump, t.time_ms, s.peak_acc, s.max_jump, s.time_ms, s.split, block_count,
+         t.step_err_us, s.step_err_us);
+}
+
+TEST_CASE(s_curve_keeps_peak_and_steps) {
+  const float accel = 5000;
+  printf("%d steps per ramp, peak ratio %.3f, planned acceleration %.0f mm/s^2\n",
+         SHAPER_S_CURVE_SEGMENTS, float(SHAPER_S_CURVE_PEAK_RATIO), accel);
+  printf("  path                   | trapezoid: peak   step   time ms | s-curve: peak   step   time ms  split   | step error\n");
+
+  // Separate moves from and to a stop
+  std::vector<xy_pos_t> pts;
+  const float lengths[] = { 3, 10, 40, 150 };
+  xy_pos_t at = { 20, 20 };
+  pts.push_back(at);
+  for (const float l : lengths) {
+    at.x += l; pts.push_back(at);
+    at.y += 5; pts.push_back(at);
+  }
+  plan(pts, 250, 0, accel);
+  const Profile stops_t = run(true), stops_s = run(false);
+  report("moves from stops", stops_t, stops_s);
+
+  // A 20 mm zigzag, slowing for every corner
+  pts.clear();
+  for (int k = 0; k <= 40; k++) pts.push_back({ 20 + 20.0f * (k & 1), 20 + 2.0f * k });
+  plan(pts, 200, 10, accel);
+  const Profile zigzag_t = run(true), zigzag_s = run(false);
+  report("20 mm zigzag", zigzag_t, zigzag_s);
+
+  // 0.5 mm segments along a line, speeding up to 150 mm/s and braking at the full rate
+  pts.clear();
+  for (int k = 0; k <= 500; k++) pts.push_back({ 20 + 0.5f * k, 20.0f + (k & 1) * 0.05f });
+  plan(pts, 150, 150, accel);
+  const Profile chain_t = run(true), chain_s = run(false);
+  report("0.5 mm segments", chain_t, chain_s);
+
+  for (const Profile *p : { &stops_t, &stops_s, &zigzag_t, &zigzag_s, &chain_t, &chain_s }) {
+    // Never above the planned acceleration, every step where the moves put it
+    CHECK(p->peak_acc <= accel * 1.001f);
+    CHECK_EQ(p->end_err, 0);
+    CHECK(p->step_err_us < 5);
+  }
+  // Splitting the ramps costs the float step times nothing that matters
+  CHECK(zigzag_s.step_err_us < zigzag_t.step_err_us + 1);
+  // The full ring keeps the planned trapezoids
+  CHECK_EQ(stops_t.split, 0);
+  CHECK_NEAR(stops_t.peak_acc, accel, 1);
+  // The acceleration steps are cut to about half, for under 15% of time
+  CHECK_EQ(stops_s.split, 8);
+  CHECK(stops_s.max_jump < 0.6f * stops_t.max_jump);
+  CHECK(zigzag_s.max_jump < 0.6f * zigzag_t.max_jump);
+  CHECK(stops_s.time_ms < stops_t.time_ms * 1.15f);
+  CHECK(zigzag_s.time_ms < zigzag_t.time_ms * 1.15f);
+  // Blocks ramping at the planned rate can't be split, and keep their time
+  CHECK_EQ(chain_s.split, 0);
+  CHECK_NEAR(chain_s.time_ms, chain_t.time_ms, 0.5);
+}
@@ -0,0 +1,157 @@
+/*
+ * AxisInputShaper::calcSmoothing() against Klipper's estimate: the same
+ * pulse trains (shaper_defs.py), _get_shaper_smoothing() and the bisection
+ * find_shaper_max_accel() uses, in double precision.
+ */
+#include <initializer_list>
+#include "test.h"
+#include "src/inc/MarlinConfig.h"
+#include "src/module/shaper/AxisInputShaper.h"
+
+struct Pulses {
+  double A[5], T[5];
+  int n;
+};
+
+static Pulses reference_pulses(InputShaperType type, double f, double zeta) {
+  const double v_tol = 1. / SHAPER_VIBRATION_REDUCTION,
+               df = sqrt(1. - zeta * zeta),
+               K = exp(-zeta * M_PI / df),
+               t_d = 1. / (f * df);
+  Pulses p;
+  switch (type) {
+    case InputShaperType::zv:
+      p = { { 1, K }, { 0, .5 * t_d }, 2 };
+      break;
+    case InputShaperType::zvd:
+      p = { { 1, 2 * K, K * K }, { 0, .5 * t_d, t_d }, 3 };
+      break;
+    case InputShaperType::zvdd:
+      p = { { 1, 3 * K, 3 * K * K, K * K * K }, { 0, .5 * t_d, t_d, 1.5 * t_d }, 4 };
+      break;
+    case InputShaperType::zvddd:
+      p = { { 1, 4 * K, 6 * K * K, 4 * K * K * K, K * K * K * K }, { 0, .5 * t_d, t_d, 1.5 * t_d, 2 * t_d }, 5 };
+      break;
+    case InputShaperType::mzv: {
+      const double k = exp(-.75 * zeta * M_PI / df), a1 = 1. - 1. / sqrt(2.);
+      p = { { a1, (sqrt(2.) - 1.) * k, a1 * k * k }, { 0, .375 * t_d, .75 * t_d }, 3 };
+    } break;
+    case InputShaperType::ei: {
+      const double a1 = .25 * (1. + v_tol);
+      p = { { a1, .5 * (1. - v_tol) * K, a1 * K * K }, { 0, .5 * t_d, t_d }, 3 };
+    } break;
+    case InputShaperType::ei2: {
+      const double V2 = v_tol * v_tol,
+                   X = pow(V2 * (sqrt(1. - V2) + 1.), 1. / 3.),
+                   a1 = (3. * X * X + 2. * X + 3. * V2) / (16. * X),
+                   a2 = (.5 - a1) * K;
+      p = { { a1, a2, a2 * K, a1 * K * K * K }, { 0, .5 * t_d, t_d, 1.5 * t_d }, 4 };
+    } break;
+    case InputShaperType::ei3: {
+      const double K2 = K * K,
+                   a1 = .0625 * (1. + 3. * v_tol + 2. * sqrt(2. * (v_tol + 1.) * v_tol)),
+                   a2 = .25 * (1. - v_tol) * K;
+      p = { { a1, a2, (.5 * (1. + v_tol) - 2. * a1) * K2, a2 * K2, a1 * K2 * K2 },
+            { 0, .5 * t_d, t_d, 1.5 * t_d, 2 * t_d }, 5 };
+    } break;
+    default:
+      p = { { 1 }, { 0 }, 1 };
+      break;
+  }
+  return p;
+}
+
+// Klipper's _get_shaper_smoothing()
+static double reference_smoothing(const Pulses &p, double accel, double scv) {
+  const double half_accel = accel * .5;
+  double sum_a = 0, ts = 0;
+  for (int i = 0; i < p.n; i++) { sum_a += p.A[i]; ts += p.A[i] * p.T[i]; }
+  ts /= sum_a;
+  double offset_90 = 0, offset_180 = 0;
+  for (int i = 0; i < p.n; i++) {
+    if (p.T[i] >= ts)
+      offset_90 += p.A[i] * (scv + half_accel * (p.T[i] - ts)) * (p.T[i] - ts);
+    offset_180 += p.A[i] * half_accel * (p.T[i] - ts) * (p.T[i] - ts);
+  }
+  return fmax(offset_90 * sqrt(2.) / sum_a, offset_180 / sum_a);
+}
+
+// Klipper's find_shaper_max_accel() with its _bisect()
+static double reference_max_accel(const Pulses &p) {
+  auto ok = [&](double accel) {
+    return reference_smoothing(p, accel, SHAPER_SMOOTHING_SCV) <= SHAPER_TARGET_SMOOTHING;
+  };
+  double left = 1., right = 1.;
+  if (!ok(1e-9)) return 0;
+  while (!ok(left)) { right = left; left *= .5; }
+  if (right == left) while (ok(right)) right *= 2.;
+  while (right - left > 1e-8) {
+    const double middle = (left + right) * .5;
+    if (ok(middle)) left = middle; else right = middle;
+  }
+  return left;
+}
+
+static const InputShaperType shaped_types[] = {
+  InputShaperType::ei, InputShaperType::ei2, InputShaperType::ei3, InputShaperType::mzv,
+  InputShaperType::zv, InputShaperType::zvd, InputShaperType::zvdd, InputShaperType::zvddd
+};
+
+TEST_CASE(smoothing_matches_klipper) {
+  for (InputShaperType type : shaped_types)
+    for (float f : { 20.f, 35.f, 50.f, 72.5f, 100.f, 150.f })
+      for (float zeta : { 0.f, .1f, .2f }) {
+        AxisInputShaper shaper;
+        shaper.setConfig(int(type), f, zeta);
+        shaper.init();
+        const Pulses p = reference_pulses(type, f, zeta);
+        const double expect = reference_smoothing(p, SHAPER_SMOOTHING_ACCEL, SHAPER_SMOOTHING_SCV);
+        CHECK_NEAR(shaper.smoothing, expect, expect * 1e-4 + 1e-6);
+      }
+}
+
+TEST_CASE(max_accel_matches_klipper_bisection) {
+  for (InputShaperType type : shaped_types)
+    for (float f : { 20.f, 35.f, 50.f, 72.5f, 100.f, 150.f })
+      for (float zeta : { 0.f, .1f, .2f }) {
+        AxisInputShaper shaper;
+        shaper.setConfig(int(type), f, zeta);
+        shaper.init();
+        const double expect = fmax(reference_max_accel(reference_pulses(type, f, zeta)), SHAPER_MIN_ACCEL);
+        CHECK_NEAR(shaper.max_accel, expect, expect * 1e-4);
+      }
+}
+
+TEST_CASE(max_accel_keeps_target_smoothing) {
+  for (InputShaperType type : shaped_types) {
+    AxisInputShaper shaper;
+    shaper.setConfig(int(type), 40, .1);
+    shaper.init();
+    const Pulses p = reference_pulses(type, 40, .1);
+    if (shaper.max_accel > SHAPER_MIN_ACCEL)
+      CHECK(reference_smoothing(p, shaper.max_accel, SHAPER_SMOOTHING_SCV) <= SHAPER_TARGET_SMOOTHING * (1 + 1e-4));
+    else
+      CHECK(reference_smoothing(p, SHAPER_MIN_ACCEL, SHAPER_SMOOTHING_SCV) >= SHAPER_TARGET_SMOOTHING);
+  }
+}
+
+TEST_CASE(higher_frequency_allows_more_accel) {
+  for (InputShaperType type : shaped_types) {
+    float last = 0;
+    for (float f : { 30.f, 45.f, 60.f, 90.f }) {
+      AxisInputShaper shaper;
+      shaper.setConfig(int(type), f, .1);
+      shaper.init();
+      CHECK(shaper.max_accel >= last);
+      last = shaper.max_accel;
+    }
+  }
+}
+
+TEST_CASE(unshaped_has_no_limit) {
+  AxisInputShaper shaper;
+  shaper.setConfig(int(InputShaperType::none), 50, .1);
+  shaper.init();
+  CHECK_EQ(shaper.max_accel, 0);
+  CHECK_NEAR(shaper.smoothing, 0, 1e-9);
+}
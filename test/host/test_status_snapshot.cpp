@@ -0,0 +1,270 @@
+/*
+ * Status snapshot: the records decoded from the snapshot frames match the
+ * reports sent one by one, and the link bytes per second of both ways of
+ * subscribing to them while printing and while idle.
+ */
+#include <string.h>
+#include <map>
+#include <vector>
+#include "test.h"
+#include "snapmaker/event/subscribe.h"
+#include "snapmaker/event/event_system.h"
+#include "snapmaker/event/event_fdm.h"
+#include "snapmaker/event/event_printer.h"
+#include "snapmaker/event/event_enclouser.h"
+#include "snapmaker/module/fdm.h"
+
+static HardwareSerial &port = *event_serial[EVENT_SOURCE_HMI];
+
+/**
+ * The reports a snapshot folds in, with the payloads of the firmware's own
+ * handlers. Two hotends, the active one printing, the work time counting.
+ */
+struct Printer {
+  bool printing = true;
+  uint32_t seconds = 0, noise = 1;
+  float temp[2] = { 210, 170 };
+
+  int reading(const uint8_t e) {
+    if (!printing) return FLOAT_TO_INT(25.0f);
+    noise = noise * 1103515245 + 12345;
+    return FLOAT_TO_INT(temp[e] + ((noise >> 16) % 101 - 50) / 100.0f);
+  }
+  void extruder_info(const uint8_t e, extruder_info_t *info) {
+    memset(info, 0, sizeof(*info));
+    info->index = e;
+    info->is_available = true;
+    info->diameter = FLOAT_TO_INT(0.4f);
+    info->cur_temp = reading(e);
+    info->target_temp = printing ? FLOAT_TO_INT(temp[e]) : 0;
+  }
+} printer;
+
+static ErrCode extruder_info(event_param_t &event) {
+  for (uint8_t e = 0; e < 2; e++) {
+    event.data[0] = E_SUCCESS;
+    event.data[1] = e;
+    event.data[2] = 1;
+    printer.extruder_info(e, (extruder_info_t *)(event.data + 3));
+    event.length = sizeof(extruder_info_t) + 3;
+    send_event(event);
+  }
+  return E_SUCCESS;
+}
+
+static ErrCode extrusion_status(event_param_t &event) {
+  event.data[0] = E_SUCCESS;
+  event.data[1] = 2;
+  memset(event.data + 2, 0, 2 * sizeof(extruder_move_status_t));
+  event.length = 2 * sizeof(extruder_move_status_t) + 2;
+  return send_event(event);
+}
+
+static ErrCode fan_info(event_param_t &event) {
+  for (uint8_t e = 0; e < 2; e++) {
+    event.data[0] = E_SUCCESS;
+    event.data[1] = e;
+    event.data[2] = 1;
+    extruder_fan_info_t *info = (extruder_fan_info_t *)(event.data + 3);
+    info->index = 0;
+    info->type = FAN_TYPE_COLD_MODULE;
+    info->speed = printer.printing && e == 0 ? 255 : 0;
+    event.length = sizeof(extruder_fan_info_t) + 3;
+    send_event(event);
+  }
+  return E_SUCCESS;
+}
+
+static ErrCode module_info(event_param_t &event) {
+  for (uint8_t e = 0; e < 2; e++) {
+    event.data[0] = E_SUCCESS;
+    FDM_info *info = (FDM_info *)(event.data + 1);
+    memset(info, 0, sizeof(*info));
+    info->key = e;
+    info->head_active = e == 0;
+    info->extruder_count = 1;
+    printer.extruder_info(e, &info->extruder_info);
+    info->fan_count = 1;
+    event.length = sizeof(FDM_info) + 1;
+    send_event(event);
+  }
+  return E_SUCCESS;
+}
+
+static ErrCode short_report(event_param_t &event, const uint16_t length, const uint32_t value) {
+  memset(event.data, 0, length);
+  memcpy(event.data + 1, &value, _MIN(length - 1, 4));
+  event.length = length;
+  return send_event(event);
+}
+static ErrCode work_percentage(event_param_t &event) { return short_report(event, 4, 100); }
+static ErrCode print_mode(event_param_t &event) { return short_report(event, 2, 0); }
+static ErrCode work_time(event_param_t &event) { return short_report(event, 5, printer.seconds); }
+static ErrCode enclosure_info(event_param_t &event) { return short_report(event, 3, 0x6400); }
+
+static ErrCode flow_percentage(event_param_t &event) {
+  for (uint8_t e = 0; e < 2; e++) short_report(event, 5, e | 1 << 8 | 100 << 16);
+  return E_SUCCESS;
+}
+
+static event_cb_info_t reports[] = {
+  { FDM_ID_SUBSCRIBE_MODULE_INFO, EVENT_CB_DIRECT_RUN, module_info },
+  { FDM_ID_SUBSCRIBE_EXTRUDER_INFO, EVENT_CB_DIRECT_RUN, extruder_info },
+  { FDM_ID_SUBSCRIBE_FAN_INFO, EVENT_CB_DIRECT_RUN, fan_info },
+  { FDM_ID_SUBSCRIBE_EXTRUSION_STATUS, EVENT_CB_DIRECT_RUN, extrusion_status },
+  { PRINTER_ID_SUBSCRIBE_WORK_PERCENTAGE, EVENT_CB_DIRECT_RUN, work_percentage },
+  { PRINTER_ID_SUBSCRIBE_FLOW_PERCENTAGE, EVENT_CB_DIRECT_RUN, flow_percentage },
+  { PRINTER_ID_SUBSCRIBE_WORK_TIME, EVENT_CB_DIRECT_RUN, work_time },
+  { PRINTER_ID_SUBSCRIBE_PRINT_MODE, EVENT_CB_DIRECT_RUN, print_mode },
+  { ENCLOUSER_ID_SUBSCRIBE_INFO, EVENT_CB_DIRECT_RUN, enclosure_info },
+};
+static const uint8_t report_sets[] = {
+  COMMAND_SET_FDM, COMMAND_SET_FDM, COMMAND_SET_FDM, COMMAND_SET_FDM,
+  COMMAND_SET_PRINTER, COMMAND_SET_PRINTER, COMMAND_SET_PRINTER, COMMAND_SET_PRINTER,
+  COMMAND_SET_ENCLOUSER,
+};
+
+static event_cb_info_t snapshot_info = { SYS_ID_SUBSCRIBE_STATUS_SNAPSHOT, EVENT_CB_DIRECT_RUN,
+  [](event_param_t &event) { return subscribe.status_snapshot(event); } };
+
+event_cb_info_t *get_event_info(uint8_t cmd_set, uint8_t cmd_id) {
+  if (cmd_set == COMMAND_SET_SYS && cmd_id == SYS_ID_SUBSCRIBE_STATUS_SNAPSHOT) return &snapshot_info;
+  for (uint8_t i = 0; i < COUNT(reports); i++)
+    if (report_sets[i] == cmd_set && reports[i].command_id == cmd_id) return &reports[i];
+  return NULL;
+}
+
+// (cmd_set, cmd_id) and, for the reports sent once per hotend, the hotend
+// they name in their second byte
+typedef std::pair<uint16_t, int> record_key_t;
+typedef std::map<record_key_t, std::vector<uint8_t>> records_t;
+
+static record_key_t record_key(const uint8_t cmd_set, const uint8_t cmd_id, const uint8_t *data) {
+  const bool per_hotend = cmd_set == COMMAND_SET_FDM ? cmd_id != FDM_ID_SUBSCRIBE_EXTRUSION_STATUS
+                                                     : cmd_id == PRINTER_ID_SUBSCRIBE_FLOW_PERCENTAGE;
+  return record_key_t(cmd_set << 8 | cmd_id, per_hotend ? data[1] : -1);
+}
+
+static event_param_t param;
+
+static void prepare(const uint8_t cmd_set, const uint8_t cmd_id) {
+  param.info = { SACP_ID_HMI, SACP_ATTR_ACK, 1, cmd_set, cmd_id };
+  param.source = EVENT_SOURCE_HMI;
+  param.length = 0;
+}
+
+static std::vector<SACP_struct_t *> frames_sent(std::vector<std::vector<uint8_t>> &store) {
+  static SACP_param_t rx;
+  std::vector<SACP_struct_t *> out;
+  memset(&rx, 0, sizeof(rx));
+  for (size_t i = 0; i < port.tx_len; i++) {
+    uint8_t ch = port.tx[i];
+    if (protocol_sacp.parse(&ch, 1, rx) == E_SUCCESS) {
+      store.push_back(std::vector<uint8_t>(rx.buff, rx.buff + sizeof(rx.buff)));
+      out.push_back((SACP_struct_t *)store.back().data());
+    }
+  }
+  return out;
+}
+
+// Every report subscribed on its own, one interval
+static records_t send_reports(size_t *bytes) {
+  port.clear();
+  for (uint8_t i = 0; i < COUNT(reports); i++) {
+    prepare(report_sets[i], reports[i].command_id);
+    reports[i].cb(param);
+  }
+  *bytes = port.tx_len;
+  std::vector<std::vector<uint8_t>> store;
+  store.reserve(64);
+  records_t out;
+  for (SACP_struct_t *f : frames_sent(store))
+    out[record_key(f->command_set, f->command_id, f->data)].assign(f->data, f->data + f->length - 8);
+  return out;
+}
+
+// The snapshot subscription, one interval, records folded into what the
+// HMI already holds
+static void send_snapshot(records_t &held, size_t *bytes, int *frames, bool *keyframe) {
+  port.clear();
+  prepare(COMMAND_SET_SYS, SYS_ID_SUBSCRIBE_STATUS_SNAPSHOT);
+  CHECK_EQ(subscribe.status_snapshot(param), E_SUCCESS);
+  *bytes = port.tx_len;
+  std::vector<std::vector<uint8_t>> store;
+  store.reserve(16);
+  const std::vector<SACP_struct_t *> fs = frames_sent(store);
+  *frames = fs.size();
+  *keyframe = false;
+  for (SACP_struct_t *f : fs) {
+    CHECK_EQ(f->data[0], E_SUCCESS);
+    *keyframe |= (f->data[1] & 1) != 0;
+    for (uint16_t at = 2; at < f->length - 8;) {
+      const uint8_t *rec = f->data + at;
+      const uint16_t length = rec[2] | rec[3] << 8;
+      held[record_key(rec[0], rec[1], rec + 4)].assign(rec + 4, rec + 4 + length);
+      at += 4 + length;
+    }
+  }
+}
+
+static void restart(const bool printing) {
+  printer = Printer();
+  printer.printing = printing;
+  // Subscribing starts the snapshot over with a keyframe
+  prepare(COMMAND_SET_SYS, SYS_ID_SUBSCRIBE);
+  const uint8_t req[] = { COMMAND_SET_SYS, SYS_ID_SUBSCRIBE_STATUS_SNAPSHOT, 0xE8, 0x03 };
+  memcpy(param.data, req, sizeof(req));
+  param.length = sizeof(req);
+  CHECK_EQ(subscribe.enable(param), E_SUCCESS);
+}
+
+TEST_CASE(snapshot_carries_every_report) {
+  subscribe_init();
+  port.enable_sacp(true);
+  restart(true);
+  records_t held;
+  for (int s = 0; s < 2 * SNAPSHOT_KEYFRAME_INTERVAL + 3; s++, printer.seconds++) {
+    // Both read the printer at the same moment
+    const Printer now = printer;
+    size_t bytes;
+    int frames;
+    bool keyframe;
+    send_snapshot(held, &bytes, &frames, &keyframe);
+    printer = now;
+    const records_t reports = send_reports(&bytes);
+    CHECK_EQ(keyframe, s % SNAPSHOT_KEYFRAME_INTERVAL == 0);
+    CHECK(held == reports);
+    CHECK_EQ(frames, 1);
+  }
+}
+
+TEST_CASE(link_bytes_per_second) {
+  // The HMI subscribes to each report at 1 s, or to the snapshot at 1 s
+  const int seconds = 300;
+  printf("status reporting, 2 hotends, 1 s interval, %d s\n", seconds);
+  printf("           | reports one by one  | snapshot\n");
+  printf("           | frames  bytes/s     | frames  bytes/s  keyframe bytes\n");
+  for (const bool printing : { true, false }) {
+    restart(printing);
+    size_t report_bytes = 0, snapshot_bytes = 0, key_bytes = 0, report_frames = 0;
+    int snapshot_frames = 0;
+    records_t held;
+    for (int s = 0; s < seconds; s++, printer.seconds += printing) {
+      const Printer now = printer;
+      size_t bytes;
+      int frames;
+      bool keyframe;
+      send_snapshot(held, &bytes, &frames, &keyframe);
+      snapshot_bytes += bytes;
+      snapshot_frames += frames;
+      if (keyframe) key_bytes = bytes;
+      printer = now;
+      report_frames += send_reports(&bytes).size();
+      report_bytes += bytes;
+    }
+    const float report_bps = float(report_bytes) / seconds, snapshot_bps = float(snapshot_bytes) / seconds;
+    printf("  %-8s | %6.1f  %7.1f     | %6.1f  %7.1f  %5d\n", printing ? "printing" : "idle",
+           float(report_frames) / seconds, report_bps, float(snapshot_frames) / seconds, snapshot_bps, int(key_bytes));
+    CHECK(snapshot_bps < report_bps / 2);
+  }
+}
@@ -0,0 +1,576 @@
+/*
+ * Step generation replayed on a simulated timeline: the producer,
+ * fillAxisSteppers(), runs from a main loop of a given period, and the
+ * stepper ISR takes its steps with getNextStepBundle() at the times it asks
+ * for, as block_phase_isr() does. Checks the positions reached and measures
+ * the step rate the producer sustains and how well the steps compress.
+ */
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <initializer_list>
+#include "test.h"
+#include "src/inc/MarlinConfig.h"
+#include "src/module/AxisManager.h"
+
+static const float steps_per_mm[AXIS_SIZE] = { 80, 80, 400, 138.58f };
+
+#define TICKS_TO_US(T)  ((T) * 1e6 / STEPPER_TIMER_RATE)
+#define US_TO_TICKS(U)  uint32_t((U) * 1e-6 * STEPPER_TIMER_RATE)
+
+/**
+ * Moves as the planner hands them to the axes: positions in steps, time in
+ * ms, speed and acceleration along the path in mm/ms and mm/ms^2, with
+ * axis_r the steps per path mm of each axis.
+ */
+struct Path {
+  std::vector<Move> moves;
+  time_double_t end_t = 0;
+  float pos[AXIS_SIZE] = { 0 };  // mm
+
+  void add(const float *from, const float *to, const float s0, const float s1,
+           const float len, const float v0, const float acc, const float t) {
+    Move m;
+    memset(m.start_pos, 0, sizeof(m.start_pos));
+    memset(m.end_pos, 0, sizeof(m.end_pos));
+    memset(m.axis_r, 0, sizeof(m.axis_r));
+    for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+      const float d = (to[i] - from[i]) * steps_per_mm[i];
+      m.start_pos[i] = from[i] * steps_per_mm[i] + d * s0 / len;
+      m.end_pos[i] = from[i] * steps_per_mm[i] + d * s1 / len;
+      m.axis_r[i] = d / len;
+    }
+    m.start_pos_e = m.start_pos[E_AXIS];
+    m.end_pos_e = m.end_pos[E_AXIS];
+    m.distance = s1 - s0;
+    m.start_v = v0;
+    m.accelerate = acc;
+    m.t = t;
+    m.end_v = v0 + acc * t;
+    m.start_t = end_t;
+    end_t += t;
+    m.end_t = end_t;
+    moves.push_back(m);
+  }
+
+  // A trapezoid from v0 through v to v1 (mm/s, mm/s^2), v is lowered if the
+  // segment is too short to reach it
+  void line(const std::initializer_list<float> to_mm, const float v0, float v, const float v1, const float accel) {
+    float to[AXIS_SIZE];
+    std::copy(to_mm.begin(), to_mm.end(), to);
+    float len = 0;
+    for (uint8_t i = 0; i < E_AXIS; i++) len += sq(to[i] - pos[i]);
+    len = SQRT(len);
+    if (len < 0.001f) len = ABS(to[E_AXIS] - pos[E_AXIS]);
+    const float a = accel * 1e-6f;
+    float va = v0 * 1e-3f, vc = v * 1e-3f, vb = v1 * 1e-3f,
+          d_acc = (sq(vc) - sq(va)) / (2 * a), d_dec = (sq(vc) - sq(vb)) / (2 * a);
+    if (d_acc + d_dec > len) {
+      vc = SQRT((2 * a * len + sq(va) + sq(vb)) / 2);
+      d_acc = (sq(vc) - sq(va)) / (2 * a);
+      d_dec = (sq(vc) - sq(vb)) / (2 * a);
+    }
+    if (d_acc > 0.0001f) add(pos, to, 0, d_acc, len, va, a, (vc - va) / a);
+    if (len - d_acc - d_dec > 0.0001f) add(pos, to, d_acc, len - d_dec, len, vc, 0, (len - d_acc - d_dec) / vc);
+    if (d_dec > 0.0001f) add(pos, to, len - d_dec, len, len, vc, -a, (vc - vb) / a);
+    std::copy(to, to + AXIS_SIZE, pos);
+  }
+};
+
+static size_t fed;
+
+static void start(const Path &path) {
+  axisManager.req_abort = false;
+  for (uint8_t i = 0; i < AXIS_SIZE; i++) axisManager.axis[i].init(i, steps_per_mm[i]);
+  axisManager.reset();
+  axisManager.reset_debug_info();
+  fed = 0;
+}
+
+// The planner side: moves go to the functions of every axis while they have room
+static void feed(const Path &path) {
+  for (; fed < path.moves.size(); fed++) {
+    for (uint8_t i = 0; i < AXIS_SIZE; i++)
+      if (axisManager.axis[i].func_manager.getFreeSize() < 3) return;
+    Move m = path.moves[fed];
+    for (uint8_t i = 0; i < E_AXIS; i++) axisManager.axis[i].generateLineFuncParams(&m);
+    // generateEAxisFuncParams() without the advance
+    const double a = 0.5 * m.accelerate * m.axis_r[E_AXIS], dy = m.end_pos_e - m.start_pos_e;
+    axisManager.axis[E_AXIS].func_manager.addFuncParamsExtend(a, dy / m.t - a * m.t, m.start_pos_e,
+      IS_ZERO(dy) ? 0 : dy > 0 ? 1 : -1, m.end_t, m.end_pos_e);
+  }
+}
+
+static bool all_done(const Path &path) {
+  if (fed < path.moves.size()) return false;
+  for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+    FuncManager &fm = axisManager.axis[i].func_manager;
+    if (fm.func_params_use != fm.func_params_head || !axisManager.axis[i].is_consumed
+        || axisManager.pending_count[i] || axisManager.step_state[i].count
+        || axisManager.step_move_tail[i] != axisManager.step_move_head[i]) return false;
+  }
+  return true;
+}
+
+struct Timeline {
+  uint32_t loop_us;  // main loop period
+  uint32_t hiccup_us, hiccup_every;  // every hiccup_every passes one takes hiccup_us longer
+};
+
+static const Timeline every_ms = { 1000, 0, 1 };
+
+// A step as the ISR times it, and its direction
+struct Step {
+  step_time_t time;
+  int8_t dir;
+};
+typedef std::vector<Step> steps_t;
+
+struct Replay {
+  uint32_t steps[AXIS_SIZE];
+  uint32_t isr_entries, bundles, stalls, underruns, max_late;
+  step_time_t end;
+  steps_t record[AXIS_SIZE];
+};
+
+typedef std::chrono::steady_clock host_clock;
+
+static double elapsed_ns(const host_clock::time_point &t0) {
+  return std::chrono::duration<double, std::nano>(host_clock::now() - t0).count();
+}
+
+/**
+ * The ISR outputs the bundle it took last time, then takes the next one and
+ * sets the timer delta_ticks after the current ISR, so a stall moves every
+ * later step. max_late is how far behind its own time a step went out.
+ */
+static Replay replay(const Path &path, const Timeline &tl, const bool record=false) {
+  Replay r = Replay();
+  start(path);
+  step_time_t now = 0, next_fill = 0, next_isr = 0;
+  uint32_t passes = 0;
+  bool pending = false;
+  AxisStepper st;
+
+  for (;;) {
+    if (!STEP_TIME_BEFORE(next_isr, next_fill)) {
+      now = next_fill;
+      feed(path);
+      axisManager.fillAxisSteppers();
+      next_fill += US_TO_TICKS(tl.loop_us);
+      if (tl.hiccup_us && ++passes % tl.hiccup_every == 0) next_fill += US_TO_TICKS(tl.hiccup_us);
+      continue;
+    }
+
+    now = next_isr;
+    r.isr_entries++;
+    if (pending) {
+      for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+        if (!TEST(st.axis_bits, i)) continue;
+        r.steps[i]++;
+        if (record) r.record[i].push_back({ st.print_ticks, int8_t(TEST(st.dir_bits, i) ? -1 : 1) });
+      }
+      NOLESS(r.max_late, (uint32_t)(now - st.print_ticks));
+      r.end = now;
+    }
+    pending = axisManager.getNextStepBundle(&st);
+    if (pending && st.delta_ticks > 20 * STEPPER_TIMER_TICKS_PER_US) axisManager.topUpAxisSteppers();
+
+    if (pending) {
+      r.bundles++;
+      next_isr = now + st.delta_ticks;
+    }
+    else if (axisManager.step_stalled) {
+      r.stalls++;
+      next_isr = now + AXIS_STEPPER_STALL_TICKS;
+    }
+    else if (all_done(path)) {
+      break;
+    }
+    else {
+      next_isr = now + STEPPER_TIMER_TICKS_PER_MS;
+    }
+  }
+  r.underruns = axisManager.counts[SHAPER_DBG_STEP_UNDERRUN];
+  return r;
+}
+
+// Zigzags at 45 degrees, XY and E stepping together
+static Path zigzag(const float speed, const float accel, const int count=4, const float len=150) {
+  Path path;
+  for (int k = 0; k < count; k++) {
+    const float d = (k & 1) ? 0 : len * 0.7071f;
+    path.line({ d, d, 0.2f, path.pos[E_AXIS] + len * 0.033f }, 0, speed, 0, accel);
+  }
+  return path;
+}
+
+static int32_t target_steps(const Path &path, const uint8_t i) {
+  return LROUND(path.pos[i] * steps_per_mm[i]);
+}
+
+TEST_CASE(replay_reaches_every_target) {
+  // Short segments, reversals and a Z hop
+  Path path;
+  const float speed = 250, accel = 8000;
+  for (int k = 0; k < 60; k++) {
+    const float x = 20 + 15 * sinf(k * 0.7f), y = 30 + 12 * cosf(k * 1.1f);
+    path.line({ x, y, 0.2f, path.pos[E_AXIS] + 0.05f }, 20, speed, 20, accel);
+  }
+  path.line({ path.pos[X_AXIS], path.pos[Y_AXIS], 0.6f, path.pos[E_AXIS] - 0.8f }, 0, 40, 0, 2000);
+  path.line({ 5, 5, 0.6f, path.pos[E_AXIS] }, 0, speed, 0, accel);
+
+  const Replay r = replay(path, every_ms);
+  for (uint8_t i = 0; i < AXIS_SIZE; i++) CHECK_EQ(axisManager.current_steps[i], target_steps(path, i));
+  CHECK_EQ(r.underruns, 0);
+  CHECK_EQ(r.stalls, 0);
+  // No step goes out more than a tick behind its time
+  CHECK(r.max_late <= 1);
+  CHECK_NEAR(TICKS_TO_US(r.end) / 1000, path.end_t.toDouble(), 2);
+}
+
+TEST_CASE(starved_producer_is_covered_by_the_isr) {
+  // Main loop passes 20 ms apart are far too slow for 40 kHz
+  const Timeline tl = { 20000, 0, 1 };
+  const Path path = zigzag(700, 20000);
+  const Replay r = replay(path, tl);
+  CHECK(r.underruns > 0);
+  for (uint8_t i = 0; i < AXIS_SIZE; i++) CHECK_EQ(axisManager.current_steps[i], target_steps(path, i));
+}
+
+/**
+ * Host time of the two halves: getNextStepBundle() with the queues kept
+ * ahead, in batches short enough that no axis runs dry, and the producer.
+ */
+struct Cost { double isr_ns, steps_per_entry, fill_ns; uint32_t underruns; };
+
+static Cost step_cost(const Path &path) {
+  start(path);
+  uint32_t entries = 0, steps = 0;
+  double isr_ns = 0, fill_ns = 0;
+  AxisStepper st;
+  while (!all_done(path)) {
+    feed(path);
+    host_clock::time_point t0 = host_clock::now();
+    axisManager.fillAxisSteppers();
+    fill_ns += elapsed_ns(t0);
+    t0 = host_clock::now();
+    for (int n = 0; n < 32 && axisManager.getNextStepBundle(&st); n++, entries++)
+      for (uint8_t i = 0; i < AXIS_SIZE; i++) steps += TEST(st.axis_bits, i);
+    isr_ns += elapsed_ns(t0);
+  }
+  const Cost c = { isr_ns / entries, double(steps) / entries, fill_ns / steps, (uint32_t)axisManager.counts[SHAPER_DBG_STEP_UNDERRUN] };
+  return c;
+}
+
+/**
+ * Step rate benchmark. The X step rate of the cruise is raised until the
+ * producer no longer keeps the queues ahead of the ISR, the last rate where
+ * the ISR calculated no step itself is the sustainable one.
+ */
+TEST_CASE(sustainable_step_rate_benchmark) {
+  const Timeline timelines[] = {
+    every_ms,
+    { 1000, 5000, 50 },
+    { 2000, 10000, 25 },
+  };
+  printf("zigzag at 45 deg, 150 mm, 50000 mm/s^2, budget %d steps/axis/pass, %d moves x %d steps queued\n",
+         AXIS_STEPPER_FILL_BUDGET, STEP_MOVE_QUEUE_SIZE, STEP_PENDING_SIZE);
+  printf("  main loop              | sustainable X rate\n");
+  for (const Timeline &tl : timelines) {
+    uint32_t best_khz = 0;
+    for (uint32_t khz = 10; khz <= 200; khz += 10) {
+      const Path path = zigzag(khz * 1000 / steps_per_mm[X_AXIS] * 1.4142f, 50000);
+      const Replay r = replay(path, tl);
+      for (uint8_t i = 0; i < AXIS_SIZE; i++) CHECK_EQ(axisManager.current_steps[i], target_steps(path, i));
+      if (r.underruns || r.stalls) break;
+      best_khz = khz;
+    }
+    printf("  %2.0f ms, %2.0f ms hiccups  | %4d kHz\n", tl.loop_us / 1000.0f, tl.hiccup_us / 1000.0f, int(best_khz));
+    // The budget of a pass every ms is 64 steps per axis
+    if (!tl.hiccup_us) CHECK(best_khz >= 50);
+    else CHECK(best_khz >= 20);
+  }
+
+  const Cost c = step_cost(zigzag(300, 5000, 20));
+  printf("host time at 300 mm/s: ISR %.1f ns/entry, %.2f steps/entry, producer %.1f ns/step\n",
+         c.isr_ns, c.steps_per_entry, c.fill_ns);
+  CHECK_EQ(c.underruns, 0);
+}
+
+// The steps the FuncManagers give, timed as the producer times them, before compression
+static void raw_steps(const Path &path, steps_t raw[AXIS_SIZE]) {
+  start(path);
+  for (;;) {
+    feed(path);
+    bool more = fed < path.moves.size();
+    for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+      Axis &ax = axisManager.axis[i];
+      for (int n = 0; n < 64 && ax.getNextStep(); n++, more = true)
+        raw[i].push_back({ AxisManager::timeToTicks(ax.print_time), ax.dir });
+    }
+    if (!more) break;
+  }
+}
+
+struct Compression { double ratio; uint32_t moves, steps, max_err; };
+
+/**
+ * Replays path with every step recorded, with the merge window closed so
+ * each step keeps its own time, and checks it against the raw steps: the
+ * same count and directions on every axis, each within the allowed error.
+ */
+static Compression compression(const Path &path) {
+  steps_t raw[AXIS_SIZE];
+  raw_steps(path, raw);
+  axisManager.step_merge_ticks = 0;
+  const Replay r = replay(path, every_ms, true);
+  axisManager.step_merge_ticks = STEP_MERGE_WINDOW_US * STEPPER_TIMER_TICKS_PER_US;
+
+  uint32_t max_err = 0;
+  for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+    CHECK_EQ(r.record[i].size(), raw[i].size());
+    CHECK_EQ(axisManager.current_steps[i], target_steps(path, i));
+    for (size_t k = 0; k < _MIN(r.record[i].size(), raw[i].size()); k++) {
+      CHECK_EQ(r.record[i][k].dir, raw[i][k].dir);
+      NOLESS(max_err, (uint32_t)ABS((int32_t)(r.record[i][k].time - raw[i][k].time)));
+    }
+  }
+  // The counter the firmware reports agrees
+  CHECK_EQ(max_err, axisManager.counts[SHAPER_DBG_STEP_MAX_ERR]);
+  const Compression c = { double(axisManager.counts[SHAPER_DBG_STEP_COUNT]) / axisManager.counts[SHAPER_DBG_STEP_MOVES],
+                          (uint32_t)axisManager.counts[SHAPER_DBG_STEP_MOVES], (uint32_t)axisManager.counts[SHAPER_DBG_STEP_COUNT], max_err };
+  return c;
+}
+
+// Perimeters and infill of short segments, like sliced G-code
+static Path dense(const float speed, const float accel) {
+  Path path;
+  for (int k = 0; k < 400; k++) {
+    const float a = k * 0.21f, r = 30 + 10 * sinf(k * 0.05f);
+    path.line({ 100 + r * cosf(a), 100 + r * sinf(a), 0.2f, path.pos[E_AXIS] + 0.03f }, 30, speed, 30, accel);
+  }
+  return path;
+}
+
+TEST_CASE(compression_benchmark) {
+  struct Profile { const char *name; Path path; };
+  const Profile profiles[] = {
+    { "long lines 300 mm/s  ", zigzag(300, 5000) },
+    { "long lines  50 mm/s  ", zigzag(50, 1000) },
+    { "accel 20000, 150 mm/s", zigzag(150, 20000, 8, 20) },
+    { "dense arcs 200 mm/s  ", dense(200, 8000) },
+    { "dense arcs  60 mm/s  ", dense(60, 3000) },
+  };
+  printf("compression within %d ticks (%.2f us), %d byte moves against %d byte raw steps\n",
+         STEP_COMPRESS_MAX_ERR, TICKS_TO_US(STEP_COMPRESS_MAX_ERR), int(sizeof(step_move_t)), int(sizeof(step_time_t)));
+  printf("  profile               |   steps   moves  steps/move  queue bytes/step | max error\n");
+  for (const Profile &p : profiles) {
+    const Compression c = compression(p.path);
+    printf("  %s | %7d %7d  %8.1f     %8.2f         | %d ticks\n", p.name, int(c.steps), int(c.moves), c.ratio,
+           double(c.moves * sizeof(step_move_t)) / c.steps, int(c.max_err));
+    CHECK(c.max_err <= STEP_COMPRESS_MAX_ERR);
+    CHECK(c.ratio > 1);
+  }
+}
+
+/**
+ * Pulse phases against the merge window (M593 W). The steps of each axis
+ * are compared with their own times from a replay with the window closed:
+ * a merged step goes out early by at most the window, never late.
+ */
+TEST_CASE(merge_window_benchmark) {
+  Path path = dense(200, 8000);
+  const Path lines = zigzag(250, 5000, 6);
+  path.line({ 0, 0, 0.2f, path.pos[E_AXIS] }, 0, 250, 0, 5000);
+  for (const Move &m : lines.moves) {
+    Move n = m;
+    n.start_t = path.end_t;
+    path.end_t += m.t;
+    n.end_t = path.end_t;
+    for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+      n.start_pos[i] += path.pos[i] * steps_per_mm[i];
+      n.end_pos[i] += path.pos[i] * steps_per_mm[i];
+    }
+    n.start_pos_e = n.start_pos[E_AXIS];
+    n.end_pos_e = n.end_pos[E_AXIS];
+    path.moves.push_back(n);
+  }
+  for (uint8_t i = 0; i < AXIS_SIZE; i++) path.pos[i] += lines.pos[i];
+
+  axisManager.step_merge_ticks = 0;
+  const Replay own = replay(path, every_ms, true);
+  const double seconds = TICKS_TO_US(own.end) / 1e6;
+
+  printf("dense arcs and long lines, %.1f s\n", seconds);
+  printf("  window | ISR entries/s  vs closed | merged steps | max advance  mean advance\n");
+  for (uint32_t us : { 0, 1, 2, 5, 10, 20 }) {
+    axisManager.step_merge_ticks = us * STEPPER_TIMER_TICKS_PER_US;
+    const Replay r = replay(path, every_ms, true);
+    uint32_t max_adv = 0, merged = 0, steps = 0;
+    double sum_adv = 0;
+    bool late = false;
+    for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+      CHECK_EQ(r.record[i].size(), own.record[i].size());
+      CHECK_EQ(axisManager.current_steps[i], target_steps(path, i));
+      for (size_t k = 0; k < _MIN(r.record[i].size(), own.record[i].size()); k++) {
+        const int32_t adv = (int32_t)(own.record[i][k].time - r.record[i][k].time);
+        late |= adv < 0;
+        if (adv > 0) merged++;
+        NOLESS(max_adv, (uint32_t)_MAX(adv, 0));
+        sum_adv += _MAX(adv, 0);
+        steps++;
+      }
+    }
+    CHECK(!late);
+    CHECK(max_adv <= axisManager.step_merge_ticks);
+    CHECK_EQ(max_adv, axisManager.counts[SHAPER_DBG_STEP_MAX_JITTER]);
+    printf("  %3d us | %10.0f     %5.1f%%   | %6.1f%%      | %5.2f us     %5.3f us\n", int(us), r.bundles / seconds,
+           100.0 * r.bundles / own.bundles, 100.0 * merged / steps, TICKS_TO_US(max_adv), TICKS_TO_US(sum_adv / steps));
+  }
+  axisManager.step_merge_ticks = STEP_MERGE_WINDOW_US * STEPPER_TIMER_TICKS_PER_US;
+}
+
+/**
+ * A pause held in place: the hold is asked for at hold_ms, if at all, the
+ * axes stand for stand_ms once it is drained and then resume. The steps are recorded
+ * at the time the ISR outputs them, the park steps tagged as such.
+ */
+struct HoldStep {
+  step_time_t time;
+  int8_t dir;
+  bool park;
+};
+typedef std::vector<HoldStep> hold_steps_t;
+
+struct Hold {
+  hold_steps_t record[AXIS_SIZE];
+  step_time_t held, resumed, end;
+};
+
+static Hold hold_replay(const Path &path, const float hold_ms, const float stand_ms, const int32_t park[AXIS_SIZE]) {
+  Hold h = Hold();
+  start(path);
+  step_time_t now = 0, next_fill = 0, next_isr = 0;
+  const step_time_t hold_at = US_TO_TICKS(hold_ms * 1000);
+  bool pending = false, park_bundle = false, asked = hold_ms < 0;
+  AxisStepper st;
+
+  for (;;) {
+    if (!STEP_TIME_BEFORE(next_isr, next_fill)) {
+      now = next_fill;
+      if (!asked && !STEP_TIME_BEFORE(now, hold_at)) {
+        for (uint8_t i = 0; i < AXIS_SIZE; i++) axisManager.setFeedHoldPark(i, park[i]);
+        axisManager.feedHold();
+        asked = true;
+      }
+      if (asked && !h.held && axisManager.isFeedHeld()) h.held = now;
+      if (h.held && !h.resumed && now - h.held >= US_TO_TICKS(stand_ms * 1000)) {
+        axisManager.feedResume();
+        h.resumed = now;
+      }
+      feed(path);
+      axisManager.fillAxisSteppers();
+      next_fill += US_TO_TICKS(1000);
+      continue;
+    }
+
+    now = next_isr;
+    if (pending) {
+      for (uint8_t i = 0; i < AXIS_SIZE; i++)
+        if (TEST(st.axis_bits, i)) h.record[i].push_back({ now, int8_t(TEST(st.dir_bits, i) ? -1 : 1), park_bundle });
+      h.end = now;
+    }
+    const uint32_t park_time = axisManager.feed_park_time;
+    pending = axisManager.getNextStepBundle(&st);
+    park_bundle = pending && axisManager.feed_park_time != park_time;
+
+    if (pending)
+      next_isr = now + st.delta_ticks;
+    else if (axisManager.step_stalled)
+      next_isr = now + (axisManager.feed_hold_drained ? FEED_HOLD_IDLE_TICKS : AXIS_STEPPER_STALL_TICKS);
+    else if (all_done(path) && (h.resumed || hold_ms < 0))
+      break;
+    else
+      next_isr = now + STEPPER_TIMER_TICKS_PER_MS;
+  }
+  return h;
+}
+
+// Speed of an axis in mm/s over bins of bin_ms, from the planned steps only
+static std::vector<float> speeds(const hold_steps_t &steps, const uint8_t i, const float bin_ms, const step_time_t end) {
+  std::vector<float> v(size_t(TICKS_TO_US(end) / 1000 / bin_ms) + 1, 0.0f);
+  for (const HoldStep &s : steps)
+    if (!s.park) v[size_t(TICKS_TO_US(s.time) / 1000 / bin_ms)] += s.dir / (steps_per_mm[i] * bin_ms / 1000);
+  return v;
+}
+
+TEST_CASE(pause_in_place_keeps_the_path) {
+  // Held in the cruise of a 45 degree line at 250 mm/s
+  const float speed = 250, accel = 5000, stand_ms = 300;
+  const Path path = zigzag(speed, accel, 2);
+  const int32_t park[AXIS_SIZE] = { 0, 0, (int32_t)LROUND(0.5f * steps_per_mm[Z_AXIS]), -(int32_t)LROUND(1.0f * steps_per_mm[E_AXIS]) };
+  const int32_t none[AXIS_SIZE] = { 0 };
+
+  axisManager.step_merge_ticks = 0;
+  const Hold plain = hold_replay(path, -1, 0, none);
+  const Hold h = hold_replay(path, 300, stand_ms, park);
+  axisManager.step_merge_ticks = STEP_MERGE_WINDOW_US * STEPPER_TIMER_TICKS_PER_US;
+  CHECK(h.held && h.resumed);
+
+  // The planned steps are the same steps, the park steps come in pairs
+  // that are back in place before the first planned step after the resume
+  for (uint8_t i = 0; i < AXIS_SIZE; i++) {
+    CHECK_EQ(axisManager.current_steps[i], target_steps(path, i));
+    size_t k = 0;
+    int32_t away = 0, farthest = 0;
+    for (const HoldStep &s : h.record[i]) {
+      if (s.park) {
+        away += s.dir;
+        if (ABS(away) > ABS(farthest)) farthest = away;
+        continue;
+      }
+      if (k < plain.record[i].size()) CHECK_EQ(s.dir, plain.record[i][k].dir);
+      if (away) {
+        CHECK_EQ(away, 0);
+        away = 0;
+      }
+      k++;
+    }
+    CHECK_EQ(k, plain.record[i].size());
+    CHECK_EQ(farthest, park[i]);
+  }
+
+  // The ramps add FEED_HOLD_RAMP_MS, the park two FEED_HOLD_PARK_MS
+  const double added_ms = TICKS_TO_US(h.end - plain.end) / 1000, stood_ms = TICKS_TO_US(h.resumed - h.held) / 1000;
+  CHECK_NEAR(added_ms, FEED_HOLD_RAMP_MS + stood_ms + 2 * FEED_HOLD_PARK_MS, 3);
+
+  // X decelerates over the ramp at about v / FEED_HOLD_RAMP_MS, and never
+  // goes faster than it was planned to
+  const float bin_ms = 10, vx = speed * 0.7071f;
+  const std::vector<float> v = speeds(h.record[X_AXIS], X_AXIS, bin_ms, h.end),
+                           vp = speeds(plain.record[X_AXIS], X_AXIS, bin_ms, plain.end);
+  const size_t held = size_t(TICKS_TO_US(h.held) / 1000 / bin_ms), resumed = size_t(TICKS_TO_US(h.resumed) / 1000 / bin_ms);
+  const size_t ramp_bins = (FEED_HOLD_RAMP_MS + FEED_HOLD_PARK_MS) / bin_ms + 2;
+  float peak_dec = 0, peak_acc = 0, vmax = 0, vmax_plain = 0;
+  for (size_t b = 1; b < v.size(); b++) {
+    const float a = (ABS(v[b]) - ABS(v[b - 1])) / (bin_ms / 1000);
+    if (b + ramp_bins > held && b <= held) NOLESS(peak_dec, -a);
+    if (b > resumed && b < resumed + ramp_bins) NOLESS(peak_acc, a);
+    NOLESS(vmax, ABS(v[b]));
+  }
+  for (const float s : vp) NOLESS(vmax_plain, ABS(s));
+  for (size_t b = held + 1; b < resumed; b++) CHECK_EQ(v[b], 0);
+  // The hold starts after the steps already calculated on every axis
+  step_time_t slowed = 0;
+  for (size_t k = 0, n = 0; k < h.record[X_AXIS].size() && !slowed; k++)
+    if (!h.record[X_AXIS][k].park && h.record[X_AXIS][k].time != plain.record[X_AXIS][n++].time) slowed = h.record[X_AXIS][k].time;
+  const float ramp_acc = vx / (FEED_HOLD_RAMP_MS / 1000.0f);
+  printf("pause at %.0f mm/s, X %.0f mm/s: peak deceleration %.0f mm/s^2, peak acceleration on resume %.0f mm/s^2,"
+         " ramp %.0f mm/s^2, planned %.0f mm/s^2\n", speed, vx, peak_dec, peak_acc, ramp_acc, accel * 0.7071f);
+  printf("  slows down %.0f ms after the request, stood %.0f ms, print time %.0f ms longer, Z hop %d steps, E retract %d steps\n",
+         TICKS_TO_US(slowed) / 1000 - 300, stood_ms, added_ms, int(park[Z_AXIS]), int(-park[E_AXIS]));
+  CHECK_NEAR(peak_dec, ramp_acc, 0.2f * ramp_acc);
+  CHECK_NEAR(peak_acc, ramp_acc, 0.2f * ramp_acc);
+  CHECK(vmax <= vmax_plain + 1);
+}
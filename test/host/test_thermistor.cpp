@@ -0,0 +1,98 @@
+/*
+ * The uniform-index thermistor tables against the bisection lookup they
+ * replaced, over every raw value of the hotend and bed sensors.
+ */
+#include "test.h"
+#include "src/inc/MarlinConfig.h"
+#include "src/module/thermistor/thermistors.h"
+#include "src/module/thermistor/thermistor_uniform.h"
+
+// The SCAN_THERMISTOR_TABLE body before the uniform tables
+static float bisect_celsius(const temp_entry_t *tbl, const uint8_t len, const int32_t raw) {
+  uint8_t l = 0, r = len, m;
+  for (;;) {
+    m = (l + r) >> 1;
+    if (!m) return celsius_t(tbl[0].celsius);
+    if (m == l || m == r) return celsius_t(tbl[len - 1].celsius);
+    const int32_t v00 = tbl[m - 1].value, v10 = tbl[m].value;
+         if (raw < v00) r = m;
+    else if (raw > v10) l = m;
+    else {
+      const celsius_t v01 = tbl[m - 1].celsius, v11 = tbl[m].celsius;
+      return v01 + (raw - v00) * float(v11 - v01) / float(v10 - v00);
+    }
+  }
+}
+
+#define UNIFORM(TBL) uniform_tt<TBL, TBL##_LEN>::table
+
+// Within margin of a segment where the table value goes backwards
+static bool in_reversal(const temp_entry_t *tbl, const uint8_t len, const int32_t raw, const int32_t margin) {
+  for (uint8_t i = 1; i < len; i++)
+    if (tbl[i].value <= tbl[i - 1].value
+        && raw >= tbl[i].value - margin && raw <= tbl[i - 1].value + margin)
+      return true;
+  return false;
+}
+
+TEST_CASE(bed_table_within_quarter_degree) {
+  for (int32_t raw = 0; raw <= MAX_RAW_THERMISTOR_VALUE; raw++) {
+    const float expect = bisect_celsius(TEMPTABLE_BED, TEMPTABLE_BED_LEN, raw);
+    if (!WITHIN(expect, 10, 150)) continue;
+    CHECK_NEAR(uniform_tt_to_celsius(UNIFORM(TEMPTABLE_BED), raw), expect, 0.25);
+  }
+}
+
+TEST_CASE(hotend_table_within_quarter_degree) {
+  // Around the non-monotonic pair the old lookup jumped, the new one ramps
+  const int32_t margin = _BV(UNIFORM_TT_SHIFT);
+  for (int32_t raw = 0; raw <= MAX_RAW_THERMISTOR_VALUE; raw++) {
+    const float expect = bisect_celsius(TEMPTABLE_0, TEMPTABLE_0_LEN, raw);
+    if (expect < 10 || in_reversal(TEMPTABLE_0, TEMPTABLE_0_LEN, raw, margin)) continue;
+    CHECK_NEAR(uniform_tt_to_celsius(UNIFORM(TEMPTABLE_0), raw), expect, 0.25);
+  }
+}
+
+TEST_CASE(entries_hit_source_points) {
+  // Where a source point falls on an entry the stored value is exact to its rounding
+  for (uint8_t i = 0; i < TEMPTABLE_BED_LEN; i++) {
+    const temp_entry_t &e = TEMPTABLE_BED[i];
+    if ((e.value & (_BV(UNIFORM_TT_SHIFT) - 1)) || !WITHIN(e.value, 0, MAX_RAW_THERMISTOR_VALUE)) continue;
+    CHECK_NEAR(uniform_tt_to_celsius(UNIFORM(TEMPTABLE_BED), e.value), e.celsius, 0.5 / _BV(UNIFORM_TT_FRAC));
+  }
+}
+
+TEST_CASE(clamps_out_of_range_raw) {
+  CHECK_EQ(uniform_tt_to_celsius(UNIFORM(TEMPTABLE_BED), -100), uniform_tt_to_celsius(UNIFORM(TEMPTABLE_BED), 0));
+  CHECK_EQ(uniform_tt_to_celsius(UNIFORM(TEMPTABLE_BED), MAX_RAW_THERMISTOR_VALUE + 100),
+           uniform_tt_to_celsius(UNIFORM(TEMPTABLE_BED), MAX_RAW_THERMISTOR_VALUE));
+  CHECK_NEAR(uniform_tt_to_celsius(UNIFORM(TEMPTABLE_0), MAX_RAW_THERMISTOR_VALUE),
+             bisect_celsius(TEMPTABLE_0, TEMPTABLE_0_LEN, MAX_RAW_THERMISTOR_VALUE), 1.0);
+}
+
+// Steepest slope of the source table, in degrees per raw value
+static float max_slope(const temp_entry_t *tbl, const uint8_t len) {
+  float m = 0;
+  for (uint8_t i = 1; i < len; i++)
+    if (tbl[i].value != tbl[i - 1].value)
+      NOLESS(m, fabs(float(tbl[i].celsius - tbl[i - 1].celsius) / (tbl[i].value - tbl[i - 1].value)));
+  return m;
+}
+
+template<const temp_entry_t *TBL, uint8_t LEN>
+static void check_continuous() {
+  // Neighbouring raw values never step further than the source table does.
+  // Below 0C table 25 jumps from -30C at a single raw value, which now ramps.
+  const float limit = max_slope(TBL, LEN) + 1.0f / _BV(UNIFORM_TT_FRAC);
+  float last = uniform_tt_to_celsius(uniform_tt<TBL, LEN>::table, 0);
+  for (int32_t raw = 1; raw <= MAX_RAW_THERMISTOR_VALUE; raw++) {
+    const float c = uniform_tt_to_celsius(uniform_tt<TBL, LEN>::table, raw);
+    if (c > 0 && last > 0) CHECK(fabs(c - last) <= limit);
+    last = c;
+  }
+}
+
+TEST_CASE(conversion_is_continuous) {
+  check_continuous<TEMPTABLE_0, TEMPTABLE_0_LEN>();
+  check_continuous<TEMPTABLE_BED, TEMPTABLE_BED_LEN>();
+}
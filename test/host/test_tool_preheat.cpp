@@ -0,0 +1,186 @@
+/*
+ * Time lost waiting for the nozzle at IDEX tool changes, with and without
+ * the preheat scan. A full-control print alternates tools every layer; the
+ * HMI keeps the staged gcode buffer full, the printer runs the lines in
+ * real time and two simulated hotends heat at full power toward their
+ * targets. ToolPreheat::loop() runs on its own interval, as from the main
+ * loop, and sees only what is buffered.
+ */
+#include <string>
+#include "test.h"
+#include "src/inc/MarlinConfig.h"
+#include "src/MarlinCore.h"
+#include "src/lcd/marlinui.h"
+#include "src/module/motion.h"
+#include "src/module/planner.h"
+#include "src/module/temperature.h"
+#include "src/gcode/queue.h"
+#include "snapmaker/module/print_control.h"
+#include "snapmaker/module/power_loss.h"
+#include "snapmaker/module/system.h"
+#include "snapmaker/module/tool_preheat.h"
+
+// What queue.cpp reaches outside of the ring buffer
+PGMSTR(M112_KILL_STR, "M112 Shutdown");
+MarlinState marlin_state = MF_RUNNING;
+bool wait_for_heatup = true;
+void kill(PGM_P const, PGM_P const, const bool) {}
+void quickstop_stepper() {}
+void MarlinUI::set_status_P(PGM_P const, const int8_t) {}
+bool relative_mode;
+feedRate_t feedrate_mm_s = MMM_TO_MMS(1500);
+int16_t feedrate_percentage = 100;
+
+#define PRINT_TEMP   220
+#define STANDBY_TEMP 170
+#define FEED_MM_S     60
+#define SIM_STEP_MS   10
+
+/**
+ * A hotend heating at full power toward its target and losing heat to the
+ * air, read through a sensor that lags the block. The block is 8% heavier,
+ * the heater 5% weaker and the sensor 10% slower than the constants
+ * heat_time_ms() uses.
+ */
+struct Nozzle {
+  float block = PRINT_TEMP, sensor = PRINT_TEMP;
+  void step(const celsius_t target, const MPC_t &c, const float dt) {
+    const float loss = (block - 25) * c.ambient_xfer_coeff_fan0;
+    const float power = sensor < target ? c.heater_power * 0.95f : (sensor - target < 0.5f ? loss : 0);
+    block += (power - loss) * dt / (c.block_heat_capacity * 1.08f);
+    sensor += (block - sensor) * c.sensor_responsiveness * 0.9f * dt;
+  }
+};
+
+struct Result { int changes; float wait_s, hot_idle_s, print_s; };
+
+// Layers of moves of segment_mm, each printed by the other tool
+static std::string make_print(const float segment_mm, const int layers, const int moves) {
+  std::string g = "G90\nM104 T1 S" STRINGIFY(STANDBY_TEMP) "\nG1 X10 Y10 F" STRINGIFY(FEED_MM_S) "00\n";
+  char line[64];
+  float x = 10;
+  for (int l = 0; l < layers; l++) {
+    const int t = l & 1;
+    if (l) {
+      sprintf(line, "M104 T%d S%d\nT%d\nM109 T%d S%d\n", !t, STANDBY_TEMP, t, t, PRINT_TEMP);
+      g += line;
+    }
+    for (int m = 0; m < moves; m++) {
+      x = x > 150 ? 10 : x + segment_mm;
+      sprintf(line, "G1 X%.2f Y%.2f E%.4f\n", x, 10.0f + (m & 1), segment_mm * 0.033f);
+      g += line;
+    }
+  }
+  return g;
+}
+
+static Result run(const std::string &print, const bool preheat) {
+  system_service.set_status(SYSTEM_STATUE_PRINTING);
+  print_control.clear_gcode_buf();
+  power_loss.line_number_sum = power_loss.next_req = 0;
+  dual_x_carriage_mode = DXC_FULL_CONTROL_MODE;
+  active_extruder = 0;
+  current_position.reset();
+  feedrate_mm_s = MMM_TO_MMS(1500);
+  host_millis = 0;
+  tool_preheat = ToolPreheat();
+
+  MPC_t c;
+  c.heater_power = 40.0f; c.block_heat_capacity = 16.7f; c.sensor_responsiveness = 0.22f;
+  c.ambient_xfer_coeff_fan0 = 0.068f; c.fan255_adjustment = 0.029f; c.filament_heat_capacity_permm = 5.6e-3f;
+  Nozzle nozzle[EXTRUDERS];
+  LOOP_L_N(e, EXTRUDERS) {
+    thermalManager.temp_hotend[e].constants = c;
+    thermalManager.temp_hotend[e].modeled_block_temp = NAN;
+    thermalManager.temp_hotend[e].target = PRINT_TEMP;
+  }
+
+  Result r = { 0, 0, 0, 0 };
+  size_t sent = 0;
+  uint32_t busy_until = 0;
+  float busy_ms = 0;
+  bool done = false;
+  int8_t waiting = -1;
+  celsius_t wait_temp = 0;
+  for (;;) {
+    // The HMI sends the next lines whenever they fit
+    while (sent < print.size()) {
+      const size_t end = print.find('\n', sent) + 1;
+      if (print_control.get_buf_used() + (end - sent) >= 2048 - 1) break;
+      const uint32_t start = power_loss.next_req;
+      print_control.push_gcode(start, start, (uint8_t *)&print[sent], end - sent);
+      sent = end;
+    }
+
+    if (preheat) tool_preheat.loop();
+
+    const float dt = SIM_STEP_MS / 1000.0f;
+    LOOP_L_N(e, EXTRUDERS) {
+      hotend_info_t &he = thermalManager.temp_hotend[e];
+      nozzle[e].step(he.target, c, dt);
+      he.celsius = nozzle[e].sensor;
+      // Heated for printing while parked and the other tool prints, oozing
+      if (e != active_extruder && he.target >= PRINT_TEMP && he.celsius >= PRINT_TEMP - TEMP_WINDOW && waiting < 0) r.hot_idle_s += dt;
+    }
+
+    if (waiting >= 0) {
+      if (thermalManager.degHotend(waiting) >= wait_temp - TEMP_WINDOW) {
+        waiting = -1;
+        busy_ms = host_millis;
+      }
+      else r.wait_s += dt;
+    }
+    else while (!PENDING(host_millis, busy_until) && waiting < 0) {
+      uint8_t cmd[MAX_CMD_SIZE];
+      uint32_t line;
+      if (!print_control.get_commands(cmd, line, sizeof(cmd))) { done = true; break; }
+      const char *l = (const char *)cmd;
+      float v;
+      if (l[0] == 'T') {
+        active_extruder = atoi(l + 1);
+        r.changes++;
+      }
+      else if (!strncmp(l, "M104", 4) || !strncmp(l, "M109", 4)) {
+        const uint8_t e = gcode_word(l, 'T', v) ? uint8_t(v) : active_extruder;
+        gcode_word(l, 'S', v);
+        thermalManager.setTargetHotend(celsius_t(v), e);
+        if (l[3] == '9') { waiting = e; wait_temp = celsius_t(v); }
+      }
+      else if (!strncmp(l, "G1", 2)) {
+        xy_pos_t to = current_position;
+        if (gcode_word(l, 'X', v)) to.x = v;
+        if (gcode_word(l, 'Y', v)) to.y = v;
+        if (gcode_word(l, 'F', v)) feedrate_mm_s = MMM_TO_MMS(v);
+        busy_ms += (to - xy_pos_t(current_position)).magnitude() * 1000 / feedrate_mm_s;
+        busy_until = LROUND(busy_ms);
+        current_position.set(to.x, to.y);
+      }
+    }
+    if (done) break;
+    host_millis += SIM_STEP_MS;
+  }
+  r.print_s = host_millis / 1000.0f;
+  return r;
+}
+
+TEST_CASE(tool_changes_wait_less) {
+  printf("Full-control print, a tool change every layer, %d C printing and %d C standby at %d mm/s\n",
+         PRINT_TEMP, STANDBY_TEMP, FEED_MM_S);
+  printf("  segment |      | changes  wait at changes  parked at %d C  print time\n", PRINT_TEMP);
+  const float segments[] = { 2, 10, 40 };
+  for (const float seg : segments) {
+    const std::string print = make_print(seg, 5, int(60 * FEED_MM_S / seg));   // a minute a layer
+    const Result off = run(print, false), on = run(print, true);
+    printf("  %4.0f mm | off  |   %d      %6.1f s        %6.1f s       %6.1f s\n", seg, off.changes, off.wait_s, off.hot_idle_s, off.print_s);
+    printf("          | on   |   %d      %6.1f s        %6.1f s       %6.1f s\n", on.changes, on.wait_s, on.hot_idle_s, on.print_s);
+
+    CHECK_EQ(on.changes, 4);
+    CHECK_EQ(off.changes, on.changes);
+    // Preheating never makes a change wait longer, and it does not park a
+    // nozzle hot for longer than the margin and one scan per change
+    CHECK(on.wait_s <= off.wait_s);
+    CHECK(on.hot_idle_s - off.hot_idle_s <= on.changes * (TOOL_PREHEAT_MARGIN_MS + TOOL_PREHEAT_SCAN_INTERVAL_MS) / 1000.0f);
+    // Sparse gcode puts the change within the buffer early enough to hide the heat-up
+    if (seg >= 40) CHECK(on.wait_s < off.wait_s / 4);
+  }
+}
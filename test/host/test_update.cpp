@@ -0,0 +1,284 @@
+/*
+ * Staged update with compressed frames: the frames gen_header.py --compress
+ * makes, fed to UpdateServer::stage_write_compressed() in packets and
+ * programmed into simulated flash, and the framing errors it must reject.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <initializer_list>
+#include "test.h"
+#include "src/inc/MarlinConfig.h"
+#include "snapmaker/module/update.h"
+#include "flash_stm32.h"
+
+// Written by gen_header.py: a 256 byte head, then the image (.pack) or
+// its frames (.pack.hs), each a little-endian length and a heatshrink stream
+#define PACK_HEAD_SIZE 256
+
+uint32_t update_calc_checksum(uint8_t *buffer, uint32_t length);
+
+typedef std::vector<uint8_t> bytes_t;
+
+struct Frame {
+  uint32_t offset;
+  bytes_t data;
+};
+
+static bytes_t read_file(const char *path) {
+  bytes_t out;
+  FILE *f = fopen(path, "rb");
+  if (!f) { printf("cannot open %s\n", path); exit(1); }
+  uint8_t buf[1024];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return out;
+}
+
+static update_packet_info_t head;
+static bytes_t image;
+static std::vector<Frame> frames;
+
+static void load() {
+  static bool loaded;
+  if (loaded) return;
+  loaded = true;
+  const bytes_t pack = read_file(UPDATE_IMAGE_PACK), hs = read_file(UPDATE_IMAGE_PACK ".hs");
+  memcpy(&head, hs.data(), sizeof(head));
+  image.assign(pack.begin() + PACK_HEAD_SIZE, pack.end());
+  for (size_t i = PACK_HEAD_SIZE; i < hs.size();) {
+    const uint16_t len = hs[i] | hs[i + 1] << 8;
+    i += 2;
+    frames.push_back({ uint32_t(frames.size() * UPDATE_STAGING_PAGE_SIZE), bytes_t(hs.begin() + i, hs.begin() + i + len) });
+    i += len;
+  }
+}
+
+// A server just out of reset, with the flash erased unless it survives the reset
+static UpdateServer& fresh_server(const bool erase=true) {
+  static UpdateServer server;
+  load();
+  if (erase && !host_flash_init()) { printf("cannot map flash at 0x%x\n", FLASH_BASE); exit(1); }
+  server = UpdateServer();
+  return server;
+}
+
+static update_packet_info_t *flash_info() { return (update_packet_info_t *)UPDATE_DATA_FLASH_ADDR; }
+
+// Send a frame in packets of at most chunk bytes, as the host does
+static ErrCode send_frame(UpdateServer &server, const Frame &fr, const size_t chunk, size_t len=SIZE_MAX) {
+  NOMORE(len, fr.data.size());
+  ErrCode ret = E_SUCCESS;
+  for (size_t pos = 0; pos < len && ret == E_SUCCESS; pos += chunk) {
+    bytes_t packet(fr.data.begin() + pos, fr.data.begin() + pos + _MIN(chunk, len - pos));
+    ret = server.stage_write_compressed(fr.offset, pos, packet.data(), packet.size());
+    server.stage_erase_ahead();
+  }
+  return ret;
+}
+
+static bool staged_matches(const uint32_t len) {
+  return memcmp((void *)UPDATE_STAGING_FLASH_ADDR, image.data(), len) == 0;
+}
+
+TEST_CASE(frames_decode_to_pages) {
+  load();
+  CHECK_EQ(head.app_length, image.size());
+  CHECK_EQ(frames.size(), (image.size() + UPDATE_STAGING_PAGE_SIZE - 1) / UPDATE_STAGING_PAGE_SIZE);
+  // The odd tail makes stage_finish() fold the last byte back
+  CHECK(image.size() % 2);
+}
+
+TEST_CASE(compressed_image_stages) {
+  for (size_t chunk : { size_t(1), size_t(7), size_t(200), size_t(4096) }) {
+    UpdateServer &server = fresh_server();
+    CHECK_EQ(server.stage_start(&head, 1, 2), E_SUCCESS);
+    CHECK_EQ(flash_info()->status_flag, UPDATE_STATUS_STAGING);
+    for (const Frame &fr : frames) CHECK_EQ(send_frame(server, fr, chunk), E_SUCCESS);
+    CHECK_EQ(server.stage_offset(), image.size());
+    CHECK_EQ(server.stage_finish(), E_SUCCESS);
+    CHECK(staged_matches(image.size()));
+    CHECK_EQ(flash_info()->status_flag, UPDATE_STATUS_STAGED);
+    CHECK_EQ(flash_info()->usart_num, 1);
+    CHECK_EQ(flash_info()->receiver_id, 2);
+    CHECK_EQ(host_flash_overwrites, 0);
+  }
+}
+
+TEST_CASE(short_frame_rejected_at_next) {
+  UpdateServer &server = fresh_server();
+  CHECK_EQ(server.stage_start(&head, 1, 2), E_SUCCESS);
+  CHECK_EQ(send_frame(server, frames[0], 64), E_SUCCESS);
+  // Cut short, the frame decodes less than its page but nothing is wrong yet
+  CHECK_EQ(send_frame(server, frames[1], 64, frames[1].data.size() - 40), E_SUCCESS);
+  CHECK(server.stage_offset() > frames[1].offset);
+  // The next frame finds it short and rewinds to its start
+  CHECK_EQ(send_frame(server, frames[2], 64), E_PARAM);
+  CHECK_EQ(server.stage_offset(), frames[1].offset);
+  // The host resends from the rewound page
+  for (size_t i = 1; i < frames.size(); i++) CHECK_EQ(send_frame(server, frames[i], 64), E_SUCCESS);
+  CHECK_EQ(server.stage_finish(), E_SUCCESS);
+  CHECK(staged_matches(image.size()));
+  CHECK_EQ(host_flash_overwrites, 0);
+}
+
+TEST_CASE(long_frame_rejected) {
+  UpdateServer &server = fresh_server();
+  CHECK_EQ(server.stage_start(&head, 1, 2), E_SUCCESS);
+  CHECK_EQ(send_frame(server, frames[0], 256), E_SUCCESS);
+
+  // Literals past the end of the page, in the same packet
+  Frame fr = frames[1];
+  fr.data.insert(fr.data.end(), 8, 0xFF);
+  CHECK_EQ(send_frame(server, fr, 8192), E_PARAM);
+  CHECK_EQ(server.stage_offset(), frames[1].offset);
+
+  // and in a packet after the frame completed
+  CHECK_EQ(send_frame(server, frames[1], 8192), E_SUCCESS);
+  const uint8_t extra[8] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+  CHECK_EQ(server.stage_write_compressed(frames[1].offset, frames[1].data.size(), (uint8_t *)extra, sizeof(extra)), E_PARAM);
+  CHECK_EQ(server.stage_offset(), frames[2].offset);
+
+  for (size_t i = 2; i < frames.size(); i++) CHECK_EQ(send_frame(server, frames[i], 256), E_SUCCESS);
+  CHECK_EQ(server.stage_finish(), E_SUCCESS);
+  CHECK(staged_matches(image.size()));
+}
+
+TEST_CASE(out_of_order_packets_rejected) {
+  UpdateServer &server = fresh_server();
+  uint8_t *data = (uint8_t *)frames[0].data.data();
+  CHECK_EQ(server.stage_write_compressed(0, 0, data, 16), E_INVALID_STATE);
+  CHECK_EQ(server.stage_start(&head, 1, 2), E_SUCCESS);
+  // A frame that does not start at the next page
+  CHECK_EQ(server.stage_write_compressed(frames[1].offset, 0, frames[1].data.data(), 16), E_PARAM);
+  CHECK_EQ(server.stage_write_compressed(100, 0, data, 16), E_PARAM);
+  CHECK_EQ(server.stage_write_compressed(0, 0, data, 16), E_SUCCESS);
+  // A gap and another frame's offset within the frame
+  CHECK_EQ(server.stage_write_compressed(0, 20, data + 20, 16), E_PARAM);
+  CHECK_EQ(server.stage_write_compressed(frames[1].offset, 16, data + 16, 16), E_PARAM);
+  // None of it broke the frame
+  bytes_t rest(frames[0].data.begin() + 16, frames[0].data.end());
+  CHECK_EQ(server.stage_write_compressed(0, 16, rest.data(), rest.size()), E_SUCCESS);
+  CHECK_EQ(server.stage_offset(), frames[1].offset);
+  CHECK(staged_matches(frames[1].offset));
+
+  // Starting a frame over drops what it had, the host then sends it whole
+  CHECK_EQ(server.stage_write_compressed(frames[1].offset, 0, frames[1].data.data(), 16), E_SUCCESS);
+  CHECK_EQ(server.stage_write_compressed(frames[1].offset, 0, frames[1].data.data(), 16), E_PARAM);
+  CHECK_EQ(server.stage_offset(), frames[1].offset);
+  CHECK_EQ(send_frame(server, frames[1], 1000), E_SUCCESS);
+  CHECK_EQ(server.stage_offset(), frames[2].offset);
+  CHECK(staged_matches(frames[2].offset));
+}
+
+TEST_CASE(resume_after_interruption) {
+  UpdateServer &server = fresh_server();
+  CHECK_EQ(server.stage_start(&head, 1, 2), E_SUCCESS);
+  CHECK_EQ(send_frame(server, frames[0], 300), E_SUCCESS);
+  CHECK_EQ(send_frame(server, frames[1], 300), E_SUCCESS);
+  CHECK_EQ(send_frame(server, frames[2], 300, 500), E_SUCCESS);
+
+  // Power lost, the flash keeps the status and the pages programmed so far
+  UpdateServer &again = fresh_server(false);
+  again.init();
+  CHECK_EQ(flash_info()->status_flag, UPDATE_STATUS_STAGING);
+  CHECK_EQ(again.stage_start(&head, 1, 2), E_SUCCESS);
+  // The partly programmed page is received again
+  CHECK_EQ(again.stage_offset(), frames[2].offset);
+  for (size_t i = 2; i < frames.size(); i++) CHECK_EQ(send_frame(again, frames[i], 300), E_SUCCESS);
+  CHECK_EQ(again.stage_finish(), E_SUCCESS);
+  CHECK(staged_matches(image.size()));
+  CHECK_EQ(host_flash_overwrites, 0);
+}
+
+TEST_CASE(other_image_restarts) {
+  UpdateServer &server = fresh_server();
+  CHECK_EQ(server.stage_start(&head, 1, 2), E_SUCCESS);
+  CHECK_EQ(send_frame(server, frames[0], 300), E_SUCCESS);
+  // A different image after the reset starts over, and fails its checksum
+  update_packet_info_t other = head;
+  other.app_checknum ^= 1;
+  other.pack_head_checknum = update_calc_checksum((uint8_t *)&other, sizeof(other) - sizeof(other.pack_head_checknum));
+  UpdateServer &again = fresh_server(false);
+  CHECK_EQ(again.stage_start(&other, 1, 2), E_SUCCESS);
+  CHECK_EQ(again.stage_offset(), 0);
+  for (const Frame &fr : frames) CHECK_EQ(send_frame(again, fr, 300), E_SUCCESS);
+  CHECK_EQ(again.stage_finish(), E_FAILURE);
+  CHECK_EQ(flash_info()->status_flag, UPDATE_STATUS_APP_NORMAL);
+}
+
+/**
+ * Transfer time over the 115200 baud HMI link. Each packet is a SACP frame
+ * answered by an ack before the host sends the next, and a packet's flash
+ * programming happens before its ack. Flash times are the F105 datasheet
+ * typicals, the figures for the GD32 part are of the same order.
+ */
+#define LINK_BYTES_PER_S  (115200 / 10)
+#define SACP_FRAME_BYTES  15  // SACP frame around a payload
+#define STAGE_ACK_BYTES   (SACP_FRAME_BYTES + 5)
+#define ERASE_PAGE_S      0.020
+#define PROGRAM_HALF_S    52.5e-6
+#define PACKET_DATA       512
+
+struct Transfer { uint32_t packets, wire_bytes; double link_s, flash_s; };
+
+static Transfer transfer(const bool compressed) {
+  UpdateServer &server = fresh_server();
+  CHECK_EQ(server.stage_start(&head, 1, 2), E_SUCCESS);
+  Transfer t = { 0, 0, 0, 0 };
+  const uint32_t header = compressed ? 8 : 6;   // update_stage_(compressed|data)_t
+  const auto packet = [&](const uint32_t length) {
+    t.packets++;
+    t.wire_bytes += SACP_FRAME_BYTES + header + length;
+    t.link_s += double(SACP_FRAME_BYTES + header + length + STAGE_ACK_BYTES) / LINK_BYTES_PER_S;
+  };
+  if (compressed) {
+    for (const Frame &fr : frames) {
+      for (size_t pos = 0; pos < fr.data.size(); pos += PACKET_DATA) {
+        const uint16_t len = _MIN(size_t(PACKET_DATA), fr.data.size() - pos);
+        CHECK_EQ(server.stage_write_compressed(fr.offset, pos, (uint8_t *)fr.data.data() + pos, len), E_SUCCESS);
+        server.stage_erase_ahead();
+        packet(len);
+      }
+    }
+  }
+  else {
+    for (uint32_t offset = 0; offset < image.size(); offset += PACKET_DATA) {
+      const uint16_t len = _MIN(size_t(PACKET_DATA), image.size() - offset);
+      CHECK_EQ(server.stage_write(offset, image.data() + offset, len), E_SUCCESS);
+      server.stage_erase_ahead();
+      packet(len);
+    }
+  }
+  CHECK_EQ(server.stage_finish(), E_SUCCESS);
+  CHECK(staged_matches(image.size()));
+  // Programming holds up the ack, the erase-ahead runs while the next packet is on the wire
+  t.flash_s = host_flash_erases * ERASE_PAGE_S + host_flash_halfwords * PROGRAM_HALF_S;
+  t.link_s += host_flash_halfwords * PROGRAM_HALF_S;
+  return t;
+}
+
+TEST_CASE(transfer_time) {
+  load();
+  const Transfer raw = transfer(false), hs = transfer(true);
+  // The bootloader erases and programs the application pages either way:
+  // during the whole transfer before, only for the swap when staging
+  const uint32_t app_pages = (image.size() + APP_FLASH_PAGE_SIZE - 1) / APP_FLASH_PAGE_SIZE;
+  const double swap_s = app_pages * ERASE_PAGE_S + (image.size() + 1) / 2 * PROGRAM_HALF_S;
+  const double boot_transfer_s = raw.link_s + app_pages * ERASE_PAGE_S;
+
+  printf("image %u bytes, %u byte packets at 115200 baud\n", unsigned(image.size()), PACKET_DATA);
+  printf("  raw staged:        %3u packets %6u bytes on the wire %6.2f s, flash busy %.2f s\n",
+         raw.packets, raw.wire_bytes, raw.link_s, raw.flash_s);
+  printf("  compressed staged: %3u packets %6u bytes on the wire %6.2f s, flash busy %.2f s\n",
+         hs.packets, hs.wire_bytes, hs.link_s, hs.flash_s);
+  printf("  printer unusable:  %.2f s through the bootloader, %.2f s for the staged swap\n",
+         boot_transfer_s, swap_s);
+  printf("  per 100 KB of image: %.1f s raw, %.1f s compressed (ratio of this image %.2f)\n",
+         raw.link_s * 102400 / image.size(), hs.link_s * 102400 / image.size(),
+         double(hs.wire_bytes) / raw.wire_bytes);
+
+  CHECK(hs.link_s < raw.link_s);
+  CHECK(swap_s < boot_transfer_s / 2);
+}
@@ -0,0 +1,295 @@
+/*
+ * ZMesh: the bilinear height lookup and the Z pieces addMoveFuncParams()
+ * adds for a Move, sampled against the mesh height along the path.
+ */
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <initializer_list>
+#include "test.h"
+#include "src/inc/MarlinConfig.h"
+#include "src/module/planner.h"
+#include "src/module/shaper/ZMesh.h"
+
+#define XY_STEPS  80.0f
+#define Z_STEPS   400.0f
+#define LEVELED_SEGMENT_MM  5.0f  // LEVELED_SEGMENT_LENGTH, leveling is off in Configuration.h
+
+static void setup_axes() {
+  planner.steps_to_mm[X_AXIS] = planner.steps_to_mm[Y_AXIS] = 1 / XY_STEPS;
+  planner.settings.axis_steps_per_mm[Z_AXIS] = Z_STEPS;
+}
+
+// A warped bed, not representable by the bilinear patches of a coarser grid
+static float bed_height(const uint8_t i, const uint8_t j) {
+  return 0.12f * sinf(i * 1.3f) - 0.08f * cosf(j * 0.9f) + 0.01f * i * j;
+}
+
+static void load_warped() {
+  for (uint8_t j = 0; j < Z_MESH_GRID_Y; j++)
+    for (uint8_t i = 0; i < Z_MESH_GRID_X; i++)
+      zMesh.z[j][i] = bed_height(i, j);
+  zMesh.valid = true;
+}
+
+TEST_CASE(getz_hits_grid_points) {
+  load_warped();
+  for (uint8_t j = 0; j < Z_MESH_GRID_Y; j++)
+    for (uint8_t i = 0; i < Z_MESH_GRID_X; i++)
+      CHECK_NEAR(zMesh.getZ(ZMesh::gridX(i), ZMesh::gridY(j)), bed_height(i, j), 1e-5);
+}
+
+TEST_CASE(getz_is_bilinear_in_a_cell) {
+  load_warped();
+  const float x = ZMesh::gridX(1) + 0.25f * Z_MESH_SPACING_X,
+              y = ZMesh::gridY(2) + 0.75f * Z_MESH_SPACING_Y,
+              z0 = 0.75f * zMesh.z[2][1] + 0.25f * zMesh.z[2][2],
+              z1 = 0.75f * zMesh.z[3][1] + 0.25f * zMesh.z[3][2];
+  CHECK_NEAR(zMesh.getZ(x, y), 0.25f * z0 + 0.75f * z1, 1e-5);
+}
+
+TEST_CASE(getz_reproduces_a_plane) {
+  for (uint8_t j = 0; j < Z_MESH_GRID_Y; j++)
+    for (uint8_t i = 0; i < Z_MESH_GRID_X; i++)
+      zMesh.z[j][i] = 0.1f + 0.002f * ZMesh::gridX(i) - 0.001f * ZMesh::gridY(j);
+  for (float x = Z_MESH_MIN_X; x <= X_BED_SIZE - Z_MESH_INSET; x += 7.3f)
+    for (float y = Z_MESH_MIN_Y; y <= Y_BED_SIZE - Z_MESH_INSET; y += 5.1f)
+      CHECK_NEAR(zMesh.getZ(x, y), 0.1f + 0.002f * x - 0.001f * y, 1e-5);
+}
+
+TEST_CASE(getz_extends_edges) {
+  load_warped();
+  CHECK_NEAR(zMesh.getZ(-50, -50), zMesh.z[0][0], 1e-6);
+  CHECK_NEAR(zMesh.getZ(X_BED_SIZE + 50, -50), zMesh.z[0][Z_MESH_GRID_X - 1], 1e-6);
+  CHECK_NEAR(zMesh.getZ(X_BED_SIZE + 50, Y_BED_SIZE + 50), zMesh.z[Z_MESH_GRID_Y - 1][Z_MESH_GRID_X - 1], 1e-6);
+  CHECK_NEAR(zMesh.getZ(ZMesh::gridX(2), -5), zMesh.z[0][2], 1e-6);
+}
+
+// XY move at Z z_mm, starting at speed v0 (mm/s) and accelerating at a (mm/s^2)
+static Move make_move(const float x0, const float y0, const float x1, const float y1, const float z_mm,
+                      const float v0, const float a, const time_double_t start_t) {
+  Move m;
+  memset(m.start_pos, 0, sizeof(m.start_pos));
+  memset(m.end_pos, 0, sizeof(m.end_pos));
+  memset(m.axis_r, 0, sizeof(m.axis_r));
+  m.start_pos[X_AXIS] = x0 * XY_STEPS; m.end_pos[X_AXIS] = x1 * XY_STEPS;
+  m.start_pos[Y_AXIS] = y0 * XY_STEPS; m.end_pos[Y_AXIS] = y1 * XY_STEPS;
+  m.start_pos[Z_AXIS] = m.end_pos[Z_AXIS] = z_mm * Z_STEPS;
+  m.mesh_origin[0] = m.mesh_origin[1] = 0;
+  m.distance = SQRT(sq(m.end_pos[X_AXIS] - m.start_pos[X_AXIS]) + sq(m.end_pos[Y_AXIS] - m.start_pos[Y_AXIS]));
+  m.axis_r[X_AXIS] = (m.end_pos[X_AXIS] - m.start_pos[X_AXIS]) / m.distance;
+  m.axis_r[Y_AXIS] = (m.end_pos[Y_AXIS] - m.start_pos[Y_AXIS]) / m.distance;
+  // Steps and ms
+  m.start_v = v0 * XY_STEPS / 1000;
+  m.accelerate = a * XY_STEPS / 1e6f;
+  m.t = IS_ZERO(m.accelerate) ? m.distance / m.start_v
+      : (SQRT(sq(m.start_v) + 2 * m.accelerate * m.distance) - m.start_v) / m.accelerate;
+  m.end_v = m.start_v + m.accelerate * m.t;
+  m.start_t = start_t;
+  m.end_t = start_t + m.t;
+  return m;
+}
+
+// Z the pieces should follow: the move's own Z plus the mesh below the nozzle
+static float expected_z(const Move &m, const float t, const float base) {
+  const float s = (m.start_v + 0.5f * m.accelerate * t) * t,
+              x = (m.start_pos[X_AXIS] + m.axis_r[X_AXIS] * s) / XY_STEPS,
+              y = (m.start_pos[Y_AXIS] + m.axis_r[Y_AXIS] * s) / XY_STEPS;
+  return m.start_pos[Z_AXIS] + zMesh.getZ(x, y) * Z_STEPS - base;
+}
+
+static float max_error(FuncManager &fm, const Move &m, const float base) {
+  float err = 0;
+  for (int k = 0; k <= 400; k++) {
+    const float t = m.t * k / 400;
+    NOLESS(err, ABS(fm.getPos(m.start_t + t) - expected_z(m, t, base)));
+  }
+  return err;
+}
+
+static FuncManager& fresh_z(const float z_steps) {
+  static FuncManager fm;
+  fm.init(Z_AXIS);
+  fm.reset();
+  fm.last_pos = z_steps;
+  return fm;
+}
+
+TEST_CASE(cruise_follows_mesh) {
+  setup_axes();
+  load_warped();
+  Move m = make_move(15, 20, 300, 170, 0.3f, 150, 0, 0);
+  FuncManager &fm = fresh_z(m.start_pos[Z_AXIS]);
+  float base = 0, last = 0;
+  zMesh.addMoveFuncParams(fm, m, base, last);
+
+  // Anchored on the start height, so Z does not jump when the move starts
+  CHECK_NEAR(fm.getPos(0), m.start_pos[Z_AXIS], 0.01);
+  // A quadratic per cell is exact at constant speed
+  CHECK(max_error(fm, m, base) < 0.05f);
+  // One piece per cell crossed, at least
+  CHECK(fm.getSize() >= 6);
+  CHECK_NEAR(last, zMesh.getZ(300, 170) * Z_STEPS - base, 0.01);
+}
+
+TEST_CASE(acceleration_follows_mesh) {
+  setup_axes();
+  load_warped();
+  Move m = make_move(300, 180, 20, 15, 0.2f, 5, 3000, 0);
+  FuncManager &fm = fresh_z(m.start_pos[Z_AXIS]);
+  float base = 0, last = 0;
+  zMesh.addMoveFuncParams(fm, m, base, last);
+  // Quartic in time within a cell, one step is 2.5um
+  CHECK(max_error(fm, m, base) < 1.0f);
+  CHECK_NEAR(fm.getPos(m.end_t), expected_z(m, m.t, base), 0.05);
+}
+
+TEST_CASE(moves_chain_without_jumps) {
+  setup_axes();
+  load_warped();
+  Move a = make_move(30, 30, 200, 60, 0.25f, 120, 0, 0),
+       b = make_move(200, 60, 100, 190, 0.25f, 120, 0, a.end_t);
+  FuncManager &fm = fresh_z(a.start_pos[Z_AXIS]);
+  float base = 0, last = 0;
+  zMesh.addMoveFuncParams(fm, a, base, last);
+  const float end_a = fm.getPos(a.end_t);
+  zMesh.addMoveFuncParams(fm, b, base, last);
+  CHECK_NEAR(fm.getPos(b.start_t), end_a, 0.01);
+  CHECK(max_error(fm, b, base) < 0.05f);
+}
+
+TEST_CASE(flat_offset_moves_nothing) {
+  // A bed uniformly off by 0.3mm changes nothing once anchored
+  setup_axes();
+  for (uint8_t j = 0; j < Z_MESH_GRID_Y; j++)
+    for (uint8_t i = 0; i < Z_MESH_GRID_X; i++)
+      zMesh.z[j][i] = 0.3f;
+  Move m = make_move(15, 20, 300, 170, 0.3f, 150, 0, 0);
+  FuncManager &fm = fresh_z(m.start_pos[Z_AXIS]);
+  float base = 0, last = 0;
+  zMesh.addMoveFuncParams(fm, m, base, last);
+  for (int k = 0; k <= 20; k++)
+    CHECK_NEAR(fm.getPos(m.t * k / 20), m.start_pos[Z_AXIS], 0.01);
+}
+
+TEST_CASE(mesh_is_valid_once_every_point_is_set) {
+  zMesh.reset();
+  CHECK_EQ(zMesh.missing(), Z_MESH_GRID_X * Z_MESH_GRID_Y);
+  for (uint8_t j = 0; j < Z_MESH_GRID_Y; j++)
+    for (uint8_t i = 0; i < Z_MESH_GRID_X; i++) {
+      CHECK(!zMesh.valid);
+      zMesh.setPoint(i, j, bed_height(i, j));
+    }
+  CHECK(zMesh.valid);
+  CHECK_EQ(zMesh.missing(), 0);
+  // Setting a point again keeps it valid
+  zMesh.setPoint(2, 2, 0.05f);
+  CHECK(zMesh.valid);
+
+  // A saved mesh is complete or dropped
+  zMesh.restore();
+  CHECK(zMesh.valid);
+  zMesh.valid = false;
+  zMesh.restore();
+  CHECK_EQ(zMesh.missing(), Z_MESH_GRID_X * Z_MESH_GRID_Y);
+}
+
+/**
+ * Planner blocks and Z error of a path with the mesh in the shaper, against
+ * segmented leveling: split at every inner grid line as bilinear leveling
+ * does, or every LEVELED_SEGMENT_MM with SEGMENT_LEVELED_MOVES. A
+ * segment moves Z in a straight line between the mesh heights at its ends.
+ */
+struct Leveled { int moves, pieces, at_lines, at_length; float mesh_err, lines_err, length_err; };
+
+static float segment_error(const xy_pos_t &a, const xy_pos_t &b) {
+  const float za = zMesh.getZ(a.x, a.y), zb = zMesh.getZ(b.x, b.y);
+  float err = 0;
+  for (int k = 1; k < 20; k++) {
+    const float f = k / 20.0f;
+    NOLESS(err, ABS(za + (zb - za) * f - zMesh.getZ(a.x + (b.x - a.x) * f, a.y + (b.y - a.y) * f)));
+  }
+  return err;
+}
+
+static Leveled level(const std::vector<xy_pos_t> &pts) {
+  Leveled l = { int(pts.size()) - 1, 0, 0, 0, 0, 0, 0 };
+  float base = 0, last = 0, z_end = 0.2f * Z_STEPS;
+  for (size_t k = 1; k < pts.size(); k++) {
+    const xy_pos_t a = pts[k - 1], b = pts[k], d = b - a;
+    // Every move on its own Z functions, chained by the anchor as in the pipeline
+    Move m = make_move(a.x, a.y, b.x, b.y, 0.2f, 150, 0, 0);
+    FuncManager &fm = fresh_z(z_end);
+    zMesh.addMoveFuncParams(fm, m, base, last);
+    l.pieces += fm.getSize();
+    NOLESS(l.mesh_err, max_error(fm, m, base) / Z_STEPS);
+    z_end = fm.getPos(m.end_t);
+
+    // Cut where the path crosses the inner grid lines
+    std::vector<float> cuts;
+    for (uint8_t g = 1; g < Z_MESH_GRID_X - 1; g++)
+      if (WITHIN(ZMesh::gridX(g), _MIN(a.x, b.x), _MAX(a.x, b.x)) && ZMesh::gridX(g) != a.x && ZMesh::gridX(g) != b.x)
+        cuts.push_back((ZMesh::gridX(g) - a.x) / d.x);
+    for (uint8_t g = 1; g < Z_MESH_GRID_Y - 1; g++)
+      if (WITHIN(ZMesh::gridY(g), _MIN(a.y, b.y), _MAX(a.y, b.y)) && ZMesh::gridY(g) != a.y && ZMesh::gridY(g) != b.y)
+        cuts.push_back((ZMesh::gridY(g) - a.y) / d.y);
+    std::sort(cuts.begin(), cuts.end());
+    cuts.push_back(1);
+    l.at_lines += cuts.size();
+    float f0 = 0;
+    for (const float f1 : cuts) {
+      NOLESS(l.lines_err, segment_error(a + d * f0, a + d * f1));
+      f0 = f1;
+    }
+
+    const int segs = _MAX(1, int(CEIL(d.magnitude() / (LEVELED_SEGMENT_MM))));
+    l.at_length += segs;
+    for (int s = 0; s < segs; s++) NOLESS(l.length_err, segment_error(a + d * (float(s) / segs), a + d * (float(s + 1) / segs)));
+  }
+  return l;
+}
+
+static void report(const char *name, const Leveled &l) {
+  printf("  %-20s | %5d  %5d  %6.1f um | %5d  %6.1f um | %5d  %6.1f um\n", name,
+         l.moves, l.pieces, l.mesh_err * 1000, l.at_lines, l.lines_err * 1000, l.at_length, l.length_err * 1000);
+}
+
+TEST_CASE(mesh_queues_fewer_blocks_than_segmented_leveling) {
+  setup_axes();
+  load_warped();
+  printf("Planner blocks on a %dx%d mesh, Z error against the bilinear surface\n", Z_MESH_GRID_X, Z_MESH_GRID_Y);
+  printf("  path                 | shaper mesh: blocks  Z pieces  error | grid lines: blocks  error | %.0f mm: blocks  error\n",
+         float(LEVELED_SEGMENT_MM));
+
+  // Infill at 45 degrees across the bed, lines x + y = c about 3.7 mm apart
+  std::vector<xy_pos_t> infill;
+  for (int k = 0; k < 100; k++) {
+    const float c = 40 + 5.2f * k, x0 = _MAX(10.0f, c - 290), x1 = _MIN(290.0f, c - 10);
+    xy_pos_t a = { x0, c - x0 }, b = { x1, c - x1 };
+    if (k & 1) std::swap(a, b);
+    infill.push_back(a);
+    infill.push_back(b);
+  }
+  const Leveled fill = level(infill);
+  report("45 degree infill", fill);
+
+  // Perimeters of small parts spread over the bed, 2 mm segments of circles
+  std::vector<xy_pos_t> small;
+  for (int part = 0; part < 9; part++) {
+    const xy_pos_t c = { 50.0f + 100 * (part % 3), 50.0f + 100 * (part / 3) };
+    for (int k = 0; k <= 60; k++) small.push_back({ c.x + 19 * cosf(k * float(M_PI) / 30), c.y + 19 * sinf(k * float(M_PI) / 30) });
+  }
+  const Leveled parts = level(small);
+  report("small perimeters", parts);
+
+  for (const Leveled *l : { &fill, &parts }) {
+    // One block a move, and Z as close to the surface as any segmenting
+    CHECK(l->moves < l->at_length);
+    CHECK(l->moves <= l->at_lines);
+    CHECK(l->mesh_err <= l->lines_err + 0.001f);
+    CHECK(l->mesh_err < 0.002f);
+  }
+  // Long moves are where the segments add up
+  CHECK(fill.at_length > 10 * fill.moves);
+  CHECK(fill.at_lines > fill.moves + fill.moves / 2);
+}